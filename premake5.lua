@@ -141,6 +141,41 @@ project "ProfileClientServer"
     links { "Core", "Network", "Protocol", "ClientServer" }
     targetdir "bin"
 
+project "ProfileClientLookup"
+    language "C++"
+    kind "ConsoleApp"
+    files { "tests/ClientServer/ProfileClientLookup.cpp" }
+    links { "Core", "Network", "Protocol", "ClientServer" }
+    targetdir "bin"
+
+project "ProfileSimulator"
+    language "C++"
+    kind "ConsoleApp"
+    files { "tests/Network/ProfileSimulator.cpp" }
+    links { "Core", "Network", "Protocol" }
+    targetdir "bin"
+
+project "ProfileSnapshot"
+    language "C++"
+    kind "ConsoleApp"
+    files { "tests/game/ProfileSnapshot.cpp" }
+    links { "Core", "Protocol" }
+    targetdir "bin"
+
+project "DictionaryTool"
+    language "C++"
+    kind "ConsoleApp"
+    files { "tools/Dictionary/*.cpp" }
+    links { "Core", "Network" }
+    targetdir "bin"
+
+project "DeltaTool"
+    language "C++"
+    kind "ConsoleApp"
+    files { "tools/Delta/*.cpp" }
+    links { "Core", "Network", "Protocol" }
+    targetdir "bin"
+
 --[[project "FontTool"
     language "C++"
     kind "ConsoleApp"
@@ -702,4 +737,49 @@ if not os.is "windows" then
         end
     }
 
+    newaction
+    {
+        trigger     = "profile_client_lookup",
+        description = "Build and run client lookup profile",
+        valid_kinds = premake.action.get("gmake").valid_kinds,
+        valid_languages = premake.action.get("gmake").valid_languages,
+        valid_tools = premake.action.get("gmake").valid_tools,
+     
+        execute = function ()
+            if os.execute "make -j4 ProfileClientLookup" == 0 then
+                os.execute "bin/ProfileClientLookup"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "profile_simulator",
+        description = "Build and run network simulator profile",
+        valid_kinds = premake.action.get("gmake").valid_kinds,
+        valid_languages = premake.action.get("gmake").valid_languages,
+        valid_tools = premake.action.get("gmake").valid_tools,
+     
+        execute = function ()
+            if os.execute "make -j4 ProfileSimulator" == 0 then
+                os.execute "bin/ProfileSimulator"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "profile_snapshot",
+        description = "Build and run snapshot quantization profile",
+        valid_kinds = premake.action.get("gmake").valid_kinds,
+        valid_languages = premake.action.get("gmake").valid_languages,
+        valid_tools = premake.action.get("gmake").valid_tools,
+     
+        execute = function ()
+            if os.execute "make -j4 ProfileSnapshot" == 0 then
+                os.execute "bin/ProfileSnapshot"
+            end
+        end
+    }
+
 end
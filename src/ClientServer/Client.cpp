@@ -61,6 +61,7 @@ namespace clientServer
         connectionConfig.maxPacketSize = m_config.networkInterface->GetMaxPacketSize();
         connectionConfig.channelStructure = m_config.channelStructure;
         connectionConfig.packetFactory = m_packetFactory;
+        connectionConfig.ackWindowSize = m_config.ackWindowSize;
         connectionConfig.context = m_context;
 
         m_connection = CORE_NEW( *m_allocator, protocol::Connection, connectionConfig );
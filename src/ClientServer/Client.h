@@ -73,6 +73,8 @@ namespace clientServer
         int fragmentSize = 1024;                                // send client data in 1k fragments by default. a good size given that MTU is typically 1200 bytes.
         int fragmentsPerSecond = 60;                            // number of fragment packets to send per-second. set pretty high because we want the data to get across quickly.
 
+        int ackWindowSize = 32;                                 // number of received packets acked per connection packet: 32, 64 or 128. see protocol::ConnectionConfig.
+
         network::Simulator * networkSimulator = nullptr;        // optional network simulator.
     };
 
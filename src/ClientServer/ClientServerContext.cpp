@@ -24,22 +24,88 @@
 
 #include "ClientServerContext.h"
 #include "core/Memory.h"
+#include "core/Hash.h"
 
 namespace clientServer
 {
+    static uint64_t hash_address( const network::Address & address )
+    {
+        uint64_t hash = address.GetPort();
+        if ( address.GetType() == network::ADDRESS_IPV4 )
+        {
+            const uint32_t address4 = address.GetAddress4();
+            hash = core::murmur_hash_64( &address4, sizeof( address4 ), hash );
+        }
+        else if ( address.GetType() == network::ADDRESS_IPV6 )
+        {
+            hash = core::murmur_hash_64( address.GetAddress6(), 8 * sizeof( uint16_t ), hash );
+        }
+        return hash;
+    }
+
+    static uint64_t hash_ids( uint16_t clientId, uint16_t serverId )
+    {
+        return ( uint64_t( clientId ) << 16 ) | serverId;
+    }
+
+    static void remove_index_entry( core::Hash<int> & index, uint64_t key, int clientIndex )
+    {
+        auto entry = core::multi_hash::find_first( index, key );
+        while ( entry )
+        {
+            if ( entry->value == clientIndex )
+            {
+                core::multi_hash::remove( index, entry );
+                return;
+            }
+            entry = core::multi_hash::find_next( index, entry );
+        }
+        CORE_ASSERT( !"client index entry not found" );
+    }
+
     void ClientServerContext::Initialize( core::Allocator & allocator, int _numClients )
     {
         CORE_ASSERT( _numClients > 0 );
         classId = ClientServerContext::ClassId;
         numClients = _numClients;
         clientInfo = (ClientInfo*) CORE_NEW_ARRAY( allocator, ClientInfo, numClients );
+
+        // IMPORTANT: reserve so the indices never grow at runtime. they hold at most one entry per client.
+
+        addressIndex = CORE_NEW( allocator, core::Hash<int>, allocator );
+        idIndex = CORE_NEW( allocator, core::Hash<int>, allocator );
+        core::hash::reserve( *addressIndex, numClients * 2 + 1 );
+        core::hash::reserve( *idIndex, numClients * 2 + 1 );
+        core::array::reserve( addressIndex->_data, numClients );
+        core::array::reserve( idIndex->_data, numClients );
+
+        // free slots are handed out lowest index first until slots start being recycled
+
+        freeSlots = CORE_NEW_ARRAY( allocator, int, numClients );
+        freeSlotPosition = CORE_NEW_ARRAY( allocator, int, numClients );
+        numFreeSlots = numClients;
+        for ( int i = 0; i < numClients; ++i )
+        {
+            freeSlots[i] = numClients - 1 - i;
+            freeSlotPosition[numClients - 1 - i] = i;
+        }
     }
 
     void ClientServerContext::Free( core::Allocator & allocator )
     {
         CORE_ASSERT( clientInfo );
         CORE_DELETE_ARRAY( allocator, clientInfo, numClients );
+        typedef core::Hash<int> IndexHash;
+        CORE_DELETE( allocator, IndexHash, addressIndex );
+        CORE_DELETE( allocator, IndexHash, idIndex );
+        CORE_DELETE_ARRAY( allocator, freeSlots, numClients );
+        CORE_DELETE_ARRAY( allocator, freeSlotPosition, numClients );
         clientInfo = nullptr;
+        addressIndex = nullptr;
+        idIndex = nullptr;
+        freeSlots = nullptr;
+        freeSlotPosition = nullptr;
+        numFreeSlots = 0;
         numClients = 0;
     }
 
@@ -47,28 +113,62 @@ namespace clientServer
     {
         CORE_ASSERT( clientIndex >= 0 );
         CORE_ASSERT( clientIndex < numClients );
+
+        if ( clientInfo[clientIndex].connected )
+            RemoveClient( clientIndex );
+
         ClientInfo & client = clientInfo[clientIndex];
         client.connected = true;
         client.address = address;
         client.clientId = clientId;
         client.serverId = serverId;
+
+        core::multi_hash::insert( *addressIndex, hash_address( address ), clientIndex );
+        core::multi_hash::insert( *idIndex, hash_ids( clientId, serverId ), clientIndex );
+
+        // take the slot off the free stack by swapping it with the top
+
+        const int position = freeSlotPosition[clientIndex];
+        CORE_ASSERT( position >= 0 );
+        CORE_ASSERT( position < numFreeSlots );
+        const int top = freeSlots[numFreeSlots - 1];
+        freeSlots[position] = top;
+        freeSlotPosition[top] = position;
+        freeSlotPosition[clientIndex] = -1;
+        numFreeSlots--;
     }
 
     void ClientServerContext::RemoveClient( int clientIndex )
     {
         CORE_ASSERT( clientIndex >= 0 );
         CORE_ASSERT( clientIndex < numClients );
-        clientInfo[clientIndex] = ClientInfo();
+
+        ClientInfo & client = clientInfo[clientIndex];
+        if ( !client.connected )
+            return;
+
+        remove_index_entry( *addressIndex, hash_address( client.address ), clientIndex );
+        remove_index_entry( *idIndex, hash_ids( client.clientId, client.serverId ), clientIndex );
+
+        client = ClientInfo();
+
+        CORE_ASSERT( numFreeSlots < numClients );
+        freeSlots[numFreeSlots] = clientIndex;
+        freeSlotPosition[clientIndex] = numFreeSlots;
+        numFreeSlots++;
     }
 
     int ClientServerContext::FindClient( const network::Address & address ) const
     {
         CORE_ASSERT( (int) classId == ClientServerContext::ClassId );
-        for ( int i = 0; i < numClients; ++i )
+        auto entry = core::multi_hash::find_first( *addressIndex, hash_address( address ) );
+        while ( entry )
         {
-            if ( clientInfo[i].connected && 
-                 clientInfo[i].address == address )
-                return i;
+            const ClientInfo & client = clientInfo[entry->value];
+            CORE_ASSERT( client.connected );
+            if ( client.address == address )
+                return entry->value;
+            entry = core::multi_hash::find_next( *addressIndex, entry );
         }
         return -1;
     }
@@ -76,12 +176,14 @@ namespace clientServer
     int ClientServerContext::FindClient( const network::Address & address, uint16_t clientId ) const
     {
         CORE_ASSERT( (int) classId == ClientServerContext::ClassId );
-        for ( int i = 0; i < numClients; ++i )
+        auto entry = core::multi_hash::find_first( *addressIndex, hash_address( address ) );
+        while ( entry )
         {
-            if ( clientInfo[i].connected && 
-                 clientInfo[i].address == address &&
-                 clientInfo[i].clientId == clientId )
-                return i;
+            const ClientInfo & client = clientInfo[entry->value];
+            CORE_ASSERT( client.connected );
+            if ( client.address == address && client.clientId == clientId )
+                return entry->value;
+            entry = core::multi_hash::find_next( *addressIndex, entry );
         }
         return -1;
     }
@@ -89,13 +191,14 @@ namespace clientServer
     int ClientServerContext::FindClient( const network::Address & address, uint16_t clientId, uint16_t serverId ) const
     {
         CORE_ASSERT( (int) classId == ClientServerContext::ClassId );
-        for ( int i = 0; i < numClients; ++i )
+        auto entry = core::multi_hash::find_first( *addressIndex, hash_address( address ) );
+        while ( entry )
         {
-            if ( clientInfo[i].connected && 
-                 clientInfo[i].address == address &&
-                 clientInfo[i].clientId == clientId && 
-                 clientInfo[i].serverId == serverId )
-                return i;
+            const ClientInfo & client = clientInfo[entry->value];
+            CORE_ASSERT( client.connected );
+            if ( client.address == address && client.clientId == clientId && client.serverId == serverId )
+                return entry->value;
+            entry = core::multi_hash::find_next( *addressIndex, entry );
         }
         return -1;
     }
@@ -103,13 +206,12 @@ namespace clientServer
     bool ClientServerContext::ClientPotentiallyExists( uint16_t clientId, uint16_t serverId ) const
     {
         CORE_ASSERT( (int) classId == ClientServerContext::ClassId );
-        for ( int i = 0; i < numClients; ++i )
-        {
-            if ( clientInfo[i].connected &&
-                 clientInfo[i].clientId == clientId && 
-                 clientInfo[i].serverId == serverId )
-                return true;
-        }
-        return false;
+        return core::multi_hash::find_first( *idIndex, hash_ids( clientId, serverId ) ) != nullptr;
+    }
+
+    int ClientServerContext::FindFreeSlot() const
+    {
+        CORE_ASSERT( (int) classId == ClientServerContext::ClassId );
+        return numFreeSlots > 0 ? freeSlots[numFreeSlots - 1] : -1;
     }
 }
@@ -26,6 +26,7 @@
 #define PROTOCOL_CLIENT_SERVER_CONTEXT_H
 
 #include "core/Core.h"
+#include "core/Types.h"
 #include "network/Address.h"
 
 namespace clientServer
@@ -55,10 +56,25 @@ namespace clientServer
 
         ClientInfo * clientInfo;
 
+        // lookups are O(1): connected clients are indexed by address hash and by client/server id pair,
+        // and free slots are kept on a stack so finding one doesn't scan the client array.
+
+        core::Hash<int> * addressIndex;                 // hash of address -> client index. multi hash, compare address on lookup.
+        core::Hash<int> * idIndex;                      // (clientId,serverId) -> client index. multi hash.
+
+        int numFreeSlots;
+        int * freeSlots;                                // stack of free client indices. top is the next slot handed out.
+        int * freeSlotPosition;                         // position of each free client index in the stack, -1 if connected.
+
         ClientServerContext()
         {
             numClients = 0;
             clientInfo = NULL;
+            addressIndex = NULL;
+            idIndex = NULL;
+            numFreeSlots = 0;
+            freeSlots = NULL;
+            freeSlotPosition = NULL;
         }
 
         void Initialize( core::Allocator & allocator, int numClients );
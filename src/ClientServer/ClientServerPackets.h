@@ -155,6 +155,7 @@ namespace clientServer
         uint32_t fragmentId;
         uint32_t fragmentBytes;
         uint8_t * fragmentData;
+        core::Allocator * fragmentAllocator;
 
         DataBlockFragmentPacket() : Packet( CLIENT_SERVER_PACKET_DATA_BLOCK_FRAGMENT ) 
         {
@@ -166,13 +167,14 @@ namespace clientServer
             fragmentId = 0;
             fragmentBytes = 0;
             fragmentData = NULL;
+            fragmentAllocator = &core::memory::scratch_allocator();
         }
 
         ~DataBlockFragmentPacket()
         {
             if ( fragmentData )
             {
-                core::memory::scratch_allocator().Free( fragmentData );
+                fragmentAllocator->Free( fragmentData );
                 fragmentData = nullptr;
             }
         }
@@ -190,16 +192,16 @@ namespace clientServer
             serialize_bits( stream, fragmentId, 16 );
             serialize_bits( stream, fragmentBytes, 16 );        // actual fragment bytes included in this packed. may be *less* than fragment size!
 
-            if ( Stream::IsReading )
+            CORE_ASSERT( fragmentSize <= protocol::MaxFragmentSize );
+            if ( Stream::IsReading && fragmentSize > protocol::MaxFragmentSize )
             {
-                CORE_ASSERT( fragmentSize <= protocol::MaxFragmentSize );
-                if ( fragmentSize <= protocol::MaxFragmentSize )
-                    fragmentData = (uint8_t*) core::memory::scratch_allocator().Allocate( fragmentBytes );
+                stream.Abort();
+                return;
             }
 
-            CORE_ASSERT( fragmentData );
+            // when reading from a packet buffer the fragment is a slice of the packet, not a copy
 
-            serialize_bytes( stream, fragmentData, fragmentBytes );
+            serialize_owned_bytes( stream, fragmentData, fragmentBytes, fragmentAllocator );
         }
     };
 
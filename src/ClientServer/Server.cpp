@@ -23,6 +23,7 @@
 */
 
 #include "clientServer/Server.h"
+#include "clientServer/ServerThreads.h"
 #include "network/Simulator.h"
 #include "core/Memory.h"
 
@@ -52,12 +53,29 @@ namespace clientServer
         m_context[CONTEXT_CONNECTION] = m_config.channelStructure;
         m_context[CONTEXT_CLIENT_SERVER] = &m_clientServerContext;
 
-        m_config.networkInterface->SetContext( m_context );
+        if ( m_config.threaded )
+        {
+            CORE_ASSERT( m_config.numWorkerThreads >= 0 );
+
+            m_threads = CORE_NEW( *m_allocator, ServerThreads, 
+                                  *m_allocator, 
+                                  *m_config.networkInterface, 
+                                  m_config.networkSimulator,
+                                  m_context,
+                                  m_numClients,
+                                  m_config.numWorkerThreads + 1,
+                                  m_config.threadQueueSize );
+        }
+        else
+        {
+            m_config.networkInterface->SetContext( m_context );
+        }
 
         protocol::ConnectionConfig connectionConfig;
         connectionConfig.maxPacketSize = m_config.networkInterface->GetMaxPacketSize();
         connectionConfig.channelStructure = m_config.channelStructure;
         connectionConfig.packetFactory = m_packetFactory;
+        connectionConfig.ackWindowSize = m_config.ackWindowSize;
         connectionConfig.context = m_context;
 
         m_clients = CORE_NEW_ARRAY( *m_allocator, ClientData, m_numClients );
@@ -80,6 +98,14 @@ namespace clientServer
         CORE_ASSERT( m_clients );
         CORE_ASSERT( m_packetFactory );
 
+        // IMPORTANT: stop threads before destroying anything they may touch
+
+        if ( m_threads )
+        {
+            CORE_DELETE( *m_allocator, ServerThreads, m_threads );
+            m_threads = nullptr;
+        }
+
         m_clientServerContext.Free( *m_allocator );
 
         for ( int i = 0; i < m_numClients; ++i )
@@ -126,6 +152,9 @@ namespace clientServer
     {
         m_timeBase = timeBase;
 
+        if ( m_threads )
+            m_threads->UpdateTime( timeBase );
+
         UpdateClients();
 
         UpdateNetworkSimulator();
@@ -186,10 +215,19 @@ namespace clientServer
         CORE_ASSERT( index >= CONTEXT_USER );
         CORE_ASSERT( index < protocol::MaxContexts );
         m_context[index] = ptr;
+
+        if ( m_threads )
+            m_threads->SetContext( index, ptr );
     }
 
     void Server::UpdateClients()
     {
+        // in threaded mode, connected clients are updated in parallel up front. 
+        // anything that can change client state is deferred to the loop below
+
+        if ( m_threads )
+            m_threads->RunShards( RunConnectedShard, this );
+
         for ( int i = 0; i < m_numClients; ++i )
         {
             switch ( m_clients[i].state )
@@ -207,7 +245,10 @@ namespace clientServer
                     break;
 
                 case SERVER_CLIENT_STATE_CONNECTED:
-                    UpdateConnected( i );
+                    if ( !m_threads )
+                        UpdateConnected( i );
+                    else if ( m_clients[i].connectionError )
+                        ResetClientSlot( i );
                     break;
 
                 default:
@@ -224,6 +265,22 @@ namespace clientServer
         }
     }
 
+    void Server::RunConnectedShard( void * server, int shard )
+    {
+        static_cast<Server*>( server )->UpdateConnectedShard( shard );
+    }
+
+    void Server::UpdateConnectedShard( int shard )
+    {
+        CORE_ASSERT( m_threads );
+
+        for ( int i = shard; i < m_numClients; i += m_threads->GetNumShards() )
+        {
+            if ( m_clients[i].state == SERVER_CLIENT_STATE_CONNECTED )
+                UpdateConnected( i );
+        }
+    }
+
     void Server::UpdateSendingChallenge( int clientIndex )
     {
         CORE_ASSERT( clientIndex >= 0 );
@@ -299,7 +356,10 @@ namespace clientServer
         if ( client.connection->GetError() != protocol::CONNECTION_ERROR_NONE )
         {
 //            printf( "client connection is in error state\n" );
-            ResetClientSlot( clientIndex );
+            if ( m_threads )
+                client.connectionError = true;
+            else
+                ResetClientSlot( clientIndex );
             return;
         }
 
@@ -312,7 +372,7 @@ namespace clientServer
             packet->clientId = client.clientId;
             packet->serverId = client.serverId;
 
-            SendPacket( client.address, packet );
+            SendPacket( client.address, packet, m_threads ? clientIndex % m_threads->GetNumShards() : 0 );
 
             client.accumulator = 0.0;
         }
@@ -339,7 +399,7 @@ namespace clientServer
 
     void Server::UpdateNetworkSimulator()
     {
-        if ( !m_config.networkSimulator )
+        if ( !m_config.networkSimulator || m_threads )
             return;
 
         m_config.networkSimulator->Update( m_timeBase );
@@ -357,6 +417,9 @@ namespace clientServer
     {
         CORE_ASSERT( m_config.networkInterface );
 
+        if ( m_threads )
+            return;
+
         m_config.networkInterface->Update( m_timeBase );
     }
 
@@ -364,7 +427,7 @@ namespace clientServer
     {
         while ( true )
         {
-            auto packet = m_config.networkInterface->ReceivePacket();
+            auto packet = GetReceiveInterface()->ReceivePacket();
             if ( !packet )
                 break;
 
@@ -476,7 +539,7 @@ namespace clientServer
         info.clientId = client.clientId;
         info.serverId = client.serverId;
         info.packetFactory = m_packetFactory;
-        info.networkInterface = m_config.networkInterface;
+        info.networkInterface = m_threads ? &m_threads->GetInterface( 0 ) : m_config.networkInterface;
 
         if ( client.dataBlockSender )
             client.dataBlockSender->SetInfo( info );
@@ -485,6 +548,9 @@ namespace clientServer
             client.dataBlockReceiver->SetInfo( info );
 
         m_clientServerContext.AddClient( clientIndex, client.address, client.clientId, client.serverId );
+
+        if ( m_threads )
+            m_threads->AddClient( clientIndex, client.address, client.clientId, client.serverId );
     }
 
     void Server::ProcessChallengeResponsePacket( ChallengeResponsePacket * packet )
@@ -645,12 +711,9 @@ namespace clientServer
 
     int Server::FindFreeClientSlot() const
     {
-        for ( int i = 0; i < m_numClients; ++i )
-        {
-            if ( m_clients[i].state == SERVER_CLIENT_STATE_DISCONNECTED )
-                return i;
-        }
-        return -1;
+        const int clientIndex = m_clientServerContext.FindFreeSlot();
+        CORE_ASSERT( clientIndex == -1 || m_clients[clientIndex].state == SERVER_CLIENT_STATE_DISCONNECTED );
+        return clientIndex;
     }
 
     void Server::ResetClientSlot( int clientIndex )
@@ -668,14 +731,29 @@ namespace clientServer
         client.connection->Reset();
 
         m_clientServerContext.RemoveClient( clientIndex );
+
+        if ( m_threads )
+            m_threads->RemoveClient( clientIndex );
     }
 
-    void Server::SendPacket( const network::Address & address, protocol::Packet * packet )
+    void Server::SendPacket( const network::Address & address, protocol::Packet * packet, int shard )
     {
+        if ( m_threads )
+        {
+            // the I/O thread forwards this to the network simulator if there is one
+            m_threads->GetInterface( shard ).SendPacket( address, packet );
+            return;
+        }
+
         auto interface = m_config.networkSimulator ? m_config.networkSimulator : m_config.networkInterface;
         interface->SendPacket( address, packet );
     }
 
+    network::Interface * Server::GetReceiveInterface()
+    {
+        return m_threads ? &m_threads->GetInterface( 0 ) : m_config.networkInterface;
+    }
+
     void Server::SetClientState( int clientIndex, ServerClientState state )
     {
         CORE_ASSERT( clientIndex >= 0 );
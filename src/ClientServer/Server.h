@@ -41,6 +41,8 @@ namespace network
 
 namespace clientServer
 {
+    class ServerThreads;
+
     struct ServerConfig
     {
         core::Allocator * allocator = nullptr;                  // allocator used for allocations that match the life cycle of this object. if null then default allocator is used.
@@ -62,7 +64,13 @@ namespace clientServer
         int fragmentSize = 1024;                                // send server data in 1k fragments by default. good size given that MTU is typically 1200 bytes.
         int fragmentsPerSecond = 60;                            // number of fragment packets to send per-second. set pretty high because we want the data to get across quickly.
 
+        int ackWindowSize = 32;                                 // number of received packets acked per connection packet: 32, 64 or 128. see protocol::ConnectionConfig.
+
         network::Simulator * networkSimulator = nullptr;        // optional network simulator.
+
+        bool threaded = false;                                  // if true, packet I/O runs on its own thread and connected clients are updated across a worker pool. see ServerThreads.h
+        int numWorkerThreads = 3;                               // number of worker threads in threaded mode, in addition to the thread calling Update.
+        int threadQueueSize = 4096;                             // size of each queue between threads in packets. packets that don't fit are dropped.
     };
 
     class Server
@@ -76,6 +84,7 @@ namespace clientServer
             uint16_t serverId;                          // the server id generated randomly on connection request unique to this client.
             ServerClientState state;                    // the current state of this client slot.
             bool readyForConnection;                    // set to true once the client is ready for a connection to start, eg. client has sent their client data across (if any)
+            bool connectionError;                       // set by a worker thread when the connection errors. the slot is reset on the main thread.
             protocol::Connection * connection;          // connection object. active in SERVER_CLIENT_STATE_CONNECTION.
             DataBlockSender * dataBlockSender;          // data block sender. active while in SERVER_CLIENT_STATE_SENDING_SERVER_DATA.
             DataBlockReceiver * dataBlockReceiver;      // data block receiver. active while in SERVER_CLIENT_STATE_SENDING_SERVER_DATA.
@@ -96,6 +105,7 @@ namespace clientServer
                 serverId = 0;
                 state = SERVER_CLIENT_STATE_DISCONNECTED;
                 readyForConnection = false;
+                connectionError = false;
 
                 if ( dataBlockSender )
                     dataBlockSender->Clear();
@@ -123,6 +133,8 @@ namespace clientServer
 
         const void * m_context[protocol::MaxContexts];
 
+        ServerThreads * m_threads = nullptr;                       // threads for threaded mode. null otherwise.
+
     public:
 
         Server( const ServerConfig & config );
@@ -195,7 +207,13 @@ namespace clientServer
 
         void ResetClientSlot( int clientIndex );
 
-        void SendPacket( const network::Address & address, protocol::Packet * packet );
+        void SendPacket( const network::Address & address, protocol::Packet * packet, int shard = 0 );
+
+        network::Interface * GetReceiveInterface();
+
+        void UpdateConnectedShard( int shard );
+
+        static void RunConnectedShard( void * server, int shard );
 
         void SetClientState( int clientIndex, ServerClientState state );
 
@@ -0,0 +1,364 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "clientServer/ServerThreads.h"
+#include "clientServer/ClientServerEnums.h"
+#include "network/Simulator.h"
+#include "protocol/PacketFactory.h"
+#include "core/Memory.h"
+#include <chrono>
+
+namespace clientServer
+{
+    const int IoIdleSleepMicroseconds = 100;
+
+    void ServerQueueInterface::Initialize( ServerThreads & threads, int shard )
+    {
+        m_threads = &threads;
+        m_shard = shard;
+    }
+
+    void ServerQueueInterface::SendPacket( const network::Address & address, protocol::Packet * packet )
+    {
+        CORE_ASSERT( m_threads );
+        CORE_ASSERT( packet );
+
+        packet->SetAddress( address );
+
+        if ( !m_threads->m_sendQueues[m_shard]->Push( packet ) )
+        {
+            m_threads->m_packetsDropped++;
+            GetPacketFactory().Destroy( packet );
+        }
+    }
+
+    protocol::Packet * ServerQueueInterface::ReceivePacket()
+    {
+        CORE_ASSERT( m_threads );
+        CORE_ASSERT( m_shard == 0 );
+
+        protocol::Packet * packet = nullptr;
+        m_threads->m_receiveQueue->Pop( packet );
+        return packet;
+    }
+
+    void ServerQueueInterface::Update( const core::TimeBase & /*timeBase*/ )
+    {
+        // the I/O thread updates the real network interface
+    }
+
+    uint32_t ServerQueueInterface::GetMaxPacketSize() const
+    {
+        CORE_ASSERT( m_threads );
+        return m_threads->m_networkInterface->GetMaxPacketSize();
+    }
+
+    protocol::PacketFactory & ServerQueueInterface::GetPacketFactory() const
+    {
+        CORE_ASSERT( m_threads );
+        return m_threads->m_networkInterface->GetPacketFactory();
+    }
+
+    void ServerQueueInterface::SetContext( const void ** /*context*/ )
+    {
+        // the context used to decode packets is owned by the I/O thread. see ServerThreads::SetContext
+    }
+
+    // ----------------------------------------------------------------
+
+    ServerThreads::ServerThreads( core::Allocator & allocator,
+                                  network::Interface & networkInterface,
+                                  network::Simulator * networkSimulator,
+                                  const void ** context,
+                                  int numClients,
+                                  int numShards,
+                                  int queueSize )
+    {
+        CORE_ASSERT( context );
+        CORE_ASSERT( numClients >= 1 );
+        CORE_ASSERT( numShards >= 1 );
+        CORE_ASSERT( queueSize >= 1 );
+
+        m_allocator = &allocator;
+        m_networkInterface = &networkInterface;
+        m_networkSimulator = networkSimulator;
+        m_numShards = numShards;
+
+        m_interfaces = CORE_NEW_ARRAY( *m_allocator, ServerQueueInterface, m_numShards );
+        m_sendQueues = CORE_NEW_ARRAY( *m_allocator, PacketQueue*, m_numShards );
+        for ( int i = 0; i < m_numShards; ++i )
+        {
+            m_interfaces[i].Initialize( *this, i );
+            m_sendQueues[i] = CORE_NEW( *m_allocator, PacketQueue, *m_allocator, queueSize );
+        }
+
+        m_receiveQueue = CORE_NEW( *m_allocator, PacketQueue, *m_allocator, queueSize );
+        m_commandQueue = CORE_NEW( *m_allocator, CommandQueue, *m_allocator, queueSize );
+
+        m_clientServerContext.Initialize( *m_allocator, numClients );
+
+        memcpy( m_context, context, sizeof( m_context ) );
+        m_context[CONTEXT_CLIENT_SERVER] = &m_clientServerContext;
+
+        m_networkInterface->SetContext( m_context );
+
+        m_quit = false;
+        m_packetsDropped = 0;
+
+        m_generation = 0;
+        m_workersRemaining = 0;
+        m_function = nullptr;
+        m_functionData = nullptr;
+
+        m_ioThread = std::thread( &ServerThreads::IoThread, this );
+
+        m_workerThreads = CORE_NEW_ARRAY( *m_allocator, std::thread, m_numShards - 1 );
+        for ( int i = 1; i < m_numShards; ++i )
+            m_workerThreads[i-1] = std::thread( &ServerThreads::WorkerThread, this, i );
+    }
+
+    ServerThreads::~ServerThreads()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_quit = true;
+        }
+
+        m_workerCondition.notify_all();
+
+        for ( int i = 0; i < m_numShards - 1; ++i )
+            m_workerThreads[i].join();
+
+        m_ioThread.join();
+
+        // destroy any packets still in flight between threads
+
+        protocol::PacketFactory & packetFactory = m_networkInterface->GetPacketFactory();
+
+        protocol::Packet * packet;
+
+        for ( int i = 0; i < m_numShards; ++i )
+        {
+            while ( m_sendQueues[i]->Pop( packet ) )
+                packetFactory.Destroy( packet );
+            CORE_DELETE( *m_allocator, PacketQueue, m_sendQueues[i] );
+        }
+
+        while ( m_receiveQueue->Pop( packet ) )
+            packetFactory.Destroy( packet );
+
+        CORE_DELETE( *m_allocator, PacketQueue, m_receiveQueue );
+        CORE_DELETE( *m_allocator, CommandQueue, m_commandQueue );
+
+        CORE_DELETE_ARRAY( *m_allocator, m_sendQueues, m_numShards );
+        CORE_DELETE_ARRAY( *m_allocator, m_interfaces, m_numShards );
+        CORE_DELETE_ARRAY( *m_allocator, m_workerThreads, m_numShards - 1 );
+
+        m_clientServerContext.Free( *m_allocator );
+
+        m_sendQueues = nullptr;
+        m_receiveQueue = nullptr;
+        m_commandQueue = nullptr;
+        m_interfaces = nullptr;
+        m_workerThreads = nullptr;
+    }
+
+    network::Interface & ServerThreads::GetInterface( int shard )
+    {
+        CORE_ASSERT( shard >= 0 );
+        CORE_ASSERT( shard < m_numShards );
+        return m_interfaces[shard];
+    }
+
+    void ServerThreads::UpdateTime( const core::TimeBase & timeBase )
+    {
+        Command command;
+        command.type = COMMAND_UPDATE_TIME;
+        command.timeBase = timeBase;
+        PushCommand( command );
+    }
+
+    void ServerThreads::AddClient( int clientIndex, const network::Address & address, uint16_t clientId, uint16_t serverId )
+    {
+        Command command;
+        command.type = COMMAND_ADD_CLIENT;
+        command.index = clientIndex;
+        command.address = address;
+        command.clientId = clientId;
+        command.serverId = serverId;
+        PushCommand( command );
+    }
+
+    void ServerThreads::RemoveClient( int clientIndex )
+    {
+        Command command;
+        command.type = COMMAND_REMOVE_CLIENT;
+        command.index = clientIndex;
+        PushCommand( command );
+    }
+
+    void ServerThreads::SetContext( int index, const void * ptr )
+    {
+        Command command;
+        command.type = COMMAND_SET_CONTEXT;
+        command.index = index;
+        command.ptr = ptr;
+        PushCommand( command );
+    }
+
+    void ServerThreads::PushCommand( const Command & command )
+    {
+        // IMPORTANT: commands must never be dropped or the I/O thread context goes out of sync. wait for space instead.
+
+        while ( !m_commandQueue->Push( command ) )
+            std::this_thread::yield();
+    }
+
+    void ServerThreads::RunShards( ShardFunction function, void * data )
+    {
+        CORE_ASSERT( function );
+
+        if ( m_numShards == 1 )
+        {
+            function( data, 0 );
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_function = function;
+            m_functionData = data;
+            m_workersRemaining = m_numShards - 1;
+            m_generation++;
+        }
+
+        m_workerCondition.notify_all();
+
+        function( data, 0 );
+
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_doneCondition.wait( lock, [this] { return m_workersRemaining == 0; } );
+    }
+
+    void ServerThreads::WorkerThread( int shard )
+    {
+        uint64_t generation = 0;
+
+        while ( true )
+        {
+            ShardFunction function;
+            void * data;
+
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_workerCondition.wait( lock, [this, generation] { return m_quit || m_generation != generation; } );
+                if ( m_quit )
+                    return;
+                generation = m_generation;
+                function = m_function;
+                data = m_functionData;
+            }
+
+            function( data, shard );
+
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                if ( --m_workersRemaining == 0 )
+                    m_doneCondition.notify_one();
+            }
+        }
+    }
+
+    void ServerThreads::IoThread()
+    {
+        core::TimeBase timeBase;
+
+        while ( !m_quit )
+        {
+            bool busy = false;
+
+            Command command;
+            while ( m_commandQueue->Pop( command ) )
+            {
+                switch ( command.type )
+                {
+                    case COMMAND_UPDATE_TIME:
+                    {
+                        timeBase = command.timeBase;
+
+                        if ( m_networkSimulator )
+                        {
+                            m_networkSimulator->Update( timeBase );
+
+                            while ( protocol::Packet * packet = m_networkSimulator->ReceivePacket() )
+                                m_networkInterface->SendPacket( packet->GetAddress(), packet );
+                        }
+                    }
+                    break;
+
+                    case COMMAND_ADD_CLIENT:
+                        m_clientServerContext.AddClient( command.index, command.address, command.clientId, command.serverId );
+                        break;
+
+                    case COMMAND_REMOVE_CLIENT:
+                        m_clientServerContext.RemoveClient( command.index );
+                        break;
+
+                    case COMMAND_SET_CONTEXT:
+                        m_context[command.index] = command.ptr;
+                        break;
+                }
+
+                busy = true;
+            }
+
+            network::Interface * sendInterface = m_networkSimulator ? m_networkSimulator : m_networkInterface;
+
+            for ( int i = 0; i < m_numShards; ++i )
+            {
+                protocol::Packet * packet;
+                while ( m_sendQueues[i]->Pop( packet ) )
+                {
+                    sendInterface->SendPacket( packet->GetAddress(), packet );
+                    busy = true;
+                }
+            }
+
+            m_networkInterface->Update( timeBase );
+
+            while ( protocol::Packet * packet = m_networkInterface->ReceivePacket() )
+            {
+                if ( !m_receiveQueue->Push( packet ) )
+                {
+                    m_packetsDropped++;
+                    m_networkInterface->GetPacketFactory().Destroy( packet );
+                }
+                busy = true;
+            }
+
+            if ( !busy )
+                std::this_thread::sleep_for( std::chrono::microseconds( IoIdleSleepMicroseconds ) );
+        }
+    }
+}
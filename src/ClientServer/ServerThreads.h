@@ -0,0 +1,184 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CLIENT_SERVER_SERVER_THREADS_H
+#define CLIENT_SERVER_SERVER_THREADS_H
+
+#include "core/Core.h"
+#include "core/SPSCQueue.h"
+#include "network/Interface.h"
+#include "ClientServerContext.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace network { class Simulator; }
+
+namespace clientServer
+{
+    class ServerThreads;
+
+    /*
+        Network interface handed to server code running in threaded mode.
+        Sent packets go onto an SPSC queue drained by the I/O thread,
+        received packets come off the I/O thread's receive queue. There
+        is one of these per-shard, and each may only be used by the one
+        thread that runs that shard.
+    */
+
+    class ServerQueueInterface : public network::Interface
+    {
+        ServerThreads * m_threads;
+        int m_shard;
+
+    public:
+
+        ServerQueueInterface() : m_threads( nullptr ), m_shard( 0 ) {}
+
+        void Initialize( ServerThreads & threads, int shard );
+
+        void SendPacket( const network::Address & address, protocol::Packet * packet );
+
+        protocol::Packet * ReceivePacket();
+
+        void Update( const core::TimeBase & timeBase );
+
+        uint32_t GetMaxPacketSize() const;
+
+        protocol::PacketFactory & GetPacketFactory() const;
+
+        void SetContext( const void ** context );
+    };
+
+    /*
+        Threads backing threaded server mode.
+
+        The I/O thread exclusively owns the network interface (and network
+        simulator, if any). It sends packets queued by the shards and receives
+        and decodes incoming packets. Decoding needs its own copy of the
+        client server context, kept in sync by commands from the main thread.
+
+        Client slots are statically sharded by index. Shard 0 runs on the
+        thread calling RunShards, the rest on worker threads, and RunShards
+        returns once all shards are done.
+    */
+
+    class ServerThreads
+    {
+        enum CommandType
+        {
+            COMMAND_UPDATE_TIME,
+            COMMAND_ADD_CLIENT,
+            COMMAND_REMOVE_CLIENT,
+            COMMAND_SET_CONTEXT,
+        };
+
+        struct Command
+        {
+            CommandType type;
+            core::TimeBase timeBase;
+            network::Address address;
+            int index;
+            uint16_t clientId;
+            uint16_t serverId;
+            const void * ptr;
+        };
+
+        typedef core::SPSCQueue<protocol::Packet*> PacketQueue;
+        typedef core::SPSCQueue<Command> CommandQueue;
+        typedef void (*ShardFunction)( void * data, int shard );
+
+        core::Allocator * m_allocator;
+
+        network::Interface * m_networkInterface;
+        network::Simulator * m_networkSimulator;
+
+        int m_numShards;
+
+        ServerQueueInterface * m_interfaces;                // per-shard queue interfaces
+        PacketQueue ** m_sendQueues;                        // per-shard send queues. shard thread -> I/O thread
+        PacketQueue * m_receiveQueue;                       // received packets. I/O thread -> shard 0
+        CommandQueue * m_commandQueue;                      // commands. shard 0 -> I/O thread
+
+        ClientServerContext m_clientServerContext;          // I/O thread copy of client server context
+        const void * m_context[protocol::MaxContexts];      // I/O thread copy of context passed to the network interface
+
+        std::atomic<bool> m_quit;
+        std::atomic<uint64_t> m_packetsDropped;
+
+        std::thread m_ioThread;
+        std::thread * m_workerThreads;
+
+        std::mutex m_mutex;
+        std::condition_variable m_workerCondition;          // signalled when a new generation of shard work starts
+        std::condition_variable m_doneCondition;            // signalled when the last worker finishes its shard
+        uint64_t m_generation;
+        int m_workersRemaining;
+        ShardFunction m_function;
+        void * m_functionData;
+
+        ServerThreads( const ServerThreads & other );
+        ServerThreads & operator = ( const ServerThreads & other );
+
+    public:
+
+        ServerThreads( core::Allocator & allocator,
+                       network::Interface & networkInterface,
+                       network::Simulator * networkSimulator,
+                       const void ** context,
+                       int numClients,
+                       int numShards,
+                       int queueSize );
+
+        ~ServerThreads();
+
+        int GetNumShards() const { return m_numShards; }
+
+        network::Interface & GetInterface( int shard );
+
+        void UpdateTime( const core::TimeBase & timeBase );
+
+        void AddClient( int clientIndex, const network::Address & address, uint16_t clientId, uint16_t serverId );
+
+        void RemoveClient( int clientIndex );
+
+        void SetContext( int index, const void * ptr );
+
+        void RunShards( ShardFunction function, void * data );
+
+        uint64_t GetPacketsDropped() const { return m_packetsDropped.load(); }
+
+    private:
+
+        friend class ServerQueueInterface;
+
+        void PushCommand( const Command & command );
+
+        void IoThread();
+
+        void WorkerThread( int shard );
+    };
+}
+
+#endif
@@ -202,7 +202,7 @@ namespace core
             now /= info.denom;
             return now;
 
-        #elif CORE_PLATFORM == CORE_PLATFORM_LINUX
+        #elif CORE_PLATFORM == CORE_PLATFORM_UNIX
 
             #ifdef CLOCK_MONOTONIC
             #define CLOCKID CLOCK_MONOTONIC
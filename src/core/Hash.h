@@ -157,13 +157,18 @@ namespace core
                 return;
             }
 
-            h._data[fr.data_i] = h._data[array::size(h._data) - 1];
-            FindResult last = find(h, h._data[fr.data_i].key);
+            // move the last entry into the hole. find it by pointer, not key: with a multi hash
+            // the first entry for that key is not necessarily the last one in the data array.
+
+            const FindResult last = find(h, &h._data[array::size(h._data) - 1]);
 
             if (last.data_prev != END_OF_LIST)
                 h._data[last.data_prev].next = fr.data_i;
             else
                 h._hash[last.hash_i] = fr.data_i;
+
+            h._data[fr.data_i] = h._data[array::size(h._data) - 1];
+            array::pop_back(h._data);
         }
 
         template<typename T> uint32_t find_or_fail(const Hash<T> &h, uint64_t key)
@@ -218,10 +223,11 @@ namespace core
                 multi_hash::insert(nh, e.key, e.value);
             }
 
+            // a hash is two arrays of allocator, size, capacity and data pointer, so it is safe to move bytewise. nh is left empty so its destructor frees nothing
             Hash<T> empty(*h._hash.m_allocator);
             h.~Hash<T>();
-            memcpy(&h, &nh, sizeof(Hash<T>));
-            memcpy(&nh, &empty, sizeof(Hash<T>));
+            memcpy((void*)&h, (const void*)&nh, sizeof(Hash<T>));
+            memcpy((void*)&nh, (const void*)&empty, sizeof(Hash<T>));
         }
 
         template<typename T> bool full(const Hash<T> &h)
@@ -0,0 +1,285 @@
+/*
+    Networked Physics Example
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "core/JobSystem.h"
+#include "core/Memory.h"
+
+namespace core
+{
+    static thread_local const JobSystem * t_jobSystem = nullptr;       // job system owning the current worker thread, if any
+    static thread_local int t_threadIndex = 0;
+
+    JobSystem::JobSystem( const JobSystemConfig & config )
+    {
+        CORE_ASSERT( config.numThreads >= 0 );
+        CORE_ASSERT( config.queueSize > 0 );
+        CORE_ASSERT( ( config.queueSize & ( config.queueSize - 1 ) ) == 0 );
+
+        m_allocator = config.allocator ? config.allocator : &memory::default_allocator();
+
+        m_numThreads = config.numThreads;
+        if ( m_numThreads == 0 )
+            m_numThreads = (int) std::thread::hardware_concurrency();
+        if ( m_numThreads < 1 )
+            m_numThreads = 1;
+
+        m_queueSize = config.queueSize;
+
+        m_queues = (JobQueue*) m_allocator->Allocate( sizeof( JobQueue ) * m_numThreads, alignof( JobQueue ) );
+        for ( int i = 0; i < m_numThreads; ++i )
+        {
+            JobQueue & queue = m_queues[i];
+            queue.lock.clear();
+            queue.top = 0;
+            queue.bottom = 0;
+            queue.jobs = (Job*) m_allocator->Allocate( sizeof( Job ) * m_queueSize, alignof( Job ) );
+        }
+
+        m_pending.store( 0 );
+        m_next.store( 0 );
+        m_quit.store( false );
+
+        for ( int i = 0; i < JOB_SYSTEM_NUM_COUNTERS; ++i )
+            m_counters[i].store( 0 );
+
+        m_threads = nullptr;
+        if ( m_numThreads > 1 )
+        {
+            m_threads = CORE_NEW_ARRAY( *m_allocator, std::thread, m_numThreads - 1 );
+            for ( int i = 1; i < m_numThreads; ++i )
+                m_threads[i-1] = std::thread( &JobSystem::WorkerThread, this, i );
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_sleepMutex );
+            m_quit.store( true );
+        }
+        m_sleepCondition.notify_all();
+
+        if ( m_threads )
+        {
+            for ( int i = 0; i < m_numThreads - 1; ++i )
+                m_threads[i].join();
+            CORE_DELETE_ARRAY( *m_allocator, m_threads, m_numThreads - 1 );
+            m_threads = nullptr;
+        }
+
+        CORE_ASSERT( m_pending.load() == 0 );
+
+        for ( int i = 0; i < m_numThreads; ++i )
+            m_allocator->Free( m_queues[i].jobs );
+        m_allocator->Free( m_queues );
+        m_queues = nullptr;
+    }
+
+    void JobSystem::Run( JobFunction function, void * data, int count, JobCounter & counter )
+    {
+        CORE_ASSERT( function );
+        CORE_ASSERT( count >= 0 );
+
+        if ( count == 0 )
+            return;
+
+        counter.value.fetch_add( count, std::memory_order_relaxed );
+
+        // deal the jobs out round robin so every thread starts with some work and stealing only evens out the tail
+
+        const uint32_t first = m_next.fetch_add( count, std::memory_order_relaxed );
+
+        for ( int i = 0; i < count; ++i )
+        {
+            Job job;
+            job.function = function;
+            job.data = data;
+            job.index = i;
+            job.counter = &counter;
+
+            if ( !Push( ( first + i ) % m_numThreads, job ) && !Push( GetThreadIndex(), job ) )
+            {
+                m_counters[JOB_SYSTEM_COUNTER_QUEUE_FULL]++;
+                Execute( job );
+            }
+        }
+
+        if ( m_numThreads > 1 )
+        {
+            std::lock_guard<std::mutex> lock( m_sleepMutex );
+            m_sleepCondition.notify_all();
+        }
+    }
+
+    void JobSystem::Wait( JobCounter & counter )
+    {
+        const int threadIndex = GetThreadIndex();
+
+        while ( counter.value.load( std::memory_order_acquire ) > 0 )
+        {
+            Job job;
+            if ( FindJob( threadIndex, job ) )
+                Execute( job );
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::ParallelFor( JobFunction function, void * data, int count )
+    {
+        JobCounter counter;
+        Run( function, data, count, counter );
+        Wait( counter );
+    }
+
+    int JobSystem::GetNumThreads() const
+    {
+        return m_numThreads;
+    }
+
+    uint64_t JobSystem::GetCounter( int index ) const
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < JOB_SYSTEM_NUM_COUNTERS );
+        return m_counters[index];
+    }
+
+    bool JobSystem::Push( int queueIndex, const Job & job )
+    {
+        JobQueue & queue = m_queues[queueIndex];
+
+        while ( queue.lock.test_and_set( std::memory_order_acquire ) ) {}
+
+        const bool full = queue.bottom - queue.top == m_queueSize;
+
+        if ( !full )
+        {
+            queue.jobs[queue.bottom & ( m_queueSize - 1 )] = job;
+            queue.bottom++;
+            m_pending.fetch_add( 1, std::memory_order_relaxed );
+        }
+
+        queue.lock.clear( std::memory_order_release );
+
+        return !full;
+    }
+
+    bool JobSystem::Pop( int queueIndex, Job & job )
+    {
+        // owner end. most recently added job first, it is most likely still in cache
+
+        JobQueue & queue = m_queues[queueIndex];
+
+        while ( queue.lock.test_and_set( std::memory_order_acquire ) ) {}
+
+        const bool empty = queue.bottom == queue.top;
+
+        if ( !empty )
+        {
+            queue.bottom--;
+            job = queue.jobs[queue.bottom & ( m_queueSize - 1 )];
+            m_pending.fetch_sub( 1, std::memory_order_relaxed );
+        }
+
+        queue.lock.clear( std::memory_order_release );
+
+        return !empty;
+    }
+
+    bool JobSystem::Steal( int queueIndex, Job & job )
+    {
+        // thief end. oldest job first
+
+        JobQueue & queue = m_queues[queueIndex];
+
+        if ( queue.lock.test_and_set( std::memory_order_acquire ) )
+            return false;
+
+        const bool empty = queue.bottom == queue.top;
+
+        if ( !empty )
+        {
+            job = queue.jobs[queue.top & ( m_queueSize - 1 )];
+            queue.top++;
+            m_pending.fetch_sub( 1, std::memory_order_relaxed );
+        }
+
+        queue.lock.clear( std::memory_order_release );
+
+        return !empty;
+    }
+
+    bool JobSystem::FindJob( int threadIndex, Job & job )
+    {
+        if ( Pop( threadIndex, job ) )
+            return true;
+
+        for ( int i = 1; i < m_numThreads; ++i )
+        {
+            if ( Steal( ( threadIndex + i ) % m_numThreads, job ) )
+            {
+                m_counters[JOB_SYSTEM_COUNTER_JOBS_STOLEN]++;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void JobSystem::Execute( const Job & job )
+    {
+        job.function( job.data, job.index );
+        m_counters[JOB_SYSTEM_COUNTER_JOBS_RUN]++;
+        job.counter->value.fetch_sub( 1, std::memory_order_release );
+    }
+
+    int JobSystem::GetThreadIndex() const
+    {
+        // threads that are not workers of this job system, eg. the one that created it, share queue 0
+        return t_jobSystem == this ? t_threadIndex : 0;
+    }
+
+    void JobSystem::WorkerThread( int threadIndex )
+    {
+        t_jobSystem = this;
+        t_threadIndex = threadIndex;
+
+        while ( true )
+        {
+            Job job;
+            if ( FindJob( threadIndex, job ) )
+            {
+                Execute( job );
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock( m_sleepMutex );
+            m_sleepCondition.wait( lock, [this] { return m_quit.load() || m_pending.load() > 0; } );
+            if ( m_quit.load() )
+                break;
+        }
+
+        t_jobSystem = nullptr;
+    }
+}
@@ -0,0 +1,152 @@
+/*
+    Networked Physics Example
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CORE_JOB_SYSTEM_H
+#define CORE_JOB_SYSTEM_H
+
+#include "core/Core.h"
+#include "core/Allocator.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace core
+{
+    enum JobSystemCounters
+    {
+        JOB_SYSTEM_COUNTER_JOBS_RUN,                    // jobs executed, by any thread
+        JOB_SYSTEM_COUNTER_JOBS_STOLEN,                 // jobs taken from the queue of another thread
+        JOB_SYSTEM_COUNTER_QUEUE_FULL,                  // jobs run inline by the submitting thread because its queue was full
+        JOB_SYSTEM_NUM_COUNTERS
+    };
+
+    typedef void (*JobFunction)( void * data, int index );
+
+    struct JobCounter
+    {
+        std::atomic<int> value;                         // jobs added with this counter that have not finished yet
+
+        JobCounter() : value(0) {}
+    };
+
+    struct JobSystemConfig
+    {
+        Allocator * allocator;
+        int numThreads;                                 // threads running jobs, including the calling thread. 0 uses every hardware thread.
+        int queueSize;                                  // jobs per thread queue. power of two.
+
+        JobSystemConfig()
+        {
+            allocator = nullptr;
+            numThreads = 0;
+            queueSize = 1024;
+        }
+    };
+
+    /*
+        Small work stealing job system.
+
+        Each thread has its own job queue. Jobs are dealt round robin across the
+        queues when added. A thread pops jobs from the back of its own queue,
+        and when that is empty, steals from the front of the other queues, so
+        uneven jobs even out without a central queue.
+
+        The thread that created the job system is thread 0. It does not sleep,
+        instead Wait runs jobs on the calling thread until the counter is done.
+        Worker threads sleep while there is no work. Jobs may add more jobs
+        and wait on them from inside a job.
+    */
+
+    class JobSystem
+    {
+    public:
+
+        JobSystem( const JobSystemConfig & config = JobSystemConfig() );
+
+        ~JobSystem();
+
+        void Run( JobFunction function, void * data, int count, JobCounter & counter );     // adds jobs for index [0,count)
+
+        void Wait( JobCounter & counter );
+
+        void ParallelFor( JobFunction function, void * data, int count );                   // run and wait
+
+        int GetNumThreads() const;
+
+        uint64_t GetCounter( int index ) const;
+
+    private:
+
+        struct Job
+        {
+            JobFunction function;
+            void * data;
+            int index;
+            JobCounter * counter;
+        };
+
+        struct JobQueue
+        {
+            std::atomic_flag lock;
+            uint32_t top;                               // next job to steal
+            uint32_t bottom;                            // next job to push. the owner pops from here.
+            Job * jobs;
+            uint8_t pad[64];
+        };
+
+        bool Push( int queueIndex, const Job & job );
+
+        bool Pop( int queueIndex, Job & job );
+
+        bool Steal( int queueIndex, Job & job );
+
+        bool FindJob( int threadIndex, Job & job );
+
+        void Execute( const Job & job );
+
+        int GetThreadIndex() const;
+
+        void WorkerThread( int threadIndex );
+
+        Allocator * m_allocator;
+        int m_numThreads;
+        uint32_t m_queueSize;
+        JobQueue * m_queues;
+        std::thread * m_threads;
+
+        std::atomic<int> m_pending;                     // jobs sitting in queues
+        std::atomic<uint32_t> m_next;                   // round robin queue for the next job added
+        std::atomic<bool> m_quit;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_sleepCondition;
+
+        std::atomic<uint64_t> m_counters[JOB_SYSTEM_NUM_COUNTERS];
+
+        JobSystem( const JobSystem & other );
+        JobSystem & operator = ( const JobSystem & other );
+    };
+}
+
+#endif
@@ -72,6 +72,16 @@ namespace core
 			return *memory_globals.scratch_allocator;
 		}
 
+		uint64_t num_allocations()
+		{
+			CORE_ASSERT( memory_globals.default_allocator );
+#if USE_SCRATCH_ALLOCATOR
+			return memory_globals.default_allocator->GetNumAllocations();
+#else
+			return memory_globals.default_allocator->GetNumAllocations() + memory_globals.scratch_allocator->GetNumAllocations();
+#endif
+		}
+
 		void shutdown() 
 		{
 #if USE_SCRATCH_ALLOCATOR
@@ -29,6 +29,7 @@
 #include "core/Allocator.h"
 #include <new>
 #include <stdio.h>
+#include <atomic>
 
 namespace core
 {
@@ -43,6 +44,8 @@ namespace core
 		Allocator & default_allocator();
 		
 		Allocator & scratch_allocator();
+
+		uint64_t num_allocations();		// number of mallocs made by the default and scratch allocators since initialize. for profiling.
 		
 		void shutdown();
 	}
@@ -181,7 +184,11 @@ namespace core
 
 	class MallocAllocator : public Allocator
 	{
-		uint32_t m_total_allocated;
+		// counters are atomic so the allocator may be shared between threads, eg. threaded server mode.
+		// note that the CORE_DEBUG_MEMORY_LEAKS map is not thread safe.
+
+		std::atomic<uint32_t> m_total_allocated;
+		std::atomic<uint64_t> m_num_allocations;
 
 #if CORE_DEBUG_MEMORY_LEAKS
 		std::map<void*,int> m_alloc_map;
@@ -194,7 +201,7 @@ namespace core
 
 	public:
 
-		MallocAllocator() : m_total_allocated(0) {}
+		MallocAllocator() : m_total_allocated(0), m_num_allocations(0) {}
 
 		~MallocAllocator()
 		{
@@ -203,7 +210,7 @@ namespace core
 			{
 				printf( "you leaked memory!\n" );
 				printf( "%d blocks still allocated\n", (int) m_alloc_map.size() );
-				printf( "%d bytes still allocated\n", m_total_allocated );
+				printf( "%d bytes still allocated\n", m_total_allocated.load() );
 				for ( auto itor : m_alloc_map )
 				{
 					auto p = itor.first;
@@ -214,7 +221,7 @@ namespace core
 #endif
 			if ( m_total_allocated != 0 )
 			{
-				printf( "you leaked memory! %d bytes still allocated\n", m_total_allocated );
+				printf( "you leaked memory! %d bytes still allocated\n", m_total_allocated.load() );
 				CORE_ASSERT( !"leaked memory" );
 			}
 			CORE_ASSERT( m_total_allocated == 0 );
@@ -227,6 +234,7 @@ namespace core
 			void * p = data_pointer( h, align );
 			fill( h, p, ts );
 			m_total_allocated += ts;
+			m_num_allocations++;
 #if CORE_DEBUG_MEMORY_LEAKS
 			m_alloc_map[p] = 1;
 #endif
@@ -257,6 +265,11 @@ namespace core
 		{
 			return m_total_allocated;
 		}
+
+		uint64_t GetNumAllocations() const
+		{
+			return m_num_allocations;
+		}
 	};
 
 	class ScratchAllocator : public Allocator
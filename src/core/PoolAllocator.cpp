@@ -0,0 +1,291 @@
+/*
+    Networked Physics Example
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "core/PoolAllocator.h"
+#include "core/Memory.h"
+#include <thread>
+
+namespace core
+{
+    const uint32_t EmptyIndex = 0xFFFFFFFF;
+    const uint32_t OversizeClass = 0xFFFFFFFF;
+    const uint32_t BlockMagic = 0x9001B10C;
+
+    PoolAllocator::PoolAllocator( Allocator & backing, uint32_t maxBlockSize, uint32_t chunkSize )
+    {
+        CORE_ASSERT( maxBlockSize > 0 );
+        CORE_ASSERT( chunkSize > 0 );
+
+        m_backing = &backing;
+        m_chunkSize = chunkSize;
+
+        // size classes are power of two block sizes including the header, from 32 bytes up
+
+        m_numSizeClasses = 0;
+        uint32_t blockSize = 2 * HeaderSize;
+        while ( true )
+        {
+            m_numSizeClasses++;
+            if ( blockSize - HeaderSize >= maxBlockSize || m_numSizeClasses == MaxSizeClasses )
+                break;
+            blockSize <<= 1;
+        }
+
+        CORE_ASSERT( blockSize - HeaderSize >= maxBlockSize );
+
+        m_sizeClasses = (SizeClass*) m_backing->Allocate( sizeof( SizeClass ) * m_numSizeClasses, 64 );
+
+        blockSize = 2 * HeaderSize;
+        for ( int i = 0; i < m_numSizeClasses; ++i )
+        {
+            SizeClass * sizeClass = new ( m_sizeClasses + i ) SizeClass();
+            sizeClass->head.store( EmptyIndex, std::memory_order_relaxed );
+            sizeClass->numChunks.store( 0, std::memory_order_relaxed );
+            sizeClass->growLock.clear();
+            sizeClass->blockSize = blockSize;
+            sizeClass->blocksPerChunk = 8;
+            sizeClass->blocksPerChunkShift = 3;
+            while ( sizeClass->blocksPerChunk * blockSize < m_chunkSize )
+            {
+                sizeClass->blocksPerChunk <<= 1;
+                sizeClass->blocksPerChunkShift++;
+            }
+            blockSize <<= 1;
+        }
+
+        m_totalAllocated.store( 0 );
+        for ( int i = 0; i < POOL_ALLOCATOR_NUM_COUNTERS; ++i )
+            m_counters[i].store( 0 );
+    }
+
+    PoolAllocator::~PoolAllocator()
+    {
+        if ( m_totalAllocated != 0 )
+        {
+            printf( "you leaked memory! %d bytes still allocated from pool\n", m_totalAllocated.load() );
+            CORE_ASSERT( !"leaked memory" );
+        }
+
+        for ( int i = 0; i < m_numSizeClasses; ++i )
+        {
+            SizeClass & sizeClass = m_sizeClasses[i];
+            const int numChunks = sizeClass.numChunks.load();
+            for ( int j = 0; j < numChunks; ++j )
+                m_backing->Free( sizeClass.chunks[j] );
+            sizeClass.~SizeClass();
+        }
+
+        m_backing->Free( m_sizeClasses );
+        m_sizeClasses = nullptr;
+    }
+
+    void * PoolAllocator::Allocate( uint32_t size, uint32_t align )
+    {
+        // blocks in a size class are only header aligned, so anything needing more comes from the backing allocator
+
+        if ( align > HeaderSize )
+            return AllocateOversize( size, align );
+
+        CORE_ASSERT( HeaderSize % align == 0 );
+
+        // smallest power of two block that fits size plus header. size class 0 is 32 byte blocks
+
+        const int sizeClassIndex = core::max( 0, bits_required( 0, size + HeaderSize - 1 ) - 5 );
+
+        if ( sizeClassIndex >= m_numSizeClasses )
+            return AllocateOversize( size, HeaderSize );
+
+        CORE_ASSERT( m_sizeClasses[sizeClassIndex].blockSize - HeaderSize >= size );
+
+        SizeClass & sizeClass = m_sizeClasses[sizeClassIndex];
+
+        BlockHeader * block = nullptr;
+        while ( ( block = Pop( sizeClass ) ) == nullptr )
+        {
+            if ( !Grow( sizeClassIndex ) )
+                return AllocateOversize( size, HeaderSize );
+        }
+
+        CORE_ASSERT( block->magic == BlockMagic );
+        CORE_ASSERT( block->sizeClass == uint32_t( sizeClassIndex ) );
+
+        m_totalAllocated += sizeClass.blockSize - HeaderSize;
+        m_counters[POOL_ALLOCATOR_COUNTER_ALLOCATIONS]++;
+
+        return block + 1;
+    }
+
+    void PoolAllocator::Free( void * p )
+    {
+        if ( !p )
+            return;
+
+        BlockHeader * block = ( (BlockHeader*) p ) - 1;
+
+        CORE_ASSERT( block->magic == BlockMagic );
+
+        if ( block->sizeClass == OversizeClass )
+        {
+            m_totalAllocated -= block->index;
+            m_counters[POOL_ALLOCATOR_COUNTER_OVERSIZE_FREES]++;
+            m_backing->Free( ( (uint8_t*) block ) - block->next.load( std::memory_order_relaxed ) );
+            return;
+        }
+
+        CORE_ASSERT( block->sizeClass < uint32_t( m_numSizeClasses ) );
+
+        SizeClass & sizeClass = m_sizeClasses[block->sizeClass];
+
+        m_totalAllocated -= sizeClass.blockSize - HeaderSize;
+        m_counters[POOL_ALLOCATOR_COUNTER_FREES]++;
+
+        Push( sizeClass, block, block );
+    }
+
+    uint32_t PoolAllocator::GetAllocatedSize( void * p )
+    {
+        CORE_ASSERT( p );
+        BlockHeader * block = ( (BlockHeader*) p ) - 1;
+        CORE_ASSERT( block->magic == BlockMagic );
+        if ( block->sizeClass == OversizeClass )
+            return block->index;
+        return m_sizeClasses[block->sizeClass].blockSize - HeaderSize;
+    }
+
+    uint32_t PoolAllocator::GetTotalAllocated()
+    {
+        return m_totalAllocated;
+    }
+
+    uint64_t PoolAllocator::GetCounter( int index ) const
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < POOL_ALLOCATOR_NUM_COUNTERS );
+        return m_counters[index];
+    }
+
+    PoolAllocator::BlockHeader * PoolAllocator::GetBlock( SizeClass & sizeClass, uint32_t index )
+    {
+        const uint32_t chunk = index >> sizeClass.blocksPerChunkShift;
+        const uint32_t offset = index & ( sizeClass.blocksPerChunk - 1 );
+        return (BlockHeader*) ( sizeClass.chunks[chunk] + offset * sizeClass.blockSize );
+    }
+
+    PoolAllocator::BlockHeader * PoolAllocator::Pop( SizeClass & sizeClass )
+    {
+        uint64_t head = sizeClass.head.load( std::memory_order_acquire );
+        while ( true )
+        {
+            const uint32_t index = uint32_t( head );
+            if ( index == EmptyIndex )
+                return nullptr;
+
+            // IMPORTANT: another thread may pop and reuse this block between the load and the
+            // compare exchange, so next may be stale. the tag makes the exchange fail if so.
+
+            BlockHeader * block = GetBlock( sizeClass, index );
+            const uint32_t next = block->next.load( std::memory_order_relaxed );
+            const uint64_t newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) | next;
+            if ( sizeClass.head.compare_exchange_weak( head, newHead, std::memory_order_acquire, std::memory_order_acquire ) )
+                return block;
+        }
+    }
+
+    void PoolAllocator::Push( SizeClass & sizeClass, BlockHeader * first, BlockHeader * last )
+    {
+        uint64_t head = sizeClass.head.load( std::memory_order_relaxed );
+        while ( true )
+        {
+            last->next.store( uint32_t( head ), std::memory_order_relaxed );
+            const uint64_t newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) | first->index;
+            if ( sizeClass.head.compare_exchange_weak( head, newHead, std::memory_order_release, std::memory_order_relaxed ) )
+                return;
+        }
+    }
+
+    bool PoolAllocator::Grow( int sizeClassIndex )
+    {
+        SizeClass & sizeClass = m_sizeClasses[sizeClassIndex];
+
+        while ( sizeClass.growLock.test_and_set( std::memory_order_acquire ) )
+            std::this_thread::yield();
+
+        // another thread may have grown the size class while we waited for the lock
+
+        if ( uint32_t( sizeClass.head.load( std::memory_order_acquire ) ) != EmptyIndex )
+        {
+            sizeClass.growLock.clear( std::memory_order_release );
+            return true;
+        }
+
+        const int chunkIndex = sizeClass.numChunks.load( std::memory_order_relaxed );
+        if ( chunkIndex == MaxChunksPerSizeClass )
+        {
+            sizeClass.growLock.clear( std::memory_order_release );
+            return false;
+        }
+
+        uint8_t * chunk = (uint8_t*) m_backing->Allocate( sizeClass.blocksPerChunk * sizeClass.blockSize, HeaderSize );
+        CORE_ASSERT( chunk );
+
+        sizeClass.chunks[chunkIndex] = chunk;
+        sizeClass.numChunks.store( chunkIndex + 1, std::memory_order_release );
+
+        const uint32_t firstIndex = uint32_t( chunkIndex ) << sizeClass.blocksPerChunkShift;
+
+        for ( uint32_t i = 0; i < sizeClass.blocksPerChunk; ++i )
+        {
+            BlockHeader * block = new ( chunk + i * sizeClass.blockSize ) BlockHeader();
+            block->next.store( firstIndex + i + 1, std::memory_order_relaxed );
+            block->index = firstIndex + i;
+            block->sizeClass = sizeClassIndex;
+            block->magic = BlockMagic;
+        }
+
+        m_counters[POOL_ALLOCATOR_COUNTER_CHUNK_ALLOCATIONS]++;
+
+        Push( sizeClass, (BlockHeader*) chunk, (BlockHeader*) ( chunk + ( sizeClass.blocksPerChunk - 1 ) * sizeClass.blockSize ) );
+
+        sizeClass.growLock.clear( std::memory_order_release );
+
+        return true;
+    }
+
+    void * PoolAllocator::AllocateOversize( uint32_t size, uint32_t align )
+    {
+        // the header sits right before the returned pointer, so with more than header alignment it is offset into the allocation
+
+        CORE_ASSERT( align % HeaderSize == 0 );
+        const uint32_t offset = align - HeaderSize;
+        uint8_t * memory = (uint8_t*) m_backing->Allocate( align + size, align );
+        CORE_ASSERT( memory );
+        BlockHeader * block = new ( memory + offset ) BlockHeader();
+        block->next.store( offset, std::memory_order_relaxed );
+        block->index = size;
+        block->sizeClass = OversizeClass;
+        block->magic = BlockMagic;
+        m_totalAllocated += size;
+        m_counters[POOL_ALLOCATOR_COUNTER_OVERSIZE_ALLOCATIONS]++;
+        return block + 1;
+    }
+}
@@ -0,0 +1,120 @@
+/*
+    Networked Physics Example
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef CORE_POOL_ALLOCATOR_H
+#define CORE_POOL_ALLOCATOR_H
+
+#include "core/Core.h"
+#include "core/Allocator.h"
+#include <atomic>
+
+namespace core
+{
+    enum PoolAllocatorCounters
+    {
+        POOL_ALLOCATOR_COUNTER_ALLOCATIONS,                 // allocations served from a size class free list
+        POOL_ALLOCATOR_COUNTER_FREES,                       // blocks returned to a size class free list
+        POOL_ALLOCATOR_COUNTER_CHUNK_ALLOCATIONS,           // chunks allocated from the backing allocator to grow a size class
+        POOL_ALLOCATOR_COUNTER_OVERSIZE_ALLOCATIONS,        // allocations too large for any size class or more than header aligned, passed through to the backing allocator
+        POOL_ALLOCATOR_COUNTER_OVERSIZE_FREES,              // oversize allocations returned to the backing allocator
+        POOL_ALLOCATOR_NUM_COUNTERS
+    };
+
+    /*
+        Size class pool allocator.
+
+        Allocations are rounded up to a power of two block size and served from
+        a free list per size class, so objects of the same type always come back
+        to the same list. Free lists are lock-free stacks, so the allocator may be
+        shared between threads, eg. a threaded server. Only growing a size class
+        by another chunk takes a (per size class) spin lock.
+
+        Memory is never returned to the backing allocator until the pool is destroyed,
+        so once a steady state working set has been reached there are no more mallocs.
+    */
+
+    class PoolAllocator : public Allocator
+    {
+    public:
+
+        static const int MaxSizeClasses = 16;
+        static const int MaxChunksPerSizeClass = 1024;
+        static const uint32_t HeaderSize = 16;
+
+        PoolAllocator( Allocator & backing, uint32_t maxBlockSize = 4096, uint32_t chunkSize = 64 * 1024 );
+
+        ~PoolAllocator();
+
+        void * Allocate( uint32_t size, uint32_t align = DEFAULT_ALIGN );
+
+        void Free( void * p );
+
+        uint32_t GetAllocatedSize( void * p );
+
+        uint32_t GetTotalAllocated();
+
+        uint64_t GetCounter( int index ) const;
+
+    private:
+
+        struct BlockHeader
+        {
+            std::atomic<uint32_t> next;                     // next free block index while on the free list. offset of the header into the allocation if oversize.
+            uint32_t index;                                 // block index within its size class. allocation size if oversize.
+            uint32_t sizeClass;                             // size class index, or OversizeClass
+            uint32_t magic;
+        };
+
+        struct SizeClass
+        {
+            std::atomic<uint64_t> head;                     // tag in high 32 bits to avoid ABA, free block index in low 32 bits
+            std::atomic<int> numChunks;
+            std::atomic_flag growLock;
+            uint32_t blockSize;                             // including header
+            uint32_t blocksPerChunk;                        // power of two
+            uint32_t blocksPerChunkShift;
+            uint8_t * chunks[MaxChunksPerSizeClass];
+            uint8_t pad[64];
+        };
+
+        BlockHeader * GetBlock( SizeClass & sizeClass, uint32_t index );
+
+        BlockHeader * Pop( SizeClass & sizeClass );
+
+        void Push( SizeClass & sizeClass, BlockHeader * first, BlockHeader * last );
+
+        bool Grow( int sizeClassIndex );
+
+        void * AllocateOversize( uint32_t size, uint32_t align );
+
+        Allocator * m_backing;
+        uint32_t m_chunkSize;
+        int m_numSizeClasses;
+        SizeClass * m_sizeClasses;
+
+        std::atomic<uint32_t> m_totalAllocated;
+        std::atomic<uint64_t> m_counters[POOL_ALLOCATOR_NUM_COUNTERS];
+    };
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*
+    Networked Physics Example
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CORE_SPSC_QUEUE_H
+#define CORE_SPSC_QUEUE_H
+
+#include "core/Core.h"
+#include "core/Memory.h"
+#include <atomic>
+
+namespace core
+{
+    /*
+        Bounded lock-free queue for passing items from exactly one producer
+        thread to exactly one consumer thread. The producer owns the tail
+        and the consumer owns the head, so each side only ever writes its
+        own index. Size is rounded up to a power of two.
+        Entries are raw memory, so T must be trivially copyable, eg. a pointer.
+    */
+
+    template <typename T> class SPSCQueue
+    {
+        Allocator * m_allocator;
+        T * m_entries;
+        uint32_t m_size;
+
+        std::atomic<uint32_t> m_head;                   // next entry to pop. written by the consumer only.
+        uint8_t m_pad[64];                              // keep producer and consumer indices on separate cache lines
+        std::atomic<uint32_t> m_tail;                   // next entry to push. written by the producer only.
+
+        SPSCQueue( const SPSCQueue & other );
+        SPSCQueue & operator = ( const SPSCQueue & other );
+
+    public:
+
+        SPSCQueue( Allocator & allocator, int size )
+        {
+            CORE_ASSERT( size > 0 );
+            m_allocator = &allocator;
+            m_size = 1;
+            while ( m_size < uint32_t( size ) )
+                m_size <<= 1;
+            m_entries = (T*) m_allocator->Allocate( sizeof( T ) * m_size, alignof( T ) );
+            CORE_ASSERT( m_entries );
+            m_head.store( 0, std::memory_order_relaxed );
+            m_tail.store( 0, std::memory_order_relaxed );
+        }
+
+        ~SPSCQueue()
+        {
+            CORE_ASSERT( m_entries );
+            m_allocator->Free( m_entries );
+            m_entries = nullptr;
+        }
+
+        bool Push( const T & value )                    // producer only. returns false if the queue is full.
+        {
+            const uint32_t tail = m_tail.load( std::memory_order_relaxed );
+            if ( tail - m_head.load( std::memory_order_acquire ) == m_size )
+                return false;
+            m_entries[tail & ( m_size - 1 )] = value;
+            m_tail.store( tail + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool Pop( T & value )                           // consumer only. returns false if the queue is empty.
+        {
+            const uint32_t head = m_head.load( std::memory_order_relaxed );
+            if ( head == m_tail.load( std::memory_order_acquire ) )
+                return false;
+            value = m_entries[head & ( m_size - 1 )];
+            m_head.store( head + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool IsEmpty() const
+        {
+            return m_head.load( std::memory_order_acquire ) == m_tail.load( std::memory_order_acquire );
+        }
+
+        int GetSize() const
+        {
+            return (int) m_size;
+        }
+    };
+}
+
+#endif
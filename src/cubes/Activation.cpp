@@ -26,6 +26,16 @@
 
 namespace activation
 {
+	CellObject & CellObjectSet::InsertObject( ObjectId id, float x, float y )
+	{
+		if ( count >= size )
+			Grow();
+		ids[count] = id;
+		positionX[count] = x;
+		positionY[count] = y;
+		return objects[count++];
+	}
+
 	void CellObjectSet::DeleteObject( ActiveObject * activeObjects, ObjectId id )
 	{
 		assert( count >= 1 );
@@ -52,6 +62,8 @@ namespace activation
 		{
 			ids[i] = ids[last];
 			cellObjects[i] = cellObjects[last];
+			positionX[i] = positionX[last];
+			positionY[i] = positionY[last];
 			if ( cellObjects[i].active )
 			{
 				const int activeObjectIndex = cellObjects[i].activeObjectIndex;
@@ -63,6 +75,31 @@ namespace activation
 			Shrink();
 	}
 
+	void CellObjectSet::Grow()
+	{
+		Set<CellObject>::Grow();
+		ResizePositions();
+	}
+
+	void CellObjectSet::Shrink()
+	{
+		Set<CellObject>::Shrink();
+		ResizePositions();
+	}
+
+	void CellObjectSet::ResizePositions()
+	{
+		// keep the position arrays the same size as the object array
+		float * oldX = positionX;
+		float * oldY = positionY;
+		positionX = new float[size];
+		positionY = new float[size];
+		memcpy( &positionX[0], &oldX[0], sizeof(float)*count );
+		memcpy( &positionY[0], &oldY[0], sizeof(float)*count );
+		delete[] oldX;
+		delete[] oldY;
+	}
+
 #ifdef VALIDATION
 
 	void Cell::ValidateCellObject( Cell * cells, ActiveObject * activeObjects, const CellObject & cellObject )
@@ -100,12 +137,11 @@ namespace activation
 		assert( x < x2 + epsilon );
 		assert( y < y2 + epsilon );
 		#endif
-		CellObject & cellObject = objects.InsertObject( id );
+		CellObject & cellObject = objects.InsertObject( id, x, y );
 		cellObject.id = id;
-		cellObject.x = x;
-		cellObject.y = y;
 		cellObject.active = 0;
 		cellObject.disabled = 0;
+		cellObject.refCount = 0;
 		cellObject.activeObjectIndex = 0;
 		#ifdef VALIDATION
 		cellObject.cellIndex = index;
@@ -152,7 +188,7 @@ namespace activation
 			Shrink();
 	}
 
-	ActivationSystem::ActivationSystem( int maxObjects, float radius, int width, int height, float size, int initialObjectsPerCell, int initialActiveObjects, float deactivationTime )
+	ActivationSystem::ActivationSystem( int maxObjects, float radius, int width, int height, float size, int initialObjectsPerCell, int initialActiveObjects, float deactivationTime, int numActivationPoints )
 	{
 		/*
 		printf( "max objects is %d\n", maxObjects );
@@ -165,9 +201,9 @@ namespace activation
 		assert( width > 0 );
 		assert( height >  0 );
 		assert( size > 0.0f );
+		assert( numActivationPoints > 0 );
+		assert( numActivationPoints <= MaxActivationPoints );
 		this->maxObjects = maxObjects;
-		this->activation_x = 0.0f;
-		this->activation_y = 0.0f;
 		this->activation_radius = radius;
 		this->activation_radius_squared = radius * radius;
 		this->width = width;
@@ -196,6 +232,7 @@ namespace activation
 				cell.y1 = fy;
 				cell.x2 = fx + size;
 				cell.y2 = fy + size;
+				cell.coverCount = 0;
 				cell.Initialize( initialObjectsPerCell );
 				fx += size;
 				++index;
@@ -209,6 +246,17 @@ namespace activation
 		#endif
 		enabled = true;
 		enabled_last_frame = false;
+		activation_points.resize( numActivationPoints );
+		for ( int i = 0; i < numActivationPoints; ++i )
+		{
+			ActivationPoint & point = activation_points[i];
+			point.x = 0.0f;
+			point.y = 0.0f;
+			point.enabled = true;
+			point.applied_x = 0.0f;
+			point.applied_y = 0.0f;
+			point.applied = false;
+		}
 		active_objects.Allocate( initialActiveObjects );
 		initial_objects_per_cell = initialObjectsPerCell;
 	}
@@ -226,9 +274,8 @@ namespace activation
 
 	void ActivationSystem::Update( float deltaTime )
 	{
-		if ( !enabled_last_frame && enabled )
-			ActivateObjectsInsideCircle();
-		else if ( enabled_last_frame && !enabled )
+		UpdateActivationPoints();
+		if ( enabled_last_frame && !enabled )
 			DeactivateAllObjects();
 		enabled_last_frame = enabled;
 		int i = 0;
@@ -253,171 +300,355 @@ namespace activation
 		}
 	}
 
-	void ActivationSystem::ActivateObjectsInsideCircle()
+	void ActivationSystem::DeactivateAllObjects()
+	{
+		for ( int i = 0; i < active_objects.GetCount(); ++i )
+		{
+			ActiveObject & activeObject = active_objects.GetObject( i );
+			if ( !activeObject.pendingDeactivation )
+				QueueObjectForDeactivation( activeObject );
+		}
+	}
+
+	void ActivationSystem::MoveActivationPoint( int index, float new_x, float new_y )
 	{
-		// determine grid cells to inspect...
-		int ix1 = (int) math::floor( ( activation_x - activation_radius + bound_x ) * inverse_size ) - 1;
-		int ix2 = (int) math::floor( ( activation_x + activation_radius + bound_x ) * inverse_size ) + 1;
-		int iy1 = (int) math::floor( ( activation_y - activation_radius + bound_y ) * inverse_size ) - 1;
-		int iy2 = (int) math::floor( ( activation_y + activation_radius + bound_y ) * inverse_size ) + 1;
-		ix1 = math::clamp( ix1, 0, width - 1 );
-		ix2 = math::clamp( ix2, 0, width - 1 );
-		iy1 = math::clamp( iy1, 0, height - 1 );
-		iy2 = math::clamp( iy2, 0, height - 1 );
-		// iterate over grid cells and activate objects inside activation circle
-		int index = iy1 * width + ix1;
-		int stride = width - ( ix2 - ix1 + 1 );
+		assert( index >= 0 );
+		assert( index < (int) activation_points.size() );
+		activation_points[index].x = math::clamp( new_x, -bound_x, +bound_x );
+		activation_points[index].y = math::clamp( new_y, -bound_y, +bound_y );
+	}
+
+	void ActivationSystem::SetActivationPointEnabled( int index, bool enabled )
+	{
+		assert( index >= 0 );
+		assert( index < (int) activation_points.size() );
+		activation_points[index].enabled = enabled;
+	}
+
+	void ActivationSystem::UpdateActivationPoints()
+	{
+		Validate();
+
+		// find circles that moved, were enabled or were disabled since the last update.
+		// a circle only counts while both it and the activation system are enabled
+
+		changed_points.clear();
+		for ( int i = 0; i < (int) activation_points.size(); ++i )
+		{
+			const ActivationPoint & point = activation_points[i];
+			const bool apply = enabled && point.enabled;
+			if ( apply != point.applied || ( apply && ( point.x != point.applied_x || point.y != point.applied_y ) ) )
+				changed_points.push_back( i );
+		}
+
+		if ( changed_points.empty() )
+			return;
+
+		// determine grid rows covered by any changed circle, before or after the change
+		int iy1 = height;
+		int iy2 = -1;
+		for ( int i = 0; i < (int) changed_points.size(); ++i )
+		{
+			const ActivationPoint & point = activation_points[changed_points[i]];
+			if ( point.applied )
+				ExtendRows( point.applied_y, iy1, iy2 );
+			if ( enabled && point.enabled )
+				ExtendRows( point.y, iy1, iy2 );
+		}
+
+		if ( (int) row_mask.size() < width )
+			row_mask.resize( width );
+
+		// walk each row once for all changed circles. a cell can only change for a circle if it overlaps the circle
+		// before or after and is not entirely inside it both times, so each circle marks those cells in a row mask
+		// and every marked cell is visited once no matter how many circles overlap it
 		for ( int iy = iy1; iy <= iy2; ++iy )
 		{
-			assert( iy >= 0 );
-			assert( iy < height );
-			for ( int ix = ix1; ix <= ix2; ++ix )
+			row_circles.clear();
+
+			int mark1 = width;
+			int mark2 = -1;
+
+			for ( int i = 0; i < (int) changed_points.size(); ++i )
 			{
-				assert( ix >= 0 );
-				assert( ix < width );
-				assert( index == iy * width + ix );
-				Cell & cell = cells[index++];
-				for ( int i = 0; i < cell.objects.GetCount(); ++i )
+				const ActivationPoint & point = activation_points[changed_points[i]];
+				RowCircle rowCircle;
+				rowCircle.point = changed_points[i];
+				rowCircle.oldSpan.outer1 = rowCircle.oldSpan.inner1 = width;
+				rowCircle.oldSpan.outer2 = rowCircle.oldSpan.inner2 = -1;
+				rowCircle.newSpan = rowCircle.oldSpan;
+				if ( point.applied )
+					GetRowSpan( iy, point.applied_x, point.applied_y, rowCircle.oldSpan );
+				if ( enabled && point.enabled )
+					GetRowSpan( iy, point.x, point.y, rowCircle.newSpan );
+				const RowSpan & oldSpan = rowCircle.oldSpan;
+				const RowSpan & newSpan = rowCircle.newSpan;
+				const int ix1 = oldSpan.outer1 < newSpan.outer1 ? oldSpan.outer1 : newSpan.outer1;
+				const int ix2 = oldSpan.outer2 > newSpan.outer2 ? oldSpan.outer2 : newSpan.outer2;
+				if ( ix1 > ix2 )
+					continue;
+				const int skip1 = oldSpan.inner1 > newSpan.inner1 ? oldSpan.inner1 : newSpan.inner1;
+				const int skip2 = oldSpan.inner2 < newSpan.inner2 ? oldSpan.inner2 : newSpan.inner2;
+				row_circles.push_back( rowCircle );
+				if ( skip1 <= skip2 )
 				{
-					CellObject & cellObject = cell.objects.GetObject( i );
-					const float dx = cellObject.x - activation_x;
-					const float dy = cellObject.y - activation_y;
-					const float distanceSquared = dx*dx + dy*dy;
-					if ( distanceSquared < activation_radius_squared && !cellObject.disabled )
-					{
-						if ( !cellObject.active )
-						{
-							ActivateObject( cellObject, cell );
-						}
-						else
-						{
-							ActiveObject & activeObject = active_objects.GetObject( cellObject.activeObjectIndex );
-							activeObject.pendingDeactivation = false;
-						}
-					}
+					MarkRowCells( ix1, skip1 - 1, mark1, mark2 );
+					MarkRowCells( skip2 + 1, ix2, mark1, mark2 );
 				}
+				else
+					MarkRowCells( ix1, ix2, mark1, mark2 );
+			}
+
+			for ( int ix = mark1; ix <= mark2; ++ix )
+			{
+				if ( !row_mask[ix] )
+					continue;
+				row_mask[ix] = 0;
+				Cell & cell = cells[iy*width+ix];
+				cell_changes.clear();
+				for ( int j = 0; j < (int) row_circles.size(); ++j )
+				{
+					const RowCircle & rowCircle = row_circles[j];
+					CellChange change;
+					change.point = rowCircle.point;
+					change.oldOverlap = GetOverlap( rowCircle.oldSpan, ix );
+					change.newOverlap = GetOverlap( rowCircle.newSpan, ix );
+					if ( change.oldOverlap == change.newOverlap && change.oldOverlap != Partial )
+						continue;
+					cell_changes.push_back( change );
+				}
+				if ( !cell_changes.empty() )
+					UpdateCellObjects( cell );
 			}
-			index += stride;
 		}
+
+		// the cell object ref counts now include the changed circles at their new positions
+		for ( int i = 0; i < (int) changed_points.size(); ++i )
+		{
+			ActivationPoint & point = activation_points[changed_points[i]];
+			point.applied = enabled && point.enabled;
+			point.applied_x = point.x;
+			point.applied_y = point.y;
+		}
+
 		Validate();
 	}
 
-	void ActivationSystem::DeactivateAllObjects()
+	void ActivationSystem::ExtendRows( float y, int & iy1, int & iy2 ) const
 	{
-		for ( int i = 0; i < active_objects.GetCount(); ++i )
-		{
-			ActiveObject & activeObject = active_objects.GetObject( i );
-			if ( !activeObject.pendingDeactivation )
-				QueueObjectForDeactivation( activeObject );
-		}
+		const int y1 = math::clamp( (int) math::floor( ( y - activation_radius + bound_y ) * inverse_size ) - 1, 0, height - 1 );
+		const int y2 = math::clamp( (int) math::floor( ( y + activation_radius + bound_y ) * inverse_size ) + 1, 0, height - 1 );
+		if ( y1 < iy1 )
+			iy1 = y1;
+		if ( y2 > iy2 )
+			iy2 = y2;
 	}
 
-	void ActivationSystem::MoveActivationPoint( float new_x, float new_y )
+	void ActivationSystem::MarkRowCells( int ix1, int ix2, int & mark1, int & mark2 )
 	{
-		Validate();
-		
-		// clamp in bounds
-		new_x = math::clamp( new_x, -bound_x, +bound_x );
-		new_y = math::clamp( new_y, -bound_y, +bound_y );
-		
-		// if we are not enabled, don't do anything...
-		if ( !enabled )
+		if ( ix1 > ix2 )
 			return;
-			
-		const float old_x = activation_x;
-		const float old_y = activation_y;
+		for ( int ix = ix1; ix <= ix2; ++ix )
+			row_mask[ix] = 1;
+		if ( ix1 < mark1 )
+			mark1 = ix1;
+		if ( ix2 > mark2 )
+			mark2 = ix2;
+	}
+
+	int ActivationSystem::GetCellOverlap( const Cell & cell, float x, float y ) const
+	{
+		RowSpan span;
+		GetRowSpan( cell.iy, x, y, span );
+		return GetOverlap( span, cell.ix );
+	}
+
+	void ActivationSystem::GetRowSpan( int iy, float x, float y, RowSpan & span ) const
+	{
+		// cells in the row overlapping the circle and entirely inside it. objects can sit a tiny bit outside their
+		// cell due to floating point, so cell bounds are padded. every cell vs. circle test goes through here,
+		// which keeps cell cover counts consistent from one update to the next
+
+		span.outer1 = span.inner1 = width;
+		span.outer2 = span.inner2 = -1;
+
+		const Cell & row = cells[iy*width];
+		const float epsilon = size * 0.01f;
+		const float y1 = row.y1 - epsilon;
+		const float y2 = row.y2 + epsilon;
 
-		// if there is no overlap between new and old,
-		// then we can take a shortcut and just deactivate old circle
-		// and activate the new circle...
-		if ( math::abs( new_x - old_x ) > activation_radius || math::abs( new_y - old_y ) > activation_radius )
+		const float nearY = math::clamp( y, y1, y2 ) - y;
+		const float outerSquared = activation_radius_squared - nearY*nearY;
+		if ( outerSquared <= 0.0f )
+			return;
+		const float outer = math::sqrt( outerSquared );
+		span.outer1 = math::clamp( (int) math::floor( ( x - outer - epsilon + bound_x ) * inverse_size ), 0, width - 1 );
+		span.outer2 = math::clamp( (int) math::floor( ( x + outer + epsilon + bound_x ) * inverse_size ), 0, width - 1 );
+
+		const float farY = math::maximum( math::abs( y1 - y ), math::abs( y2 - y ) );
+		const float innerSquared = activation_radius_squared - farY*farY;
+		if ( innerSquared <= 0.0f )
+			return;
+		const float inner = math::sqrt( innerSquared );
+		span.inner1 = math::clamp( (int) math::ceiling( ( x - inner + epsilon + bound_x ) * inverse_size ), 0, width );
+		span.inner2 = math::clamp( (int) math::floor( ( x + inner - epsilon + bound_x ) * inverse_size ) - 1, -1, width - 1 );
+	}
+
+	void ActivationSystem::AccumulateOverlap( const float * positionX, const float * positionY, int count, float x, float y, int overlap, int sign, int * delta ) const
+	{
+		if ( overlap == Outside )
+			return;
+
+		if ( overlap == Inside )
 		{
-			DeactivateAllObjects();
-			activation_x = new_x;
-			activation_y = new_y;
-			ActivateObjectsInsideCircle();
-			Validate();
+			for ( int i = 0; i < count; ++i )
+				delta[i] += sign;
 			return;
 		}
-		
-		// new and old activation regions overlap
-		// first, we determine which grid cells to inspect...
-		int ix1,ix2;
-		if ( new_x > old_x )
+
+		// branch free distance test over the position arrays so it vectorizes
+		for ( int i = 0; i < count; ++i )
 		{
-			ix1 = (int) math::floor( ( old_x - activation_radius + bound_x ) * inverse_size ) - 1;
-			ix2 = (int) math::floor( ( new_x + activation_radius + bound_x ) * inverse_size ) + 1;
+			const float dx = positionX[i] - x;
+			const float dy = positionY[i] - y;
+			delta[i] += sign * ( dx*dx + dy*dy < activation_radius_squared );
 		}
-		else
+	}
+
+	void ActivationSystem::UpdateCellObjects( Cell & cell )
+	{
+		// apply the circle changes in cell_changes to the cell. while any circle covers the whole cell every
+		// object in it is inside, so object ref counts are only kept up to date for cells nothing covers
+
+		const int oldCoverCount = cell.coverCount;
+
+		for ( int i = 0; i < (int) cell_changes.size(); ++i )
 		{
-			ix1 = (int) math::floor( ( new_x - activation_radius + bound_x ) * inverse_size ) - 1;
-			ix2 = (int) math::floor( ( old_x + activation_radius + bound_x ) * inverse_size ) + 1;
+			if ( cell_changes[i].oldOverlap == Inside )
+				cell.coverCount--;
+			if ( cell_changes[i].newOverlap == Inside )
+				cell.coverCount++;
 		}
-		int iy1,iy2;
-		if ( new_y > old_y )
+
+		assert( cell.coverCount >= 0 );
+
+		if ( oldCoverCount > 0 && cell.coverCount > 0 )
+			return;
+
+		const int count = cell.objects.GetCount();
+		if ( count == 0 )
+			return;
+
+		if ( cell.coverCount > 0 )
 		{
-			iy1 = (int) math::floor( ( old_y - activation_radius + bound_y ) * inverse_size ) - 1;
-			iy2 = (int) math::floor( ( new_y + activation_radius + bound_y ) * inverse_size ) + 1;
+			// newly covered: everything in the cell is inside
+			for ( int i = 0; i < count; ++i )
+				UpdateCellObject( cell, cell.objects.GetObject( i ), true );
+			return;
 		}
-		else
+
+		if ( (int) refcount_delta.size() < count )
+			refcount_delta.resize( count );
+
+		int * delta = &refcount_delta[0];
+
+		memset( delta, 0, sizeof(int) * count );
+
+		const float * positionX = cell.objects.GetPositionX();
+		const float * positionY = cell.objects.GetPositionY();
+
+		if ( oldCoverCount > 0 )
 		{
-			iy1 = (int) math::floor( ( new_y - activation_radius + bound_y ) * inverse_size ) - 1;
-			iy2 = (int) math::floor( ( old_y + activation_radius + bound_y ) * inverse_size ) + 1;
+			// no longer covered: ref counts went stale while it was, so count every circle overlapping the cell from scratch
+			for ( int i = 0; i < (int) activation_points.size(); ++i )
+			{
+				const ActivationPoint & point = activation_points[i];
+				if ( !enabled || !point.enabled )
+					continue;
+				const int overlap = GetCellOverlap( cell, point.x, point.y );
+				assert( overlap != Inside );
+				AccumulateOverlap( positionX, positionY, count, point.x, point.y, overlap, +1, delta );
+			}
+			for ( int i = 0; i < count; ++i )
+			{
+				CellObject & cellObject = cell.objects.GetObject( i );
+				assert( delta[i] <= MaxActivationPoints );
+				cellObject.refCount = delta[i];
+				UpdateCellObject( cell, cellObject, delta[i] > 0 );
+			}
+			return;
 		}
-		ix1 = math::clamp( ix1, 0, width - 1 );
-		ix2 = math::clamp( ix2, 0, width - 1 );
-		iy1 = math::clamp( iy1, 0, height - 1 );
-		iy2 = math::clamp( iy2, 0, height - 1 );
-		
-		// iterate over grid cells and activate/deactivate objects
-		int index = iy1 * width + ix1;
-		int stride = width - ( ix2 - ix1 + 1 );
-		for ( int iy = iy1; iy <= iy2; ++iy )
+
+		for ( int i = 0; i < (int) cell_changes.size(); ++i )
+		{
+			const CellChange & change = cell_changes[i];
+			const ActivationPoint & point = activation_points[change.point];
+			AccumulateOverlap( positionX, positionY, count, point.applied_x, point.applied_y, change.oldOverlap, -1, delta );
+			AccumulateOverlap( positionX, positionY, count, point.x, point.y, change.newOverlap, +1, delta );
+		}
+
+		for ( int i = 0; i < count; ++i )
+		{
+			if ( delta[i] == 0 )
+				continue;
+			CellObject & cellObject = cell.objects.GetObject( i );
+			const int refCount = (int) cellObject.refCount + delta[i];
+			assert( refCount >= 0 );
+			assert( refCount <= MaxActivationPoints );
+			cellObject.refCount = refCount;
+			UpdateCellObject( cell, cellObject, refCount > 0 );
+		}
+	}
+
+	void ActivationSystem::UpdateCellObject( Cell & cell, CellObject & cellObject, bool inside )
+	{
+		if ( inside )
 		{
-			assert( iy >= 0 );
-			assert( iy < height );
-			for ( int ix = ix1; ix <= ix2; ++ix )
+			if ( cellObject.disabled )
+				return;
+			if ( !cellObject.active )
 			{
-				assert( ix >= 0 );
-				assert( ix < width );
-				assert( index == iy * width + ix );
-				Cell & cell = cells[index++];
-				for ( int i = 0; i < cell.objects.GetCount(); ++i )
-				{
-					CellObject & cellObject = cell.objects.GetObject( i );
-					const float dx = cellObject.x - new_x;
-					const float dy = cellObject.y - new_y;
-					const float distanceSquared = dx*dx + dy*dy;
-					if ( distanceSquared < activation_radius_squared && !cellObject.disabled )
-					{
-						if ( !cellObject.active )
-						{
-							ActivateObject( cellObject, cell );
-						}
-						else
-						{
-							ActiveObject & activeObject = active_objects.GetObject( cellObject.activeObjectIndex );
-							activeObject.pendingDeactivation = false;						
-						}
-					}
-					else if ( cellObject.active )
-					{
-						ActiveObject & activeObject = active_objects.GetObject( cellObject.activeObjectIndex );
-						if ( !activeObject.pendingDeactivation )
-							QueueObjectForDeactivation( activeObject );
-					}
-				}
+				ActivateObject( cellObject, cell );
+			}
+			else
+			{
+				ActiveObject & activeObject = active_objects.GetObject( cellObject.activeObjectIndex );
+				activeObject.pendingDeactivation = false;
 			}
-			index += stride;
 		}
-		
-		// update position
-		activation_x = new_x;
-		activation_y = new_y;
-		
-		Validate();
+		else if ( cellObject.active )
+		{
+			ActiveObject & activeObject = active_objects.GetObject( cellObject.activeObjectIndex );
+			if ( !activeObject.pendingDeactivation )
+				QueueObjectForDeactivation( activeObject );
+		}
 	}
-	
+
+	bool ActivationSystem::IsInsideCircle( const Cell & cell, CellObject & cellObject, float x, float y )
+	{
+		// updates the object ref count unless the cell is covered, in which case it is stale anyway
+		if ( cell.coverCount > 0 )
+			return true;
+		cellObject.refCount = CountCirclesContaining( x, y );
+		return cellObject.refCount > 0;
+	}
+
+	int ActivationSystem::CountCirclesContaining( float x, float y ) const
+	{
+		int count = 0;
+		for ( int i = 0; i < (int) activation_points.size(); ++i )
+		{
+			const ActivationPoint & point = activation_points[i];
+			if ( !point.applied )
+				continue;
+			const float dx = x - point.applied_x;
+			const float dy = y - point.applied_y;
+			if ( dx*dx + dy*dy < activation_radius_squared )
+				count++;
+		}
+		return count;
+	}
+
 	void ActivationSystem::InsertObject( ObjectId id, float x, float y )
 	{
 		assert( x >= - bound_x );
@@ -426,11 +657,13 @@ namespace activation
 		assert( y <= + bound_y );
 		Cell * cell = CellAtPosition( x, y );
 		assert( cell );
-		cell->InsertObject( cells, active_objects.GetObjectArray(), id, x, y );
+		CellObject & cellObject = cell->InsertObject( cells, active_objects.GetObjectArray(), id, x, y );
 		#ifdef DEBUG
 		assert( idToCellIndex[id] == -1 );
 		#endif
 		idToCellIndex[id] = (int) ( cell - &cells[0] );
+		if ( IsInsideCircle( *cell, cellObject, x, y ) )
+			ActivateObject( cellObject, *cell );
 	}
 	
 	void ActivationSystem::MoveObject( ObjectId id, float x, float y )
@@ -472,8 +705,7 @@ namespace activation
 		if ( currentCell == newCell )
 		{
 			// common case: same cell
-			cellObject->x = new_x;
-			cellObject->y = new_y;
+			currentCell->objects.SetPosition( currentCell->GetCellObjectIndex( *cellObject ), new_x, new_y );
 		}
 		else
 		{
@@ -498,10 +730,7 @@ namespace activation
 		#endif
 
 		// see if the object needs to be deactivated
-		const float dx = new_x - activation_x;
-		const float dy = new_y - activation_y;
-		const float distanceSquared = dx*dx + dy*dy;
-		if ( distanceSquared > activation_radius_squared )
+		if ( !IsInsideCircle( *currentCell, *cellObject, new_x, new_y ) )
 		{
 			if ( !activeObject->pendingDeactivation )
 				QueueObjectForDeactivation( *activeObject );
@@ -534,8 +763,7 @@ namespace activation
 		if ( currentCell == newCell )
 		{
 			// common case: same cell
-			cellObject->x = new_x;
-			cellObject->y = new_y;
+			currentCell->objects.SetPosition( currentCell->GetCellObjectIndex( *cellObject ), new_x, new_y );
 		}
 		else
 		{
@@ -551,6 +779,10 @@ namespace activation
 		#ifdef VALIDATION
 		Cell::ValidateCellObject( cells, active_objects.GetObjectArray(), *cellObject );
 		#endif
+
+		// circles only revisit cells their boundary sweeps across, so an object moving into a circle activates here
+		if ( IsInsideCircle( *currentCell, *cellObject, new_x, new_y ) && !cellObject->disabled && !cellObject->active )
+			ActivateObject( *cellObject, *currentCell );
 	}
 	
 	ActiveObject & ActivationSystem::ActivateObject( CellObject & cellObject, Cell & cell )
@@ -597,11 +829,10 @@ namespace activation
 		CellObject * cellObject = cell.FindObject( objectId );
 		assert( cellObject );
 		cellObject->disabled = 0;
-		if ( !cellObject->active )
-		{
-			// activate object
-			ActivateObject( *cellObject, cell );			
-		}
+
+		// circles won't look at this object again until one of their boundaries sweeps across its cell,
+		// so activate it (or cancel the deactivation pending from being disabled) only if it is inside one now
+		UpdateCellObject( cell, *cellObject, cell.coverCount > 0 || cellObject->refCount > 0 );
 	}
 	
 	void ActivationSystem::DisableObject( ObjectId objectId )
@@ -664,11 +895,11 @@ namespace activation
 			Cell::ValidateActiveObject( cells, active_objects.GetObjectArray(), activeObject );
 			Cell & cell = cells[activeObject.cellIndex];
 			CellObject & cellObject = cell.GetObject( activeObject.cellObjectIndex );
-			const float dx = cellObject.x - activation_x;
-			const float dy = cellObject.y - activation_y;
-			const float distanceSquared = dx*dx + dy*dy;
-			assert( !activeObject.pendingDeactivation && distanceSquared <= activation_radius_squared + 0.001f ||
-			         activeObject.pendingDeactivation && distanceSquared >= activation_radius_squared - 0.001f );
+			const float x = cell.objects.GetPositionX()[activeObject.cellObjectIndex];
+			const float y = cell.objects.GetPositionY()[activeObject.cellObjectIndex];
+			const bool inside = cell.coverCount > 0 || cellObject.refCount > 0;
+			assert( cell.coverCount > 0 || cellObject.refCount == CountCirclesContaining( x, y ) );
+			assert( !activeObject.pendingDeactivation && inside || activeObject.pendingDeactivation && !inside );
 		}
 		#endif
 	}
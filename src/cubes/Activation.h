@@ -34,9 +34,14 @@ namespace activation
 	typedef uint32_t ObjectId;
 	typedef uint32_t ActiveId;
 
+	const int MaxActivationPoints = 1023;				// limited by the cell object ref count bits
+
 	/*
 		The activation system divides the world up into grid cells.
 		This is the per-object entry for an object inside a cell.
+		Object positions are stored separately in the cell object set.
+		The ref count is the number of activation circles containing the object.
+		It is only kept up to date while no circle covers the whole cell.
 	*/
 	
 	struct CellObject
@@ -44,8 +49,8 @@ namespace activation
 		uint32_t id : 20;
 		uint32_t active : 1;
 		uint32_t disabled : 1;
-		uint32_t activeObjectIndex : 10;
-		float x,y;
+		uint32_t refCount : 10;
+		uint32_t activeObjectIndex;
 		#ifdef VALIDATION
  		int cellIndex;
 		void Clear()
@@ -53,10 +58,9 @@ namespace activation
 			id = 0;
 			active = 0;
 			disabled = 0;
+			refCount = 0;
 			activeObjectIndex = 0;
 			cellIndex = -1;
-			x = 0.0f;
-			y = 0.0f;
 		}
 		#endif
 	};
@@ -69,9 +73,9 @@ namespace activation
 	struct ActiveObject
 	{
  		uint32_t id : 20;
-		uint32_t cellIndex : 20;
- 		uint32_t cellObjectIndex : 12;
 		uint32_t pendingDeactivation : 1;
+		uint32_t cellIndex : 20;
+ 		uint32_t cellObjectIndex;						// full width, dense cells can hold more than 4096 objects
 		float pendingDeactivationTime;					// TODO - convert to n bits frame counter
 
 		#ifdef VALIDATION
@@ -264,12 +268,35 @@ namespace activation
 		Special handling is required when deleting an object
 		to keep the active object "cellObjectIndex" up to date
 		when the last item is moved into the deleted object slot.
+		Positions are kept in separate x and y arrays parallel
+		to the objects so distance tests over a cell vectorize.
 	*/
 	
 	class CellObjectSet : public Set<CellObject>
 	{
 	public:
 
+		CellObjectSet()
+		{
+			positionX = NULL;
+			positionY = NULL;
+		}
+
+		~CellObjectSet()
+		{
+			delete [] positionX;
+			delete [] positionY;
+		}
+
+		void Allocate( int initialSize )
+		{
+			Set<CellObject>::Allocate( initialSize );
+			positionX = new float[initialSize];
+			positionY = new float[initialSize];
+		}
+
+		CellObject & InsertObject( ObjectId id, float x, float y );
+
 		void DeleteObject( ActiveObject * activeObjects, ObjectId id );
 
 		void DeleteObject( ActiveObject * activeObjects, CellObject & cellObject );
@@ -278,11 +305,36 @@ namespace activation
 		{
 			return &objects[0];
 		}
+
+		const float * GetPositionX() const
+		{
+			return positionX;
+		}
+
+		const float * GetPositionY() const
+		{
+			return positionY;
+		}
+
+		void SetPosition( int index, float x, float y )
+		{
+			assert( index >= 0 );
+			assert( index < count );
+			positionX[index] = x;
+			positionY[index] = y;
+		}
 		
 	private:
 		
 		void DeleteObject( ObjectId id );
 		void DeleteObject( CellObject * object );
+
+		void Grow();
+		void Shrink();
+		void ResizePositions();
+
+		float * positionX;
+		float * positionY;
 	};
 	
 	/*
@@ -299,6 +351,7 @@ namespace activation
 		#endif
 		int ix,iy;
 		float x1,y1,x2,y2;
+		int coverCount;									// number of activation circles containing the whole cell
 		CellObjectSet objects;
 
 	#ifdef DEBUG
@@ -402,9 +455,24 @@ namespace activation
 		uint32_t id : 31;
 	};
 
+	/*
+		Each activation point is the center of an activation circle,
+		typically one per-player. Objects inside any enabled circle
+		are active. Moves are applied together on the next update,
+		so overlapping circles share one pass over the grid.
+	*/
+
+	struct ActivationPoint
+	{
+		float x,y;										// requested position, applied on the next update
+		bool enabled;
+		float applied_x,applied_y;						// position included in the cell object ref counts
+		bool applied;
+	};
+
 	/*
 		The activation system tracks which objects are in each grid cell,
-		and maintains the set of active objects for the local player.
+		and maintains the set of objects inside the activation circles.
 	*/
 	
 	class ActivationSystem
@@ -413,14 +481,21 @@ namespace activation
 
 		typedef std::vector<Event> Events;
 
-		ActivationSystem( int maxObjects, float radius, int width, int height, float size, int initialObjectsPerCell, int initialActiveObjects, float deactivationTime = 0.0f );
+		ActivationSystem( int maxObjects, float radius, int width, int height, float size, int initialObjectsPerCell, int initialActiveObjects, float deactivationTime = 0.0f, int numActivationPoints = 1 );
 		~ActivationSystem();
 
 		void SetEnabled( bool enabled );
 		
 		void Update( float deltaTime );
 
-		void MoveActivationPoint( float new_x, float new_y );
+		void MoveActivationPoint( float new_x, float new_y )
+		{
+			MoveActivationPoint( 0, new_x, new_y );
+		}
+
+		void MoveActivationPoint( int index, float new_x, float new_y );
+
+		void SetActivationPointEnabled( int index, bool enabled );
 		
 		void InsertObject( ObjectId id, float x, float y );
 
@@ -466,14 +541,30 @@ namespace activation
 			position.y = math::clamp( position.y, -bound_y, +bound_y );
 		}
 		
-		float GetX() const
+		float GetX( int index = 0 ) const
 		{
-			return activation_x;
+			assert( index >= 0 );
+			assert( index < (int) activation_points.size() );
+			return activation_points[index].x;
 		}
 
-		float GetY() const
+		float GetY( int index = 0 ) const
 		{
-			return activation_y;
+			assert( index >= 0 );
+			assert( index < (int) activation_points.size() );
+			return activation_points[index].y;
+		}
+
+		int GetNumActivationPoints() const
+		{
+			return (int) activation_points.size();
+		}
+
+		bool IsActivationPointEnabled( int index ) const
+		{
+			assert( index >= 0 );
+			assert( index < (int) activation_points.size() );
+			return activation_points[index].enabled;
 		}
 
 		int GetActiveCount() const
@@ -524,7 +615,7 @@ namespace activation
 		
 		int GetBytes() const
 		{
-			return sizeof( ActivationSystem ) + width * height * ( sizeof( Cell ) + sizeof( CellObject ) * initial_objects_per_cell ) + maxObjects * sizeof( int );
+			return sizeof( ActivationSystem ) + width * height * ( sizeof( Cell ) + ( sizeof( CellObject ) + 2 * sizeof( float ) ) * initial_objects_per_cell ) + maxObjects * sizeof( int );
 		}
 
         void DumpInfo()
@@ -534,7 +625,7 @@ namespace activation
             printf( "cell = %d bytes\n", (int) sizeof( Cell ) );
             printf( "cell object = %d bytes\n", (int) sizeof( CellObject ) );
             printf( "cell array = %d bytes\n", (int) ( width * height * sizeof( Cell ) ) );
-            printf( "cell objects = %d bytes\n", (int) ( width * height * sizeof( CellObject ) * initial_objects_per_cell ) );
+            printf( "cell objects = %d bytes\n", (int) ( width * height * ( sizeof( CellObject ) + 2 * sizeof( float ) ) * initial_objects_per_cell ) );
             printf( "initial objects per-cell = %d\n", initial_objects_per_cell );
             printf( "id to cell array = %d bytes\n", (int) ( maxObjects * sizeof( int ) ) );
             printf( "------------------------------------\n" );
@@ -542,10 +633,59 @@ namespace activation
 
 	protected:
 
-		void ActivateObjectsInsideCircle();
+		enum Overlap { Outside, Partial, Inside };
+
+		struct RowSpan
+		{
+			int outer1,outer2;							// cells in the row overlapping the circle. empty is width, -1
+			int inner1,inner2;							// cells in the row entirely inside the circle. empty is width, -1
+		};
+
+		struct RowCircle
+		{
+			int point;
+			RowSpan oldSpan;
+			RowSpan newSpan;
+		};
+
+		struct CellChange
+		{
+			int point;
+			int oldOverlap;
+			int newOverlap;
+		};
+
+		void UpdateActivationPoints();
 
 		void DeactivateAllObjects();
 
+		void ExtendRows( float y, int & iy1, int & iy2 ) const;
+
+		void MarkRowCells( int ix1, int ix2, int & mark1, int & mark2 );
+
+		int GetCellOverlap( const Cell & cell, float x, float y ) const;
+
+		void GetRowSpan( int iy, float x, float y, RowSpan & span ) const;
+
+		static int GetOverlap( const RowSpan & span, int ix )
+		{
+			if ( ix >= span.inner1 && ix <= span.inner2 )
+				return Inside;
+			if ( ix >= span.outer1 && ix <= span.outer2 )
+				return Partial;
+			return Outside;
+		}
+
+		void AccumulateOverlap( const float * positionX, const float * positionY, int count, float x, float y, int overlap, int sign, int * delta ) const;
+
+		void UpdateCellObjects( Cell & cell );
+
+		void UpdateCellObject( Cell & cell, CellObject & cellObject, bool inside );
+
+		bool IsInsideCircle( const Cell & cell, CellObject & cellObject, float x, float y );
+
+		int CountCirclesContaining( float x, float y ) const;
+
 		Cell * CellAtPosition( float x, float y )
 		{
 			assert( x >= -bound_x );
@@ -580,8 +720,6 @@ namespace activation
 		int height;
 		int maxObjects;
 		int initial_objects_per_cell;
-		float activation_x;
-		float activation_y;
 		float activation_radius;
 		float activation_radius_squared;
 		float size;
@@ -593,6 +731,14 @@ namespace activation
  		int * idToCellIndex;
 		Events activation_events;
 		ActiveObjectSet active_objects;
+		std::vector<ActivationPoint> activation_points;
+
+		// scratch for UpdateActivationPoints. kept between frames so there is no per-frame heap traffic
+		std::vector<int> changed_points;
+		std::vector<RowCircle> row_circles;
+		std::vector<uint8_t> row_mask;
+		std::vector<CellChange> cell_changes;
+		std::vector<int> refcount_delta;
 	};
 }
 
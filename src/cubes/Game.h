@@ -399,6 +399,11 @@ namespace game
 			return origin;
 		}
 
+		Simulation * GetSimulation()
+		{
+			return simulation;
+		}
+
 		void Update( float deltaTime = 0.1f )
 		{
 			for ( int i = 0; i < MaxPlayers; ++i )
@@ -885,7 +890,8 @@ namespace game
 
 			// build map from active id to active index
 			
-			std::vector<int> activeIdToIndex( maxActiveId + 1 );
+			if ( (int) activeIdToIndex.size() < maxActiveId + 1 )
+				activeIdToIndex.resize( maxActiveId + 1 );
 			for ( int i = 0; i < activeObjects.GetCount(); ++i )
 			{
 				ActiveObject & activeObject = activeObjects.GetObject( i );
@@ -893,65 +899,72 @@ namespace game
 			}
 			
 			// interaction based authority for active objects
+			//
+			// one flood fill over all players. each player floods out from the objects it has authority over,
+			// through enabled objects with default authority, claiming objects as they are reached. disabled
+			// objects are claimed but not flooded through. players flood in player id order, so a pile touched
+			// by two players still goes to the lower player id. each object is queued at most once per frame,
+			// so the cost is O(active objects + interaction pairs), and the scratch buffers persist across frames.
 
 			if ( InGame() && !GetFlag( FLAG_DisableInteractionAuthority ) )
 			{
+				const int numActiveObjects = activeObjects.GetCount();
+
+				if ( (int) authorityQueue.size() < numActiveObjects )
+				{
+					authorityQueue.resize( numActiveObjects );
+					authoritySeeds.resize( numActiveObjects );
+				}
+
+				// bucket objects under player authority by player. these are the sources of the flood fill
+
+				int seedStart[MaxPlayers+1];
+				memset( seedStart, 0, sizeof( seedStart ) );
+				for ( int i = 0; i < numActiveObjects; ++i )
+				{
+					const int authority = activeObjects.GetObject( i ).authority;
+					if ( authority < MaxPlayers )
+						seedStart[authority+1]++;
+				}
+				for ( int playerId = 0; playerId < MaxPlayers; ++playerId )
+					seedStart[playerId+1] += seedStart[playerId];
+
+				int seedEnd[MaxPlayers];
+				memcpy( seedEnd, seedStart, sizeof( seedEnd ) );
+				for ( int i = 0; i < numActiveObjects; ++i )
+				{
+					const int authority = activeObjects.GetObject( i ).authority;
+					if ( authority < MaxPlayers )
+						authoritySeeds[seedEnd[authority]++] = i;
+				}
+
 				for ( int playerId = 0; playerId < MaxPlayers; ++playerId )
 				{
-					std::vector<bool> interacting( maxActiveId + 1, false );
-					std::vector<bool> ignores( maxActiveId + 1, false );
-					std::vector<int> queue( activeObjects.GetCount() );
 					int head = 0;
 					int tail = 0;
 
-					for ( int i = 0; i < activeObjects.GetCount(); ++i )
-					{
-						ActiveObject & activeObject = activeObjects.GetObject( i );
-						const int activeId = activeObject.activeId;
-						assert( activeId >= 0 );
-						assert( activeId < (int) ignores.size() );
-						assert( activeId < (int) interacting.size() );
-						if ( activeObject.authority == playerId )
-						{
-							interacting[activeId] = true;
-							assert( head < activeObjects.GetCount() );
-							queue[head++] = activeObject.activeId;
-						}
-						else if ( activeObject.authority != MaxPlayers || activeObject.enabled == 0 )
-						{
-							ignores[activeId] = true;
-						}
-					}
-					
+					for ( int i = seedStart[playerId]; i < seedEnd[playerId]; ++i )
+						authorityQueue[tail++] = authoritySeeds[i];
+
 					while ( head != tail )
 					{
-						const std::vector<uint16_t> & objectInteractions = simulation->GetObjectInteractions( queue[tail] );
-						for ( int i = 0; i < (int) objectInteractions.size(); ++i )
+						ActiveObject & activeObject = activeObjects.GetObject( authorityQueue[head++] );
+						const ObjectInteractions objectInteractions = simulation->GetObjectInteractions( activeObject.activeId );
+						for ( int i = 0; i < objectInteractions.size(); ++i )
 						{
 							const int activeId = objectInteractions[i];
 							assert( activeId >= 0 );
-							assert( activeId < (int) interacting.size() );
-							if ( !ignores[activeId] && !interacting[activeId] )
+							assert( activeId <= maxActiveId );
+							const int index = activeIdToIndex[activeId];
+							ActiveObject & interactingObject = activeObjects.GetObject( index );
+							if ( interactingObject.authority != MaxPlayers )
+								continue;
+							interactingObject.authority = playerId;
+							if ( interactingObject.enabled )
 							{
-								assert( head < activeObjects.GetCount() );
-								queue[head++] = activeId;
-							}
-							interacting[activeId] = true;
-						}
-						tail++;
-					}
-					
-					for ( int i = 0; i <= maxActiveId; ++i )
-					{
-						if ( interacting[i] )
-						{
-							int index = activeIdToIndex[i];
-							ActiveObject & activeObject = activeObjects.GetObject( index );
-							if ( activeObject.authority == MaxPlayers || activeObject.authority == playerId )
-							{
-								activeObject.authority = playerId;
-								if ( activeObject.enabled )
-									activeObject.authorityTime = 0;
+								interactingObject.authorityTime = 0;
+								assert( tail < numActiveObjects );
+								authorityQueue[tail++] = index;
 							}
 						}
 					}
@@ -989,6 +1002,10 @@ namespace game
 
         activation::Set<ActiveObject> activeObjects;
 
+        std::vector<int> activeIdToIndex;                   // scratch for UpdateAuthority. kept between frames so there is no per-frame heap traffic
+        std::vector<int> authoritySeeds;
+        std::vector<int> authorityQueue;
+
         view::Packet viewPacket;
 	};
 }
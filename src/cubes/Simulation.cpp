@@ -23,6 +23,7 @@
 */
 
 #include "Simulation.h"
+#include "core/Core.h"
 #define dSINGLE
 #include <ode/ode.h>
 
@@ -39,6 +40,8 @@ namespace cubes
 			world = 0;
 			space = 0;
 			contacts = 0;
+			collisionTime = 0;
+			solverTime = 0;
 		}
 		
 		~SimulationImpl()
@@ -58,6 +61,8 @@ namespace cubes
 		dWorldID world;
 		dSpaceID space;
 		dJointGroupID contacts;
+		uint64_t collisionTime;
+		uint64_t solverTime;
 
 		struct ObjectData
 		{
@@ -83,7 +88,20 @@ namespace cubes
 		SimulationConfig config;
 		std::vector<dGeomID> planes;
 		std::vector<ObjectData> objects;
-		std::vector< std::vector<uint16_t> > interactions;
+
+		// interaction pairs are appended to a flat edge list during collision, then compacted so the
+		// objects interacting with object i are interactionIds[interactionOffsets[i]] .. interactionIds[interactionOffsets[i+1]-1].
+		// all three vectors keep their capacity between frames, so there is no per-frame heap traffic once warmed up.
+
+		struct InteractionPair
+		{
+			uint16_t a;
+			uint16_t b;
+		};
+
+		std::vector<InteractionPair> interactionPairs;
+		std::vector<int> interactionOffsets;
+		std::vector<uint16_t> interactionIds;
 
 	    dContact contact[MaxContacts];			
 
@@ -95,8 +113,45 @@ namespace cubes
 			uint64_t objectId1 = reinterpret_cast<uint64_t>( dBodyGetData( b1 ) );
 			uint64_t objectId2 = reinterpret_cast<uint64_t>( dBodyGetData( b2 ) );
 
-			interactions[objectId1].push_back( (uint16_t) objectId2 );
-			interactions[objectId2].push_back( (uint16_t) objectId1 );
+			InteractionPair pair;
+			pair.a = (uint16_t) objectId1;
+			pair.b = (uint16_t) objectId2;
+			interactionPairs.push_back( pair );
+		}
+
+		void BuildInteractions()
+		{
+			// counting sort of the edge list by object id. each object's interactions stay in collision order
+
+			const int numObjects = (int) objects.size();
+			const int numPairs = (int) interactionPairs.size();
+
+			interactionOffsets.assign( numObjects + 1, 0 );
+
+			for ( int i = 0; i < numPairs; ++i )
+			{
+				interactionOffsets[interactionPairs[i].a+1]++;
+				interactionOffsets[interactionPairs[i].b+1]++;
+			}
+
+			for ( int i = 0; i < numObjects; ++i )
+				interactionOffsets[i+1] += interactionOffsets[i];
+
+			interactionIds.resize( numPairs * 2 );
+
+			// fill using the start offsets as write cursors. afterwards each offset points at the start of the next object, so shift them back
+
+			for ( int i = 0; i < numPairs; ++i )
+			{
+				const InteractionPair & pair = interactionPairs[i];
+				interactionIds[interactionOffsets[pair.a]++] = pair.b;
+				interactionIds[interactionOffsets[pair.b]++] = pair.a;
+			}
+
+			for ( int i = numObjects; i > 0; --i )
+				interactionOffsets[i] = interactionOffsets[i-1];
+
+			interactionOffsets[0] = 0;
 		}
 
 		static void NearCallback( void * data, dGeomID o1, dGeomID o2 )
@@ -148,6 +203,38 @@ namespace cubes
 			dCloseODE();
 	}
 
+	static dSpaceID CreateSpace( const SimulationConfig & config )
+	{
+		switch ( config.Broadphase )
+		{
+			case BROADPHASE_QuadTree:
+			{
+				dVector3 center = { 0,0,0 };
+				dVector3 extents = { config.QuadTreeExtents, config.QuadTreeExtents, config.QuadTreeExtents };
+				return dQuadTreeSpaceCreate( 0, center, extents, config.QuadTreeDepth );
+			}
+
+			case BROADPHASE_Hash:
+			{
+				assert( config.HashMinLevel <= config.HashMaxLevel );
+				dSpaceID space = dHashSpaceCreate( 0 );
+				dHashSpaceSetLevels( space, config.HashMinLevel, config.HashMaxLevel );
+				return space;
+			}
+
+			case BROADPHASE_SweepAndPrune:
+			{
+				static const int axes[] = { dSAP_AXES_XYZ, dSAP_AXES_XZY, dSAP_AXES_YXZ, dSAP_AXES_YZX, dSAP_AXES_ZXY, dSAP_AXES_ZYX };
+				assert( config.SweepAndPruneAxisOrder >= 0 );
+				assert( config.SweepAndPruneAxisOrder < (int) ( sizeof( axes ) / sizeof( axes[0] ) ) );
+				return dSweepAndPruneSpaceCreate( 0, axes[config.SweepAndPruneAxisOrder] );
+			}
+		}
+
+		assert( false );
+		return 0;
+	}
+
 	void Simulation::Initialize( const SimulationConfig & config )
 	{
 		impl->config = config;
@@ -156,9 +243,7 @@ namespace cubes
 
 		impl->world = dWorldCreate();
 	    impl->contacts = dJointGroupCreate( 0 );
-	    dVector3 center = { 0,0,0 };
-	    dVector3 extents = { 100,100,100 };
-	    impl->space = dQuadTreeSpaceCreate( 0, center, extents, 10 );
+		impl->space = CreateSpace( config );
 
 		// configure world
 
@@ -186,12 +271,16 @@ namespace cubes
 
 	void Simulation::Update( float deltaTime, bool paused )
 	{		
-		impl->interactions.clear();
-		
-		impl->interactions.resize( impl->objects.size() );
+		impl->interactionPairs.clear();
+
+		impl->collisionTime = 0;
+		impl->solverTime = 0;
 
 		if ( paused )
+		{
+			impl->BuildInteractions();
 			return;
+		}
 
 		// IMPORTANT: do this *first* before updating simulation then at rest calculations
 		// will work properly with rough quantization (quantized state is fed in prior to update)
@@ -253,12 +342,22 @@ namespace cubes
 
 		dJointGroupEmpty( impl->contacts );
 
+		uint64_t start = core::nanoseconds();
+
 		dSpaceCollide( impl->space, impl, SimulationImpl::NearCallback );
 
+		impl->collisionTime = core::nanoseconds() - start;
+
+		impl->BuildInteractions();
+
+		start = core::nanoseconds();
+
 		if ( impl->config.QuickStep )
 			dWorldQuickStep( impl->world, deltaTime );
 		else
 			dWorldStep( impl->world, deltaTime );
+
+		impl->solverTime = core::nanoseconds() - start;
 	}
 	
 	int Simulation::AddObject( const SimulationObjectState & initialObjectState )
@@ -387,11 +486,30 @@ namespace cubes
 		}
 	}
 
-	const std::vector<uint16_t> & Simulation::GetObjectInteractions( int id ) const
+	ObjectInteractions Simulation::GetObjectInteractions( int id ) const
 	{
 		assert( id >= 0 );
-		assert( id < (int) impl->interactions.size() );
-		return impl->interactions[id];
+		assert( id + 1 < (int) impl->interactionOffsets.size() );
+		const int start = impl->interactionOffsets[id];
+		ObjectInteractions interactions;
+		interactions.ids = impl->interactionIds.data() + start;
+		interactions.count = impl->interactionOffsets[id+1] - start;
+		return interactions;
+	}
+
+	int Simulation::GetNumInteractionPairs() const
+	{
+		return (int) impl->interactionPairs.size();
+	}
+
+	uint64_t Simulation::GetCollisionTime() const
+	{
+		return impl->collisionTime;
+	}
+
+	uint64_t Simulation::GetSolverTime() const
+	{
+		return impl->solverTime;
 	}
 
 	void Simulation::ApplyForce( int id, const math::Vector & force )
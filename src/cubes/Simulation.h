@@ -31,6 +31,27 @@
 
 namespace cubes
 {	
+	// broadphase collision space
+
+	enum SimulationBroadphase
+	{
+		BROADPHASE_QuadTree,
+		BROADPHASE_Hash,
+		BROADPHASE_SweepAndPrune
+	};
+
+	// sweep and prune sorts along the first axis and tests overlap on the other two
+
+	enum SweepAndPruneAxes
+	{
+		SWEEP_AND_PRUNE_AXES_XYZ,
+		SWEEP_AND_PRUNE_AXES_XZY,
+		SWEEP_AND_PRUNE_AXES_YXZ,
+		SWEEP_AND_PRUNE_AXES_YZX,
+		SWEEP_AND_PRUNE_AXES_ZXY,
+		SWEEP_AND_PRUNE_AXES_ZYX
+	};
+
 	// simulation config
 
 	struct SimulationConfig
@@ -49,6 +70,12 @@ namespace cubes
 		float RestTime;
 		float LinearRestThresholdSquared;
 		float AngularRestThresholdSquared;
+		SimulationBroadphase Broadphase;
+		float QuadTreeExtents;						// half size of the quadtree root block, centered on the origin
+		int QuadTreeDepth;
+		int HashMinLevel;							// hash cells are 2^level units in size
+		int HashMaxLevel;
+		SweepAndPruneAxes SweepAndPruneAxisOrder;
 
 		SimulationConfig()
 		{
@@ -66,6 +93,12 @@ namespace cubes
 			RestTime = 0.1f;
 			LinearRestThresholdSquared = 0.25f * 0.25f;
 			AngularRestThresholdSquared = 0.25f * 0.25f;
+			Broadphase = BROADPHASE_QuadTree;
+			QuadTreeExtents = 100.0f;
+			QuadTreeDepth = 10;
+			HashMinLevel = -2;
+			HashMaxLevel = 4;
+			SweepAndPruneAxisOrder = SWEEP_AND_PRUNE_AXES_XYZ;
 		}  
 	};
 
@@ -81,6 +114,26 @@ namespace cubes
 		math::Vector angularVelocity;
 	};
 
+	// objects touching an object this frame. points into storage owned by the simulation, valid until the next update
+
+	struct ObjectInteractions
+	{
+		const uint16_t * ids;
+		int count;
+
+		int size() const { return count; }
+
+		const uint16_t * begin() const { return ids; }
+		const uint16_t * end() const { return ids + count; }
+
+		uint16_t operator [] ( int index ) const
+		{
+			assert( index >= 0 );
+			assert( index < count );
+			return ids[index];
+		}
+	};
+
 	// simulation class with dynamic object allocation
 
 	class Simulation
@@ -108,10 +161,16 @@ namespace cubes
 
 		void SetObjectState( int id, const SimulationObjectState & objectState, bool ignoreEnabledFlag = false );
 
-		const std::vector<uint16_t> & GetObjectInteractions( int id ) const;
+		ObjectInteractions GetObjectInteractions( int id ) const;
 
 		int GetNumInteractionPairs() const;
 
+		// nanoseconds spent in collision detection and in the solver during the last update
+
+		uint64_t GetCollisionTime() const;
+
+		uint64_t GetSolverTime() const;
+
 		void ApplyForce( int id, const math::Vector & force );
 
 		void ApplyTorque( int id, const math::Vector & torque );
@@ -6,10 +6,11 @@
 #include "Cubes.h"
 #include "Global.h"
 #include "Snapshot.h"
+#include "DeltaTables.h"
+#include "SnapshotDeltaEncoder.h"
 #include "Font.h"
 #include "FontManager.h"
 #include "protocol/Stream.h"
-#include "protocol/SlidingWindow.h"
 #include "protocol/SequenceBuffer.h"
 #include "protocol/PacketFactory.h"
 #include "network/Simulator.h"
@@ -17,6 +18,7 @@
 static const int LeftPort = 1000;
 static const int RightPort = 1001;
 static const int MaxSnapshots = 256;
+static const int MaxDeltaClients = 1;                // the right simulation is the only client
 static const int MaxPacketSize = 64 * 1024;         // this has to be really large for the worst case!
 
 #if DELTA_DATA
@@ -85,7 +87,7 @@ static FILE * axis_angle_values = nullptr;
 
 enum Context
 {
-    CONTEXT_QUANTIZED_SNAPSHOT_SLIDING_WINDOW,      // quantized send snapshots (for serialize write)
+    CONTEXT_SNAPSHOT_DELTA_ENCODER,                 // quantized send snapshots and baselines (for serialize write)
     CONTEXT_QUANTIZED_SNAPSHOT_SEQUENCE_BUFFER,     // quantized recv snapshots (for serialize read)
     CONTEXT_QUANTIZED_INITIAL_SNAPSHOT              // quantized initial snapshot
 };
@@ -134,7 +136,6 @@ static void InitDeltaModes()
     // ...
 }
 
-typedef protocol::SlidingWindow<QuantizedSnapshot> QuantizedSnapshotSlidingWindow;
 typedef protocol::SequenceBuffer<QuantizedSnapshot> QuantizedSnapshotSequenceBuffer;
 
 enum DeltaPackets
@@ -221,9 +222,6 @@ template <typename Stream> void serialize_relative_position( Stream & stream,
                                                              int base_position_y,
                                                              int base_position_z )
 {
-    const int RelativePositionBound_Small = 16;
-    const int RelativePositionBound_Large = 256;
-
     bool relative_position = false;
     bool relative_position_small_x = false;
     bool relative_position_small_y = false;
@@ -348,9 +346,6 @@ template <typename Stream> void serialize_cube_relative_position( Stream & strea
 
 template <typename Stream> void serialize_relative_orientation( Stream & stream, compressed_quaternion<9> & orientation, const compressed_quaternion<9> & base_orientation )
 {
-    const int RelativeOrientationBound_Small = 16;
-    const int RelativeOrientationBound_Large = 128;
-
     bool relative_orientation = false;
     bool small_a = false;
     bool small_b = false;
@@ -708,7 +703,7 @@ struct DeltaSnapshotPacket : public protocol::Packet
 
     PROTOCOL_SERIALIZE_OBJECT( stream )
     {
-        auto quantized_snapshot_sliding_window = (QuantizedSnapshotSlidingWindow*) stream.GetContext( CONTEXT_QUANTIZED_SNAPSHOT_SLIDING_WINDOW );
+        auto snapshot_delta_encoder = (const SnapshotDeltaEncoder*) stream.GetContext( CONTEXT_SNAPSHOT_DELTA_ENCODER );
         auto quantized_snapshot_sequence_buffer = (QuantizedSnapshotSequenceBuffer*) stream.GetContext( CONTEXT_QUANTIZED_SNAPSHOT_SEQUENCE_BUFFER );
         auto quantized_initial_snapshot = (QuantizedSnapshot*) stream.GetContext( CONTEXT_QUANTIZED_INITIAL_SNAPSHOT );
 
@@ -725,8 +720,8 @@ struct DeltaSnapshotPacket : public protocol::Packet
 
         if ( Stream::IsWriting )
         {
-            CORE_ASSERT( quantized_snapshot_sliding_window );
-            auto & entry = quantized_snapshot_sliding_window->Get( sequence );
+            CORE_ASSERT( snapshot_delta_encoder );
+            auto & entry = snapshot_delta_encoder->GetSnapshot( sequence );
             quantized_cubes = (QuantizedCubeState*) &entry.cubes[0];
         }
         else
@@ -757,8 +752,8 @@ struct DeltaSnapshotPacket : public protocol::Packet
                 {
                     if ( Stream::IsWriting )
                     {
-                        CORE_ASSERT( quantized_snapshot_sliding_window );
-                        auto & entry = quantized_snapshot_sliding_window->Get( base_sequence );
+                        CORE_ASSERT( snapshot_delta_encoder );
+                        auto & entry = snapshot_delta_encoder->GetSnapshot( base_sequence );
                         quantized_base_cubes = (QuantizedCubeState*) &entry.cubes[0];
                     }
                     else
@@ -810,8 +805,8 @@ struct DeltaSnapshotPacket : public protocol::Packet
                 {
                     if ( Stream::IsWriting )
                     {
-                        CORE_ASSERT( quantized_snapshot_sliding_window );
-                        auto & entry = quantized_snapshot_sliding_window->Get( base_sequence );
+                        CORE_ASSERT( snapshot_delta_encoder );
+                        auto & entry = snapshot_delta_encoder->GetSnapshot( base_sequence );
                         quantized_base_cubes = (QuantizedCubeState*) &entry.cubes[0];
                     }
                     else
@@ -914,8 +909,8 @@ struct DeltaSnapshotPacket : public protocol::Packet
                 {
                     if ( Stream::IsWriting )
                     {
-                        CORE_ASSERT( quantized_snapshot_sliding_window );
-                        auto & entry = quantized_snapshot_sliding_window->Get( base_sequence );
+                        CORE_ASSERT( snapshot_delta_encoder );
+                        auto & entry = snapshot_delta_encoder->GetSnapshot( base_sequence );
                         quantized_base_cubes = (QuantizedCubeState*) &entry.cubes[0];
                     }
                     else
@@ -1050,8 +1045,8 @@ struct DeltaSnapshotPacket : public protocol::Packet
                 {
                     if ( Stream::IsWriting )
                     {
-                        CORE_ASSERT( quantized_snapshot_sliding_window );
-                        auto & entry = quantized_snapshot_sliding_window->Get( base_sequence );
+                        CORE_ASSERT( snapshot_delta_encoder );
+                        auto & entry = snapshot_delta_encoder->GetSnapshot( base_sequence );
                         quantized_base_cubes = (QuantizedCubeState*) &entry.cubes[0];
                     }
                     else
@@ -1178,8 +1173,8 @@ struct DeltaSnapshotPacket : public protocol::Packet
                 {
                     if ( Stream::IsWriting )
                     {
-                        CORE_ASSERT( quantized_snapshot_sliding_window );
-                        auto & entry = quantized_snapshot_sliding_window->Get( base_sequence );
+                        CORE_ASSERT( snapshot_delta_encoder );
+                        auto & entry = snapshot_delta_encoder->GetSnapshot( base_sequence );
                         quantized_base_cubes = (QuantizedCubeState*) &entry.cubes[0];
                     }
                     else
@@ -1346,12 +1341,16 @@ struct DeltaInternal
     {
         this->allocator = &allocator;
         network::SimulatorConfig networkSimulatorConfig;
-        quantized_snapshot_sliding_window = CORE_NEW( allocator, QuantizedSnapshotSlidingWindow, allocator, MaxSnapshots );
+        SnapshotDeltaEncoderConfig snapshotDeltaEncoderConfig;
+        snapshotDeltaEncoderConfig.allocator = &allocator;
+        snapshotDeltaEncoderConfig.maxClients = MaxDeltaClients;
+        snapshotDeltaEncoderConfig.historySize = MaxSnapshots;
+        snapshot_delta_encoder = CORE_NEW( allocator, SnapshotDeltaEncoder, snapshotDeltaEncoderConfig );
         quantized_snapshot_sequence_buffer = CORE_NEW( allocator, QuantizedSnapshotSequenceBuffer, allocator, MaxSnapshots );
         networkSimulatorConfig.packetFactory = &packet_factory;
         networkSimulatorConfig.maxPacketSize = MaxPacketSize;
         network_simulator = CORE_NEW( allocator, network::Simulator, networkSimulatorConfig );
-        context[0] = quantized_snapshot_sliding_window;
+        context[0] = snapshot_delta_encoder;
         context[1] = quantized_snapshot_sequence_buffer;
         context[2] = &quantized_initial_snapshot;
         network_simulator->SetContext( context );
@@ -1363,10 +1362,10 @@ struct DeltaInternal
         CORE_ASSERT( network_simulator );
         typedef network::Simulator NetworkSimulator;
         CORE_DELETE( *allocator, NetworkSimulator, network_simulator );
-        CORE_DELETE( *allocator, QuantizedSnapshotSlidingWindow, quantized_snapshot_sliding_window );
+        CORE_DELETE( *allocator, SnapshotDeltaEncoder, snapshot_delta_encoder );
         CORE_DELETE( *allocator, QuantizedSnapshotSequenceBuffer, quantized_snapshot_sequence_buffer );
         network_simulator = nullptr;
-        quantized_snapshot_sliding_window = nullptr;
+        snapshot_delta_encoder = nullptr;
         quantized_snapshot_sequence_buffer = nullptr;
     }
 
@@ -1376,22 +1375,18 @@ struct DeltaInternal
         network_simulator->Reset();
         network_simulator->ClearStates();
         network_simulator->AddState( { mode_data.latency, mode_data.jitter, mode_data.packet_loss } );
-        quantized_snapshot_sliding_window->Reset();
+        snapshot_delta_encoder->Reset();
         quantized_snapshot_sequence_buffer->Reset();
-        send_sequence = 0;
         recv_sequence = 0;
         send_accumulator = 1.0f;
-        received_ack = false;
     }
 
     core::Allocator * allocator;
-    uint16_t send_sequence;
     uint16_t recv_sequence;
-    bool received_ack;
     float send_accumulator;
     const void * context[3];
     network::Simulator * network_simulator;
-    QuantizedSnapshotSlidingWindow * quantized_snapshot_sliding_window;
+    SnapshotDeltaEncoder * snapshot_delta_encoder;
     QuantizedSnapshotSequenceBuffer * quantized_snapshot_sequence_buffer;
     DeltaPacketFactory packet_factory;
     SnapshotInterpolationBuffer interpolation_buffer;
@@ -1632,15 +1627,16 @@ void DeltaDemo::Update()
 
         auto snapshot_packet = (DeltaSnapshotPacket*) m_delta->packet_factory.Create( DELTA_SNAPSHOT_PACKET );
 
-        snapshot_packet->sequence = m_delta->send_sequence++;
-        snapshot_packet->base_sequence = m_delta->quantized_snapshot_sliding_window->GetAck() + 1;
-        snapshot_packet->initial = !m_delta->received_ack;
-
         snapshot_packet->delta_mode = GetMode();
 
         uint16_t sequence;
 
-        auto & snapshot = m_delta->quantized_snapshot_sliding_window->Insert( sequence );
+        auto & snapshot = m_delta->snapshot_delta_encoder->InsertSnapshot( sequence );
+
+        // pick the baseline after inserting, in case the insert overwrote it in the history
+
+        snapshot_packet->sequence = sequence;
+        snapshot_packet->initial = !m_delta->snapshot_delta_encoder->GetBaseline( 0, snapshot_packet->base_sequence );
 
         if ( GetQuantizedSnapshot( game_instance, snapshot ) )
         {
@@ -1706,8 +1702,7 @@ void DeltaDemo::Update()
             CORE_ASSERT( quantized_snapshot );
     
             Snapshot snapshot;
-            for ( int i = 0; i < NumCubes; ++i )
-                quantized_snapshot->cubes[i].Save( snapshot.cubes[i] );
+            DequantizeSnapshot( *quantized_snapshot, snapshot );
 
             m_delta->interpolation_buffer.AddSnapshot( global.timeBase.time, snapshot_packet->sequence, snapshot.cubes );
 
@@ -1721,8 +1716,7 @@ void DeltaDemo::Update()
         {
             auto ack_packet = (DeltaAckPacket*) packet;
 
-            m_delta->quantized_snapshot_sliding_window->Ack( ack_packet->ack - 1 );
-            m_delta->received_ack = true;
+            m_delta->snapshot_delta_encoder->ProcessAck( 0, ack_packet->ack );
         }
 
         m_delta->packet_factory.Destroy( packet );
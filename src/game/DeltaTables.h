@@ -0,0 +1,15 @@
+// Delta coding bounds, written by DeltaTool from DeltaDemo delta histograms. Regenerate rather than editing by hand.
+//
+// These are the original hand tuned bounds until histograms are captured. Run DeltaDemo with DELTA_STATS, then:
+// DeltaTool src/game/DeltaTables.h RelativePosition:output/delta_position.txt RelativeOrientation:output/delta_smallest_three.txt
+
+#ifndef GAME_DELTA_TABLES_H
+#define GAME_DELTA_TABLES_H
+
+constexpr int RelativePositionBound_Small = 16;
+constexpr int RelativePositionBound_Large = 256;
+
+constexpr int RelativeOrientationBound_Small = 16;
+constexpr int RelativeOrientationBound_Large = 128;
+
+#endif
@@ -10,6 +10,14 @@
 #include "protocol/Object.h"
 #include "protocol/SequenceBuffer.h"
 
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif // #if defined( __SSE2__ )
+
+#if defined( __SSE4_1__ )
+#include <smmintrin.h>
+#endif // #if defined( __SSE4_1__ )
+
 #define DELTA_STATS 1
 #define DELTA_DATA 1
 //#define SERIALIZE_ANGULAR_VELOCITY
@@ -1230,18 +1238,45 @@ inline bool GetSnapshot( GameInstance * game_instance, Snapshot & snapshot )
     return true;
 }
 
-inline bool GetQuantizedSnapshot( GameInstance * game_instance, QuantizedSnapshot & snapshot )
+/*
+    Batch quantization.
+
+    Active objects are quantized four at a time: each group is gathered into SoA form with one SSE2 lane
+    per cube, quantized in registers, then scattered back into the snapshot. Every operation mirrors the
+    scalar Load/Save functions above (same operation order, division rather than multiplication by the
+    reciprocal, rsqrt when normalizing like vectorial) so the result is bit-exact with the per-cube path,
+    as long as the compiler is not allowed to contract the scalar path into FMA instructions.
+
+    tests/game/ProfileSnapshot.cpp checks this and measures both paths.
+*/
+
+inline CubeState GetCubeState( const hypercube::ActiveObject & object )
 {
-    const int num_active_objects = game_instance->GetNumActiveObjects();
+    CubeState cube_state;
 
-    if ( num_active_objects == 0 )
-        return false;
+    cube_state.position = vectorial::vec3f( object.position.x, object.position.y, object.position.z );
 
-    const hypercube::ActiveObject * active_objects = game_instance->GetActiveObjects();
+    cube_state.orientation = vectorial::quat4f( object.orientation.x, 
+                                                object.orientation.y, 
+                                                object.orientation.z,
+                                                object.orientation.w );
 
-    CORE_ASSERT( active_objects );
+    cube_state.linear_velocity = vectorial::vec3f( object.linearVelocity.x, 
+                                                   object.linearVelocity.y,
+                                                   object.linearVelocity.z );
 
-    for ( int i = 0; i < num_active_objects; ++i )
+    cube_state.angular_velocity = vectorial::vec3f( object.angularVelocity.x, 
+                                                    object.angularVelocity.y,
+                                                    object.angularVelocity.z );
+
+    cube_state.interacting = object.authority == 0;
+
+    return cube_state;
+}
+
+template <typename QuantizedSnapshotType> inline void QuantizeCubes_Scalar( const hypercube::ActiveObject * active_objects, int begin, int end, QuantizedSnapshotType & snapshot )
+{
+    for ( int i = begin; i < end; ++i )
     {
         auto & object = active_objects[i];
 
@@ -1250,77 +1285,456 @@ inline bool GetQuantizedSnapshot( GameInstance * game_instance, QuantizedSnapsho
         CORE_ASSERT( index >= 0 );
         CORE_ASSERT( index < NumCubes );
 
-        CubeState cube_state;
+        snapshot.cubes[index].Load( GetCubeState( object ) );
+    }
+}
+
+inline void DequantizeSnapshot_Scalar( const QuantizedSnapshot & quantized_snapshot, Snapshot & snapshot )
+{
+    for ( int i = 0; i < NumCubes; ++i )
+        quantized_snapshot.cubes[i].Save( snapshot.cubes[i] );
+}
+
+#if defined( __SSE2__ )
+
+#define SIMD_GATHER( objects, member ) _mm_setr_ps( objects[0].member, objects[1].member, objects[2].member, objects[3].member )
+
+#define SIMD_GATHER_INT( objects, member ) simd_gather_int( objects[0].member, objects[1].member, objects[2].member, objects[3].member )
+
+inline __m128i simd_gather_int( int a, int b, int c, int d )
+{
+    // IMPORTANT: built with unpacks rather than _mm_setr_epi32, which SSE2 builds bounce through the stack and stall on store forwarding
+    const __m128i ab = _mm_unpacklo_epi32( _mm_cvtsi32_si128( a ), _mm_cvtsi32_si128( b ) );
+    const __m128i cd = _mm_unpacklo_epi32( _mm_cvtsi32_si128( c ), _mm_cvtsi32_si128( d ) );
+    return _mm_unpacklo_epi64( ab, cd );
+}
+
+inline __m128 simd_select( __m128 mask, __m128 a, __m128 b )
+{
+    return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+inline __m128i simd_floor_to_int( __m128 value )
+{
+#if defined( __SSE4_1__ )
+    return _mm_cvttps_epi32( _mm_floor_ps( value ) );
+#else // #if defined( __SSE4_1__ )
+    // truncate, then step down the lanes where truncation rounded up (negative non-integers)
+    const __m128i truncated = _mm_cvttps_epi32( value );
+    const __m128 rounded_up = _mm_cmpgt_ps( _mm_cvtepi32_ps( truncated ), value );
+    return _mm_add_epi32( truncated, _mm_castps_si128( rounded_up ) );
+#endif // #if defined( __SSE4_1__ )
+}
+
+inline __m128i simd_quantize( __m128 value, float units )
+{
+    // (int) floor( value * units + 0.5f )
+    return simd_floor_to_int( _mm_add_ps( _mm_mul_ps( value, _mm_set1_ps( units ) ), _mm_set1_ps( 0.5f ) ) );
+}
+
+inline __m128 simd_dequantize( __m128i value, float units )
+{
+    // value * 1.0f / units
+    return _mm_div_ps( _mm_cvtepi32_ps( value ), _mm_set1_ps( units ) );
+}
+
+template <int bits> inline void simd_quantize_orientation( __m128 x, __m128 y, __m128 z, __m128 w, 
+                                                           __m128i & largest, __m128i & integer_a, __m128i & integer_b, __m128i & integer_c )
+{
+    const float minimum = - 1.0f / 1.414214f;       // 1.0f / sqrt(2)
+    const float maximum = + 1.0f / 1.414214f;
+
+    const float scale = float( ( 1 << bits ) - 1 );
+
+    const __m128 sign_bit = _mm_set1_ps( -0.0f );
+
+    const __m128 abs_x = _mm_andnot_ps( sign_bit, x );
+    const __m128 abs_y = _mm_andnot_ps( sign_bit, y );
+    const __m128 abs_z = _mm_andnot_ps( sign_bit, z );
+    const __m128 abs_w = _mm_andnot_ps( sign_bit, w );
 
-        cube_state.position = vectorial::vec3f( object.position.x, object.position.y, object.position.z );
+    // strict compares so the earlier component wins a tie, same as the scalar code
 
-        cube_state.orientation = vectorial::quat4f( object.orientation.x, 
-                                                    object.orientation.y, 
-                                                    object.orientation.z,
-                                                    object.orientation.w );
+    const __m128 is_y = _mm_cmpgt_ps( abs_y, abs_x );
+    const __m128 largest_xy = simd_select( is_y, abs_y, abs_x );
+    const __m128 is_z = _mm_cmpgt_ps( abs_z, largest_xy );
+    const __m128 is_w = _mm_cmpgt_ps( abs_w, simd_select( is_z, abs_z, largest_xy ) );
 
-        cube_state.linear_velocity = vectorial::vec3f( object.linearVelocity.x, 
-                                                       object.linearVelocity.y,
-                                                       object.linearVelocity.z );
+    const __m128 largest_0 = _mm_andnot_ps( _mm_or_ps( _mm_or_ps( is_y, is_z ), is_w ), _mm_castsi128_ps( _mm_set1_epi32( -1 ) ) );
+    const __m128 largest_1 = _mm_andnot_ps( _mm_or_ps( is_z, is_w ), is_y );
+    const __m128 largest_2 = _mm_andnot_ps( is_w, is_z );
+    const __m128 largest_3 = is_w;
 
-        cube_state.angular_velocity = vectorial::vec3f( object.angularVelocity.x, 
-                                                        object.angularVelocity.y,
-                                                        object.angularVelocity.z );
+    largest = _mm_and_si128( _mm_castps_si128( largest_1 ), _mm_set1_epi32( 1 ) );
+    largest = _mm_or_si128( largest, _mm_and_si128( _mm_castps_si128( largest_2 ), _mm_set1_epi32( 2 ) ) );
+    largest = _mm_or_si128( largest, _mm_and_si128( _mm_castps_si128( largest_3 ), _mm_set1_epi32( 3 ) ) );
 
-        cube_state.interacting = object.authority == 0;
+    // the three smallest components, negated unless the largest component is >= 0 (so NaN matches too)
 
-        snapshot.cubes[index].Load( cube_state );
+    const __m128 largest_value = simd_select( largest_3, w, simd_select( largest_2, z, simd_select( largest_1, y, x ) ) );
+
+    const __m128 flip = _mm_and_ps( _mm_cmpnge_ps( largest_value, _mm_setzero_ps() ), sign_bit );
+
+    const __m128 a = _mm_xor_ps( simd_select( largest_0, y, x ), flip );
+    const __m128 b = _mm_xor_ps( simd_select( _mm_or_ps( largest_0, largest_1 ), z, y ), flip );
+    const __m128 c = _mm_xor_ps( simd_select( largest_3, z, w ), flip );
+
+    const __m128 simd_minimum = _mm_set1_ps( minimum );
+    const __m128 simd_range = _mm_set1_ps( maximum - minimum );
+    const __m128 simd_scale = _mm_set1_ps( scale );
+    const __m128 half = _mm_set1_ps( 0.5f );
+
+    const __m128 normal_a = _mm_div_ps( _mm_sub_ps( a, simd_minimum ), simd_range );
+    const __m128 normal_b = _mm_div_ps( _mm_sub_ps( b, simd_minimum ), simd_range );
+    const __m128 normal_c = _mm_div_ps( _mm_sub_ps( c, simd_minimum ), simd_range );
+
+    // masked because the scalar code truncates to the bitfield width
+
+    const __m128i mask = _mm_set1_epi32( ( 1 << bits ) - 1 );
+
+    integer_a = _mm_and_si128( simd_floor_to_int( _mm_add_ps( _mm_mul_ps( normal_a, simd_scale ), half ) ), mask );
+    integer_b = _mm_and_si128( simd_floor_to_int( _mm_add_ps( _mm_mul_ps( normal_b, simd_scale ), half ) ), mask );
+    integer_c = _mm_and_si128( simd_floor_to_int( _mm_add_ps( _mm_mul_ps( normal_c, simd_scale ), half ) ), mask );
+}
+
+template <int bits> inline void simd_dequantize_orientation( __m128i largest, __m128i integer_a, __m128i integer_b, __m128i integer_c,
+                                                             __m128 & x, __m128 & y, __m128 & z, __m128 & w )
+{
+    const float minimum = - 1.0f / 1.414214f;       // 1.0f / sqrt(2)
+    const float maximum = + 1.0f / 1.414214f;
+
+    const float scale = float( ( 1 << bits ) - 1 );
+
+    const float inverse_scale = 1.0f / scale;
+
+    const __m128 largest_0 = _mm_castsi128_ps( _mm_cmpeq_epi32( largest, _mm_set1_epi32( 0 ) ) );
+    const __m128 largest_1 = _mm_castsi128_ps( _mm_cmpeq_epi32( largest, _mm_set1_epi32( 1 ) ) );
+    const __m128 largest_2 = _mm_castsi128_ps( _mm_cmpeq_epi32( largest, _mm_set1_epi32( 2 ) ) );
+    const __m128 largest_3 = _mm_castsi128_ps( _mm_cmpeq_epi32( largest, _mm_set1_epi32( 3 ) ) );
+
+    const __m128 simd_minimum = _mm_set1_ps( minimum );
+    const __m128 simd_range = _mm_set1_ps( maximum - minimum );
+    const __m128 simd_inverse_scale = _mm_set1_ps( inverse_scale );
+
+    const __m128 a = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( _mm_cvtepi32_ps( integer_a ), simd_inverse_scale ), simd_range ), simd_minimum );
+    const __m128 b = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( _mm_cvtepi32_ps( integer_b ), simd_inverse_scale ), simd_range ), simd_minimum );
+    const __m128 c = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( _mm_cvtepi32_ps( integer_c ), simd_inverse_scale ), simd_range ), simd_minimum );
+
+    const __m128 d = _mm_sqrt_ps( _mm_sub_ps( _mm_sub_ps( _mm_sub_ps( _mm_set1_ps( 1.0f ), _mm_mul_ps( a, a ) ), _mm_mul_ps( b, b ) ), _mm_mul_ps( c, c ) ) );
+
+    x = simd_select( largest_0, d, a );
+    y = simd_select( largest_0, a, simd_select( largest_1, d, b ) );
+    z = simd_select( _mm_or_ps( largest_0, largest_1 ), b, simd_select( largest_2, d, c ) );
+    w = simd_select( largest_3, d, c );
+
+    // vectorial::normalize: multiply by rsqrt of ( ( x*x + y*y ) + z*z ) + w*w
+
+    const __m128 length_squared = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ), _mm_mul_ps( w, w ) );
+    const __m128 inverse_length = _mm_rsqrt_ps( length_squared );
+
+    x = _mm_mul_ps( x, inverse_length );
+    y = _mm_mul_ps( y, inverse_length );
+    z = _mm_mul_ps( z, inverse_length );
+    w = _mm_mul_ps( w, inverse_length );
+}
+
+struct CubeStateBatch
+{
+    __m128 position_x, position_y, position_z;
+    __m128 orientation_x, orientation_y, orientation_z, orientation_w;
+
+    void Load( const hypercube::ActiveObject * objects )
+    {
+        position_x = SIMD_GATHER( objects, position.x );
+        position_y = SIMD_GATHER( objects, position.y );
+        position_z = SIMD_GATHER( objects, position.z );
+        orientation_x = SIMD_GATHER( objects, orientation.x );
+        orientation_y = SIMD_GATHER( objects, orientation.y );
+        orientation_z = SIMD_GATHER( objects, orientation.z );
+        orientation_w = SIMD_GATHER( objects, orientation.w );
     }
 
-    return true;
+    void GetOriginal( vectorial::vec3f * position, vectorial::quat4f * orientation ) const
+    {
+        __m128 x = position_x, y = position_y, z = position_z, w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS( x, y, z, w );
+        position[0] = vectorial::vec3f( x );
+        position[1] = vectorial::vec3f( y );
+        position[2] = vectorial::vec3f( z );
+        position[3] = vectorial::vec3f( w );
+
+        x = orientation_x, y = orientation_y, z = orientation_z, w = orientation_w;
+        _MM_TRANSPOSE4_PS( x, y, z, w );
+        orientation[0] = vectorial::quat4f( vectorial::vec4f( x ) );
+        orientation[1] = vectorial::quat4f( vectorial::vec4f( y ) );
+        orientation[2] = vectorial::quat4f( vectorial::vec4f( z ) );
+        orientation[3] = vectorial::quat4f( vectorial::vec4f( w ) );
+    }
+};
+
+struct QuantizedCubeStateBatch
+{
+    int position_x[4];
+    int position_y[4];
+    int position_z[4];
+    uint32_t largest[4];
+    uint32_t integer_a[4];
+    uint32_t integer_b[4];
+    uint32_t integer_c[4];
+
+    template <int bits> void Quantize( const CubeStateBatch & batch, float units )
+    {
+        _mm_storeu_si128( (__m128i*) position_x, simd_quantize( batch.position_x, units ) );
+        _mm_storeu_si128( (__m128i*) position_y, simd_quantize( batch.position_y, units ) );
+        _mm_storeu_si128( (__m128i*) position_z, simd_quantize( batch.position_z, units ) );
+
+        __m128i simd_largest, simd_a, simd_b, simd_c;
+        simd_quantize_orientation<bits>( batch.orientation_x, batch.orientation_y, batch.orientation_z, batch.orientation_w, simd_largest, simd_a, simd_b, simd_c );
+        _mm_storeu_si128( (__m128i*) largest, simd_largest );
+        _mm_storeu_si128( (__m128i*) integer_a, simd_a );
+        _mm_storeu_si128( (__m128i*) integer_b, simd_b );
+        _mm_storeu_si128( (__m128i*) integer_c, simd_c );
+    }
+};
+
+struct QuantizedVelocityBatch
+{
+    int linear_velocity_x[4];
+    int linear_velocity_y[4];
+    int linear_velocity_z[4];
+    int angular_velocity_x[4];
+    int angular_velocity_y[4];
+    int angular_velocity_z[4];
+
+    void Quantize( const hypercube::ActiveObject * objects, float units )
+    {
+        _mm_storeu_si128( (__m128i*) linear_velocity_x, simd_quantize( SIMD_GATHER( objects, linearVelocity.x ), units ) );
+        _mm_storeu_si128( (__m128i*) linear_velocity_y, simd_quantize( SIMD_GATHER( objects, linearVelocity.y ), units ) );
+        _mm_storeu_si128( (__m128i*) linear_velocity_z, simd_quantize( SIMD_GATHER( objects, linearVelocity.z ), units ) );
+        _mm_storeu_si128( (__m128i*) angular_velocity_x, simd_quantize( SIMD_GATHER( objects, angularVelocity.x ), units ) );
+        _mm_storeu_si128( (__m128i*) angular_velocity_y, simd_quantize( SIMD_GATHER( objects, angularVelocity.y ), units ) );
+        _mm_storeu_si128( (__m128i*) angular_velocity_z, simd_quantize( SIMD_GATHER( objects, angularVelocity.z ), units ) );
+    }
+};
+
+#endif // #if defined( __SSE2__ )
+
+inline void QuantizeCubes( const hypercube::ActiveObject * active_objects, int num_active_objects, QuantizedSnapshot & snapshot )
+{
+    int i = 0;
+
+#if defined( __SSE2__ )
+
+    for ( ; i + 4 <= num_active_objects; i += 4 )
+    {
+        const hypercube::ActiveObject * objects = active_objects + i;
+
+        CubeStateBatch batch;
+        batch.Load( objects );
+
+        QuantizedCubeStateBatch quantized;
+        quantized.Quantize<OrientationBits>( batch, UnitsPerMeter );
+
+#if defined( DELTA_STATS ) || defined( DELTA_DATA )
+        vectorial::vec3f original_position[4];
+        vectorial::quat4f original_orientation[4];
+        batch.GetOriginal( original_position, original_orientation );
+#endif // #if defined( DELTA_STATS ) || defined( DELTA_DATA )
+
+        for ( int j = 0; j < 4; ++j )
+        {
+            const int index = objects[j].id - 1;
+
+            CORE_ASSERT( index >= 0 );
+            CORE_ASSERT( index < NumCubes );
+
+            auto & cube = snapshot.cubes[index];
+            cube.interacting = objects[j].authority == 0;
+            cube.position_x = quantized.position_x[j];
+            cube.position_y = quantized.position_y[j];
+            cube.position_z = quantized.position_z[j];
+            cube.orientation.largest = quantized.largest[j];
+            cube.orientation.integer_a = quantized.integer_a[j];
+            cube.orientation.integer_b = quantized.integer_b[j];
+            cube.orientation.integer_c = quantized.integer_c[j];
+#if defined( DELTA_STATS ) || defined( DELTA_DATA )
+            cube.original_position = original_position[j];
+            cube.original_orientation = original_orientation[j];
+#endif // #if defined( DELTA_STATS ) || defined( DELTA_DATA )
+        }
+    }
+
+#endif // #if defined( __SSE2__ )
+
+    QuantizeCubes_Scalar( active_objects, i, num_active_objects, snapshot );
 }
 
-inline bool GetQuantizedSnapshotWithVelocity( GameInstance * game_instance, QuantizedSnapshotWithVelocity & snapshot )
+inline void QuantizeCubes( const hypercube::ActiveObject * active_objects, int num_active_objects, QuantizedSnapshotWithVelocity & snapshot )
 {
-    const int num_active_objects = game_instance->GetNumActiveObjects();
+    int i = 0;
 
-    if ( num_active_objects == 0 )
-        return false;
+#if defined( __SSE2__ )
 
-    const hypercube::ActiveObject * active_objects = game_instance->GetActiveObjects();
+    for ( ; i + 4 <= num_active_objects; i += 4 )
+    {
+        const hypercube::ActiveObject * objects = active_objects + i;
 
-    CORE_ASSERT( active_objects );
+        CubeStateBatch batch;
+        batch.Load( objects );
 
-    for ( int i = 0; i < num_active_objects; ++i )
+        QuantizedCubeStateBatch quantized;
+        quantized.Quantize<OrientationBits>( batch, UnitsPerMeter );
+
+        QuantizedVelocityBatch quantized_velocity;
+        quantized_velocity.Quantize( objects, UnitsPerMeter );
+
+#if defined( DELTA_STATS ) || defined( DELTA_DATA )
+        vectorial::vec3f original_position[4];
+        vectorial::quat4f original_orientation[4];
+        batch.GetOriginal( original_position, original_orientation );
+#endif // #if defined( DELTA_STATS ) || defined( DELTA_DATA )
+
+        for ( int j = 0; j < 4; ++j )
+        {
+            const int index = objects[j].id - 1;
+
+            CORE_ASSERT( index >= 0 );
+            CORE_ASSERT( index < NumCubes );
+
+            auto & cube = snapshot.cubes[index];
+            cube.interacting = objects[j].authority == 0;
+            cube.position_x = quantized.position_x[j];
+            cube.position_y = quantized.position_y[j];
+            cube.position_z = quantized.position_z[j];
+            cube.orientation.largest = quantized.largest[j];
+            cube.orientation.integer_a = quantized.integer_a[j];
+            cube.orientation.integer_b = quantized.integer_b[j];
+            cube.orientation.integer_c = quantized.integer_c[j];
+            cube.linear_velocity_x = quantized_velocity.linear_velocity_x[j];
+            cube.linear_velocity_y = quantized_velocity.linear_velocity_y[j];
+            cube.linear_velocity_z = quantized_velocity.linear_velocity_z[j];
+            cube.angular_velocity_x = quantized_velocity.angular_velocity_x[j];
+            cube.angular_velocity_y = quantized_velocity.angular_velocity_y[j];
+            cube.angular_velocity_z = quantized_velocity.angular_velocity_z[j];
+#if defined( DELTA_STATS ) || defined( DELTA_DATA )
+            cube.original_position = original_position[j];
+            cube.original_orientation = original_orientation[j];
+#endif // #if defined( DELTA_STATS ) || defined( DELTA_DATA )
+        }
+    }
+
+#endif // #if defined( __SSE2__ )
+
+    QuantizeCubes_Scalar( active_objects, i, num_active_objects, snapshot );
+}
+
+inline void QuantizeCubes( const hypercube::ActiveObject * active_objects, int num_active_objects, QuantizedSnapshot_HighPrecision & snapshot )
+{
+    int i = 0;
+
+#if defined( __SSE2__ )
+
+    for ( ; i + 4 <= num_active_objects; i += 4 )
     {
-        auto & object = active_objects[i];
+        const hypercube::ActiveObject * objects = active_objects + i;
 
-        const int index = object.id - 1;
+        CubeStateBatch batch;
+        batch.Load( objects );
 
-        CORE_ASSERT( index >= 0 );
-        CORE_ASSERT( index < NumCubes );
+        QuantizedCubeStateBatch quantized;
+        quantized.Quantize<OrientationBits_HighPrecision>( batch, UnitsPerMeter_HighPrecision );
+
+        QuantizedVelocityBatch quantized_velocity;
+        quantized_velocity.Quantize( objects, VelocityUnits_HighPrecision );
+
+#if DELTA_STATS
+        vectorial::vec3f original_position[4];
+        vectorial::quat4f original_orientation[4];
+        batch.GetOriginal( original_position, original_orientation );
+#endif // #if DELTA_STATS
+
+        for ( int j = 0; j < 4; ++j )
+        {
+            const int index = objects[j].id - 1;
+
+            CORE_ASSERT( index >= 0 );
+            CORE_ASSERT( index < NumCubes );
+
+            auto & cube = snapshot.cubes[index];
+            cube.interacting = objects[j].authority == 0;
+            cube.position_x = quantized.position_x[j];
+            cube.position_y = quantized.position_y[j];
+            cube.position_z = quantized.position_z[j];
+            cube.linear_velocity_x = quantized_velocity.linear_velocity_x[j];
+            cube.linear_velocity_y = quantized_velocity.linear_velocity_y[j];
+            cube.linear_velocity_z = quantized_velocity.linear_velocity_z[j];
+            cube.angular_velocity_x = quantized_velocity.angular_velocity_x[j];
+            cube.angular_velocity_y = quantized_velocity.angular_velocity_y[j];
+            cube.angular_velocity_z = quantized_velocity.angular_velocity_z[j];
+            cube.orientation.largest = quantized.largest[j];
+            cube.orientation.integer_a = quantized.integer_a[j];
+            cube.orientation.integer_b = quantized.integer_b[j];
+            cube.orientation.integer_c = quantized.integer_c[j];
+#if DELTA_STATS
+            cube.original_orientation = original_orientation[j];
+#endif // #if DELTA_STATS
+        }
+    }
+
+#endif // #if defined( __SSE2__ )
+
+    QuantizeCubes_Scalar( active_objects, i, num_active_objects, snapshot );
+}
+
+inline void DequantizeSnapshot( const QuantizedSnapshot & quantized_snapshot, Snapshot & snapshot )
+{
+    int i = 0;
+
+#if defined( __SSE2__ )
+
+    for ( ; i + 4 <= NumCubes; i += 4 )
+    {
+        const QuantizedCubeState * input = quantized_snapshot.cubes + i;
 
-        CubeState cube_state;
+        __m128 x = simd_dequantize( SIMD_GATHER_INT( input, position_x ), UnitsPerMeter );
+        __m128 y = simd_dequantize( SIMD_GATHER_INT( input, position_y ), UnitsPerMeter );
+        __m128 z = simd_dequantize( SIMD_GATHER_INT( input, position_z ), UnitsPerMeter );
+        __m128 w = _mm_setzero_ps();
 
-        cube_state.position = vectorial::vec3f( object.position.x, object.position.y, object.position.z );
+        _MM_TRANSPOSE4_PS( x, y, z, w );
 
-        cube_state.orientation = vectorial::quat4f( object.orientation.x, 
-                                                    object.orientation.y, 
-                                                    object.orientation.z,
-                                                    object.orientation.w );
+        snapshot.cubes[i+0].position = vectorial::vec3f( x );
+        snapshot.cubes[i+1].position = vectorial::vec3f( y );
+        snapshot.cubes[i+2].position = vectorial::vec3f( z );
+        snapshot.cubes[i+3].position = vectorial::vec3f( w );
 
-        cube_state.linear_velocity = vectorial::vec3f( object.linearVelocity.x, 
-                                                       object.linearVelocity.y,
-                                                       object.linearVelocity.z );
+        simd_dequantize_orientation<OrientationBits>( SIMD_GATHER_INT( input, orientation.largest ),
+                                                      SIMD_GATHER_INT( input, orientation.integer_a ),
+                                                      SIMD_GATHER_INT( input, orientation.integer_b ),
+                                                      SIMD_GATHER_INT( input, orientation.integer_c ),
+                                                      x, y, z, w );
 
-        cube_state.angular_velocity = vectorial::vec3f( object.angularVelocity.x, 
-                                                        object.angularVelocity.y,
-                                                        object.angularVelocity.z );
+        _MM_TRANSPOSE4_PS( x, y, z, w );
 
-        cube_state.interacting = object.authority == 0;
+        snapshot.cubes[i+0].orientation = vectorial::quat4f( vectorial::vec4f( x ) );
+        snapshot.cubes[i+1].orientation = vectorial::quat4f( vectorial::vec4f( y ) );
+        snapshot.cubes[i+2].orientation = vectorial::quat4f( vectorial::vec4f( z ) );
+        snapshot.cubes[i+3].orientation = vectorial::quat4f( vectorial::vec4f( w ) );
 
-        snapshot.cubes[index].Load( cube_state );
+        for ( int j = 0; j < 4; ++j )
+        {
+            snapshot.cubes[i+j].interacting = input[j].interacting;
+            snapshot.cubes[i+j].linear_velocity = vectorial::vec3f( 0, 0, 0 );
+        }
     }
 
-    return true;
+#endif // #if defined( __SSE2__ )
+
+    for ( ; i < NumCubes; ++i )
+        quantized_snapshot.cubes[i].Save( snapshot.cubes[i] );
 }
 
-inline bool GetQuantizedSnapshot_HighPrecision( GameInstance * game_instance, QuantizedSnapshot_HighPrecision & snapshot )
+inline bool GetQuantizedSnapshot( GameInstance * game_instance, QuantizedSnapshot & snapshot )
 {
     const int num_active_objects = game_instance->GetNumActiveObjects();
 
@@ -1331,36 +1745,39 @@ inline bool GetQuantizedSnapshot_HighPrecision( GameInstance * game_instance, Qu
 
     CORE_ASSERT( active_objects );
 
-    for ( int i = 0; i < num_active_objects; ++i )
-    {
-        auto & object = active_objects[i];
+    QuantizeCubes( active_objects, num_active_objects, snapshot );
 
-        const int index = object.id - 1;
+    return true;
+}
 
-        CORE_ASSERT( index >= 0 );
-        CORE_ASSERT( index < NumCubes );
+inline bool GetQuantizedSnapshotWithVelocity( GameInstance * game_instance, QuantizedSnapshotWithVelocity & snapshot )
+{
+    const int num_active_objects = game_instance->GetNumActiveObjects();
 
-        CubeState cube_state;
+    if ( num_active_objects == 0 )
+        return false;
 
-        cube_state.position = vectorial::vec3f( object.position.x, object.position.y, object.position.z );
+    const hypercube::ActiveObject * active_objects = game_instance->GetActiveObjects();
 
-        cube_state.orientation = vectorial::quat4f( object.orientation.x, 
-                                                    object.orientation.y, 
-                                                    object.orientation.z,
-                                                    object.orientation.w );
+    CORE_ASSERT( active_objects );
 
-        cube_state.linear_velocity = vectorial::vec3f( object.linearVelocity.x, 
-                                                       object.linearVelocity.y,
-                                                       object.linearVelocity.z );
+    QuantizeCubes( active_objects, num_active_objects, snapshot );
 
-        cube_state.angular_velocity = vectorial::vec3f( object.angularVelocity.x, 
-                                                        object.angularVelocity.y,
-                                                        object.angularVelocity.z );
+    return true;
+}
 
-        cube_state.interacting = object.authority == 0;
+inline bool GetQuantizedSnapshot_HighPrecision( GameInstance * game_instance, QuantizedSnapshot_HighPrecision & snapshot )
+{
+    const int num_active_objects = game_instance->GetNumActiveObjects();
 
-        snapshot.cubes[index].Load( cube_state );
-    }
+    if ( num_active_objects == 0 )
+        return false;
+
+    const hypercube::ActiveObject * active_objects = game_instance->GetActiveObjects();
+
+    CORE_ASSERT( active_objects );
+
+    QuantizeCubes( active_objects, num_active_objects, snapshot );
 
     return true;
 }
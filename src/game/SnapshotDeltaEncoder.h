@@ -0,0 +1,328 @@
+#ifndef GAME_SNAPSHOT_DELTA_ENCODER_H
+#define GAME_SNAPSHOT_DELTA_ENCODER_H
+
+#include "Snapshot.h"
+#include "core/Memory.h"
+#include "protocol/Stream.h"
+
+/*
+    Server side baseline management for delta encoded snapshots.
+
+    Snapshots are inserted once into a history ring shared by all clients. Each client
+    only tracks the most recent snapshot it has acked, so memory is O(history) + O(clients)
+    instead of a sliding window of snapshots per-client.
+
+    Each client's packet is encoded relative to its own acked baseline. If the client has
+    not acked anything yet, or its baseline has been overwritten in the history ring,
+    the packet is encoded relative to the initial snapshot instead. The receive buffer
+    on the client must be at least as large as the history so baselines are always there.
+
+    Clients that acked the same baseline get identical packet bits, so encoded packets
+    are cached by (sequence, baseline, mode) and copied out for every client after the
+    first. Encode cost is then per distinct baseline rather than per-client.
+*/
+
+struct SnapshotDeltaEncoderConfig
+{
+    core::Allocator * allocator;
+    int maxClients;                 // maximum number of clients tracking a baseline
+    int historySize;                // number of snapshots in the shared history ring
+    int cacheSize;                  // number of encoded packets cached for the current snapshot. 0 disables the cache
+    int maxPacketSize;              // largest encoded packet that will be cached
+
+    SnapshotDeltaEncoderConfig()
+    {
+        allocator = &core::memory::default_allocator();
+        maxClients = 64;
+        historySize = 256;
+        cacheSize = 0;
+        maxPacketSize = 64 * 1024;
+    }
+};
+
+enum SnapshotDeltaEncoderCounters
+{
+    SNAPSHOT_DELTA_ENCODER_COUNTER_PACKETS_ENCODED,
+    SNAPSHOT_DELTA_ENCODER_COUNTER_CACHE_HITS,
+    SNAPSHOT_DELTA_ENCODER_COUNTER_CACHE_MISSES,
+    SNAPSHOT_DELTA_ENCODER_NUM_COUNTERS
+};
+
+struct SnapshotDeltaCacheEntry
+{
+    uint16_t sequence;
+    uint16_t base_sequence;
+    bool initial;
+    int mode;
+    int bytes;                      // 0 if this entry is free
+    uint8_t * data;
+};
+
+struct SnapshotDeltaClient
+{
+    uint16_t ack;                   // most recent snapshot sequence acked by this client
+    bool acked;                     // true once the client has acked at least one snapshot
+};
+
+class SnapshotDeltaEncoder
+{
+public:
+
+    SnapshotDeltaEncoder( const SnapshotDeltaEncoderConfig & config = SnapshotDeltaEncoderConfig() )
+        : m_config( config )
+    {
+        CORE_ASSERT( m_config.allocator );
+        CORE_ASSERT( m_config.maxClients > 0 );
+        CORE_ASSERT( m_config.historySize > 0 );
+        CORE_ASSERT( m_config.cacheSize >= 0 );
+        CORE_ASSERT( m_config.maxPacketSize > 0 );
+        auto & allocator = *m_config.allocator;
+        m_clients = (SnapshotDeltaClient*) allocator.Allocate( sizeof( SnapshotDeltaClient ) * m_config.maxClients );
+        m_entry_sequence = (uint32_t*) allocator.Allocate( sizeof( uint32_t ) * m_config.historySize );
+        m_entries = (QuantizedSnapshot*) allocator.Allocate( sizeof( QuantizedSnapshot ) * m_config.historySize, alignof( QuantizedSnapshot ) );
+        m_cache = nullptr;
+        if ( m_config.cacheSize > 0 )
+        {
+            m_cache = (SnapshotDeltaCacheEntry*) allocator.Allocate( sizeof( SnapshotDeltaCacheEntry ) * m_config.cacheSize );
+            for ( int i = 0; i < m_config.cacheSize; ++i )
+                m_cache[i].data = (uint8_t*) allocator.Allocate( m_config.maxPacketSize );
+        }
+        Reset();
+    }
+
+    ~SnapshotDeltaEncoder()
+    {
+        auto & allocator = *m_config.allocator;
+        if ( m_cache )
+        {
+            for ( int i = 0; i < m_config.cacheSize; ++i )
+                allocator.Free( m_cache[i].data );
+            allocator.Free( m_cache );
+        }
+        allocator.Free( m_clients );
+        allocator.Free( m_entry_sequence );
+        allocator.Free( m_entries );
+        m_cache = nullptr;
+        m_clients = nullptr;
+        m_entry_sequence = nullptr;
+        m_entries = nullptr;
+    }
+
+    void Reset()
+    {
+        m_sequence = 0;
+        m_cacheIndex = 0;
+        for ( int i = 0; i < m_config.historySize; ++i )
+            m_entry_sequence[i] = 0xFFFFFFFF;
+        for ( int i = 0; i < m_config.maxClients; ++i )
+            ResetClient( i );
+        ClearCache();
+        memset( m_counters, 0, sizeof( m_counters ) );
+    }
+
+    void ResetClient( int clientIndex )
+    {
+        // call this when a client connects or disconnects so it starts over from the initial snapshot
+
+        CORE_ASSERT( clientIndex >= 0 );
+        CORE_ASSERT( clientIndex < m_config.maxClients );
+        m_clients[clientIndex].ack = 0;
+        m_clients[clientIndex].acked = false;
+    }
+
+    QuantizedSnapshot & InsertSnapshot( uint16_t & sequence )
+    {
+        // IMPORTANT: Fill the snapshot in place to avoid copying it. Overwrites the oldest entry in the history.
+        const int index = m_sequence % m_config.historySize;
+        m_entry_sequence[index] = m_sequence;
+        ClearCache();
+        sequence = m_sequence;
+        m_sequence++;
+        return m_entries[index];
+    }
+
+    bool IsValid( uint16_t sequence ) const
+    {
+        return m_entry_sequence[sequence%m_config.historySize] == sequence;
+    }
+
+    const QuantizedSnapshot & GetSnapshot( uint16_t sequence ) const
+    {
+        CORE_ASSERT( IsValid( sequence ) );
+        return m_entries[sequence%m_config.historySize];
+    }
+
+    void ProcessAck( int clientIndex, uint16_t ack )
+    {
+        CORE_ASSERT( clientIndex >= 0 );
+        CORE_ASSERT( clientIndex < m_config.maxClients );
+
+        // acks come off the network: ignore snapshots we have not sent yet, and acks older than the current baseline
+
+        if ( !core::sequence_less_than( ack, m_sequence ) )
+            return;
+
+        auto & client = m_clients[clientIndex];
+
+        if ( client.acked && !core::sequence_greater_than( ack, client.ack ) )
+            return;
+
+        client.ack = ack;
+        client.acked = true;
+    }
+
+    bool GetBaseline( int clientIndex, uint16_t & base_sequence ) const
+    {
+        // returns false if the client must be encoded relative to the initial snapshot
+
+        CORE_ASSERT( clientIndex >= 0 );
+        CORE_ASSERT( clientIndex < m_config.maxClients );
+
+        const auto & client = m_clients[clientIndex];
+
+        if ( !client.acked || !IsValid( client.ack ) )
+            return false;
+
+        base_sequence = client.ack;
+
+        return true;
+    }
+
+    template <typename Packet> int WritePacket( int clientIndex, int mode, Packet & packet, uint8_t * buffer, int bufferSize, const void ** context ) const
+    {
+        // encodes the most recent snapshot for this client, bypassing the cache. the packet reads its snapshots back from this encoder via the stream context.
+        // this only reads encoder state, so per-client jobs may call it concurrently as long as nothing is inserted or acked until they are done.
+
+        CORE_ASSERT( IsValid( m_sequence - 1 ) );
+
+        packet.sequence = m_sequence - 1;
+        packet.initial = !GetBaseline( clientIndex, packet.base_sequence );
+        packet.delta_mode = mode;
+
+        protocol::WriteStream stream( buffer, bufferSize );
+        stream.SetContext( context );
+        packet.SerializeWrite( stream );
+        stream.Flush();
+
+        if ( stream.IsOverflow() )
+            return 0;
+
+        return stream.GetBytesProcessed();
+    }
+
+    template <typename Packet> int EncodePacket( int clientIndex, int mode, Packet & packet, uint8_t * buffer, int bufferSize, const void ** context )
+    {
+        // encodes the most recent snapshot for this client, reusing the packet of an earlier client with the same baseline if possible
+
+        CORE_ASSERT( IsValid( m_sequence - 1 ) );
+
+        packet.sequence = m_sequence - 1;
+        packet.initial = !GetBaseline( clientIndex, packet.base_sequence );
+        packet.delta_mode = mode;
+
+        m_counters[SNAPSHOT_DELTA_ENCODER_COUNTER_PACKETS_ENCODED]++;
+
+        SnapshotDeltaCacheEntry * entry = FindCacheEntry( packet.sequence, packet.base_sequence, packet.initial, mode );
+
+        if ( entry )
+        {
+            if ( entry->bytes > bufferSize )
+                return 0;
+            m_counters[SNAPSHOT_DELTA_ENCODER_COUNTER_CACHE_HITS]++;
+            memcpy( buffer, entry->data, entry->bytes );
+            return entry->bytes;
+        }
+
+        const int bytes = WritePacket( clientIndex, mode, packet, buffer, bufferSize, context );
+
+        if ( bytes == 0 )
+            return 0;
+
+        if ( m_cache )
+        {
+            m_counters[SNAPSHOT_DELTA_ENCODER_COUNTER_CACHE_MISSES]++;
+            if ( bytes <= m_config.maxPacketSize )
+            {
+                // round robin replacement. entries for older snapshots were already freed on insert
+
+                entry = &m_cache[m_cacheIndex];
+                m_cacheIndex = ( m_cacheIndex + 1 ) % m_config.cacheSize;
+                entry->sequence = packet.sequence;
+                entry->base_sequence = packet.initial ? 0 : packet.base_sequence;
+                entry->initial = packet.initial;
+                entry->mode = mode;
+                entry->bytes = bytes;
+                memcpy( entry->data, buffer, bytes );
+            }
+        }
+
+        return bytes;
+    }
+
+    uint64_t GetCounter( int index ) const
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < SNAPSHOT_DELTA_ENCODER_NUM_COUNTERS );
+        return m_counters[index];
+    }
+
+    uint16_t GetSequence() const
+    {
+        // sequence of the next snapshot to be inserted
+        return m_sequence;
+    }
+
+    const SnapshotDeltaEncoderConfig & GetConfig() const
+    {
+        return m_config;
+    }
+
+    int GetMaxClients() const
+    {
+        return m_config.maxClients;
+    }
+
+    int GetHistorySize() const
+    {
+        return m_config.historySize;
+    }
+
+private:
+
+    void ClearCache()
+    {
+        for ( int i = 0; i < m_config.cacheSize; ++i )
+            m_cache[i].bytes = 0;
+    }
+
+    SnapshotDeltaCacheEntry * FindCacheEntry( uint16_t sequence, uint16_t base_sequence, bool initial, int mode )
+    {
+        if ( initial )
+            base_sequence = 0;
+
+        for ( int i = 0; i < m_config.cacheSize; ++i )
+        {
+            auto & entry = m_cache[i];
+            if ( entry.bytes > 0 && entry.sequence == sequence && entry.base_sequence == base_sequence && entry.initial == initial && entry.mode == mode )
+                return &entry;
+        }
+
+        return nullptr;
+    }
+
+    const SnapshotDeltaEncoderConfig m_config;
+
+    uint16_t m_sequence;
+    int m_cacheIndex;
+    SnapshotDeltaClient * m_clients;
+    uint32_t * m_entry_sequence;
+    QuantizedSnapshot * m_entries;
+    SnapshotDeltaCacheEntry * m_cache;
+
+    uint64_t m_counters[SNAPSHOT_DELTA_ENCODER_NUM_COUNTERS];
+
+    SnapshotDeltaEncoder( const SnapshotDeltaEncoder & other );
+    SnapshotDeltaEncoder & operator = ( const SnapshotDeltaEncoder & other );
+};
+
+#endif // #ifndef GAME_SNAPSHOT_DELTA_ENCODER_H
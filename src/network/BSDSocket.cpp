@@ -24,9 +24,13 @@
 
 #include "network/Network.h"
 #include "network/BSDSocket.h"
+#include "network/Config.h"
+#include "network/Compressor.h"
 #include "core/Config.h"
 #include "core/Memory.h"
 #include "core/Queue.h"
+#include "core/PoolAllocator.h"
+#include "protocol/PacketBuffer.h"
 #include <string.h>
 
 #if CORE_PLATFORM == CORE_PLATFORM_WINDOWS
@@ -62,6 +66,116 @@
 
 namespace network
 {     
+    // compressed packets are the protocol id, then a mode byte, then the rest of the packet stored or compressed
+
+    static const int ProtocolIdBytes = 8;
+    static const int CompressionHeaderBytes = ProtocolIdBytes + 1;
+
+    enum CompressionMode
+    {
+        COMPRESSION_MODE_STORED,
+        COMPRESSION_MODE_COMPRESSED
+    };
+
+    /*
+        Pool that zero copy receive packet buffers are allocated from.
+
+        Blocks read in place keep slices of their packet buffer, and may still be
+        held after the socket is destroyed. Each packet buffer holds a reference
+        to the pool, as does the socket, so the pool is only destroyed once the
+        last of them has been freed.
+    */
+
+    class ReceiveBufferPool : public core::Allocator
+    {
+    public:
+
+        ReceiveBufferPool( core::Allocator & allocator, uint32_t maxBlockSize, uint32_t chunkSize )
+            : m_allocator( &allocator ), m_pool( allocator, maxBlockSize, chunkSize ), m_refCount( 1 )
+        {
+            // the socket holds the first reference
+        }
+
+        void Release()
+        {
+            const int previous = m_refCount.fetch_sub( 1, std::memory_order_acq_rel );
+            CORE_ASSERT( previous > 0 );
+            if ( previous != 1 )
+                return;
+            core::Allocator * allocator = m_allocator;
+            this->~ReceiveBufferPool();
+            allocator->Free( this );
+        }
+
+        void * Allocate( uint32_t size, uint32_t align = DEFAULT_ALIGN )
+        {
+            m_refCount.fetch_add( 1, std::memory_order_relaxed );
+            return m_pool.Allocate( size, align );
+        }
+
+        void Free( void * p )
+        {
+            if ( !p )
+                return;
+            m_pool.Free( p );
+            Release();
+        }
+
+        uint32_t GetAllocatedSize( void * p )
+        {
+            return m_pool.GetAllocatedSize( p );
+        }
+
+        uint32_t GetTotalAllocated()
+        {
+            return m_pool.GetTotalAllocated();
+        }
+
+    private:
+
+        core::Allocator * m_allocator;
+        core::PoolAllocator m_pool;
+        std::atomic<int> m_refCount;
+    };
+
+#if NETWORK_HAS_BATCHED_IO
+
+    struct BSDSocketBatch
+    {
+        int size;                                   // max messages per sendmmsg/recvmmsg call
+        uint8_t * buffers;                          // size * maxPacketSize bytes, one packet buffer per message. only used for sending in zero copy mode.
+        protocol::PacketBuffer ** packetBuffers;    // one reference counted packet buffer per message in zero copy mode, otherwise nullptr.
+        mmsghdr * messages;
+        iovec * iovecs;
+        sockaddr_storage * addresses;
+    };
+
+#endif
+
+    static socklen_t AddressToSocketAddress( const Address & address, sockaddr_storage & storage )
+    {
+        memset( &storage, 0, sizeof( storage ) );
+
+        if ( address.GetType() == ADDRESS_IPV6 )
+        {
+            sockaddr_in6 & socket_address = reinterpret_cast<sockaddr_in6&>( storage );
+            socket_address.sin6_family = AF_INET6;
+            socket_address.sin6_port = htons( address.GetPort() );
+            memcpy( &socket_address.sin6_addr, address.GetAddress6(), sizeof( socket_address.sin6_addr ) );
+            return sizeof( sockaddr_in6 );
+        }
+        else if ( address.GetType() == ADDRESS_IPV4 )
+        {
+            sockaddr_in & socket_address = reinterpret_cast<sockaddr_in&>( storage );
+            socket_address.sin_family = AF_INET;
+            socket_address.sin_addr.s_addr = address.GetAddress4();
+            socket_address.sin_port = htons( (unsigned short) address.GetPort() );
+            return sizeof( sockaddr_in );
+        }
+
+        return 0;
+    }
+
     BSDSocket::BSDSocket( const BSDSocketConfig & config )
         : m_config( config ), 
           m_send_queue( config.allocator ? *config.allocator : core::memory::default_allocator() ),
@@ -79,7 +193,56 @@ namespace network
         core::queue::reserve( m_send_queue, m_config.sendQueueSize );
         core::queue::reserve( m_receive_queue, m_config.receiveQueueSize );
 
-        m_receiveBuffer = (uint8_t*) m_allocator->Allocate( m_config.maxPacketSize );
+        m_receiveBuffer = nullptr;
+        m_receiveBufferPool = nullptr;
+        m_receivePacketBuffer = nullptr;
+
+        if ( m_config.zeroCopy )
+            m_receiveBufferPool = CORE_NEW( *m_allocator, ReceiveBufferPool, *m_allocator, m_config.maxPacketSize + 64, 4 * m_config.maxPacketSize );
+        else
+            m_receiveBuffer = (uint8_t*) m_allocator->Allocate( m_config.maxPacketSize );
+
+        m_batch = nullptr;
+
+#if NETWORK_HAS_BATCHED_IO
+        if ( m_config.batchSize > 1 )
+        {
+            const int n = m_config.batchSize;
+            m_batch = CORE_NEW( *m_allocator, BSDSocketBatch );
+            m_batch->size = n;
+            m_batch->buffers = (uint8_t*) m_allocator->Allocate( n * m_config.maxPacketSize );
+            m_batch->packetBuffers = nullptr;
+            if ( m_config.zeroCopy )
+            {
+                m_batch->packetBuffers = (protocol::PacketBuffer**) m_allocator->Allocate( n * sizeof( protocol::PacketBuffer* ), alignof( protocol::PacketBuffer* ) );
+                memset( m_batch->packetBuffers, 0, n * sizeof( protocol::PacketBuffer* ) );
+            }
+            m_batch->messages = (mmsghdr*) m_allocator->Allocate( n * sizeof( mmsghdr ), alignof( mmsghdr ) );
+            m_batch->iovecs = (iovec*) m_allocator->Allocate( n * sizeof( iovec ), alignof( iovec ) );
+            m_batch->addresses = (sockaddr_storage*) m_allocator->Allocate( n * sizeof( sockaddr_storage ), alignof( sockaddr_storage ) );
+        }
+#endif
+
+        m_compressor = nullptr;
+        m_compressBuffer = nullptr;
+        m_decompressBuffer = nullptr;
+        m_decompressPacketBuffer = nullptr;
+        m_compressionStats = nullptr;
+
+        if ( m_config.compression )
+        {
+            CORE_ASSERT( m_config.maxPacketSize > CompressionHeaderBytes );
+            m_compressor = CORE_NEW( *m_allocator, Compressor, *m_allocator, m_config.compressionDictionary, m_config.compressionDictionaryBytes );
+            m_compressBuffer = (uint8_t*) m_allocator->Allocate( m_config.maxPacketSize );
+            if ( !m_config.zeroCopy )
+                m_decompressBuffer = (uint8_t*) m_allocator->Allocate( m_config.maxPacketSize );
+        }
+
+        const int numPacketTypes = m_config.packetFactory->GetNumTypes();
+        m_compressionStats = (BSDSocketCompressionStats*) m_allocator->Allocate( numPacketTypes * sizeof( BSDSocketCompressionStats ), alignof( BSDSocketCompressionStats ) );
+        memset( m_compressionStats, 0, numPacketTypes * sizeof( BSDSocketCompressionStats ) );
+
+        memset( m_counters, 0, sizeof( m_counters ) );
 
         m_error = BSD_SOCKET_ERROR_NONE;
 
@@ -177,6 +340,27 @@ namespace network
             m_receiveBuffer = nullptr;
         }
 
+#if NETWORK_HAS_BATCHED_IO
+        if ( m_batch )
+        {
+            if ( m_batch->packetBuffers )
+            {
+                for ( int i = 0; i < m_batch->size; ++i )
+                {
+                    if ( m_batch->packetBuffers[i] )
+                        m_batch->packetBuffers[i]->Release();
+                }
+                m_allocator->Free( m_batch->packetBuffers );
+            }
+            m_allocator->Free( m_batch->buffers );
+            m_allocator->Free( m_batch->messages );
+            m_allocator->Free( m_batch->iovecs );
+            m_allocator->Free( m_batch->addresses );
+            CORE_DELETE( *m_allocator, BSDSocketBatch, m_batch );
+            m_batch = nullptr;
+        }
+#endif
+
         if ( m_socket != 0 )
         {
             #if CORE_PLATFORM == CORE_PLATFORM_MAC || CORE_PLATFORM == CORE_PLATFORM_UNIX
@@ -205,6 +389,41 @@ namespace network
 
         core::queue::clear( m_send_queue );
         core::queue::clear( m_receive_queue );
+
+        if ( m_receivePacketBuffer )
+        {
+            m_receivePacketBuffer->Release();
+            m_receivePacketBuffer = nullptr;
+        }
+
+        if ( m_decompressPacketBuffer )
+        {
+            m_decompressPacketBuffer->Release();
+            m_decompressPacketBuffer = nullptr;
+        }
+
+        if ( m_compressor )
+        {
+            CORE_DELETE( *m_allocator, Compressor, m_compressor );
+            m_allocator->Free( m_compressBuffer );
+            if ( m_decompressBuffer )
+                m_allocator->Free( m_decompressBuffer );
+            m_compressor = nullptr;
+            m_compressBuffer = nullptr;
+            m_decompressBuffer = nullptr;
+        }
+
+        CORE_ASSERT( m_compressionStats );
+        m_allocator->Free( m_compressionStats );
+        m_compressionStats = nullptr;
+
+        // packet buffers still referenced by received blocks keep the pool alive until they are freed
+
+        if ( m_receiveBufferPool )
+        {
+            m_receiveBufferPool->Release();
+            m_receiveBufferPool = nullptr;
+        }
     }
 
     bool BSDSocket::IsError() const
@@ -259,6 +478,17 @@ namespace network
         if ( m_error )
             return;
 
+#if NETWORK_HAS_BATCHED_IO
+        if ( m_batch )
+        {
+            SendPacketsBatched();
+
+            ReceivePacketsBatched();
+
+            return;
+        }
+#endif
+
         SendPackets();
 
         ReceivePackets();
@@ -292,135 +522,450 @@ namespace network
         return m_port;
     }
 
+    const BSDSocketCompressionStats & BSDSocket::GetCompressionStats( int packetType ) const
+    {
+        CORE_ASSERT( packetType >= 0 );
+        CORE_ASSERT( packetType < m_config.packetFactory->GetNumTypes() );
+        return m_compressionStats[packetType];
+    }
+
     void BSDSocket::SendPackets()
     {
+        uint8_t * buffer = (uint8_t*) alloca( m_config.maxPacketSize );
+
         while ( core::queue::size( m_send_queue ) )
         {
             protocol::Packet * packet = m_send_queue[0];
 
             core::queue::consume( m_send_queue, 1 );
 
-            uint8_t * buffer = (uint8_t*) alloca( m_config.maxPacketSize );
+            const int bytes = WritePacketToBuffer( packet, buffer );
+
+            if ( bytes > 0 )
+                SendPacketInternal( packet->GetAddress(), buffer, bytes );
+
+            m_config.packetFactory->Destroy( packet );
+        }
+    }
+
+    void BSDSocket::ReceivePackets()
+    {
+        while ( true )
+        {
+            if ( (int) core::queue::size( m_receive_queue ) == m_config.receiveQueueSize )
+                break;
 
-            typedef protocol::WriteStream Stream;
+            uint8_t * buffer = m_receiveBuffer;
+
+            if ( m_config.zeroCopy )
+            {
+                m_receivePacketBuffer = AcquireReceivePacketBuffer( m_receivePacketBuffer );
+                buffer = m_receivePacketBuffer->GetData();
+            }
 
-            Stream stream( buffer, m_config.maxPacketSize );
+            Address address;
+            int received_bytes = ReceivePacketInternal( address, buffer, m_config.maxPacketSize );
+            if ( !received_bytes )
+                break;
 
-            stream.SetContext( m_context );
+            protocol::Packet * packet = ReadPacketFromBuffer( address, buffer, received_bytes, m_receivePacketBuffer );
+            if ( !packet )
+                continue;
 
-            uint64_t protocolId = m_config.protocolId;
-            serialize_uint64( stream, protocolId );
+            core::queue::push_back( m_receive_queue, packet );
+        }
+    }
 
-            const int maxPacketType = m_config.packetFactory->GetNumTypes() - 1;
-            
-            int packetType = packet->GetType();
-            
-            serialize_int( stream, packetType, 0, maxPacketType );
-            
-            stream.Align();
+#if NETWORK_HAS_BATCHED_IO
 
-            packet->SerializeWrite( stream );
+    void BSDSocket::SendPacketsBatched()
+    {
+        CORE_ASSERT( m_batch );
 
-            stream.Check( 0x51246234 );
+        BSDSocketBatch & batch = *m_batch;
 
-            stream.Flush();
+        while ( core::queue::size( m_send_queue ) )
+        {
+            // serialize up to one batch worth of packets into the batch buffers
 
-            CORE_ASSERT( !stream.IsOverflow() );
+            int numMessages = 0;
 
-            if ( stream.IsOverflow() )
+            while ( numMessages < batch.size && core::queue::size( m_send_queue ) )
             {
-                m_counters[BSD_SOCKET_COUNTER_SERIALIZE_WRITE_OVERFLOW]++;
-                m_config.packetFactory->Destroy( packet );
-                continue;
-            }
+                protocol::Packet * packet = m_send_queue[0];
 
-            const int bytes = stream.GetBytesProcessed();
-            const uint8_t * data = stream.GetData();
+                core::queue::consume( m_send_queue, 1 );
+
+                uint8_t * buffer = batch.buffers + numMessages * m_config.maxPacketSize;
+
+                const int bytes = WritePacketToBuffer( packet, buffer );
+
+                const socklen_t addressLength = bytes > 0 ? AddressToSocketAddress( packet->GetAddress(), batch.addresses[numMessages] ) : 0;
 
-            CORE_ASSERT( bytes <= m_config.maxPacketSize );
-            if ( bytes > m_config.maxPacketSize )
-            {
-                m_counters[BSD_SOCKET_COUNTER_PACKET_TOO_LARGE_TO_SEND]++;
                 m_config.packetFactory->Destroy( packet );
-                continue;
+
+                if ( addressLength == 0 )
+                    continue;
+
+                iovec & iov = batch.iovecs[numMessages];
+                iov.iov_base = buffer;
+                iov.iov_len = bytes;
+
+                mmsghdr & message = batch.messages[numMessages];
+                memset( &message, 0, sizeof( message ) );
+                message.msg_hdr.msg_name = &batch.addresses[numMessages];
+                message.msg_hdr.msg_namelen = addressLength;
+                message.msg_hdr.msg_iov = &iov;
+                message.msg_hdr.msg_iovlen = 1;
+
+                numMessages++;
             }
 
-            SendPacketInternal( packet->GetAddress(), data, bytes );
+            if ( numMessages == 0 )
+                continue;
 
-            m_config.packetFactory->Destroy( packet );
+            m_counters[BSD_SOCKET_COUNTER_PACKETS_SENT] += numMessages;
+            m_counters[BSD_SOCKET_COUNTER_SEND_BATCHES]++;
+            if ( (uint64_t) numMessages > m_counters[BSD_SOCKET_COUNTER_MAX_SEND_BATCH_SIZE] )
+                m_counters[BSD_SOCKET_COUNTER_MAX_SEND_BATCH_SIZE] = numMessages;
+
+            // sendmmsg may send only part of the batch. keep going until it is all sent or the socket errors out
+
+            int numSent = 0;
+
+            while ( numSent < numMessages )
+            {
+                const int result = sendmmsg( m_socket, batch.messages + numSent, numMessages - numSent, 0 );
+
+                if ( result <= 0 )
+                {
+                    m_counters[BSD_SOCKET_COUNTER_SEND_FAILURES] += numMessages - numSent;
+                    break;
+                }
+
+                for ( int i = numSent; i < numSent + result; ++i )
+                {
+                    if ( batch.messages[i].msg_len != batch.iovecs[i].iov_len )
+                        m_counters[BSD_SOCKET_COUNTER_SEND_FAILURES]++;
+                    else
+                        m_counters[BSD_SOCKET_COUNTER_BYTES_SENT] += batch.messages[i].msg_len;
+                }
+
+                numSent += result;
+            }
         }
     }
 
-    void BSDSocket::ReceivePackets()
+    void BSDSocket::ReceivePacketsBatched()
     {
+        CORE_ASSERT( m_batch );
+
+        BSDSocketBatch & batch = *m_batch;
+
         while ( true )
         {
-            if ( (int) core::queue::size( m_receive_queue ) == m_config.receiveQueueSize )
+            const int available = m_config.receiveQueueSize - (int) core::queue::size( m_receive_queue );
+            if ( available <= 0 )
                 break;
 
-            Address address;
-            int received_bytes = ReceivePacketInternal( address, m_receiveBuffer, m_config.maxPacketSize );
-            if ( !received_bytes )
-                break;
+            const int numMessages = core::min( available, batch.size );
 
-            typedef protocol::ReadStream Stream;
+            for ( int i = 0; i < numMessages; ++i )
+            {
+                if ( batch.packetBuffers )
+                    batch.packetBuffers[i] = AcquireReceivePacketBuffer( batch.packetBuffers[i] );
+
+                iovec & iov = batch.iovecs[i];
+                iov.iov_base = batch.packetBuffers ? batch.packetBuffers[i]->GetData() : batch.buffers + i * m_config.maxPacketSize;
+                iov.iov_len = m_config.maxPacketSize;
+
+                mmsghdr & message = batch.messages[i];
+                memset( &message, 0, sizeof( message ) );
+                message.msg_hdr.msg_name = &batch.addresses[i];
+                message.msg_hdr.msg_namelen = sizeof( sockaddr_storage );
+                message.msg_hdr.msg_iov = &iov;
+                message.msg_hdr.msg_iovlen = 1;
+            }
 
-            Stream stream( m_receiveBuffer, m_config.maxPacketSize );
+            const int result = recvmmsg( m_socket, batch.messages, numMessages, MSG_DONTWAIT, nullptr );
+
+            if ( result <= 0 )
+                break;
 
-            stream.SetContext( m_context );
+            m_counters[BSD_SOCKET_COUNTER_PACKETS_RECEIVED] += result;
+            m_counters[BSD_SOCKET_COUNTER_RECEIVE_BATCHES]++;
+            if ( (uint64_t) result > m_counters[BSD_SOCKET_COUNTER_MAX_RECEIVE_BATCH_SIZE] )
+                m_counters[BSD_SOCKET_COUNTER_MAX_RECEIVE_BATCH_SIZE] = result;
 
-            uint64_t protocolId;
-            serialize_uint64( stream, protocolId );
-            if ( protocolId != m_config.protocolId )
+            for ( int i = 0; i < result; ++i )
             {
-                m_counters[BSD_SOCKET_COUNTER_PROTOCOL_ID_MISMATCH]++;
-                continue;
+                if ( batch.messages[i].msg_len == 0 )
+                    continue;
+
+                m_counters[BSD_SOCKET_COUNTER_BYTES_RECEIVED] += batch.messages[i].msg_len;
+
+                Address address( batch.addresses[i] );
+
+                protocol::Packet * packet = batch.packetBuffers ? ReadPacketFromBuffer( address, batch.packetBuffers[i]->GetData(), batch.messages[i].msg_len, batch.packetBuffers[i] )
+                                                                : ReadPacketFromBuffer( address, batch.buffers + i * m_config.maxPacketSize, batch.messages[i].msg_len );
+                if ( !packet )
+                    continue;
+
+                core::queue::push_back( m_receive_queue, packet );
             }
 
-            const int maxPacketType = m_config.packetFactory->GetNumTypes() - 1;
-            int packetType = 0;
-            serialize_int( stream, packetType, 0, maxPacketType );
+            // a short batch means the socket receive buffer is drained
 
-            stream.Align();
+            if ( result < numMessages )
+                break;
+        }
+    }
 
-            protocol::Packet * packet = m_config.packetFactory->Create( packetType );
-            CORE_ASSERT( packet );
-            CORE_ASSERT( packet->GetType() == packetType );
-            if ( !packet )
+#endif
+
+    int BSDSocket::WritePacketToBuffer( protocol::Packet * packet, uint8_t * buffer )
+    {
+        CORE_ASSERT( packet );
+        CORE_ASSERT( buffer );
+
+        typedef protocol::WriteStream Stream;
+
+        // with compression, serialize to the compress buffer leaving room for the mode byte, then compress into the buffer.
+        // the stream needs a multiple of four bytes, so the packet loses up to four bytes of space rather than one.
+
+        uint8_t * data = m_compressor ? m_compressBuffer : buffer;
+
+        Stream stream( data, m_compressor ? ( m_config.maxPacketSize - 1 ) & ~3 : m_config.maxPacketSize );
+
+        stream.SetContext( m_context );
+
+        uint64_t protocolId = m_config.protocolId;
+        serialize_uint64( stream, protocolId );
+
+        const int maxPacketType = m_config.packetFactory->GetNumTypes() - 1;
+        
+        int packetType = packet->GetType();
+        
+        serialize_int( stream, packetType, 0, maxPacketType );
+        
+        stream.Align();
+
+        packet->SerializeWrite( stream );
+
+        stream.Check( 0x51246234 );
+
+        stream.Flush();
+
+        CORE_ASSERT( !stream.IsOverflow() );
+
+        if ( stream.IsOverflow() )
+        {
+            m_counters[BSD_SOCKET_COUNTER_SERIALIZE_WRITE_OVERFLOW]++;
+            return 0;
+        }
+
+        const int bytes = stream.GetBytesProcessed();
+
+        CORE_ASSERT( stream.GetData() == data );
+
+        CORE_ASSERT( bytes <= m_config.maxPacketSize );
+        if ( bytes > m_config.maxPacketSize )
+        {
+            m_counters[BSD_SOCKET_COUNTER_PACKET_TOO_LARGE_TO_SEND]++;
+            return 0;
+        }
+
+        CORE_ASSERT( bytes > ProtocolIdBytes );
+
+        if ( m_config.capture )
+            m_config.capture->AddPacket( data + ProtocolIdBytes, bytes - ProtocolIdBytes );
+
+        if ( m_compressor )
+            return CompressPacket( packetType, data, bytes, buffer );
+
+        return bytes;
+    }
+
+    int BSDSocket::CompressPacket( int packetType, const uint8_t * input, int bytes, uint8_t * output )
+    {
+        CORE_ASSERT( m_compressor );
+        CORE_ASSERT( bytes > ProtocolIdBytes );
+        CORE_ASSERT( bytes + 1 <= m_config.maxPacketSize );
+
+        const uint64_t start = core::nanoseconds();
+
+        // the protocol id stays uncompressed. if compressing doesn't save anything the packet is stored as is
+
+        memcpy( output, input, ProtocolIdBytes );
+
+        int payloadBytes = m_compressor->Compress( input + ProtocolIdBytes, bytes - ProtocolIdBytes, output + CompressionHeaderBytes, m_config.maxPacketSize - CompressionHeaderBytes );
+
+        if ( payloadBytes > 0 && payloadBytes < bytes - ProtocolIdBytes )
+        {
+            output[ProtocolIdBytes] = COMPRESSION_MODE_COMPRESSED;
+        }
+        else
+        {
+            output[ProtocolIdBytes] = COMPRESSION_MODE_STORED;
+            payloadBytes = bytes - ProtocolIdBytes;
+            memcpy( output + CompressionHeaderBytes, input + ProtocolIdBytes, payloadBytes );
+        }
+
+        BSDSocketCompressionStats & stats = m_compressionStats[packetType];
+        stats.packetsCompressed++;
+        stats.uncompressedBytes += bytes;
+        stats.compressedBytes += CompressionHeaderBytes + payloadBytes;
+        stats.compressNanoseconds += core::nanoseconds() - start;
+
+        return CompressionHeaderBytes + payloadBytes;
+    }
+
+    int BSDSocket::DecompressPacket( const uint8_t * input, int bytes, uint8_t * output )
+    {
+        CORE_ASSERT( m_compressor );
+
+        if ( bytes < CompressionHeaderBytes || bytes > m_config.maxPacketSize )
+            return -1;
+
+        memcpy( output, input, ProtocolIdBytes );
+
+        const int payloadBytes = bytes - CompressionHeaderBytes;
+
+        switch ( input[ProtocolIdBytes] )
+        {
+            case COMPRESSION_MODE_STORED:
+                memcpy( output + ProtocolIdBytes, input + CompressionHeaderBytes, payloadBytes );
+                return ProtocolIdBytes + payloadBytes;
+
+            case COMPRESSION_MODE_COMPRESSED:
             {
-//                printf( "failed to create packet of type %d\n", packetType );
-                m_counters[BSD_SOCKET_COUNTER_CREATE_PACKET_FAILURES]++;
-                continue;
+                const int result = m_compressor->Decompress( input + CompressionHeaderBytes, payloadBytes, output + ProtocolIdBytes, m_config.maxPacketSize - ProtocolIdBytes );
+                return result < 0 ? -1 : ProtocolIdBytes + result;
             }
 
-            packet->SerializeRead( stream );
+            default:
+                return -1;
+        }
+    }
+
+    protocol::PacketBuffer * BSDSocket::AcquireReceivePacketBuffer( protocol::PacketBuffer * packetBuffer )
+    {
+        // reuse the packet buffer unless a packet read from it kept a slice, in which case it is left to the slices to free
+
+        if ( packetBuffer && packetBuffer->GetRefCount() == 1 )
+            return packetBuffer;
+
+        if ( packetBuffer )
+            packetBuffer->Release();
+
+        CORE_ASSERT( m_receiveBufferPool );
+
+        m_counters[BSD_SOCKET_COUNTER_RECEIVE_BUFFERS_ALLOCATED]++;
+
+        return protocol::PacketBuffer::Create( *m_receiveBufferPool, m_config.maxPacketSize );
+    }
+
+    protocol::Packet * BSDSocket::ReadPacketFromBuffer( const Address & address, uint8_t * buffer, int bytes, protocol::PacketBuffer * packetBuffer )
+    {
+        CORE_ASSERT( buffer );
+        CORE_ASSERT( !packetBuffer || packetBuffer->GetData() == buffer );
 
-            // IMPORTANT: packet read was aborted. intentionally ignore this packet
-            if ( stream.Aborted() )
+        uint64_t decompressNanoseconds = 0;
+
+        if ( m_compressor )
+        {
+            // in zero copy mode, decompress into a packet buffer of its own so slices reference the decompressed data
+
+            const uint64_t start = core::nanoseconds();
+
+            uint8_t * input = buffer;
+
+            if ( packetBuffer )
             {
-                m_counters[BSD_SOCKET_COUNTER_ABORTED_PACKET_READS]++;
-                m_config.packetFactory->Destroy( packet );
-                continue;
+                m_decompressPacketBuffer = AcquireReceivePacketBuffer( m_decompressPacketBuffer );
+                packetBuffer = m_decompressPacketBuffer;
+                buffer = packetBuffer->GetData();
             }
-
-            CORE_ASSERT( !stream.IsOverflow() );
-            if ( stream.IsOverflow() )
+            else
             {
-                m_counters[BSD_SOCKET_COUNTER_SERIALIZE_READ_OVERFLOW]++;
-                m_config.packetFactory->Destroy( packet );
-                continue;
+                buffer = m_decompressBuffer;
             }
 
-            if ( !stream.Check( 0x51246234 ) )
+            if ( DecompressPacket( input, bytes, buffer ) < 0 )
             {
-                m_config.packetFactory->Destroy( packet );
-                continue;
+                m_counters[BSD_SOCKET_COUNTER_DECOMPRESS_FAILURES]++;
+                return nullptr;
             }
 
-            packet->SetAddress( address );
+            decompressNanoseconds = core::nanoseconds() - start;
+        }
 
-            core::queue::push_back( m_receive_queue, packet );
+        typedef protocol::ReadStream Stream;
+
+        Stream stream( buffer, m_config.maxPacketSize );
+
+        stream.SetContext( m_context );
+
+        stream.SetPacketBuffer( packetBuffer );
+
+        uint64_t protocolId;
+        serialize_uint64( stream, protocolId );
+        if ( protocolId != m_config.protocolId )
+        {
+            m_counters[BSD_SOCKET_COUNTER_PROTOCOL_ID_MISMATCH]++;
+            return nullptr;
+        }
+
+        const int maxPacketType = m_config.packetFactory->GetNumTypes() - 1;
+        int packetType = 0;
+        serialize_int( stream, packetType, 0, maxPacketType );
+
+        stream.Align();
+
+        if ( m_compressor && !stream.Aborted() )
+        {
+            BSDSocketCompressionStats & stats = m_compressionStats[packetType];
+            stats.packetsDecompressed++;
+            stats.decompressNanoseconds += decompressNanoseconds;
+        }
+
+        protocol::Packet * packet = m_config.packetFactory->Create( packetType );
+        CORE_ASSERT( packet );
+        CORE_ASSERT( packet->GetType() == packetType );
+        if ( !packet )
+        {
+//            printf( "failed to create packet of type %d\n", packetType );
+            m_counters[BSD_SOCKET_COUNTER_CREATE_PACKET_FAILURES]++;
+            return nullptr;
+        }
+
+        packet->SerializeRead( stream );
+
+        // IMPORTANT: packet read was aborted. intentionally ignore this packet
+        if ( stream.Aborted() )
+        {
+            m_counters[BSD_SOCKET_COUNTER_ABORTED_PACKET_READS]++;
+            m_config.packetFactory->Destroy( packet );
+            return nullptr;
+        }
+
+        CORE_ASSERT( !stream.IsOverflow() );
+        if ( stream.IsOverflow() )
+        {
+            m_counters[BSD_SOCKET_COUNTER_SERIALIZE_READ_OVERFLOW]++;
+            m_config.packetFactory->Destroy( packet );
+            return nullptr;
+        }
+
+        if ( !stream.Check( 0x51246234 ) )
+        {
+            m_config.packetFactory->Destroy( packet );
+            return nullptr;
         }
+
+        packet->SetAddress( address );
+
+        return packet;
     }
 
     bool BSDSocket::SendPacketInternal( const Address & address, const uint8_t * data, size_t bytes )
@@ -434,24 +979,11 @@ namespace network
 
         m_counters[BSD_SOCKET_COUNTER_PACKETS_SENT]++;
 
-        if ( address.GetType() == ADDRESS_IPV6 )
-        {
-            struct sockaddr_in6 socket_address;
-            memset( &socket_address, 0, sizeof( socket_address ) );
-            socket_address.sin6_family = AF_INET6;
-            socket_address.sin6_port = htons( address.GetPort() );
-            memcpy( &socket_address.sin6_addr, address.GetAddress6(), sizeof( socket_address.sin6_addr ) );
-            const int sent_bytes = sendto( m_socket, (const char*)data, (int) bytes, 0, (sockaddr*)&socket_address, sizeof( sockaddr_in6 ) );
-            result = sent_bytes == (int) bytes;
-        }
-        else if ( address.GetType() == ADDRESS_IPV4 )
+        sockaddr_storage socket_address;
+        const socklen_t socket_address_length = AddressToSocketAddress( address, socket_address );
+        if ( socket_address_length > 0 )
         {
-            sockaddr_in socket_address;
-            memset( &socket_address, 0, sizeof( socket_address ) );
-            socket_address.sin_family = AF_INET;
-            socket_address.sin_addr.s_addr = address.GetAddress4();
-            socket_address.sin_port = htons( (unsigned short) address.GetPort() );
-            const int sent_bytes = sendto( m_socket, (const char*)data, (int) bytes, 0, (sockaddr*) &socket_address, sizeof(sockaddr_in) );
+            const int sent_bytes = sendto( m_socket, (const char*)data, (int) bytes, 0, (sockaddr*)&socket_address, socket_address_length );
             result = sent_bytes == (int) bytes;
         }
 
@@ -459,6 +991,10 @@ namespace network
         {
             m_counters[BSD_SOCKET_COUNTER_SEND_FAILURES]++;
         }
+        else
+        {
+            m_counters[BSD_SOCKET_COUNTER_BYTES_SENT] += bytes;
+        }
 
         return result;
     }
@@ -491,6 +1027,7 @@ namespace network
         CORE_ASSERT( result >= 0 );
 
         m_counters[BSD_SOCKET_COUNTER_PACKETS_RECEIVED]++;
+        m_counters[BSD_SOCKET_COUNTER_BYTES_RECEIVED] += result;
 
         return result;
     }
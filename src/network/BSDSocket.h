@@ -29,10 +29,19 @@
 #include "network/Interface.h"
 #include "protocol/PacketFactory.h"
 
-namespace core { class Allocator; }
+namespace core { class Allocator; class PoolAllocator; }
+
+namespace protocol { class PacketBuffer; }
 
 namespace network 
 {     
+    struct BSDSocketBatch;
+
+    class ReceiveBufferPool;
+
+    class Compressor;
+    class PacketCapture;
+
     struct BSDSocketConfig
     {
         BSDSocketConfig()
@@ -45,6 +54,12 @@ namespace network
             packetFactory = nullptr;
             sendQueueSize = 256;
             receiveQueueSize = 256;
+            batchSize = 1;
+            zeroCopy = false;
+            compression = false;
+            compressionDictionary = nullptr;
+            compressionDictionaryBytes = 0;
+            capture = nullptr;
         }
 
         core::Allocator * allocator;                // allocator for long term allocations matching object life cycle. if nullptr then the default allocator is used.
@@ -54,9 +69,25 @@ namespace network
         int maxPacketSize;                          // maximum packet size
         int sendQueueSize;                          // send queue size between "SendPacket" and sendto. additional sent packets will be dropped.
         int receiveQueueSize;                       // send queue size between "recvfrom" and "ReceivePacket" function. additional received packets will be dropped.
+        int batchSize;                              // max packets sent/received per sendmmsg/recvmmsg call. 1 means one sendto/recvfrom per packet. ignored where batched io is unavailable.
+        bool zeroCopy;                              // receive into pooled, reference counted packet buffers so blocks and fragments reference the datagram instead of copying it. received blocks may outlive the socket.
+        bool compression;                           // compress packets after the protocol id. both ends must agree.
+        const uint8_t * compressionDictionary;      // optional dictionary trained offline with network::TrainDictionary. both ends must use the same dictionary.
+        int compressionDictionaryBytes;             // size of the compression dictionary in bytes
+        PacketCapture * capture;                    // if not null, packets sent are captured as they are before compression, to train a dictionary with.
         protocol::PacketFactory * packetFactory;    // packet factory (required)
     };
 
+    struct BSDSocketCompressionStats
+    {
+        uint64_t packetsCompressed;                 // packets sent through the compressor
+        uint64_t packetsDecompressed;               // packets received through the decompressor
+        uint64_t uncompressedBytes;                 // bytes sent, before compression
+        uint64_t compressedBytes;                   // bytes sent, after compression. uncompressedBytes / compressedBytes is the compression ratio.
+        uint64_t compressNanoseconds;               // total time spent compressing
+        uint64_t decompressNanoseconds;             // total time spent decompressing
+    };
+
     class BSDSocket : public Interface
     {
     public:
@@ -85,12 +116,28 @@ namespace network
 
         uint16_t GetPort() const;
 
+        const BSDSocketCompressionStats & GetCompressionStats( int packetType ) const;
+
     private:
 
         void SendPackets();
 
         void ReceivePackets();
 
+        void SendPacketsBatched();
+
+        void ReceivePacketsBatched();
+
+        int WritePacketToBuffer( protocol::Packet * packet, uint8_t * buffer );
+
+        protocol::Packet * ReadPacketFromBuffer( const Address & address, uint8_t * buffer, int bytes, protocol::PacketBuffer * packetBuffer = nullptr );
+
+        int CompressPacket( int packetType, const uint8_t * input, int bytes, uint8_t * output );
+
+        int DecompressPacket( const uint8_t * input, int bytes, uint8_t * output );
+
+        protocol::PacketBuffer * AcquireReceivePacketBuffer( protocol::PacketBuffer * packetBuffer );
+
         bool SendPacketInternal( const Address & address, const uint8_t * data, size_t bytes );
     
         int ReceivePacketInternal( Address & sender, void * data, int size );
@@ -107,6 +154,14 @@ namespace network
         core::Queue<protocol::Packet*> m_send_queue;
         core::Queue<protocol::Packet*> m_receive_queue;
         uint8_t * m_receiveBuffer;
+        ReceiveBufferPool * m_receiveBufferPool;
+        protocol::PacketBuffer * m_receivePacketBuffer;
+        BSDSocketBatch * m_batch;
+        Compressor * m_compressor;
+        uint8_t * m_compressBuffer;
+        uint8_t * m_decompressBuffer;
+        protocol::PacketBuffer * m_decompressPacketBuffer;
+        BSDSocketCompressionStats * m_compressionStats;
         const void ** m_context;
         uint64_t m_counters[BSD_SOCKET_COUNTER_NUM_COUNTERS];
 
@@ -0,0 +1,578 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "network/Compressor.h"
+#include "core/Memory.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace network
+{
+    static const int MinMatch = 4;
+    static const int MaxOffset = 65535;
+    static const int LastLiterals = 5;                  // the last 5 bytes are always literals
+    static const int MatchFindLimit = 12;               // the last match must start at least 12 bytes before the end
+    static const int HashBits = 12;
+    static const int HashSize = 1 << HashBits;
+
+    static inline uint32_t read32( const uint8_t * p )
+    {
+        uint32_t value;
+        memcpy( &value, p, 4 );
+        return value;
+    }
+
+    static inline uint32_t hash32( uint32_t value )
+    {
+        return ( value * 2654435761U ) >> ( 32 - HashBits );
+    }
+
+    static inline uint8_t * write_length( uint8_t * op, int length )
+    {
+        while ( length >= 255 )
+        {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = (uint8_t) length;
+        return op;
+    }
+
+    static inline bool read_length( const uint8_t * & ip, const uint8_t * iend, int & length )
+    {
+        while ( true )
+        {
+            if ( ip >= iend )
+                return false;
+            const int value = *ip++;
+            length += value;
+            if ( value != 255 )
+                return true;
+        }
+    }
+
+    Compressor::Compressor( core::Allocator & allocator, const uint8_t * dictionary, int dictionaryBytes )
+    {
+        CORE_ASSERT( dictionaryBytes >= 0 );
+        CORE_ASSERT( dictionary || dictionaryBytes == 0 );
+
+        m_allocator = &allocator;
+
+        m_table = (uint32_t*) m_allocator->Allocate( sizeof( uint32_t ) * HashSize );
+
+        m_dictionary = nullptr;
+        m_dictionaryTable = nullptr;
+        m_dictionaryBytes = 0;
+
+        if ( dictionaryBytes > 0 )
+        {
+            if ( dictionaryBytes > MaxOffset )
+            {
+                dictionary += dictionaryBytes - MaxOffset;
+                dictionaryBytes = MaxOffset;
+            }
+
+            m_dictionaryBytes = dictionaryBytes;
+            m_dictionary = (uint8_t*) m_allocator->Allocate( dictionaryBytes );
+            memcpy( m_dictionary, dictionary, dictionaryBytes );
+
+            // later positions overwrite earlier ones, so the table prefers matches closest to the packet
+
+            m_dictionaryTable = (uint32_t*) m_allocator->Allocate( sizeof( uint32_t ) * HashSize );
+            memset( m_dictionaryTable, 0, sizeof( uint32_t ) * HashSize );
+            for ( int i = 0; i + MinMatch <= dictionaryBytes; ++i )
+                m_dictionaryTable[hash32( read32( m_dictionary + i ) )] = i + 1;
+        }
+
+        ResetTable();
+    }
+
+    Compressor::~Compressor()
+    {
+        CORE_ASSERT( m_table );
+        m_allocator->Free( m_table );
+        m_table = nullptr;
+
+        if ( m_dictionary )
+        {
+            m_allocator->Free( m_dictionary );
+            m_allocator->Free( m_dictionaryTable );
+            m_dictionary = nullptr;
+            m_dictionaryTable = nullptr;
+        }
+    }
+
+    void Compressor::ResetTable()
+    {
+        memset( m_table, 0, sizeof( uint32_t ) * HashSize );
+        m_base = 1;
+    }
+
+    int Compressor::GetDictionaryBytes() const
+    {
+        return m_dictionaryBytes;
+    }
+
+    int Compressor::GetMaxCompressedBytes( int inputBytes )
+    {
+        return inputBytes + inputBytes / 255 + 16;
+    }
+
+    int Compressor::Compress( const uint8_t * input, int inputBytes, uint8_t * output, int outputBytes )
+    {
+        CORE_ASSERT( input );
+        CORE_ASSERT( output );
+        CORE_ASSERT( inputBytes >= 0 );
+
+        // rather than clearing the hash table for each packet, positions are offset by a base that moves past the previous packet
+
+        if ( m_base > 0x7FFFFFFF - (uint32_t) inputBytes )
+            ResetTable();
+
+        const uint32_t base = m_base;
+        m_base += inputBytes;
+
+        const uint8_t * ip = input;
+        const uint8_t * anchor = input;
+        const uint8_t * const iend = input + inputBytes;
+        const uint8_t * const mflimit = iend - MatchFindLimit;
+        const uint8_t * const matchlimit = iend - LastLiterals;
+        const uint8_t * const dictionaryEnd = m_dictionary + m_dictionaryBytes;
+
+        uint8_t * op = output;
+        uint8_t * const oend = output + outputBytes;
+
+        if ( inputBytes >= MatchFindLimit + 1 )
+        {
+            while ( ip < mflimit )
+            {
+                const uint32_t sequence = read32( ip );
+                const uint32_t hash = hash32( sequence );
+
+                const uint8_t * match = nullptr;
+                bool dictionaryMatch = false;
+
+                const uint32_t candidate = m_table[hash];
+                m_table[hash] = base + uint32_t( ip - input );
+
+                if ( candidate >= base )
+                {
+                    const uint8_t * p = input + ( candidate - base );
+                    if ( ip - p <= MaxOffset && read32( p ) == sequence )
+                        match = p;
+                }
+
+                if ( !match && m_dictionaryTable && m_dictionaryTable[hash] )
+                {
+                    const uint8_t * p = m_dictionary + m_dictionaryTable[hash] - 1;
+                    if ( ( ip - input ) + ( dictionaryEnd - p ) <= MaxOffset && read32( p ) == sequence )
+                    {
+                        match = p;
+                        dictionaryMatch = true;
+                    }
+                }
+
+                if ( !match )
+                {
+                    // skip ahead faster the longer we go without finding a match
+
+                    ip += 1 + ( ( ip - anchor ) >> 6 );
+                    continue;
+                }
+
+                // extend the match backwards into pending literals, then forwards
+
+                if ( !dictionaryMatch )
+                {
+                    while ( ip > anchor && match > input && ip[-1] == match[-1] )
+                    {
+                        ip--;
+                        match--;
+                    }
+                }
+                else
+                {
+                    while ( ip > anchor && match > m_dictionary && ip[-1] == match[-1] )
+                    {
+                        ip--;
+                        match--;
+                    }
+                }
+
+                int matchBytes = MinMatch;
+                const uint8_t * const limit = dictionaryMatch ? core::min( matchlimit, ip + ( dictionaryEnd - match ) ) : matchlimit;
+                while ( ip + matchBytes < limit && ip[matchBytes] == match[matchBytes] )
+                    matchBytes++;
+
+                const int offset = dictionaryMatch ? int( ip - input ) + int( dictionaryEnd - match ) : int( ip - match );
+                const int literalBytes = int( ip - anchor );
+
+                CORE_ASSERT( offset > 0 );
+                CORE_ASSERT( offset <= MaxOffset );
+
+                if ( op + 1 + literalBytes / 255 + 1 + literalBytes + 2 + matchBytes / 255 + 1 > oend )
+                    return 0;
+
+                uint8_t * token = op++;
+                *token = uint8_t( core::min( literalBytes, 15 ) << 4 ) | uint8_t( core::min( matchBytes - MinMatch, 15 ) );
+
+                if ( literalBytes >= 15 )
+                    op = write_length( op, literalBytes - 15 );
+
+                memcpy( op, anchor, literalBytes );
+                op += literalBytes;
+
+                *op++ = uint8_t( offset & 0xFF );
+                *op++ = uint8_t( offset >> 8 );
+
+                if ( matchBytes - MinMatch >= 15 )
+                    op = write_length( op, matchBytes - MinMatch - 15 );
+
+                ip += matchBytes;
+                anchor = ip;
+
+                if ( ip < mflimit )
+                    m_table[hash32( read32( ip - 2 ) )] = base + uint32_t( ip - 2 - input );
+            }
+        }
+
+        // last literals
+
+        const int literalBytes = int( iend - anchor );
+
+        if ( op + 1 + literalBytes / 255 + 1 + literalBytes > oend )
+            return 0;
+
+        uint8_t * token = op++;
+        *token = uint8_t( core::min( literalBytes, 15 ) << 4 );
+
+        if ( literalBytes >= 15 )
+            op = write_length( op, literalBytes - 15 );
+
+        memcpy( op, anchor, literalBytes );
+        op += literalBytes;
+
+        return int( op - output );
+    }
+
+    int Compressor::Decompress( const uint8_t * input, int inputBytes, uint8_t * output, int outputBytes ) const
+    {
+        CORE_ASSERT( input );
+        CORE_ASSERT( output );
+
+        // IMPORTANT: input comes off the network. validate everything
+
+        const uint8_t * ip = input;
+        const uint8_t * const iend = input + inputBytes;
+
+        uint8_t * op = output;
+        uint8_t * const oend = output + outputBytes;
+
+        while ( true )
+        {
+            if ( ip >= iend )
+                return -1;
+
+            const int token = *ip++;
+
+            int literalBytes = token >> 4;
+            if ( literalBytes == 15 && !read_length( ip, iend, literalBytes ) )
+                return -1;
+
+            if ( literalBytes > iend - ip || literalBytes > oend - op )
+                return -1;
+
+            memcpy( op, ip, literalBytes );
+            op += literalBytes;
+            ip += literalBytes;
+
+            // the last sequence has literals only
+
+            if ( ip == iend )
+                break;
+
+            if ( iend - ip < 2 )
+                return -1;
+
+            const int offset = ip[0] | ( ip[1] << 8 );
+            ip += 2;
+
+            int matchBytes = token & 15;
+            if ( matchBytes == 15 && !read_length( ip, iend, matchBytes ) )
+                return -1;
+            matchBytes += MinMatch;
+
+            const int position = int( op - output );
+
+            if ( offset == 0 || offset > position + m_dictionaryBytes || matchBytes > oend - op )
+                return -1;
+
+            if ( offset > position )
+            {
+                // the match starts in the dictionary and may continue into the output
+
+                const int dictionaryBytes = core::min( matchBytes, offset - position );
+                memcpy( op, m_dictionary + m_dictionaryBytes - ( offset - position ), dictionaryBytes );
+                op += dictionaryBytes;
+                matchBytes -= dictionaryBytes;
+
+                const uint8_t * match = output;
+                while ( matchBytes-- > 0 )
+                    *op++ = *match++;
+            }
+            else if ( offset >= matchBytes )
+            {
+                memcpy( op, op - offset, matchBytes );
+                op += matchBytes;
+            }
+            else
+            {
+                // overlapping match repeats the last offset bytes
+
+                const uint8_t * match = op - offset;
+                while ( matchBytes-- > 0 )
+                    *op++ = *match++;
+            }
+        }
+
+        return int( op - output );
+    }
+
+    // ----------------------------------------------------------------
+
+    PacketCapture::PacketCapture( core::Allocator & allocator, int maxPackets, int maxPacketSize )
+    {
+        CORE_ASSERT( maxPackets > 0 );
+        CORE_ASSERT( maxPacketSize > 0 );
+
+        m_allocator = &allocator;
+        m_maxPackets = maxPackets;
+        m_maxPacketSize = maxPacketSize;
+        m_packetBytes = (int*) m_allocator->Allocate( sizeof( int ) * maxPackets );
+        m_packetData = (uint8_t*) m_allocator->Allocate( maxPackets * maxPacketSize );
+
+        Reset();
+    }
+
+    PacketCapture::~PacketCapture()
+    {
+        CORE_ASSERT( m_packetBytes );
+        CORE_ASSERT( m_packetData );
+        m_allocator->Free( m_packetBytes );
+        m_allocator->Free( m_packetData );
+        m_packetBytes = nullptr;
+        m_packetData = nullptr;
+    }
+
+    void PacketCapture::Reset()
+    {
+        m_numPackets = 0;
+    }
+
+    void PacketCapture::AddPacket( const uint8_t * data, int bytes )
+    {
+        CORE_ASSERT( data );
+
+        if ( m_numPackets == m_maxPackets || bytes <= 0 || bytes > m_maxPacketSize )
+            return;
+
+        m_packetBytes[m_numPackets] = bytes;
+        memcpy( m_packetData + m_numPackets * m_maxPacketSize, data, bytes );
+        m_numPackets++;
+    }
+
+    int PacketCapture::GetNumPackets() const
+    {
+        return m_numPackets;
+    }
+
+    const uint8_t * PacketCapture::GetPacketData( int index ) const
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < m_numPackets );
+        return m_packetData + index * m_maxPacketSize;
+    }
+
+    int PacketCapture::GetPacketBytes( int index ) const
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < m_numPackets );
+        return m_packetBytes[index];
+    }
+
+    bool PacketCapture::Save( const char * filename ) const
+    {
+        FILE * file = fopen( filename, "wb" );
+        if ( !file )
+            return false;
+
+        bool result = fwrite( &m_numPackets, sizeof( int ), 1, file ) == 1;
+
+        for ( int i = 0; i < m_numPackets && result; ++i )
+        {
+            result = fwrite( &m_packetBytes[i], sizeof( int ), 1, file ) == 1 &&
+                     fwrite( GetPacketData( i ), m_packetBytes[i], 1, file ) == 1;
+        }
+
+        fclose( file );
+
+        return result;
+    }
+
+    bool PacketCapture::Load( const char * filename )
+    {
+        Reset();
+
+        FILE * file = fopen( filename, "rb" );
+        if ( !file )
+            return false;
+
+        int numPackets = 0;
+        bool result = fread( &numPackets, sizeof( int ), 1, file ) == 1 && numPackets >= 0;
+
+        uint8_t * buffer = (uint8_t*) alloca( m_maxPacketSize );
+
+        for ( int i = 0; i < numPackets && result; ++i )
+        {
+            int bytes = 0;
+            result = fread( &bytes, sizeof( int ), 1, file ) == 1 && bytes > 0;
+            if ( !result )
+                break;
+
+            // packets larger than this capture allows are skipped
+
+            if ( bytes > m_maxPacketSize )
+            {
+                result = fseek( file, bytes, SEEK_CUR ) == 0;
+                continue;
+            }
+
+            result = fread( buffer, bytes, 1, file ) == 1;
+            if ( result )
+                AddPacket( buffer, bytes );
+        }
+
+        fclose( file );
+
+        return result;
+    }
+
+    // ----------------------------------------------------------------
+
+    int TrainDictionary( const PacketCapture & capture, uint8_t * dictionary, int dictionaryBytes )
+    {
+        CORE_ASSERT( dictionary );
+        CORE_ASSERT( dictionaryBytes > 0 );
+
+        const int KeyBytes = 8;                 // byte sequences counted
+        const int SegmentBytes = 32;            // unit of packet data copied into the dictionary
+        const int SegmentStep = 4;              // candidate segments start every n bytes
+        const int KeyHashBits = 16;
+
+        core::Allocator & allocator = core::memory::default_allocator();
+
+        // count how often each key occurs across all packets. the key hash of every packet position is kept for scoring
+
+        int totalBytes = 0;
+        for ( int i = 0; i < capture.GetNumPackets(); ++i )
+            totalBytes += capture.GetPacketBytes( i );
+
+        if ( totalBytes == 0 )
+            return 0;
+
+        uint32_t * counts = (uint32_t*) allocator.Allocate( sizeof( uint32_t ) << KeyHashBits );
+        uint16_t * keys = (uint16_t*) allocator.Allocate( sizeof( uint16_t ) * totalBytes );
+
+        memset( counts, 0, sizeof( uint32_t ) << KeyHashBits );
+
+        int offset = 0;
+        for ( int i = 0; i < capture.GetNumPackets(); ++i )
+        {
+            const uint8_t * data = capture.GetPacketData( i );
+            const int bytes = capture.GetPacketBytes( i );
+            for ( int j = 0; j + KeyBytes <= bytes; ++j )
+            {
+                uint64_t value;
+                memcpy( &value, data + j, KeyBytes );
+                const uint16_t key = uint16_t( ( value * 0x9E3779B97F4A7C15ULL ) >> ( 64 - KeyHashBits ) );
+                keys[offset+j] = key;
+                counts[key]++;
+            }
+            offset += bytes;
+        }
+
+        // pick the best scoring segment, then zero the counts of its keys so the next pick covers different data
+
+        int position = dictionaryBytes;
+
+        while ( position > 0 )
+        {
+            uint64_t bestScore = 0;
+            int bestPacket = -1;
+            int bestStart = 0;
+            int bestBytes = 0;
+
+            offset = 0;
+            for ( int i = 0; i < capture.GetNumPackets(); ++i )
+            {
+                const int bytes = capture.GetPacketBytes( i );
+                const int segmentBytes = core::min( SegmentBytes, core::min( bytes, position ) );
+                for ( int start = 0; start + segmentBytes <= bytes && segmentBytes >= KeyBytes; start += SegmentStep )
+                {
+                    uint64_t score = 0;
+                    for ( int j = start; j + KeyBytes <= start + segmentBytes; ++j )
+                        score += counts[keys[offset+j]];
+                    if ( score > bestScore )
+                    {
+                        bestScore = score;
+                        bestPacket = i;
+                        bestStart = start;
+                        bestBytes = segmentBytes;
+                    }
+                }
+                offset += bytes;
+            }
+
+            if ( bestPacket < 0 || bestScore <= 1 )
+                break;
+
+            position -= bestBytes;
+            memcpy( dictionary + position, capture.GetPacketData( bestPacket ) + bestStart, bestBytes );
+
+            offset = 0;
+            for ( int i = 0; i < bestPacket; ++i )
+                offset += capture.GetPacketBytes( i );
+            for ( int j = bestStart; j + KeyBytes <= bestStart + bestBytes; ++j )
+                counts[keys[offset+j]] = 0;
+        }
+
+        allocator.Free( counts );
+        allocator.Free( keys );
+
+        // the dictionary was filled from the end. move it to the start
+
+        const int trainedBytes = dictionaryBytes - position;
+        memmove( dictionary, dictionary + position, trainedBytes );
+        return trainedBytes;
+    }
+}
@@ -0,0 +1,126 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef NETWORK_COMPRESSOR_H
+#define NETWORK_COMPRESSOR_H
+
+#include "core/Core.h"
+
+namespace core { class Allocator; }
+
+namespace network
+{
+    /*
+        Packet compressor. Produces the LZ4 block format, with an optional
+        dictionary that acts as if it was prepended to every packet.
+
+        Packets are small and laid out so that values which rarely change
+        sit at the same place in every packet, so most of the gain comes
+        from matches into a dictionary trained on captured packets (see
+        TrainDictionary). Each packet is compressed independently.
+    */
+
+    class Compressor
+    {
+    public:
+
+        Compressor( core::Allocator & allocator, const uint8_t * dictionary = nullptr, int dictionaryBytes = 0 );
+
+        ~Compressor();
+
+        int Compress( const uint8_t * input, int inputBytes, uint8_t * output, int outputBytes );
+
+        int Decompress( const uint8_t * input, int inputBytes, uint8_t * output, int outputBytes ) const;
+
+        int GetDictionaryBytes() const;
+
+        static int GetMaxCompressedBytes( int inputBytes );
+
+    private:
+
+        void ResetTable();
+
+        core::Allocator * m_allocator;
+
+        uint8_t * m_dictionary;                     // copy of the dictionary. at most the last 64k bytes are kept, since matches can't reach further back.
+        int m_dictionaryBytes;
+        uint32_t * m_dictionaryTable;               // hash of 4 bytes -> position in dictionary + 1. zero if empty.
+        uint32_t * m_table;                         // hash of 4 bytes -> m_base + position in the packet being compressed
+        uint32_t m_base;                            // positions in m_table below this belong to previous packets
+
+        Compressor( const Compressor & other );
+        Compressor & operator = ( const Compressor & other );
+    };
+
+    /*
+        Captures serialized packets, so a dictionary can be trained from
+        real traffic offline. Packets are added until the capture is full.
+    */
+
+    class PacketCapture
+    {
+    public:
+
+        PacketCapture( core::Allocator & allocator, int maxPackets, int maxPacketSize );
+
+        ~PacketCapture();
+
+        void Reset();
+
+        void AddPacket( const uint8_t * data, int bytes );
+
+        int GetNumPackets() const;
+
+        const uint8_t * GetPacketData( int index ) const;
+
+        int GetPacketBytes( int index ) const;
+
+        bool Save( const char * filename ) const;
+
+        bool Load( const char * filename );
+
+    private:
+
+        core::Allocator * m_allocator;
+
+        int m_maxPackets;
+        int m_maxPacketSize;
+        int m_numPackets;
+        int * m_packetBytes;
+        uint8_t * m_packetData;
+
+        PacketCapture( const PacketCapture & other );
+        PacketCapture & operator = ( const PacketCapture & other );
+    };
+
+    /*
+        Builds a dictionary from captured packets. Segments of packet data
+        sharing the most frequently occuring byte sequences are picked greedily,
+        and the best segments are placed at the end of the dictionary, closest
+        to the packet. Returns the number of dictionary bytes written.
+    */
+
+    int TrainDictionary( const PacketCapture & capture, uint8_t * dictionary, int dictionaryBytes );
+}
+
+#endif
@@ -27,4 +27,10 @@
 
 #define NETWORK_USE_RESOLVER 0
 
+#if defined(__linux__)
+#define NETWORK_HAS_BATCHED_IO 1                // sendmmsg/recvmmsg are available
+#else
+#define NETWORK_HAS_BATCHED_IO 0
+#endif
+
 #endif
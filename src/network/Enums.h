@@ -50,6 +50,8 @@ namespace network
     {
         BSD_SOCKET_COUNTER_PACKETS_SENT,
         BSD_SOCKET_COUNTER_PACKETS_RECEIVED,
+        BSD_SOCKET_COUNTER_BYTES_SENT,
+        BSD_SOCKET_COUNTER_BYTES_RECEIVED,
         BSD_SOCKET_COUNTER_SEND_FAILURES,
         BSD_SOCKET_COUNTER_SERIALIZE_WRITE_OVERFLOW,
         BSD_SOCKET_COUNTER_SERIALIZE_READ_OVERFLOW,
@@ -57,6 +59,12 @@ namespace network
         BSD_SOCKET_COUNTER_CREATE_PACKET_FAILURES,
         BSD_SOCKET_COUNTER_PROTOCOL_ID_MISMATCH,
         BSD_SOCKET_COUNTER_ABORTED_PACKET_READS,
+        BSD_SOCKET_COUNTER_SEND_BATCHES,
+        BSD_SOCKET_COUNTER_RECEIVE_BATCHES,
+        BSD_SOCKET_COUNTER_MAX_SEND_BATCH_SIZE,
+        BSD_SOCKET_COUNTER_MAX_RECEIVE_BATCH_SIZE,
+        BSD_SOCKET_COUNTER_RECEIVE_BUFFERS_ALLOCATED,
+        BSD_SOCKET_COUNTER_DECOMPRESS_FAILURES,
         BSD_SOCKET_COUNTER_NUM_COUNTERS
     };
 }
@@ -37,6 +37,9 @@ namespace network
 
         m_packets = CORE_NEW_ARRAY( *m_config.allocator, PacketData, config.numPackets );
 
+        m_heap = (int*) m_config.allocator->Allocate( sizeof( int ) * config.numPackets );
+        m_heapSize = 0;
+
         m_packetNumberSend = 0;
         m_packetNumberReceive = 0;
 
@@ -59,7 +62,10 @@ namespace network
 
         CORE_DELETE_ARRAY( *m_config.allocator, m_packets, m_config.numPackets );
 
+        m_config.allocator->Free( m_heap );
+
         m_packets = nullptr;
+        m_heap = nullptr;
     }
 
     void Simulator::Reset()
@@ -76,7 +82,10 @@ namespace network
                 m_config.packetFactory->Destroy( m_packets[i].packet );
                 m_packets[i].packet = nullptr;
             }
+            m_packets[i].heapIndex = -1;
         }
+
+        m_heapSize = 0;
     }
 
     int Simulator::AddState( const SimulatorState & state )
@@ -150,6 +159,8 @@ namespace network
             {
                 m_config.packetFactory->Destroy( m_packets[index].packet );
                 m_packets[index].packet = nullptr;
+                if ( !m_config.linearReceive )
+                    HeapRemove( index );
             }
 
             const float delay = m_state.latency + jitter;
@@ -160,6 +171,9 @@ namespace network
             
             packet->SetAddress( address );
 
+            if ( !m_config.linearReceive )
+                HeapPush( index );
+
             m_packetNumberSend++;
         }
     }
@@ -183,6 +197,19 @@ namespace network
                 return packet;
             }
         }
+        else if ( !m_config.linearReceive )
+        {
+            // UDP mode. Dequeue the packet with the earliest dequeue time from the top of the heap.
+
+            if ( m_heapSize > 0 && m_packets[m_heap[0]].dequeueTime <= m_timeBase.time )
+            {
+                const int index = m_heap[0];
+                HeapRemove( index );
+                protocol::Packet * packet = m_packets[index].packet;
+                m_packets[index].packet = nullptr;
+                return packet;
+            }
+        }
         else
         {
             // UDP mode. Dequeue the oldest packet we find. Don't worry about ordering at all!
@@ -236,6 +263,85 @@ namespace network
         }
     }
 
+    bool Simulator::HeapLess( int a, int b ) const
+    {
+        const PacketData & packetA = m_packets[m_heap[a]];
+        const PacketData & packetB = m_packets[m_heap[b]];
+        if ( packetA.dequeueTime != packetB.dequeueTime )
+            return packetA.dequeueTime < packetB.dequeueTime;
+        return packetA.packetNumber < packetB.packetNumber;
+    }
+
+    void Simulator::HeapSwap( int i, int j )
+    {
+        core::swap( m_heap[i], m_heap[j] );
+        m_packets[m_heap[i]].heapIndex = i;
+        m_packets[m_heap[j]].heapIndex = j;
+    }
+
+    void Simulator::HeapSiftUp( int i )
+    {
+        while ( i > 0 )
+        {
+            const int parent = ( i - 1 ) / 2;
+            if ( !HeapLess( i, parent ) )
+                break;
+            HeapSwap( i, parent );
+            i = parent;
+        }
+    }
+
+    void Simulator::HeapSiftDown( int i )
+    {
+        while ( true )
+        {
+            const int left = 2 * i + 1;
+            const int right = left + 1;
+            int smallest = i;
+            if ( left < m_heapSize && HeapLess( left, smallest ) )
+                smallest = left;
+            if ( right < m_heapSize && HeapLess( right, smallest ) )
+                smallest = right;
+            if ( smallest == i )
+                break;
+            HeapSwap( i, smallest );
+            i = smallest;
+        }
+    }
+
+    void Simulator::HeapPush( int index )
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < m_config.numPackets );
+        CORE_ASSERT( m_packets[index].heapIndex == -1 );
+        CORE_ASSERT( m_heapSize < m_config.numPackets );
+
+        const int i = m_heapSize++;
+        m_heap[i] = index;
+        m_packets[index].heapIndex = i;
+        HeapSiftUp( i );
+    }
+
+    void Simulator::HeapRemove( int index )
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < m_config.numPackets );
+
+        const int i = m_packets[index].heapIndex;
+        CORE_ASSERT( i >= 0 );
+        CORE_ASSERT( i < m_heapSize );
+
+        const int last = --m_heapSize;
+        if ( i != last )
+        {
+            HeapSwap( i, last );
+            HeapSiftUp( i );
+            HeapSiftDown( i );
+        }
+
+        m_packets[index].heapIndex = -1;
+    }
+
     protocol::Packet * Simulator::SerializePacket( protocol::Packet * input, int & packetSize )
     {
         CORE_ASSERT( input );
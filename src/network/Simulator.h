@@ -52,6 +52,7 @@ namespace network
         bool serializePackets;              // if true then serialize read/writ packets
         int bandwidthSize;                  // number of entries in bandwidth sliding window
         float bandwidthTime;                // average bandwidth over this amount of time in the past
+        bool linearReceive;                 // if true then UDP mode receive scans every buffered packet (the old O(n) path, kept for profiling)
 
         SimulatorConfig()
         {   
@@ -64,6 +65,7 @@ namespace network
             packetHeaderSize = 28;
             bandwidthSize = 1024;
             bandwidthTime = 0.5f;
+            linearReceive = false;
         }
     };
 
@@ -161,17 +163,31 @@ namespace network
 
     private:
 
+        bool HeapLess( int a, int b ) const;
+
+        void HeapSwap( int i, int j );
+
+        void HeapSiftUp( int i );
+
+        void HeapSiftDown( int i );
+
+        void HeapPush( int index );
+
+        void HeapRemove( int index );
+
         struct PacketData
         {
             protocol::Packet * packet;
             double dequeueTime;
             uint32_t packetNumber;
+            int heapIndex;
 
             PacketData()
             {
                 packet = NULL;
                 dequeueTime = 0.0;
                 packetNumber = 0;
+                heapIndex = -1;
             }
         };
 
@@ -186,6 +202,9 @@ namespace network
 
         PacketData * m_packets;
 
+        int * m_heap;                       // UDP mode: min-heap of packet indices ordered by dequeue time
+        int m_heapSize;
+
         bool m_tcpMode;
         bool m_bandwidthExclude;
 
@@ -39,18 +39,12 @@ namespace protocol
         m_overflow = false;
     }
 
-    void BitWriter::WriteBits( uint32_t value, int bits )
+    inline void BitWriter::WriteBitsUnchecked( uint32_t value, int bits )
     {
         CORE_ASSERT( bits > 0 );
         CORE_ASSERT( bits <= 32 );
         CORE_ASSERT( m_bitsWritten + bits <= m_numBits );
 
-        if ( m_bitsWritten + bits > m_numBits )
-        {
-            m_overflow = true;
-            return;
-        }
-
         value &= ( uint64_t( 1 ) << bits ) - 1;
 
         m_scratch |= uint64_t( value ) << ( 64 - m_bitIndex - bits );
@@ -69,6 +63,63 @@ namespace protocol
         m_bitsWritten += bits;
     }
 
+    void BitWriter::WriteBits( uint32_t value, int bits )
+    {
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 32 );
+        CORE_ASSERT( m_bitsWritten + bits <= m_numBits );
+
+        if ( m_bitsWritten + bits > m_numBits )
+        {
+            m_overflow = true;
+            return;
+        }
+
+        WriteBitsUnchecked( value, bits );
+    }
+
+    void BitWriter::WriteBits64( uint64_t value, int bits )
+    {
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 64 );
+        CORE_ASSERT( m_bitsWritten + bits <= m_numBits );
+
+        if ( m_bitsWritten + bits > m_numBits )
+        {
+            m_overflow = true;
+            return;
+        }
+
+        if ( bits > 32 )
+        {
+            WriteBitsUnchecked( uint32_t( value >> 32 ), bits - 32 );
+            WriteBitsUnchecked( uint32_t( value ), 32 );
+        }
+        else
+        {
+            WriteBitsUnchecked( uint32_t( value ), bits );
+        }
+    }
+
+    void BitWriter::WriteBitsArray( const uint32_t * values, int count, int bits )
+    {
+        CORE_ASSERT( values || count == 0 );
+        CORE_ASSERT( count >= 0 );
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 32 );
+
+        // IMPORTANT: the whole run is bounds checked once here, so values are packed without per-value checks
+
+        if ( m_bitsWritten + int64_t( count ) * bits > m_numBits )
+        {
+            m_overflow = true;
+            return;
+        }
+
+        for ( int i = 0; i < count; ++i )
+            WriteBitsUnchecked( values[i], bits );
+    }
+
     void BitWriter::WriteAlign()
     {
         const int remainderBits = m_bitsWritten % 8;
@@ -97,7 +148,7 @@ namespace protocol
         if ( headBytes > bytes )
             headBytes = bytes;
         for ( int i = 0; i < headBytes; ++i )
-            WriteBits( data[i], 8 );
+            WriteBitsUnchecked( data[i], 8 );
         if ( headBytes == bytes )
             return;
 
@@ -123,7 +174,7 @@ namespace protocol
         int tailBytes = bytes - tailStart;
         CORE_ASSERT( tailBytes >= 0 && tailBytes < 4 );
         for ( int i = 0; i < tailBytes; ++i )
-            WriteBits( data[tailStart+i], 8 );
+            WriteBitsUnchecked( data[tailStart+i], 8 );
 
         CORE_ASSERT( GetAlignBits() == 0 );
 
@@ -154,21 +205,16 @@ namespace protocol
         m_bitIndex = 0;
         m_wordIndex = 0;
         m_scratch = core::network_to_host( m_data[0] );
+        m_reorderedWordIndex = -1;
         m_overflow = false;
     }
 
-    uint32_t BitReader::ReadBits( int bits )
+    inline uint32_t BitReader::ReadBitsUnchecked( int bits )
     {
         CORE_ASSERT( bits > 0 );
         CORE_ASSERT( bits <= 32 );
         CORE_ASSERT( m_bitsRead + bits <= m_numBits );
 
-        if ( m_bitsRead + bits > m_numBits )
-        {
-            m_overflow = true;
-            return 0;
-        }
-
         m_bitsRead += bits;
 
         CORE_ASSERT( m_bitIndex < 32 );
@@ -197,6 +243,63 @@ namespace protocol
         return output;
     }
 
+    uint32_t BitReader::ReadBits( int bits )
+    {
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 32 );
+        CORE_ASSERT( m_bitsRead + bits <= m_numBits );
+
+        if ( m_bitsRead + bits > m_numBits )
+        {
+            m_overflow = true;
+            return 0;
+        }
+
+        return ReadBitsUnchecked( bits );
+    }
+
+    uint64_t BitReader::ReadBits64( int bits )
+    {
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 64 );
+        CORE_ASSERT( m_bitsRead + bits <= m_numBits );
+
+        if ( m_bitsRead + bits > m_numBits )
+        {
+            m_overflow = true;
+            return 0;
+        }
+
+        if ( bits > 32 )
+        {
+            const uint64_t hi = ReadBitsUnchecked( bits - 32 );
+            const uint64_t lo = ReadBitsUnchecked( 32 );
+            return ( hi << 32 ) | lo;
+        }
+        else
+        {
+            return ReadBitsUnchecked( bits );
+        }
+    }
+
+    void BitReader::ReadBitsArray( uint32_t * values, int count, int bits )
+    {
+        CORE_ASSERT( values || count == 0 );
+        CORE_ASSERT( count >= 0 );
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 32 );
+
+        if ( m_bitsRead + int64_t( count ) * bits > m_numBits )
+        {
+            memset( values, 0, sizeof( uint32_t ) * count );
+            m_overflow = true;
+            return;
+        }
+
+        for ( int i = 0; i < count; ++i )
+            values[i] = ReadBitsUnchecked( bits );
+    }
+
     void BitReader::ReadAlign()
     {
         const int remainderBits = m_bitsRead % 8;
@@ -218,7 +321,7 @@ namespace protocol
 
         if ( m_bitsRead + bytes * 8 >= m_numBits )
         {
-            memset( data, bytes, 0 );
+            memset( data, 0, bytes );
             m_overflow = true;
             return;
         }
@@ -231,7 +334,7 @@ namespace protocol
         if ( headBytes > bytes )
             headBytes = bytes;
         for ( int i = 0; i < headBytes; ++i )
-            data[i] = ReadBits( 8 );
+            data[i] = ReadBitsUnchecked( 8 );
         if ( headBytes == bytes )
             return;
 
@@ -257,10 +360,90 @@ namespace protocol
         int tailBytes = bytes - tailStart;
         CORE_ASSERT( tailBytes >= 0 && tailBytes < 4 );
         for ( int i = 0; i < tailBytes; ++i )
-            data[tailStart+i] = ReadBits( 8 );
+            data[tailStart+i] = ReadBitsUnchecked( 8 );
 
         CORE_ASSERT( GetAlignBits() == 0 );
 
         CORE_ASSERT( headBytes + numWords * 4 + tailBytes == bytes );
     }
+
+    static void reorder_partial_word( uint8_t * word )
+    {
+        // bits are packed most significant first, so the first byte read from a word is its top byte, wherever that lives in memory.
+        // IMPORTANT: this is not its own inverse, so each word must only be reordered once
+
+        const uint32_t value = core::network_to_host( *( (const uint32_t*) word ) );
+        word[0] = uint8_t( value >> 24 );
+        word[1] = uint8_t( value >> 16 );
+        word[2] = uint8_t( value >> 8 );
+        word[3] = uint8_t( value );
+    }
+
+    uint8_t * BitReader::ReadBytesInPlace( int bytes )
+    {
+        CORE_ASSERT( GetAlignBits() == 0 );
+
+        if ( m_bitsRead + bytes * 8 >= m_numBits )
+        {
+            m_overflow = true;
+            return nullptr;
+        }
+
+        // whole words are copied as is by BitWriter::WriteBytes, so only the partial words either
+        // side need their bytes put in memory order. each is rewritten after it has been loaded into
+        // the scratch, so reading continues from the scratch as if nothing had changed. consecutive
+        // in place reads can share a partial word, and once reordered it is in memory order for both.
+
+        uint8_t * buffer = (uint8_t*) const_cast<uint32_t*>( m_data );
+
+        uint8_t * data = buffer + m_bitsRead / 8;
+
+        // head bytes
+
+        CORE_ASSERT( m_bitIndex == 0 || m_bitIndex == 8 || m_bitIndex == 16 || m_bitIndex == 24 );
+
+        int headBytes = ( 4 - m_bitIndex / 8 ) % 4;
+        if ( headBytes > bytes )
+            headBytes = bytes;
+        if ( headBytes > 0 && m_wordIndex > m_reorderedWordIndex )
+        {
+            reorder_partial_word( buffer + m_wordIndex * 4 );
+            m_reorderedWordIndex = m_wordIndex;
+        }
+        for ( int i = 0; i < headBytes; ++i )
+            ReadBitsUnchecked( 8 );
+        if ( headBytes == bytes )
+            return data;
+
+        CORE_ASSERT( GetAlignBits() == 0 );
+
+        // words
+
+        int numWords = ( bytes - headBytes ) / 4;
+        if ( numWords > 0 )
+        {
+            CORE_ASSERT( m_bitIndex == 0 );
+            m_bitsRead += numWords * 32;
+            m_wordIndex += numWords;
+            m_scratch = core::network_to_host( m_data[m_wordIndex] );
+        }
+
+        // tail bytes
+
+        int tailBytes = bytes - headBytes - numWords * 4;
+        CORE_ASSERT( tailBytes >= 0 && tailBytes < 4 );
+        if ( tailBytes > 0 )
+        {
+            CORE_ASSERT( m_bitIndex == 0 );
+            CORE_ASSERT( m_wordIndex > m_reorderedWordIndex );
+            reorder_partial_word( buffer + m_wordIndex * 4 );
+            m_reorderedWordIndex = m_wordIndex;
+        }
+        for ( int i = 0; i < tailBytes; ++i )
+            ReadBitsUnchecked( 8 );
+
+        CORE_ASSERT( GetAlignBits() == 0 );
+
+        return data;
+    }
 }
@@ -37,6 +37,10 @@ namespace protocol
 
         void WriteBits( uint32_t value, int bits );
 
+        void WriteBits64( uint64_t value, int bits );
+
+        void WriteBitsArray( const uint32_t * values, int count, int bits );
+
         void WriteAlign();
 
         void WriteBytes( const uint8_t * data, int bytes );
@@ -80,6 +84,8 @@ namespace protocol
 
     private:
 
+        void WriteBitsUnchecked( uint32_t value, int bits );
+
         uint32_t * m_data;
         uint64_t m_scratch;
         int m_numBits;
@@ -98,10 +104,16 @@ namespace protocol
 
         uint32_t ReadBits( int bits );
 
+        uint64_t ReadBits64( int bits );
+
+        void ReadBitsArray( uint32_t * values, int count, int bits );
+
         void ReadAlign();
 
         void ReadBytes( uint8_t * data, int bytes );
 
+        uint8_t * ReadBytesInPlace( int bytes );      // returns a pointer to the bytes inside the buffer, or nullptr on overflow. IMPORTANT: rewrites the buffer, so it must be writable and is not readable again.
+
         int GetAlignBits() const
         {
             return ( 8 - m_bitsRead % 8 ) % 8;
@@ -139,6 +151,8 @@ namespace protocol
 
     private:
 
+        uint32_t ReadBitsUnchecked( int bits );
+
         const uint32_t * m_data;
         uint64_t m_scratch;
         int m_numBits;
@@ -146,6 +160,7 @@ namespace protocol
         int m_bitsRead;
         int m_bitIndex;
         int m_wordIndex;
+        int m_reorderedWordIndex;                   // last word put in memory order by ReadBytesInPlace, or -1
         bool m_overflow;
     };
 }
@@ -27,12 +27,27 @@
 
 namespace protocol
 {
+    core::Allocator & ChannelData::GetAllocator() const
+    {
+        return m_allocator ? *m_allocator : core::memory::scratch_allocator();
+    }
+
+    core::Allocator & Channel::GetDataAllocator() const
+    {
+        return m_dataAllocator ? *m_dataAllocator : core::memory::scratch_allocator();
+    }
+
     ChannelStructure::ChannelStructure( core::Allocator & channelAllocator, core::Allocator & channelDataAllocator, int numChannels )
     {
         CORE_ASSERT( numChannels > 0 );
         m_numChannels = numChannels;
         m_channelAllocator = &channelAllocator;
         m_channelDataAllocator = &channelDataAllocator;
+        for ( int i = 0; i < MaxChannels; ++i )
+        {
+            m_channelPriority[i] = 0;
+            m_channelWeight[i] = 1.0f;
+        }
     }
 
     ChannelStructure::~ChannelStructure()
@@ -56,14 +71,20 @@ namespace protocol
     {
         CORE_ASSERT( channelIndex >= 0 );
         CORE_ASSERT( channelIndex < m_numChannels );
-        return CreateChannelInternal( channelIndex );
+        Channel * channel = CreateChannelInternal( channelIndex );
+        if ( channel )
+            channel->SetDataAllocator( *m_channelDataAllocator );
+        return channel;
     }
 
     ChannelData * ChannelStructure::CreateChannelData( int channelIndex )
     {
         CORE_ASSERT( channelIndex >= 0 );
         CORE_ASSERT( channelIndex < m_numChannels );
-        return CreateChannelDataInternal( channelIndex );
+        ChannelData * channelData = CreateChannelDataInternal( channelIndex );
+        if ( channelData )
+            channelData->SetAllocator( *m_channelDataAllocator );
+        return channelData;
     }
 
     void ChannelStructure::DestroyChannel( Channel * channel )
@@ -89,4 +110,33 @@ namespace protocol
     { 
         return *m_channelDataAllocator;
     }
+
+    void ChannelStructure::SetChannelPriority( int channelIndex, int priority )
+    {
+        CORE_ASSERT( channelIndex >= 0 );
+        CORE_ASSERT( channelIndex < m_numChannels );
+        m_channelPriority[channelIndex] = priority;
+    }
+
+    int ChannelStructure::GetChannelPriority( int channelIndex ) const
+    {
+        CORE_ASSERT( channelIndex >= 0 );
+        CORE_ASSERT( channelIndex < m_numChannels );
+        return m_channelPriority[channelIndex];
+    }
+
+    void ChannelStructure::SetChannelWeight( int channelIndex, float weight )
+    {
+        CORE_ASSERT( channelIndex >= 0 );
+        CORE_ASSERT( channelIndex < m_numChannels );
+        CORE_ASSERT( weight >= 0.0f );
+        m_channelWeight[channelIndex] = weight;
+    }
+
+    float ChannelStructure::GetChannelWeight( int channelIndex ) const
+    {
+        CORE_ASSERT( channelIndex >= 0 );
+        CORE_ASSERT( channelIndex < m_numChannels );
+        return m_channelWeight[channelIndex];
+    }
 }
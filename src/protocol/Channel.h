@@ -27,6 +27,7 @@
 
 #include "core/Core.h"
 #include "protocol/Object.h"
+#include "protocol/ProtocolConstants.h"
 
 namespace core { class Allocator; }
 
@@ -34,7 +35,20 @@ namespace protocol
 {
     class ChannelData : public Object
     {
-        // ...
+    public:
+
+        ChannelData() : m_allocator( NULL ) {}
+
+        void SetAllocator( core::Allocator & allocator )
+        {
+            m_allocator = &allocator;
+        }
+
+        core::Allocator & GetAllocator() const;             // allocator this data was created with. it also owns anything the data allocates. defaults to the scratch allocator.
+
+    private:
+
+        core::Allocator * m_allocator;
     };
 
     class Channel
@@ -44,6 +58,8 @@ namespace protocol
         Channel()
         {
             m_context = NULL;
+            m_dataAllocator = NULL;
+            m_rto = 0.0f;
         }
 
         virtual ~Channel() {}
@@ -52,7 +68,9 @@ namespace protocol
 
         virtual int GetError() const = 0;
 
-        virtual ChannelData * GetData( uint16_t sequence ) = 0;
+        virtual bool HasDataToSend() const { return true; }                             // channels without pending data don't reserve packet space
+
+        virtual ChannelData * GetData( uint16_t sequence, int availableBits ) = 0;       // available bits is the budget the connection scheduler gives this channel for the packet
 
         virtual bool ProcessData( uint16_t sequence, ChannelData * data ) = 0;
 
@@ -65,13 +83,29 @@ namespace protocol
             m_context = context;
         }
 
+        void SetDataAllocator( core::Allocator & allocator )
+        {
+            m_dataAllocator = &allocator;
+        }
+
+        void SetRTO( float rto )
+        {
+            m_rto = rto;
+        }
+
     protected:
 
         const void ** GetContext() const { return m_context; }
 
+        float GetRTO() const { return m_rto; }              // retransmission timeout in seconds estimated by the connection from acks. zero until the first round trip is measured.
+
+        core::Allocator & GetDataAllocator() const;         // allocator for channel data returned from GetData. set from the channel structure.
+
     private:
 
         const void ** m_context;
+        core::Allocator * m_dataAllocator;
+        float m_rto;
     };
 
     /*  
@@ -88,7 +122,9 @@ namespace protocol
 
         int GetError() const { return 0; }
 
-        ChannelData * GetData( uint16_t /*sequence*/ ) { return NULL; }
+        bool HasDataToSend() const { return false; }
+
+        ChannelData * GetData( uint16_t /*sequence*/, int /*availableBits*/ ) { return NULL; }
 
         bool ProcessData( uint16_t /*sequence*/, ChannelData * /*data*/ ) { return true; }
 
@@ -106,6 +142,12 @@ namespace protocol
         channel structure cannot change once a channel is using it.
 
         See ClientServerPackets.h or TestConnection.cpp for examples of use.
+
+        The channel structure also describes how the connection splits
+        each packet between channels. Channels with higher priority are
+        offered spare packet space first, while weight sets the share of
+        the packet each channel is guaranteed regardless of priority.
+        These only affect the sender, so they need not match exactly.
     */
 
     class ChannelStructure
@@ -113,6 +155,8 @@ namespace protocol
         core::Allocator * m_channelAllocator;
         core::Allocator * m_channelDataAllocator;
         int m_numChannels;
+        int m_channelPriority[MaxChannels];
+        float m_channelWeight[MaxChannels];
  
     public:
 
@@ -139,6 +183,14 @@ namespace protocol
 
         core::Allocator & GetChannelDataAllocator();
 
+        void SetChannelPriority( int channelIndex, int priority );
+
+        int GetChannelPriority( int channelIndex ) const;
+
+        void SetChannelWeight( int channelIndex, float weight );
+
+        float GetChannelWeight( int channelIndex ) const;
+
     protected:
 
         virtual const char * GetChannelNameInternal( int channelIndex ) const = 0;
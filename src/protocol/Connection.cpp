@@ -24,13 +24,22 @@
 
 #include "protocol/Connection.h"
 #include "core/Memory.h"
+#include <math.h>
 
 namespace protocol
 {
+    // smoothing factors for round trip time and variance, as per RFC 6298, and for packet loss
+
+    static const float RTTAlpha = 0.125f;
+    static const float RTTBeta = 0.25f;
+    static const float PacketLossAlpha = 0.05f;
+
     Connection::Connection( const ConnectionConfig & config ) : m_config( config )
     {
         CORE_ASSERT( config.packetFactory );
         CORE_ASSERT( config.channelStructure );
+        CORE_ASSERT( config.ackWindowSize == 32 || config.ackWindowSize == 64 || config.ackWindowSize == 128 );
+        CORE_ASSERT( config.ackWindowSize <= config.slidingWindowSize );
 
         m_error = CONNECTION_ERROR_NONE;
 
@@ -54,6 +63,43 @@ namespace protocol
             CORE_ASSERT( m_channels[i] );
         }
 
+        /*
+            Worst case connection packet header: client and server id,
+            ack window, ack bits, align, has data per-channel, sequence,
+            full ack and alignment before each channel. Whatever is left
+            over is split between channels by weight.
+        */
+
+        const int packetHeaderBits = 32 + 2 + 1 + m_config.ackWindowSize + 7 + m_numChannels + 16 + 1 + 16 + m_numChannels * 7;
+
+        m_availableBits = m_config.maxPacketSize * 8 - packetHeaderBits;
+
+        CORE_ASSERT( m_availableBits > 0 );
+
+        float totalWeight = 0.0f;
+        for ( int i = 0; i < m_numChannels; ++i )
+            totalWeight += config.channelStructure->GetChannelWeight( i );
+
+        for ( int i = 0; i < m_numChannels; ++i )
+        {
+            const float weight = config.channelStructure->GetChannelWeight( i );
+            m_channelShare[i] = totalWeight > 0.0f ? int( m_availableBits * ( weight / totalWeight ) ) : 0;
+        }
+
+        // stable insertion sort by priority so equal priority channels keep index order
+
+        for ( int i = 0; i < m_numChannels; ++i )
+        {
+            const int priority = config.channelStructure->GetChannelPriority( i );
+            int j = i;
+            while ( j > 0 && config.channelStructure->GetChannelPriority( m_channelOrder[j-1] ) < priority )
+            {
+                m_channelOrder[j] = m_channelOrder[j-1];
+                --j;
+            }
+            m_channelOrder[j] = i;
+        }
+
         Reset();
     }
 
@@ -96,6 +142,13 @@ namespace protocol
             m_channels[i]->Reset();
 
         memset( m_counters, 0, sizeof( m_counters ) );
+        memset( m_channelCarry, 0, sizeof( m_channelCarry ) );
+        memset( m_channelCounters, 0, sizeof( m_channelCounters ) );
+
+        m_rtt = 0.0f;
+        m_rttVariance = 0.0f;
+        m_packetLoss = 0.0f;
+        m_lossSequence = 0;
     }
 
     void Connection::Update( const core::TimeBase & timeBase )
@@ -105,8 +158,12 @@ namespace protocol
 
         m_timeBase = timeBase;
 
+        const float rto = GetRTO();
+
         for ( int i = 0; i < m_numChannels; ++i )
         {
+            m_channels[i]->SetRTO( rto );
+
             m_channels[i]->Update( timeBase );
 
             if ( m_channels[i]->GetError() != 0 )
@@ -143,13 +200,68 @@ namespace protocol
 
         packet->sequence = m_sentPackets->GetSequence();
 
-        GenerateAckBits( *m_receivedPackets, packet->ack, packet->ack_bits );
+        packet->num_ack_words = m_config.ackWindowSize / 32;
+
+        GenerateAckBits( *m_receivedPackets, packet->ack, packet->ack_bits, packet->num_ack_words );
+
+        /*
+            Split the packet between channels. Each channel with data to
+            send is guaranteed its weighted share plus whatever share it
+            could not use last packet. Channels are visited highest priority
+            first and may take any space not reserved for the channels after
+            them, so spare bits go to high priority channels, not to waste.
+        */
 
+        int credit[MaxChannels];
+        int reservedBits = 0;
         for ( int i = 0; i < m_numChannels; ++i )
-            packet->channelData[i] = m_channels[i]->GetData( packet->sequence );
+        {
+            if ( m_channels[i]->HasDataToSend() )
+                credit[i] = m_channelShare[i] + m_channelCarry[i];
+            else
+                credit[i] = m_channelCarry[i] = 0;
+            reservedBits += credit[i];
+        }
+
+        int remainingBits = m_availableBits;
+
+        for ( int j = 0; j < m_numChannels; ++j )
+        {
+            const int i = m_channelOrder[j];
+
+            reservedBits -= credit[i];
+
+            const int channelBits = core::max( core::min( credit[i], remainingBits ), remainingBits - reservedBits );
+
+            m_channelCounters[i][CONNECTION_CHANNEL_COUNTER_BITS_BUDGETED] += channelBits;
+
+            ChannelData * channelData = channelBits > 0 ? m_channels[i]->GetData( packet->sequence, channelBits ) : nullptr;
+
+            packet->channelData[i] = channelData;
+
+            int usedBits = 0;
+
+            if ( channelData )
+            {
+                MeasureStream stream( m_config.maxPacketSize );
+                stream.SetContext( m_config.context );
+                channelData->SerializeMeasure( stream );
+                usedBits = stream.GetBitsProcessed();
+
+                remainingBits = core::max( remainingBits - usedBits, 0 );
+
+                m_channelCounters[i][CONNECTION_CHANNEL_COUNTER_PACKETS_WRITTEN]++;
+                m_channelCounters[i][CONNECTION_CHANNEL_COUNTER_BITS_WRITTEN] += usedBits;
+            }
+
+            // carry unused credit into the next packet so a channel with data larger than its share still gets to send it
+
+            m_channelCarry[i] = core::clamp( credit[i] - usedBits, 0, m_availableBits - m_channelShare[i] );
+        }
 
         SentPacketData * entry = m_sentPackets->Insert( packet->sequence );
         CORE_ASSERT( entry );
+        entry->timeSent = m_timeBase.time;
         entry->acked = 0;
 
         m_counters[CONNECTION_COUNTER_PACKETS_WRITTEN]++;
@@ -167,7 +279,7 @@ namespace protocol
 
 //            printf( "read packet %d\n", (int) packet->sequence );
 
-        ProcessAcks( packet->ack, packet->ack_bits );
+        ProcessAcks( packet->ack, packet->ack_bits, packet->num_ack_words );
 
         m_counters[CONNECTION_COUNTER_PACKETS_READ]++;
 
@@ -200,24 +312,122 @@ namespace protocol
         return m_counters[index];
     }
 
-    void Connection::ProcessAcks( uint16_t ack, uint32_t ack_bits )
+    uint64_t Connection::GetChannelCounter( int channelIndex, int index ) const
     {
-//            printf( "process acks: %d - %x\n", (int)ack, ack_bits );
+        CORE_ASSERT( channelIndex >= 0 );
+        CORE_ASSERT( channelIndex < m_numChannels );
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < CONNECTION_CHANNEL_COUNTER_NUM_COUNTERS );
+        return m_channelCounters[channelIndex][index];
+    }
 
-        for ( int i = 0; i < 32; ++i )
+    float Connection::GetRTT() const
+    {
+        return m_rtt;
+    }
+
+    float Connection::GetRTTVariance() const
+    {
+        return m_rttVariance;
+    }
+
+    float Connection::GetRTO() const
+    {
+        return m_rtt > 0.0f ? m_rtt + 4.0f * m_rttVariance : 0.0f;
+    }
+
+    float Connection::GetPacketLoss() const
+    {
+        return m_packetLoss;
+    }
+
+    void Connection::ProcessAcks( uint16_t ack, const uint32_t * ack_bits, int num_ack_words )
+    {
+//            printf( "process acks: %d - %x\n", (int)ack, ack_bits[0] );
+
+        CORE_ASSERT( num_ack_words > 0 );
+        CORE_ASSERT( num_ack_words <= MaxAckWords );
+
+        // the peer may use a wider ack window than ours, so acks older than our sliding window are not found and ignored
+
+        for ( int word = 0; word < num_ack_words; ++word )
         {
-            if ( ack_bits & 1 )
-            {                    
+            uint32_t bits = ack_bits[word];
+            for ( int i = word * 32; bits; ++i, bits >>= 1 )
+            {
+                if ( !( bits & 1 ) )
+                    continue;
                 const uint16_t sequence = ack - i;
                 SentPacketData * packetData = m_sentPackets->Find( sequence );
                 if ( packetData && !packetData->acked )
                 {
+                    // only the most recent ack is timed. older packets acked here were acked late because earlier acks were lost
+
+                    if ( i == 0 )
+                        UpdateRTT( float( m_timeBase.time - packetData->timeSent ) );
+
                     PacketAcked( sequence );
                     packetData->acked = 1;
                 }
             }
-            ack_bits >>= 1;
         }
+
+        UpdatePacketLoss( ack, num_ack_words * 32 );
+    }
+
+    void Connection::UpdateRTT( float sample )
+    {
+        if ( sample < 0.0f )
+            return;
+
+        if ( m_rtt == 0.0f )
+        {
+            m_rtt = sample;
+            m_rttVariance = sample / 2;
+        }
+        else
+        {
+            m_rttVariance += RTTBeta * ( fabs( m_rtt - sample ) - m_rttVariance );
+            m_rtt += RTTAlpha * ( sample - m_rtt );
+        }
+
+        // keep the estimate non-zero so zero always means "not measured yet"
+
+        if ( m_rtt < 0.000001f )
+            m_rtt = 0.000001f;
+
+        m_counters[CONNECTION_COUNTER_RTT_MICROSECONDS] = uint64_t( m_rtt * 1000000.0f );
+        m_counters[CONNECTION_COUNTER_RTT_VARIANCE_MICROSECONDS] = uint64_t( m_rttVariance * 1000000.0f );
+    }
+
+    void Connection::UpdatePacketLoss( uint16_t ack, int ackWindowSize )
+    {
+        // a sent packet older than the oldest packet this ack covers can no longer be acked, so it is lost if it wasn't acked already
+
+        const uint16_t oldestAckable = ack - ackWindowSize + 1;
+
+        if ( !core::sequence_less_than( m_lossSequence, oldestAckable ) )
+            return;
+
+        const int slidingWindowSize = m_sentPackets->GetSize();
+
+        if ( uint16_t( oldestAckable - m_lossSequence ) > slidingWindowSize )
+            m_lossSequence = oldestAckable - slidingWindowSize;
+
+        while ( m_lossSequence != oldestAckable )
+        {
+            const SentPacketData * packetData = m_sentPackets->Find( m_lossSequence );
+            if ( packetData )
+            {
+                const float lost = packetData->acked ? 0.0f : 1.0f;
+                if ( lost > 0.0f )
+                    m_counters[CONNECTION_COUNTER_PACKETS_LOST]++;
+                m_packetLoss += PacketLossAlpha * ( lost - m_packetLoss );
+            }
+            m_lossSequence++;
+        }
+
+        m_counters[CONNECTION_COUNTER_PACKET_LOSS_PPM] = uint64_t( m_packetLoss * 1000000.0f );
     }
 
     void Connection::PacketAcked( uint16_t sequence )
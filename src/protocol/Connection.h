@@ -40,8 +40,9 @@ namespace protocol
     {
         core::Allocator * allocator;
         int packetType;
-        int maxPacketSize;
+        int maxPacketSize;                                          // maximum connection packet size in bytes. split between channels by the scheduler.
         int slidingWindowSize;
+        int ackWindowSize;                                          // number of received packets acked in each packet sent: 32, 64 or 128. wider windows survive longer bursts of loss.
         PacketFactory * packetFactory;
         ChannelStructure * channelStructure;
         const void ** context;
@@ -52,13 +53,14 @@ namespace protocol
             packetType = protocol::CONNECTION_PACKET;
             maxPacketSize = 1024;
             slidingWindowSize = 256;
+            ackWindowSize = 32;
             packetFactory = NULL;
             channelStructure = NULL;
             context = NULL;
         }
     };
 
-    struct SentPacketData { uint8_t acked; };
+    struct SentPacketData { double timeSent; uint8_t acked; };
     struct ReceivedPacketData {};
     typedef SequenceBuffer<SentPacketData> SentPackets;
     typedef SequenceBuffer<ReceivedPacketData> ReceivedPackets;
@@ -78,6 +80,17 @@ namespace protocol
         Channel * m_channels[MaxChannels];                          // array of channels created according to channel structure
         uint64_t m_counters[CONNECTION_COUNTER_NUM_COUNTERS];       // counters for unit testing, stats etc.
 
+        int m_availableBits;                                        // bits per-packet available for channel data, after worst case packet header
+        int m_channelOrder[MaxChannels];                            // channel indices sorted by priority, highest first
+        int m_channelShare[MaxChannels];                            // bits per-packet guaranteed to each channel according to its weight
+        int m_channelCarry[MaxChannels];                            // unused credit carried over from previous packets, capped at one packet
+        uint64_t m_channelCounters[MaxChannels][CONNECTION_CHANNEL_COUNTER_NUM_COUNTERS];  // per-channel bandwidth counters
+
+        float m_rtt;                                                // smoothed round trip time in seconds. zero until the first ack.
+        float m_rttVariance;                                        // round trip time variance in seconds, eg. jitter
+        float m_packetLoss;                                         // smoothed fraction of sent packets not acked, 0..1
+        uint16_t m_lossSequence;                                    // next sent packet to check for loss, once acks have moved past its ack window
+
     public:
 
         Connection( const ConnectionConfig & config );
@@ -102,9 +115,25 @@ namespace protocol
 
         uint64_t GetCounter( int index ) const;
 
-        void ProcessAcks( uint16_t ack, uint32_t ack_bits );
+        uint64_t GetChannelCounter( int channelIndex, int index ) const;
+
+        float GetRTT() const;
+
+        float GetRTTVariance() const;
+
+        float GetRTO() const;
+
+        float GetPacketLoss() const;
+
+        void ProcessAcks( uint16_t ack, const uint32_t * ack_bits, int num_ack_words );
 
         void PacketAcked( uint16_t sequence );
+
+    private:
+
+        void UpdateRTT( float sample );
+
+        void UpdatePacketLoss( uint16_t ack, int ackWindowSize );
     };
 }
 
@@ -41,7 +41,8 @@ namespace protocol
         uint16_t serverId;
         uint16_t sequence;
         uint16_t ack;
-        uint32_t ack_bits;
+        int num_ack_words;
+        uint32_t ack_bits[MaxAckWords];
         ChannelData * channelData[MaxChannels];
 
         ConnectionPacket() : Packet( CONNECTION_PACKET )
@@ -50,7 +51,8 @@ namespace protocol
             serverId = 0;
             sequence = 0;
             ack = 0;
-            ack_bits = 0;
+            num_ack_words = 1;
+            memset( ack_bits, 0, sizeof( ack_bits ) );
             memset( channelData, 0, sizeof( ChannelData* ) * MaxChannels );
         }
 
@@ -62,7 +64,8 @@ namespace protocol
             {
                 if ( channelData[i] )
                 {
-                    CORE_DELETE( core::memory::scratch_allocator(), ChannelData, channelData[i] );
+                    core::Allocator & allocator = channelData[i]->GetAllocator();
+                    CORE_DELETE( allocator, ChannelData, channelData[i] );
                     channelData[i] = nullptr;
                 }
             }
@@ -106,16 +109,36 @@ namespace protocol
             // IMPORTANT: Insert non-frequently changing values here
             // This helps LZ dictionary based compressors do a good job!
 
-            bool perfect;
+            // ack window is 32, 64 or 128 packets
+
+            int ack_words_log2;
             if ( Stream::IsWriting )
-                 perfect = ack_bits == 0xFFFFFFFF;
+            {
+                CORE_ASSERT( num_ack_words == 1 || num_ack_words == 2 || num_ack_words == 4 );
+                ack_words_log2 = num_ack_words >> 1;        // 1, 2, 4 -> 0, 1, 2
+            }
+
+            serialize_int( stream, ack_words_log2, 0, 2 );
+
+            if ( Stream::IsReading )
+                num_ack_words = 1 << ack_words_log2;
+
+            bool perfect = true;
+            if ( Stream::IsWriting )
+            {
+                for ( int i = 0; i < num_ack_words; ++i )
+                    perfect = perfect && ack_bits[i] == 0xFFFFFFFF;
+            }
 
             serialize_bool( stream, perfect );
 
-            if ( !perfect )
-                serialize_bits( stream, ack_bits, 32 );
-            else
-                ack_bits = 0xFFFFFFFF;
+            for ( int i = 0; i < num_ack_words; ++i )
+            {
+                if ( !perfect )
+                    serialize_bits( stream, ack_bits[i], 32 );
+                else
+                    ack_bits[i] = 0xFFFFFFFF;
+            }
 
             stream.Align();
 
@@ -188,7 +211,8 @@ namespace protocol
         {
             return sequence == other.sequence &&
                         ack == other.ack &&
-                   ack_bits == other.ack_bits;
+              num_ack_words == other.num_ack_words &&
+                   memcmp( ack_bits, other.ack_bits, num_ack_words * sizeof( uint32_t ) ) == 0;
         }
 
         bool operator !=( const ConnectionPacket & other ) const
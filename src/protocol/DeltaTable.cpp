@@ -0,0 +1,292 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "protocol/DeltaTable.h"
+#include "core/Memory.h"
+#include <math.h>
+#include <float.h>
+
+namespace protocol
+{
+    static void build_prefix_codes( const double * weights, DeltaBucketTable & table )
+    {
+        const int n = table.numBuckets;
+
+        if ( n == 1 )
+        {
+            table.buckets[0].code = 0;
+            table.buckets[0].codeLength = 0;
+            return;
+        }
+
+        // huffman code lengths. with at most 16 buckets no code is longer than 15 bits
+
+        double nodeWeight[MaxDeltaBuckets*2];
+        int parent[MaxDeltaBuckets*2];
+        bool merged[MaxDeltaBuckets*2];
+
+        for ( int i = 0; i < n; ++i )
+        {
+            nodeWeight[i] = weights[i];
+            parent[i] = -1;
+            merged[i] = false;
+        }
+
+        int numNodes = n;
+
+        for ( int step = 0; step < n - 1; ++step )
+        {
+            int a = -1;
+            int b = -1;
+            for ( int i = 0; i < numNodes; ++i )
+            {
+                if ( merged[i] )
+                    continue;
+                if ( a < 0 || nodeWeight[i] < nodeWeight[a] )
+                {
+                    b = a;
+                    a = i;
+                }
+                else if ( b < 0 || nodeWeight[i] < nodeWeight[b] )
+                {
+                    b = i;
+                }
+            }
+
+            CORE_ASSERT( a >= 0 && b >= 0 );
+
+            nodeWeight[numNodes] = nodeWeight[a] + nodeWeight[b];
+            parent[numNodes] = -1;
+            merged[numNodes] = false;
+            parent[a] = numNodes;
+            parent[b] = numNodes;
+            merged[a] = true;
+            merged[b] = true;
+            numNodes++;
+        }
+
+        for ( int i = 0; i < n; ++i )
+        {
+            int length = 0;
+            for ( int node = i; parent[node] >= 0; node = parent[node] )
+                length++;
+            CORE_ASSERT( length <= MaxDeltaCodeLength );
+            table.buckets[i].codeLength = length;
+        }
+
+        // canonical codes: shorter codes first, ties in bucket order
+
+        uint32_t code = 0;
+        int previousLength = 0;
+        for ( int length = 1; length <= MaxDeltaCodeLength; ++length )
+        {
+            for ( int i = 0; i < n; ++i )
+            {
+                if ( table.buckets[i].codeLength != length )
+                    continue;
+                code <<= length - previousLength;
+                previousLength = length;
+                table.buckets[i].code = code++;
+            }
+        }
+    }
+
+    float BuildDeltaBucketTable( const uint64_t * histogram, int entries, int maxBuckets, DeltaBucketTable & table )
+    {
+        CORE_ASSERT( histogram );
+        CORE_ASSERT( entries > 0 );
+        CORE_ASSERT( maxBuckets > 0 );
+        CORE_ASSERT( maxBuckets <= MaxDeltaBuckets );
+
+        core::Allocator & allocator = core::memory::default_allocator();
+
+        // every delta counts at least a little, so deltas never seen while capturing don't get huge codes
+
+        double * sum = (double*) allocator.Allocate( sizeof( double ) * ( entries + 1 ), alignof( double ) );
+        sum[0] = 0.0;
+        for ( int i = 0; i < entries; ++i )
+            sum[i+1] = sum[i] + histogram[i] + 0.5;
+        const double total = sum[entries];
+
+        // dynamic programming over bucket boundaries. the cost of a bucket is its share of deltas
+        // times its bits plus its ideal code length, which the huffman codes get close to
+
+        int maxBits = 0;
+        while ( ( 1 << maxBits ) < entries )
+            maxBits++;
+
+        const int stride = entries + 1;
+        double * cost = (double*) allocator.Allocate( sizeof( double ) * stride * ( maxBuckets + 1 ), alignof( double ) );
+        int * from = (int*) allocator.Allocate( sizeof( int ) * stride * ( maxBuckets + 1 ), alignof( int ) );
+        int * fromBits = (int*) allocator.Allocate( sizeof( int ) * stride * ( maxBuckets + 1 ), alignof( int ) );
+
+        for ( int i = 0; i < stride * ( maxBuckets + 1 ); ++i )
+        {
+            cost[i] = DBL_MAX;
+            from[i] = -1;
+            fromBits[i] = 0;
+        }
+
+        cost[0] = 0.0;
+
+        for ( int n = 0; n < maxBuckets; ++n )
+        {
+            for ( int position = 0; position < entries; ++position )
+            {
+                const double current = cost[n*stride+position];
+                if ( current == DBL_MAX )
+                    continue;
+
+                for ( int bits = 0; bits <= maxBits; ++bits )
+                {
+                    const int end = core::min( position + ( 1 << bits ), entries );
+                    const double p = ( sum[end] - sum[position] ) / total;
+                    const double next = current + p * ( bits - log2( p ) );
+                    const int index = (n+1)*stride + end;
+                    if ( next < cost[index] )
+                    {
+                        cost[index] = next;
+                        from[index] = position;
+                        fromBits[index] = bits;
+                    }
+                    if ( end == entries )
+                        break;
+                }
+            }
+        }
+
+        int numBuckets = 1;
+        for ( int n = 2; n <= maxBuckets; ++n )
+        {
+            if ( cost[n*stride+entries] < cost[numBuckets*stride+entries] )
+                numBuckets = n;
+        }
+
+        table.numBuckets = numBuckets;
+
+        double weights[MaxDeltaBuckets];
+
+        int position = entries;
+        for ( int n = numBuckets; n > 0; --n )
+        {
+            const int index = n*stride + position;
+            CORE_ASSERT( from[index] >= 0 );
+            DeltaBucket & bucket = table.buckets[n-1];
+            bucket.start = from[index];
+            bucket.bits = fromBits[index];
+            weights[n-1] = sum[position] - sum[bucket.start];
+            position = bucket.start;
+        }
+
+        CORE_ASSERT( position == 0 );
+
+        for ( int i = numBuckets; i < MaxDeltaBuckets; ++i )
+        {
+            table.buckets[i].start = 0;
+            table.buckets[i].bits = 0;
+            table.buckets[i].code = 0;
+            table.buckets[i].codeLength = 0;
+        }
+
+        build_prefix_codes( weights, table );
+
+        CORE_ASSERT( delta_table_valid( table ) );
+        CORE_ASSERT( delta_table_max( table ) >= entries - 1 );
+
+        allocator.Free( sum );
+        allocator.Free( cost );
+        allocator.Free( from );
+        allocator.Free( fromBits );
+
+        return GetDeltaBucketTableCost( histogram, entries, table );
+    }
+
+    float FindDeltaBounds( const uint64_t * histogram, int entries, int fallbackBits, int & smallBound, int & largeBound )
+    {
+        CORE_ASSERT( histogram );
+        CORE_ASSERT( entries > 0 );
+
+        uint64_t total = 0;
+        for ( int i = 0; i < entries; ++i )
+            total += histogram[i];
+
+        smallBound = 1;
+        largeBound = 2;
+
+        if ( total == 0 )
+            return 0.0f;
+
+        double bestCost = DBL_MAX;
+
+        for ( int small = 1; small < entries; small *= 2 )
+        {
+            for ( int large = small * 2; large < entries * 2; large *= 2 )
+            {
+                const double smallBits = 2 + log2( small );
+                const double largeBits = 2 + log2( large );
+
+                double cost = 0.0;
+                for ( int i = 0; i < entries; ++i )
+                {
+                    if ( i < small )
+                        cost += histogram[i] * smallBits;
+                    else if ( i < small + large )
+                        cost += histogram[i] * largeBits;
+                    else
+                        cost += histogram[i] * fallbackBits;
+                }
+
+                if ( cost < bestCost )
+                {
+                    bestCost = cost;
+                    smallBound = small;
+                    largeBound = large;
+                }
+            }
+        }
+
+        return float( bestCost / total );
+    }
+
+    float GetDeltaBucketTableCost( const uint64_t * histogram, int entries, const DeltaBucketTable & table )
+    {
+        CORE_ASSERT( histogram );
+        CORE_ASSERT( delta_table_valid( table ) );
+        CORE_ASSERT( delta_table_max( table ) >= entries - 1 );
+
+        uint64_t total = 0;
+        double cost = 0.0;
+        int bucket = 0;
+        for ( int i = 0; i < entries; ++i )
+        {
+            while ( i >= delta_bucket_end( table.buckets[bucket] ) )
+                bucket++;
+            const int bits = table.buckets[bucket].codeLength + table.buckets[bucket].bits + ( i > 0 ? 1 : 0 );
+            cost += double( histogram[i] ) * bits;
+            total += histogram[i];
+        }
+
+        return total ? float( cost / total ) : 0.0f;
+    }
+}
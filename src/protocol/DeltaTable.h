@@ -0,0 +1,165 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PROTOCOL_DELTA_TABLE_H
+#define PROTOCOL_DELTA_TABLE_H
+
+#include "core/Core.h"
+#include "protocol/Stream.h"
+
+namespace protocol
+{
+    const int MaxDeltaBuckets = 16;
+    const int MaxDeltaCodeLength = 16;
+
+    /*
+        Bucket tables for delta coding.
+
+        Absolute deltas are split into buckets of power of two size. A delta is
+        sent as the prefix code of its bucket, its offset in the bucket, then a
+        sign bit if it isn't zero. DeltaTool reports what a table built from DeltaDemo
+        histograms would cost, next to the serialize_offset bounds it writes out.
+    */
+
+    struct DeltaBucket
+    {
+        int32_t start;                      // smallest absolute delta in the bucket
+        int32_t bits;                       // the bucket covers [start,start+(1<<bits))
+        uint32_t code;                      // prefix code for the bucket, sent most significant bit first
+        int32_t codeLength;                 // zero only when there is one bucket
+    };
+
+    struct DeltaBucketTable
+    {
+        int32_t numBuckets;
+        DeltaBucket buckets[MaxDeltaBuckets];
+    };
+
+    constexpr int32_t delta_bucket_end( const DeltaBucket & bucket )
+    {
+        return bucket.start + ( 1 << bucket.bits );
+    }
+
+    constexpr int32_t delta_table_max( const DeltaBucketTable & table )
+    {
+        return delta_bucket_end( table.buckets[table.numBuckets-1] ) - 1;
+    }
+
+    constexpr bool delta_table_valid( const DeltaBucketTable & table, int index = 0 )
+    {
+        // buckets must be contiguous from zero. prefix codes are not checked here
+
+        return index == 0 ? ( table.numBuckets > 0 && table.numBuckets <= MaxDeltaBuckets && table.buckets[0].start == 0 && delta_table_valid( table, 1 ) ) :
+               index == table.numBuckets ? true :
+               table.buckets[index].start == delta_bucket_end( table.buckets[index-1] ) && 
+               table.buckets[index].codeLength > 0 && table.buckets[index].codeLength <= MaxDeltaCodeLength &&
+               delta_table_valid( table, index + 1 );
+    }
+
+    /*
+        Picks the buckets and prefix codes that minimize the average bits per delta
+        for a histogram of absolute deltas. Returns the average bits per delta.
+    */
+
+    float BuildDeltaBucketTable( const uint64_t * histogram, int entries, int maxBuckets, DeltaBucketTable & table );
+
+    /*
+        Picks the small and large bounds for serialize_offset style coding: one bit to
+        select small or large, then [-small,small-1] or an offset of [-large,large-1]
+        past the small bound. Deltas beyond that cost fallbackBits. Bounds are powers
+        of two. Returns the average bits per delta.
+    */
+
+    float FindDeltaBounds( const uint64_t * histogram, int entries, int fallbackBits, int & smallBound, int & largeBound );
+
+    float GetDeltaBucketTableCost( const uint64_t * histogram, int entries, const DeltaBucketTable & table );
+}
+
+template <typename Stream> void serialize_delta( Stream & stream, int & delta, const protocol::DeltaBucketTable & table )
+{
+    CORE_ASSERT( table.numBuckets > 0 );
+
+    int bucket = 0;
+    uint32_t offset = 0;
+    bool negative = false;
+
+    if ( Stream::IsWriting )
+    {
+        const int magnitude = delta >= 0 ? delta : -delta;
+        CORE_ASSERT( magnitude <= protocol::delta_table_max( table ) );
+        while ( magnitude >= protocol::delta_bucket_end( table.buckets[bucket] ) )
+            bucket++;
+        offset = magnitude - table.buckets[bucket].start;
+        negative = delta < 0;
+
+        if ( table.buckets[bucket].codeLength > 0 )
+        {
+            uint32_t code = table.buckets[bucket].code;
+            serialize_bits( stream, code, table.buckets[bucket].codeLength );
+        }
+    }
+    else if ( table.numBuckets > 1 )
+    {
+        // read the prefix code a bit at a time until it matches a bucket
+
+        uint32_t code = 0;
+        int codeLength = 0;
+        bucket = -1;
+        while ( bucket < 0 )
+        {
+            if ( codeLength == protocol::MaxDeltaCodeLength )
+            {
+                stream.Abort();
+                return;
+            }
+
+            uint32_t bit = 0;
+            serialize_bits( stream, bit, 1 );
+            code = ( code << 1 ) | bit;
+            codeLength++;
+
+            for ( int i = 0; i < table.numBuckets; ++i )
+            {
+                if ( table.buckets[i].codeLength == codeLength && table.buckets[i].code == code )
+                {
+                    bucket = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    if ( table.buckets[bucket].bits > 0 )
+        serialize_bits( stream, offset, table.buckets[bucket].bits );
+
+    const int magnitude = table.buckets[bucket].start + offset;
+
+    if ( magnitude > 0 )
+        serialize_bool( stream, negative );
+
+    if ( Stream::IsReading )
+        delta = negative ? -magnitude : magnitude;
+}
+
+#endif
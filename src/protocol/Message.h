@@ -28,6 +28,7 @@
 #include "core/Core.h"
 #include "protocol/Object.h"
 #include "protocol/Stream.h"
+#include <atomic>
 
 namespace protocol
 {
@@ -54,7 +55,7 @@ namespace protocol
     protected:
 
         void AddRef() { m_refCount++; }
-        void Release() { CORE_ASSERT( m_magic == 0x12345 ); CORE_ASSERT( m_refCount > 0 ); m_refCount--; }
+        int Release() { CORE_ASSERT( m_magic == 0x12345 ); CORE_ASSERT( m_refCount > 0 ); return --m_refCount; }     // returns the new ref count
 
         ~Message() 
         { 
@@ -75,7 +76,7 @@ namespace protocol
         #ifndef NDEBUG
         uint32_t m_magic = 0x12345;
         #endif
-        int m_refCount;
+        std::atomic<int> m_refCount;                // atomic so a message may be released on a different thread to the one that sent it
         uint32_t m_id : 16;
         uint32_t m_type : 16;       
     };
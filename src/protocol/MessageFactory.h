@@ -27,6 +27,7 @@
 
 #include "protocol/Message.h"
 #include "core/Memory.h"
+#include <atomic>
 
 namespace protocol
 {
@@ -38,7 +39,7 @@ namespace protocol
 
         core::Allocator * m_allocator;
 
-        int num_allocated_messages;
+        std::atomic<int> num_allocated_messages;        // atomic so messages may be created and released on different threads
 
         int m_numTypes;
 
@@ -72,7 +73,7 @@ namespace protocol
             if ( num_allocated_messages != 0 )
             {
                 printf( "you leaked messages!\n" );
-                printf( "%d messages leaked\n", num_allocated_messages );
+                printf( "%d messages leaked\n", num_allocated_messages.load() );
                 exit(1);
             }
             CORE_ASSERT( num_allocated_messages == 0 );
@@ -120,9 +121,7 @@ namespace protocol
 
             CORE_ASSERT( message );
             
-            message->Release();
-            
-            if ( message->GetRefCount() == 0 )
+            if ( message->Release() == 0 )
             {
                 #if PROTOCOL_DEBUG_MEMORY_LEAKS
                 printf( "destroy message %p\n", message );
@@ -0,0 +1,86 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "protocol/PacketBuffer.h"
+#include <new>
+
+namespace protocol
+{
+    // packet data starts on a 16 byte boundary after the header so the bit reader sees aligned words
+
+    static const uint32_t HeaderSize = ( sizeof( PacketBuffer ) + 15 ) & ~15;
+
+    PacketBuffer * PacketBuffer::Create( core::Allocator & allocator, int size )
+    {
+        CORE_ASSERT( size > 0 );
+        uint8_t * memory = (uint8_t*) allocator.Allocate( HeaderSize + size, 16 );
+        CORE_ASSERT( memory );
+        return new ( memory ) PacketBuffer( allocator, memory + HeaderSize, size );
+    }
+
+    PacketBuffer::PacketBuffer( core::Allocator & allocator, uint8_t * data, int size )
+        : m_allocator( &allocator ), m_refCount( 1 ), m_data( data ), m_size( size )
+    {
+        // the creator holds the first reference
+    }
+
+    void PacketBuffer::AddRef()
+    {
+        m_refCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    void PacketBuffer::Release()
+    {
+        const int previous = m_refCount.fetch_sub( 1, std::memory_order_acq_rel );
+        CORE_ASSERT( previous > 0 );
+        if ( previous != 1 )
+            return;
+        core::Allocator * allocator = m_allocator;
+        this->~PacketBuffer();
+        allocator->Free( this );
+    }
+
+    void * PacketBuffer::Allocate( uint32_t /*size*/, uint32_t /*align*/ )
+    {
+        // slices are handed out by serialize_owned_bytes, never allocated
+        CORE_ASSERT( !"packet buffers do not allocate" );
+        return nullptr;
+    }
+
+    void PacketBuffer::Free( void * p )
+    {
+        CORE_ASSERT( Contains( p ) );
+        (void) p;
+        Release();
+    }
+
+    uint32_t PacketBuffer::GetAllocatedSize( void * /*p*/ )
+    {
+        return SIZE_NOT_TRACKED;
+    }
+
+    uint32_t PacketBuffer::GetTotalAllocated()
+    {
+        return SIZE_NOT_TRACKED;
+    }
+}
@@ -0,0 +1,98 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef PROTOCOL_PACKET_BUFFER_H
+#define PROTOCOL_PACKET_BUFFER_H
+
+#include "core/Core.h"
+#include "core/Allocator.h"
+#include <atomic>
+
+namespace protocol
+{
+    /*
+        Reference counted buffer holding one received datagram.
+
+        The header lives at the front of a single allocation with the packet
+        bytes following it. Packets read from the buffer may keep slices of it
+        (block data, fragments) instead of allocating and copying, each slice
+        holding a reference. The buffer is also the core::Allocator for its
+        slices, so freeing a slice the normal way, eg. Block::Destroy, releases
+        its reference. The last release frees the whole allocation.
+
+        Reference counting is atomic, so slices may be released on a different
+        thread from the one that received the packet.
+    */
+
+    class PacketBuffer : public core::Allocator
+    {
+    public:
+
+        static PacketBuffer * Create( core::Allocator & allocator, int size );
+
+        void AddRef();
+
+        void Release();
+
+        int GetRefCount() const
+        {
+            return m_refCount.load( std::memory_order_acquire );
+        }
+
+        uint8_t * GetData()
+        {
+            return m_data;
+        }
+
+        int GetSize() const
+        {
+            return m_size;
+        }
+
+        bool Contains( const void * p ) const
+        {
+            return (const uint8_t*) p >= m_data && (const uint8_t*) p <= m_data + m_size;
+        }
+
+        void * Allocate( uint32_t size, uint32_t align = DEFAULT_ALIGN );
+
+        void Free( void * p );
+
+        uint32_t GetAllocatedSize( void * p );
+
+        uint32_t GetTotalAllocated();
+
+    private:
+
+        PacketBuffer( core::Allocator & allocator, uint8_t * data, int size );
+
+        ~PacketBuffer() {}
+
+        core::Allocator * m_allocator;
+        std::atomic<int> m_refCount;
+        uint8_t * m_data;
+        int m_size;
+    };
+}
+
+#endif
@@ -27,6 +27,7 @@
 
 #include "core/Memory.h"
 #include "protocol/Packet.h"
+#include <atomic>
 
 namespace protocol
 {
@@ -36,7 +37,7 @@ namespace protocol
         std::map<void*,int> allocated_packets;
         #endif
 
-        int num_allocated_packets;
+        std::atomic<int> num_allocated_packets;         // atomic so packets may be created and destroyed on different threads
 
         core::Allocator * m_allocator;
 
@@ -69,7 +70,7 @@ namespace protocol
             if ( num_allocated_packets != 0 )
             {
                 printf( "you leaked packets!\n" );
-                printf( "%d packets leaked\n", num_allocated_packets );
+                printf( "%d packets leaked\n", num_allocated_packets.load() );
                 CORE_ASSERT( !"leaked packets" );
             }
             CORE_ASSERT( num_allocated_packets == 0 );
@@ -34,6 +34,8 @@ namespace protocol
     const int MaxChannelName = 64;
     const int MaxFragmentSize = 1024;
     const int MaxContexts = 16;
+    const int MaxAckBits = 128;
+    const int MaxAckWords = MaxAckBits / 32;
 }
 
 #endif
@@ -35,9 +35,21 @@ namespace protocol
         CONNECTION_COUNTER_PACKETS_WRITTEN,                     // number of packets written
         CONNECTION_COUNTER_PACKETS_ACKED,                       // number of packets acked
         CONNECTION_COUNTER_PACKETS_DISCARDED,                   // number of read packets that we discarded (eg. not acked)
+        CONNECTION_COUNTER_PACKETS_LOST,                        // number of sent packets that fell out of the ack window without being acked
+        CONNECTION_COUNTER_RTT_MICROSECONDS,                    // current smoothed round trip time estimate. not cumulative.
+        CONNECTION_COUNTER_RTT_VARIANCE_MICROSECONDS,           // current round trip time variance (jitter) estimate. not cumulative.
+        CONNECTION_COUNTER_PACKET_LOSS_PPM,                     // current smoothed packet loss estimate in parts per million. not cumulative.
         CONNECTION_COUNTER_NUM_COUNTERS
     };
 
+    enum ConnectionChannelCounters
+    {
+        CONNECTION_CHANNEL_COUNTER_PACKETS_WRITTEN,             // number of packets this channel wrote data into
+        CONNECTION_CHANNEL_COUNTER_BITS_WRITTEN,                // number of bits of channel data written (measured, worst case alignment)
+        CONNECTION_CHANNEL_COUNTER_BITS_BUDGETED,               // number of bits the scheduler offered this channel
+        CONNECTION_CHANNEL_COUNTER_NUM_COUNTERS
+    };
+
     enum ConnectionError
     {
         CONNECTION_ERROR_NONE = 0,
@@ -58,9 +70,23 @@ namespace protocol
         RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_RECEIVED,
         RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_LATE,
         RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_EARLY,
+        RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_RESENT,
         RELIABLE_MESSAGE_CHANNEL_COUNTER_NUM_COUNTERS
     };
 
+    enum UnreliableMessageChannelCounters
+    {
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_SENT,               // number of messages added to the send queue
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_WRITTEN,            // number of messages written to packets
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_READ,               // number of messages read from packets
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_RECEIVED,           // number of messages dequeued with ReceiveMessage
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_LATE,               // number of messages dropped because their packet arrived out of order (sequenced only)
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_SEND_QUEUE_FULL,             // number of messages dropped because the send queue was full
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_RECEIVE_QUEUE_FULL,          // number of messages dropped because the receive queue was full
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_TOO_LARGE,          // number of messages dropped because they can never fit in the packet budget
+        UNRELIABLE_MESSAGE_CHANNEL_COUNTER_NUM_COUNTERS
+    };
+
     enum DataBlockReceiverError
     {
         DATA_BLOCK_RECEIVER_ERROR_NONE = 0,
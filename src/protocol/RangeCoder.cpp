@@ -0,0 +1,367 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "protocol/RangeCoder.h"
+#include "core/Allocator.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace protocol
+{
+    static const uint32_t RangeTop = 1 << 24;
+
+    RangeEncoder::RangeEncoder( uint8_t * buffer, int bytes )
+    {
+        CORE_ASSERT( buffer );
+        CORE_ASSERT( bytes > 0 );
+        m_buffer = buffer;
+        m_low = 0;
+        m_range = 0xFFFFFFFF;
+        m_cacheSize = 1;
+        m_cache = 0;
+        m_first = true;
+        m_flushed = false;
+        m_overflow = false;
+        m_totalBytes = bytes;
+        m_bytesWritten = 0;
+    }
+
+    void RangeEncoder::Encode( uint32_t cumulative, uint32_t frequency, int totalBits )
+    {
+        CORE_ASSERT( !m_flushed );
+        CORE_ASSERT( totalBits > 0 );
+        CORE_ASSERT( totalBits <= 16 );
+        CORE_ASSERT( frequency > 0 );
+        CORE_ASSERT( cumulative + frequency <= ( 1U << totalBits ) );
+
+        const uint32_t step = m_range >> totalBits;
+
+        m_low += uint64_t( step ) * cumulative;
+        m_range = step * frequency;
+
+        while ( m_range < RangeTop )
+        {
+            m_range <<= 8;
+            ShiftLow();
+        }
+    }
+
+    void RangeEncoder::EncodeBits( uint32_t value, int bits )
+    {
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 32 );
+
+        if ( bits > 16 )
+        {
+            Encode( value >> 16, 1, bits - 16 );
+            value &= 0xFFFF;
+            bits = 16;
+        }
+
+        Encode( value & ( ( 1U << bits ) - 1 ), 1, bits );
+    }
+
+    void RangeEncoder::Flush()
+    {
+        CORE_ASSERT( !m_flushed );
+
+        for ( int i = 0; i < 5; ++i )
+            ShiftLow();
+
+        // the decoder reads zeros past the end of the buffer, so trailing zeros don't need to be sent
+
+        while ( m_bytesWritten > 0 && m_buffer[m_bytesWritten-1] == 0 )
+            m_bytesWritten--;
+
+        m_flushed = true;
+    }
+
+    void RangeEncoder::ShiftLow()
+    {
+        // bytes of 0xFF are held back until we know whether a carry propagates through them
+
+        if ( uint32_t( m_low ) < 0xFF000000 || ( m_low >> 32 ) != 0 )
+        {
+            const uint8_t carry = uint8_t( m_low >> 32 );
+            uint8_t value = m_cache;
+            do
+            {
+                WriteByte( value + carry );
+                value = 0xFF;
+            }
+            while ( --m_cacheSize != 0 );
+            m_cache = uint8_t( m_low >> 24 );
+        }
+
+        m_cacheSize++;
+        m_low = ( m_low & 0x00FFFFFF ) << 8;
+    }
+
+    void RangeEncoder::WriteByte( uint8_t value )
+    {
+        // the first byte is always zero, since a carry can't propagate past the initial range
+
+        if ( m_first )
+        {
+            CORE_ASSERT( value == 0 );
+            m_first = false;
+            return;
+        }
+
+        if ( m_bytesWritten >= m_totalBytes )
+        {
+            m_overflow = true;
+            return;
+        }
+
+        m_buffer[m_bytesWritten++] = value;
+    }
+
+    RangeDecoder::RangeDecoder( const uint8_t * buffer, int bytes )
+    {
+        CORE_ASSERT( buffer );
+        CORE_ASSERT( bytes >= 0 );
+        m_buffer = buffer;
+        m_totalBytes = bytes;
+        m_bytesRead = 0;
+        m_code = 0;
+        m_range = 0xFFFFFFFF;
+        m_step = 0;
+        for ( int i = 0; i < 4; ++i )
+            m_code = ( m_code << 8 ) | ReadByte();
+    }
+
+    uint32_t RangeDecoder::GetValue( int totalBits )
+    {
+        CORE_ASSERT( totalBits > 0 );
+        CORE_ASSERT( totalBits <= 16 );
+
+        m_step = m_range >> totalBits;
+
+        // corrupt data can put the code past the end of the range
+
+        const uint32_t value = m_code / m_step;
+        const uint32_t maxValue = ( 1U << totalBits ) - 1;
+        return value < maxValue ? value : maxValue;
+    }
+
+    void RangeDecoder::Decode( uint32_t cumulative, uint32_t frequency )
+    {
+        CORE_ASSERT( m_step > 0 );
+        CORE_ASSERT( frequency > 0 );
+
+        m_code -= m_step * cumulative;
+        m_range = m_step * frequency;
+
+        while ( m_range < RangeTop )
+        {
+            m_code = ( m_code << 8 ) | ReadByte();
+            m_range <<= 8;
+        }
+    }
+
+    uint32_t RangeDecoder::DecodeBits( int bits )
+    {
+        CORE_ASSERT( bits > 0 );
+        CORE_ASSERT( bits <= 32 );
+
+        uint32_t value = 0;
+
+        if ( bits > 16 )
+        {
+            value = GetValue( bits - 16 );
+            Decode( value, 1 );
+            value <<= 16;
+            bits = 16;
+        }
+
+        const uint32_t low = GetValue( bits );
+        Decode( low, 1 );
+
+        return value | low;
+    }
+
+    uint8_t RangeDecoder::ReadByte()
+    {
+        const uint8_t value = m_bytesRead < m_totalBytes ? m_buffer[m_bytesRead] : 0;
+        m_bytesRead++;
+        return value;
+    }
+
+    RangeModel::RangeModel( core::Allocator & allocator, int32_t min, int32_t max, const uint64_t * counts )
+    {
+        CORE_ASSERT( min < max );
+        CORE_ASSERT( int64_t( max ) - int64_t( min ) < MaxRangeModelSymbols );
+        CORE_ASSERT( counts );
+
+        m_allocator = &allocator;
+        m_min = min;
+        m_max = max;
+        m_numSymbols = max - min + 1;
+        m_cumulative = (uint32_t*) m_allocator->Allocate( sizeof( uint32_t ) * ( m_numSymbols + 1 ), alignof( uint32_t ) );
+
+        // every symbol gets a frequency of at least one. the rest is shared out in proportion to the counts
+
+        const uint32_t total = 1 << RangeModelBits;
+        const uint32_t available = total - m_numSymbols;
+
+        uint64_t sum = 0;
+        int largest = 0;
+        for ( int i = 0; i < m_numSymbols; ++i )
+        {
+            sum += counts[i];
+            if ( counts[i] > counts[largest] )
+                largest = i;
+        }
+
+        uint32_t assigned = 0;
+        for ( int i = 0; i < m_numSymbols; ++i )
+        {
+            uint32_t frequency = 1;
+            if ( sum > 0 )
+                frequency += uint32_t( (double) counts[i] * available / sum );
+            m_cumulative[i] = frequency;
+            assigned += frequency;
+        }
+
+        CORE_ASSERT( assigned <= total );
+
+        m_cumulative[largest] += total - assigned;
+
+        uint32_t cumulative = 0;
+        for ( int i = 0; i < m_numSymbols; ++i )
+        {
+            const uint32_t frequency = m_cumulative[i];
+            m_cumulative[i] = cumulative;
+            cumulative += frequency;
+        }
+        m_cumulative[m_numSymbols] = cumulative;
+
+        CORE_ASSERT( cumulative == total );
+    }
+
+    RangeModel::~RangeModel()
+    {
+        CORE_ASSERT( m_cumulative );
+        m_allocator->Free( m_cumulative );
+        m_cumulative = nullptr;
+    }
+
+    int RangeModel::FindSymbol( uint32_t value ) const
+    {
+        CORE_ASSERT( value < m_cumulative[m_numSymbols] );
+
+        int low = 0;
+        int high = m_numSymbols - 1;
+        while ( low < high )
+        {
+            const int middle = ( low + high + 1 ) / 2;
+            if ( m_cumulative[middle] <= value )
+                low = middle;
+            else
+                high = middle - 1;
+        }
+        return low;
+    }
+
+    float RangeModel::GetCost( int symbol ) const
+    {
+        return RangeModelBits - log2f( (float) GetFrequency( symbol ) );
+    }
+
+    RangeModelSet::RangeModelSet()
+    {
+        m_numModels = 0;
+        memset( m_models, 0, sizeof( m_models ) );
+    }
+
+    void RangeModelSet::Add( const RangeModel & model )
+    {
+        CORE_ASSERT( m_numModels < MaxRangeModels );
+        CORE_ASSERT( !Find( model.GetMin(), model.GetMax() ) );
+        m_models[m_numModels++] = &model;
+    }
+
+    const RangeModel * RangeModelSet::Find( int32_t min, int32_t max ) const
+    {
+        for ( int i = 0; i < m_numModels; ++i )
+        {
+            if ( m_models[i]->GetMin() == min && m_models[i]->GetMax() == max )
+                return m_models[i];
+        }
+        return nullptr;
+    }
+
+    int LoadDeltaHistogram( const char * filename, int column, uint64_t * histogram, int maxEntries )
+    {
+        CORE_ASSERT( filename );
+        CORE_ASSERT( column >= 0 );
+        CORE_ASSERT( histogram );
+        CORE_ASSERT( maxEntries > 0 );
+
+        FILE * file = fopen( filename, "r" );
+        if ( !file )
+            return -1;
+
+        int numEntries = 0;
+
+        char line[1024];
+        while ( numEntries < maxEntries && fgets( line, sizeof( line ), file ) )
+        {
+            const char * p = line;
+            for ( int i = 0; i < column && p; ++i )
+            {
+                p = strchr( p, ',' );
+                if ( p )
+                    p++;
+            }
+
+            unsigned long long value = 0;
+            if ( !p || sscanf( p, "%llu", &value ) != 1 )
+                break;
+
+            histogram[numEntries++] = value;
+        }
+
+        fclose( file );
+
+        return numEntries;
+    }
+
+    void GetSignedDeltaCounts( const uint64_t * histogram, int histogramEntries, int32_t min, int32_t max, uint64_t * counts )
+    {
+        CORE_ASSERT( histogram );
+        CORE_ASSERT( histogramEntries > 0 );
+        CORE_ASSERT( min < max );
+        CORE_ASSERT( counts );
+
+        for ( int32_t value = min; value <= max; ++value )
+        {
+            const int delta = core::min( value >= 0 ? value : -value, histogramEntries - 1 );
+            const uint64_t count = histogram[delta];
+            counts[value-min] = delta == 0 ? count : ( count + 1 ) / 2;
+        }
+    }
+}
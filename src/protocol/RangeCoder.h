@@ -0,0 +1,229 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PROTOCOL_RANGE_CODER_H
+#define PROTOCOL_RANGE_CODER_H
+
+#include "core/Core.h"
+
+namespace core { class Allocator; }
+
+namespace protocol
+{
+    const int RangeModelBits = 15;                          // model frequencies sum to 1 << RangeModelBits
+    const int MaxRangeModelSymbols = 4096;
+    const int MaxRangeModels = 32;
+
+    /*
+        Range encoder with carry propagation (as in LZMA).
+
+        Symbols are coded as a [cumulative,cumulative+frequency) interval out of
+        a total of 1 << totalBits, with totalBits at most 16. Uniform values are
+        coded the same way with a frequency of one.
+    */
+
+    class RangeEncoder
+    {
+    public:
+
+        RangeEncoder( uint8_t * buffer, int bytes );
+
+        void Encode( uint32_t cumulative, uint32_t frequency, int totalBits );
+
+        void EncodeBits( uint32_t value, int bits );
+
+        void Flush();
+
+        int GetBytesWritten() const
+        {
+            return m_bytesWritten;
+        }
+
+        int GetPendingBytes() const
+        {
+            return m_flushed ? 0 : m_cacheSize + 4;
+        }
+
+        int GetTotalBytes() const
+        {
+            return m_totalBytes;
+        }
+
+        bool IsOverflow() const
+        {
+            return m_overflow;
+        }
+
+    private:
+
+        void ShiftLow();
+
+        void WriteByte( uint8_t value );
+
+        uint8_t * m_buffer;
+        uint64_t m_low;
+        uint32_t m_range;
+        uint32_t m_cacheSize;
+        uint8_t m_cache;
+        bool m_first;
+        bool m_flushed;
+        bool m_overflow;
+        int m_totalBytes;
+        int m_bytesWritten;
+    };
+
+    class RangeDecoder
+    {
+    public:
+
+        RangeDecoder( const uint8_t * buffer, int bytes );
+
+        uint32_t GetValue( int totalBits );
+
+        void Decode( uint32_t cumulative, uint32_t frequency );
+
+        uint32_t DecodeBits( int bits );
+
+        int GetBytesRead() const
+        {
+            return m_bytesRead;
+        }
+
+        bool IsOverflow() const
+        {
+            // the encoder drops trailing zero bytes and the decoder reads ahead, so reading a little past the end is expected
+
+            return m_bytesRead > m_totalBytes + 4;
+        }
+
+    private:
+
+        uint8_t ReadByte();
+
+        const uint8_t * m_buffer;
+        uint32_t m_code;
+        uint32_t m_range;
+        uint32_t m_step;
+        int m_totalBytes;
+        int m_bytesRead;
+    };
+
+    /*
+        Static symbol model for integers in [min,max]. Built from symbol counts,
+        eg. histograms captured by DeltaDemo with DELTA_STATS. Every symbol gets
+        a non-zero frequency, so values never seen while capturing still code.
+    */
+
+    class RangeModel
+    {
+    public:
+
+        RangeModel( core::Allocator & allocator, int32_t min, int32_t max, const uint64_t * counts );
+
+        ~RangeModel();
+
+        int32_t GetMin() const
+        {
+            return m_min;
+        }
+
+        int32_t GetMax() const
+        {
+            return m_max;
+        }
+
+        int GetNumSymbols() const
+        {
+            return m_numSymbols;
+        }
+
+        uint32_t GetCumulative( int symbol ) const
+        {
+            CORE_ASSERT( symbol >= 0 );
+            CORE_ASSERT( symbol < m_numSymbols );
+            return m_cumulative[symbol];
+        }
+
+        uint32_t GetFrequency( int symbol ) const
+        {
+            CORE_ASSERT( symbol >= 0 );
+            CORE_ASSERT( symbol < m_numSymbols );
+            return m_cumulative[symbol+1] - m_cumulative[symbol];
+        }
+
+        int FindSymbol( uint32_t value ) const;
+
+        float GetCost( int symbol ) const;
+
+    private:
+
+        core::Allocator * m_allocator;
+        int32_t m_min;
+        int32_t m_max;
+        int m_numSymbols;
+        uint32_t * m_cumulative;                // m_numSymbols + 1 entries. symbol i is [m_cumulative[i],m_cumulative[i+1])
+
+        RangeModel( const RangeModel & other );
+        RangeModel & operator = ( const RangeModel & other );
+    };
+
+    /*
+        The models a range stream codes with, looked up by the min/max of each
+        serialize_int. Integers without a model are coded uniformly.
+    */
+
+    class RangeModelSet
+    {
+    public:
+
+        RangeModelSet();
+
+        void Add( const RangeModel & model );
+
+        const RangeModel * Find( int32_t min, int32_t max ) const;
+
+    private:
+
+        int m_numModels;
+        const RangeModel * m_models[MaxRangeModels];
+    };
+
+    /*
+        Reads one column of a histogram written by DumpDeltaAccumulators in DeltaDemo.cpp:
+        one line per absolute delta, comma separated counts per axis. Returns the number
+        of entries read, or -1 if the file could not be read.
+    */
+
+    int LoadDeltaHistogram( const char * filename, int column, uint64_t * histogram, int maxEntries );
+
+    /*
+        Converts a histogram of absolute deltas to counts for each value in [min,max],
+        splitting the count for a delta between its positive and negative value.
+        Deltas beyond the end of the histogram share the count of the last entry.
+    */
+
+    void GetSignedDeltaCounts( const uint64_t * histogram, int histogramEntries, int32_t min, int32_t max, uint64_t * counts );
+}
+
+#endif
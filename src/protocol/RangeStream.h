@@ -0,0 +1,313 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PROTOCOL_RANGE_STREAM_H
+#define PROTOCOL_RANGE_STREAM_H
+
+#include "protocol/Stream.h"
+#include "protocol/RangeCoder.h"
+
+/*
+    Range coded streams.
+
+    These have the same interface as WriteStream and ReadStream, so templated
+    serialize functions and objects declared with PROTOCOL_SERIALIZE_OBJECT
+    can be entropy coded without change. Integers whose min/max has a model
+    in the stream's RangeModelSet are coded with that model, everything else
+    is coded uniformly at about the same cost as with the bitpacker.
+
+    There is nothing to align to, so Align does nothing. Serialized bytes go
+    through the coder too, so they can't be read in place.
+
+    IMPORTANT: MeasureStream is not an upper bound for range streams, since a
+    value that is rare in the model can cost more than its bits_required.
+*/
+
+namespace protocol
+{
+    class RangeWriteStream
+    {
+    public:
+
+        enum { IsWriting = 1 };
+        enum { IsReading = 0 };
+
+        RangeWriteStream( uint8_t * buffer, int bytes, const RangeModelSet * models = nullptr ) 
+            : m_encoder( buffer, bytes ), m_buffer( buffer ), m_models( models ), m_context( NULL ), m_aborted( false ) {}
+
+        void SerializeInteger( int32_t value, int32_t min, int32_t max )
+        {
+            CORE_ASSERT( min < max );
+            CORE_ASSERT( value >= min );
+            CORE_ASSERT( value <= max );
+
+            const RangeModel * model = m_models ? m_models->Find( min, max ) : nullptr;
+            if ( model )
+            {
+                const int symbol = value - min;
+                m_encoder.Encode( model->GetCumulative( symbol ), model->GetFrequency( symbol ), RangeModelBits );
+            }
+            else
+            {
+                const int bits = core::bits_required( min, max );
+                m_encoder.EncodeBits( uint32_t( value - min ), bits );
+            }
+        }
+
+        void SerializeBits( uint32_t value, int bits )
+        {
+            CORE_ASSERT( bits > 0 );
+            CORE_ASSERT( bits <= 32 );
+            m_encoder.EncodeBits( value, bits );
+        }
+
+        void SerializeBitsArray( const uint32_t * values, int count, int bits )
+        {
+            CORE_ASSERT( bits > 0 );
+            CORE_ASSERT( bits <= 32 );
+            for ( int i = 0; i < count; ++i )
+                m_encoder.EncodeBits( values[i], bits );
+        }
+
+        void SerializeBytes( const uint8_t * data, int bytes )
+        {
+            for ( int i = 0; i < bytes; ++i )
+                m_encoder.EncodeBits( data[i], 8 );
+        }
+
+        void Align() {}
+
+        int GetAlignBits() const
+        {
+            return 0;
+        }
+
+        bool Check( uint32_t magic )
+        {
+            SerializeBits( magic, 32 );
+            return true;
+        }
+
+        void Flush()
+        {
+            m_encoder.Flush();
+        }
+
+        const uint8_t * GetData() const
+        {
+            return m_buffer;
+        }
+
+        int GetBytesProcessed() const
+        {
+            // before the stream is flushed, this includes the worst case for bytes not written yet
+
+            return m_encoder.GetBytesWritten() + m_encoder.GetPendingBytes();
+        }
+
+        int GetBitsProcessed() const
+        {
+            return GetBytesProcessed() * 8;
+        }
+
+        int GetBitsRemaining() const
+        {
+            return GetTotalBits() - GetBitsProcessed();
+        }
+
+        int GetTotalBits() const
+        {
+            return m_encoder.GetTotalBytes() * 8;
+        }
+
+        int GetTotalBytes() const
+        {
+            return m_encoder.GetTotalBytes();
+        }
+
+        bool IsOverflow() const
+        {
+            return m_encoder.IsOverflow();
+        }
+
+        void SetContext( const void ** context )
+        {
+            m_context = context;
+        }
+
+        const void * GetContext( int index ) const
+        {
+            CORE_ASSERT( index >= 0 );
+            CORE_ASSERT( index < protocol::MaxContexts );
+            return m_context ? m_context[index] : NULL;
+        }
+
+        void Abort()
+        {
+            m_aborted = true;
+        }
+
+        bool Aborted() const
+        {
+            return m_aborted;
+        }
+
+    private:
+
+        RangeEncoder m_encoder;
+        uint8_t * m_buffer;
+        const RangeModelSet * m_models;
+        const void ** m_context;
+        bool m_aborted;
+    };
+
+    class RangeReadStream
+    {
+    public:
+
+        enum { IsWriting = 0 };
+        enum { IsReading = 1 };
+
+        RangeReadStream( const uint8_t * buffer, int bytes, const RangeModelSet * models = nullptr ) 
+            : m_decoder( buffer, bytes ), m_models( models ), m_context( NULL ), m_aborted( false ) {}
+
+        void SerializeInteger( int32_t & value, int32_t min, int32_t max )
+        {
+            CORE_ASSERT( min < max );
+
+            const RangeModel * model = m_models ? m_models->Find( min, max ) : nullptr;
+            if ( model )
+            {
+                const int symbol = model->FindSymbol( m_decoder.GetValue( RangeModelBits ) );
+                m_decoder.Decode( model->GetCumulative( symbol ), model->GetFrequency( symbol ) );
+                value = min + symbol;
+            }
+            else
+            {
+                const int bits = core::bits_required( min, max );
+                value = (int32_t) m_decoder.DecodeBits( bits ) + min;
+            }
+        }
+
+        void SerializeBits( uint32_t & value, int bits )
+        {
+            CORE_ASSERT( bits > 0 );
+            CORE_ASSERT( bits <= 32 );
+            value = m_decoder.DecodeBits( bits );
+        }
+
+        void SerializeBitsArray( uint32_t * values, int count, int bits )
+        {
+            CORE_ASSERT( bits > 0 );
+            CORE_ASSERT( bits <= 32 );
+            for ( int i = 0; i < count; ++i )
+                values[i] = m_decoder.DecodeBits( bits );
+        }
+
+        void SerializeBytes( uint8_t * data, int bytes )
+        {
+            for ( int i = 0; i < bytes; ++i )
+                data[i] = (uint8_t) m_decoder.DecodeBits( 8 );
+        }
+
+        void Align() {}
+
+        int GetAlignBits() const
+        {
+            return 0;
+        }
+
+        bool Check( uint32_t magic )
+        {
+            uint32_t value = 0;
+            SerializeBits( value, 32 );
+            CORE_ASSERT( value == magic );
+            return value == magic;
+        }
+
+        int GetBitsProcessed() const
+        {
+            return GetBytesProcessed() * 8;
+        }
+
+        int GetBytesProcessed() const
+        {
+            return m_decoder.GetBytesRead();
+        }
+
+        bool IsOverflow() const
+        {
+            return m_decoder.IsOverflow();
+        }
+
+        void SetContext( const void ** context )
+        {
+            m_context = context;
+        }
+
+        const void * GetContext( int index ) const
+        {
+            CORE_ASSERT( index >= 0 );
+            CORE_ASSERT( index < MaxContexts );
+            return m_context ? m_context[index] : NULL;
+        }
+
+        void Abort()
+        {
+            m_aborted = true;
+        }
+
+        bool Aborted() const
+        {
+            return m_aborted;
+        }
+
+    private:
+
+        RangeDecoder m_decoder;
+        const RangeModelSet * m_models;
+        const void ** m_context;
+        bool m_aborted;
+    };
+}
+
+template <typename T> void serialize_object( protocol::RangeReadStream & stream, T & object )
+{                        
+    object.Serialize( stream );
+}
+
+template <typename T> void serialize_object( protocol::RangeWriteStream & stream, T & object )
+{                        
+    object.Serialize( stream );
+}
+
+inline void serialize_owned_bytes( protocol::RangeReadStream & stream, uint8_t * & data, int bytes, core::Allocator * & allocator )
+{
+    CORE_ASSERT( !data );
+    CORE_ASSERT( allocator );
+    data = (uint8_t*) allocator->Allocate( bytes );
+    stream.SerializeBytes( data, bytes );
+}
+
+#endif
@@ -29,21 +29,30 @@
 namespace protocol
 {
     ReliableMessageChannelData::ReliableMessageChannelData( const ReliableMessageChannelConfig & _config ) 
-        : config( _config ), numMessages(0), fragmentId(0), blockSize(0), blockId(0), largeBlock(0)
+        : config( _config ), numMessages(0), numFragments(0)
     {
         messages = NULL;
-        fragment = NULL;
+        fragments = NULL;
 //      printf( "create reliable message channel data: %p\n", this );
     }
 
     ReliableMessageChannelData::~ReliableMessageChannelData()
     {
-        core::Allocator & a = core::memory::scratch_allocator();
+        core::Allocator & a = GetAllocator();
 
-        if ( fragment )
+        if ( fragments )
         {
-            a.Free( fragment );
-            fragment = nullptr;
+            for ( int i = 0; i < numFragments; ++i )
+            {
+                if ( fragments[i].data )
+                {
+                    ( fragments[i].allocator ? *fragments[i].allocator : a ).Free( fragments[i].data );
+                    fragments[i].data = nullptr;
+                }
+            }
+
+            a.Free( fragments );
+            fragments = nullptr;
         }
 
         if ( messages )
@@ -62,43 +71,19 @@ namespace protocol
 
     template <typename Stream> void ReliableMessageChannelData::Serialize( Stream & stream )
     {
-        serialize_bits( stream, largeBlock, 1 );
+        CORE_ASSERT( config.messageFactory );
 
-        if ( config.align )
-            stream.Align();
+        if ( Stream::IsWriting )
+            CORE_ASSERT( numMessages > 0 || numFragments > 0 );
 
-        if ( largeBlock )
-        {
-            if ( Stream::IsWriting )
-            {
-                CORE_ASSERT( fragment );
-            }
-            else
-            {
-                core::Allocator & a = core::memory::scratch_allocator();
-                fragment = (uint8_t*) a.Allocate( config.blockFragmentSize );
-                CORE_ASSERT( fragment );
-            }
+        serialize_int( stream, numMessages, 0, config.maxMessagesPerPacket );
+        serialize_int( stream, numFragments, 0, config.maxFragmentsPerPacket );
 
-            serialize_bits( stream, blockId, 16 );
-            serialize_bits( stream, fragmentId, 16 );
-            serialize_bits( stream, blockSize, 32 );
-            serialize_bytes( stream, fragment, config.blockFragmentSize );
-        }
-        else
+        if ( numMessages > 0 )
         {
-            CORE_ASSERT( config.messageFactory );
-
-            if ( Stream::IsWriting )
-                CORE_ASSERT( numMessages > 0 );
-
-            serialize_int( stream, numMessages, 1, config.maxMessagesPerPacket );
-
-            CORE_ASSERT( numMessages > 0 );
-
             if ( Stream::IsReading )
             {
-                core::Allocator & a = core::memory::scratch_allocator();
+                core::Allocator & a = GetAllocator();
                 messages = (Message**) a.Allocate( numMessages * sizeof( Message* ) );
             }
 
@@ -175,6 +160,34 @@ namespace protocol
                 serialize_object( stream, *messages[i] );
             }
         }
+
+        if ( numFragments > 0 )
+        {
+            if ( Stream::IsReading )
+            {
+                core::Allocator & a = GetAllocator();
+                fragments = (BlockFragment*) a.Allocate( numFragments * sizeof( BlockFragment ) );
+                memset( fragments, 0, numFragments * sizeof( BlockFragment ) );
+                for ( int i = 0; i < numFragments; ++i )
+                    fragments[i].allocator = &a;
+            }
+
+            CORE_ASSERT( fragments );
+
+            for ( int i = 0; i < numFragments; ++i )
+            {
+                if ( config.align )
+                    stream.Align();
+
+                serialize_bits( stream, fragments[i].blockId, 16 );
+                serialize_bits( stream, fragments[i].fragmentId, 16 );
+                serialize_bits( stream, fragments[i].blockSize, 32 );
+
+                // when reading from a packet buffer the fragment is a slice of the packet, not a copy
+
+                serialize_owned_bytes( stream, fragments[i].data, config.blockFragmentSize, fragments[i].allocator );
+            }
+        }
     }
 
     void ReliableMessageChannelData::SerializeRead( ReadStream & stream )
@@ -201,6 +214,9 @@ namespace protocol
         CORE_ASSERT( config.smallBlockAllocator );
         CORE_ASSERT( config.largeBlockAllocator );
         CORE_ASSERT( config.maxSmallBlockSize <= MaxSmallBlockSize );
+        CORE_ASSERT( config.maxFragmentsPerPacket > 0 );
+        CORE_ASSERT( config.fragmentWindowSize > 0 );
+        CORE_ASSERT( config.maxConcurrentLargeBlocks > 0 );
 
         m_allocator = config.allocator ? config.allocator : &core::memory::default_allocator();
 
@@ -216,12 +232,32 @@ namespace protocol
 
         m_messageOverheadBits = MessageIdBits + MessageTypeBits + MessageAlignOverhead;
 
+        // align, block id, fragment id, block size, align then fragment data
+
+        m_fragmentBits = ( m_config.align ? 7 : 0 ) + 16 + 16 + 32 + 7 + m_config.blockFragmentSize * 8;
+
+        // message count, fragment count and worst case alignment
+
+        m_packetHeaderBits = core::bits_required( 0, m_config.maxMessagesPerPacket ) + core::bits_required( 0, m_config.maxFragmentsPerPacket ) + ( m_config.align ? 3 * 8 : 0 );
+
+        // fragments are never split across packets, so the budget must fit at least one or large blocks are never sent
+
+        CORE_ASSERT( m_packetHeaderBits + m_fragmentBits <= m_config.packetBudget * 8 );
+
         m_maxBlockFragments = (int) ceil( m_config.maxLargeBlockSize / (float)m_config.blockFragmentSize );
 
-        m_sendLargeBlock.time_fragment_last_sent = CORE_NEW_ARRAY( *m_allocator, double, m_maxBlockFragments );
-        m_sendLargeBlock.acked_fragment = CORE_NEW( *m_allocator, BitArray, *m_allocator, m_maxBlockFragments );
-        m_receiveLargeBlock.received_fragment = CORE_NEW( *m_allocator, BitArray, *m_allocator, m_maxBlockFragments );
+        m_sendLargeBlocks = CORE_NEW_ARRAY( *m_allocator, SendLargeBlockData, m_config.maxConcurrentLargeBlocks );
+        m_receiveLargeBlocks = CORE_NEW_ARRAY( *m_allocator, ReceiveLargeBlockData, m_config.maxConcurrentLargeBlocks );
+
+        for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+        {
+            m_sendLargeBlocks[i].time_fragment_last_sent = CORE_NEW_ARRAY( *m_allocator, double, m_config.fragmentWindowSize );
+            m_sendLargeBlocks[i].acked_fragment = CORE_NEW( *m_allocator, BitArray, *m_allocator, m_maxBlockFragments );
+            m_receiveLargeBlocks[i].received_fragment = CORE_NEW( *m_allocator, BitArray, *m_allocator, m_maxBlockFragments );
+        }
+
         m_sentPacketMessageIds = CORE_NEW_ARRAY( *m_allocator, uint16_t, m_config.maxMessagesPerPacket * m_config.sendQueueSize );
+        m_sentPacketFragments = CORE_NEW_ARRAY( *m_allocator, SentFragmentEntry, m_config.maxFragmentsPerPacket * m_config.sentPacketsSize );
 
         Reset();
     }
@@ -239,22 +275,29 @@ namespace protocol
         CORE_DELETE( *m_allocator, SequenceBuffer<ReceiveQueueEntry>, m_receiveQueue );
 
         CORE_ASSERT( m_sentPacketMessageIds );
-        CORE_ASSERT( m_sendLargeBlock.time_fragment_last_sent );
-        CORE_ASSERT( m_sendLargeBlock.acked_fragment );
-        CORE_ASSERT( m_receiveLargeBlock.received_fragment );
+        CORE_ASSERT( m_sentPacketFragments );
+        CORE_ASSERT( m_sendLargeBlocks );
+        CORE_ASSERT( m_receiveLargeBlocks );
+
+        for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+        {
+            CORE_DELETE_ARRAY( *m_allocator, m_sendLargeBlocks[i].time_fragment_last_sent, m_config.fragmentWindowSize );
+            CORE_DELETE( *m_allocator, BitArray, m_sendLargeBlocks[i].acked_fragment );
+            CORE_DELETE( *m_allocator, BitArray, m_receiveLargeBlocks[i].received_fragment );
+        }
 
         CORE_DELETE_ARRAY( *m_allocator, m_sentPacketMessageIds, m_config.maxMessagesPerPacket * m_config.sendQueueSize );
-        CORE_DELETE_ARRAY( *m_allocator, m_sendLargeBlock.time_fragment_last_sent, m_maxBlockFragments );
-        CORE_DELETE( *m_allocator, BitArray, m_sendLargeBlock.acked_fragment );
-        CORE_DELETE( *m_allocator, BitArray, m_receiveLargeBlock.received_fragment );
+        CORE_DELETE_ARRAY( *m_allocator, m_sentPacketFragments, m_config.maxFragmentsPerPacket * m_config.sentPacketsSize );
+        CORE_DELETE_ARRAY( *m_allocator, m_sendLargeBlocks, m_config.maxConcurrentLargeBlocks );
+        CORE_DELETE_ARRAY( *m_allocator, m_receiveLargeBlocks, m_config.maxConcurrentLargeBlocks );
 
         m_sendQueue = nullptr;
         m_sentPackets = nullptr;
         m_receiveQueue = nullptr;
         m_sentPacketMessageIds = nullptr;
-        m_sendLargeBlock.time_fragment_last_sent = nullptr;
-        m_sendLargeBlock.acked_fragment = nullptr;
-        m_receiveLargeBlock.received_fragment = nullptr;
+        m_sentPacketFragments = nullptr;
+        m_sendLargeBlocks = nullptr;
+        m_receiveLargeBlocks = nullptr;
     }
 
     void ReliableMessageChannel::Reset()
@@ -263,6 +306,7 @@ namespace protocol
         CORE_ASSERT( m_sentPackets );
         CORE_ASSERT( m_receiveQueue );
         CORE_ASSERT( m_sentPacketMessageIds );
+        CORE_ASSERT( m_sentPacketFragments );
 
         m_error = 0;
 
@@ -292,8 +336,11 @@ namespace protocol
 
         m_timeBase = core::TimeBase();
 
-        m_sendLargeBlock.Reset();
-        m_receiveLargeBlock.Reset();
+        for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+        {
+            m_sendLargeBlocks[i].Reset();
+            m_receiveLargeBlocks[i].Reset();
+        }
     }
 
     bool ReliableMessageChannel::CanSendMessage() const
@@ -339,6 +386,7 @@ namespace protocol
         entry->largeBlock = largeBlock;
         entry->measuredBits = 0;
         entry->timeLastSent = -1.0;
+        entry->resendTime = 0.0f;
 
         if ( !largeBlock )
         {
@@ -406,361 +454,314 @@ namespace protocol
 
     ChannelData * ReliableMessageChannel::CreateData()
     {
-        return CORE_NEW( core::memory::scratch_allocator(), ReliableMessageChannelData, m_config );
+        auto data = CORE_NEW( GetDataAllocator(), ReliableMessageChannelData, m_config );
+        data->SetAllocator( GetDataAllocator() );
+        return data;
     }
 
-    ChannelData * ReliableMessageChannel::GetData( uint16_t sequence )
+    bool ReliableMessageChannel::HasDataToSend() const
     {
-        SendQueueEntry * firstEntry = m_sendQueue->Find( m_oldestUnackedMessageId );
-        if ( !firstEntry )
-            return nullptr;
-
-        if ( firstEntry->largeBlock )
-        {
-            /*
-                Large block mode. Split large blocks into fragments 
-                and send these fragments until they are all acked.
-            */
-
-            CORE_ASSERT( firstEntry->message->GetType() == BlockMessageType );
-
-            BlockMessage & blockMessage = static_cast<BlockMessage&>( *firstEntry->message );
+        return m_sendQueue->Find( m_oldestUnackedMessageId ) != nullptr;
+    }
 
-            Block & block = blockMessage.GetBlock();
+    int ReliableMessageChannel::GetMessagesToSend( uint16_t * messageIds, int & availableBits )
+    {
+        /*
+            Gather messages and small blocks across the send queue. Large blocks
+            are skipped, they are sent as fragments by GetFragmentsToSend.
+        */
 
-            CORE_ASSERT( block.GetSize() > m_config.maxSmallBlockSize );
+        const float resendTime = GetResendTime();
 
-            if ( !m_sendLargeBlock.active )
-            {
-                m_sendLargeBlock.active = true;
-                m_sendLargeBlock.blockId = m_oldestUnackedMessageId;
-                m_sendLargeBlock.blockSize = block.GetSize();
-                m_sendLargeBlock.numFragments = (int) ceil( block.GetSize() / (float)m_config.blockFragmentSize );
-                m_sendLargeBlock.numAckedFragments = 0;
+        int numMessageIds = 0;
 
-//                    printf( "sending block %d in %d fragments\n", (int) firstMessageId, m_sendLargeBlock.numFragments );
+        for ( int i = 0; i < m_config.receiveQueueSize; ++i )
+        {
+            if ( availableBits < m_config.giveUpBits )
+                break;
 
-                CORE_ASSERT( m_sendLargeBlock.numFragments >= 0 );
-                CORE_ASSERT( m_sendLargeBlock.numFragments <= m_maxBlockFragments );
+            const uint16_t messageId = m_oldestUnackedMessageId + i;
 
-                m_sendLargeBlock.acked_fragment->Clear();
+            if ( messageId == m_sendMessageId )
+                break;
 
-                for ( int i = 0; i < m_maxBlockFragments; ++i )
-                    m_sendLargeBlock.time_fragment_last_sent[i] = -1.0;
-            }
+            SendQueueEntry * entry = m_sendQueue->Find( messageId );
 
-            CORE_ASSERT( m_sendLargeBlock.active );
+            if ( !entry || entry->largeBlock )
+                continue;
 
-            int fragmentId = -1;
-            for ( int i = 0; i < m_sendLargeBlock.numFragments; ++i )
+            if ( entry->timeLastSent + entry->resendTime <= m_timeBase.time && availableBits - entry->measuredBits >= 0 )
             {
-                if ( !m_sendLargeBlock.acked_fragment->GetBit(i) && 
-                      m_sendLargeBlock.time_fragment_last_sent[i] + m_config.resendRate < m_timeBase.time )
+                // back off exponentially while the same message goes unacked, but never wait less than the current resend time
+
+                if ( entry->timeLastSent >= 0.0 )
                 {
-                    fragmentId = i;
-                    m_sendLargeBlock.time_fragment_last_sent[i] = m_timeBase.time;
-                    break;
+                    m_counters[RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_RESENT]++;
+                    entry->resendTime = m_config.adaptiveResendRate ? core::min( core::max( entry->resendTime * 2, resendTime ), m_config.maxResendRate ) : resendTime;
                 }
+                else
+                    entry->resendTime = resendTime;
+
+                messageIds[numMessageIds++] = messageId;
+                entry->timeLastSent = m_timeBase.time;
+                availableBits -= entry->measuredBits;
             }
 
-            if ( fragmentId == -1 )
-                return nullptr;
+            if ( numMessageIds == m_config.maxMessagesPerPacket )
+                break;
+        }
 
-//                printf( "sending fragment %d\n", (int) fragmentId );
+        CORE_ASSERT( numMessageIds >= 0 );
+        CORE_ASSERT( numMessageIds <= m_config.maxMessagesPerPacket );
 
-            auto data = CORE_NEW( core::memory::scratch_allocator(), ReliableMessageChannelData, m_config );
-            data->largeBlock = 1;
-            data->blockSize = block.GetSize();
-            data->blockId = m_oldestUnackedMessageId;
-            data->fragmentId = fragmentId;
-            core::Allocator & a = core::memory::scratch_allocator();
-            data->fragment = (uint8_t*) a.Allocate( m_config.blockFragmentSize );
-            CORE_ASSERT( data->fragment );
-//                printf( "allocate fragment %p (send fragment)\n", data->fragment );
+        return numMessageIds;
+    }
 
-            //printf( "create fragment %p\n", data->fragment );
+    int ReliableMessageChannel::GetFragmentsToSend( SentFragmentEntry * fragments, int & availableBits )
+    {
+        // fragments can't be split, so wait for a packet with enough budget
 
-            int fragmentBytes = m_config.blockFragmentSize;
-            int fragmentRemainder = block.GetSize() % m_config.blockFragmentSize;
-            if ( fragmentRemainder && fragmentId == m_sendLargeBlock.numFragments - 1 )
-                fragmentBytes = fragmentRemainder;
+        if ( availableBits < m_fragmentBits )
+            return 0;
 
-            CORE_ASSERT( fragmentBytes >= 0 );
-            CORE_ASSERT( fragmentBytes <= m_config.blockFragmentSize );
-            uint8_t * src = &( block.GetData()[fragmentId*m_config.blockFragmentSize] );
-            uint8_t * dst = data->fragment;
-            memcpy( dst, src, fragmentBytes );
+        // start sending large blocks in message id order, up to the concurrency limit
 
-            auto sentPacketData = m_sentPackets->Insert( sequence );
-            CORE_ASSERT( sentPacketData );
-            sentPacketData->acked = 0;
-            sentPacketData->largeBlock = 1;
-            sentPacketData->blockId = m_oldestUnackedMessageId;
-            sentPacketData->fragmentId = fragmentId;
-            sentPacketData->timeSent = m_timeBase.time;
-            sentPacketData->messageIds = nullptr;
-            sentPacketData->numMessageIds = 0;
+        int numActiveBlocks = 0;
+        SendLargeBlockData ** activeBlocks = (SendLargeBlockData**) alloca( m_config.maxConcurrentLargeBlocks * sizeof( SendLargeBlockData* ) );
 
-            return data;
-        }
-        else
+        for ( int i = 0; i < m_config.receiveQueueSize; ++i )
         {
-            /*
-                Message and small block mode.
-                Iterate across send queue and include multiple messages 
-                per-packet, but stop before the next large block.
-            */
-
-            CORE_ASSERT( !m_sendLargeBlock.active );
+            if ( numActiveBlocks == m_config.maxConcurrentLargeBlocks )
+                break;
 
-            // gather messages to include in the packet
+            const uint16_t messageId = m_oldestUnackedMessageId + i;
 
-            int availableBits = m_config.packetBudget * 8;
-            if ( m_config.align )
-                availableBits -= 3 * 8;
+            if ( messageId == m_sendMessageId )
+                break;
 
-            int numMessageIds = 0;
-            uint16_t * messageIds = (uint16_t*) alloca( m_config.maxMessagesPerPacket * sizeof( uint16_t ) );
-            for ( int i = 0; i < m_config.receiveQueueSize; ++i )
-            {
-                if ( availableBits < m_config.giveUpBits )
-                    break;
-                
-                const uint16_t messageId = m_oldestUnackedMessageId + i;
+            SendQueueEntry * entry = m_sendQueue->Find( messageId );
 
-                SendQueueEntry * entry = m_sendQueue->Find( messageId );
-                
-                if ( !entry )
-                    break;
+            if ( !entry || !entry->largeBlock )
+                continue;
 
-                if ( entry->largeBlock )
-                    break;
+            SendLargeBlockData * sendBlock = FindSendLargeBlock( messageId );
 
-                if ( entry->timeLastSent + m_config.resendRate <= m_timeBase.time && availableBits - entry->measuredBits >= 0 )
+            if ( !sendBlock )
+            {
+                for ( int j = 0; j < m_config.maxConcurrentLargeBlocks; ++j )
                 {
-                    messageIds[numMessageIds++] = messageId;
-                    entry->timeLastSent = m_timeBase.time;
-                    availableBits -= entry->measuredBits;
+                    if ( !m_sendLargeBlocks[j].active )
+                    {
+                        sendBlock = &m_sendLargeBlocks[j];
+                        break;
+                    }
                 }
 
-                if ( numMessageIds == m_config.maxMessagesPerPacket )
+                if ( !sendBlock )
                     break;
-            }
 
-            CORE_ASSERT( numMessageIds >= 0 );
-            CORE_ASSERT( numMessageIds <= m_config.maxMessagesPerPacket );
+                CORE_ASSERT( entry->message->GetType() == BlockMessageType );
 
-            // if there are no messages then we don't have any data to send
+                BlockMessage & blockMessage = static_cast<BlockMessage&>( *entry->message );
 
-            if ( numMessageIds == 0 )
-                return nullptr;
+                Block & block = blockMessage.GetBlock();
 
-            // add sent packet data containing message ids included in this packet
+                CORE_ASSERT( block.GetSize() > m_config.maxSmallBlockSize );
 
-            auto sentPacketData = m_sentPackets->Insert( sequence );
-            CORE_ASSERT( sentPacketData );
-            sentPacketData->acked = 0;
-            sentPacketData->largeBlock = 0;
-            sentPacketData->blockId = 0;
-            sentPacketData->fragmentId = 0;
-            sentPacketData->timeSent = m_timeBase.time;
-            const int sentPacketIndex = m_sentPackets->GetIndex( sequence );
-            sentPacketData->messageIds = &m_sentPacketMessageIds[sentPacketIndex*m_config.maxMessagesPerPacket];
-            sentPacketData->numMessageIds = numMessageIds;
-            for ( int i = 0; i < numMessageIds; ++i )
-                sentPacketData->messageIds[i] = messageIds[i];
+                sendBlock->active = true;
+                sendBlock->blockId = messageId;
+                sendBlock->blockSize = block.GetSize();
+                sendBlock->numFragments = (int) ceil( block.GetSize() / (float)m_config.blockFragmentSize );
+                sendBlock->numAckedFragments = 0;
+                sendBlock->firstUnackedFragment = 0;
 
-            // update counter: num messages written
+//                printf( "sending block %d in %d fragments\n", (int) messageId, sendBlock->numFragments );
 
-            m_counters[RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_WRITTEN] += numMessageIds;
+                CORE_ASSERT( sendBlock->numFragments >= 0 );
+                CORE_ASSERT( sendBlock->numFragments <= m_maxBlockFragments );
 
-            // construct channel data for packet
+                sendBlock->acked_fragment->Clear();
 
-            core::Allocator & allocator = core::memory::scratch_allocator();
+                for ( int j = 0; j < m_config.fragmentWindowSize; ++j )
+                    sendBlock->time_fragment_last_sent[j] = -1.0;
+            }
 
-            auto data = CORE_NEW( allocator, ReliableMessageChannelData, m_config );
+            activeBlocks[numActiveBlocks++] = sendBlock;
+        }
 
-            data->messages = (Message**) allocator.Allocate( numMessageIds * sizeof( Message* ) );
-            CORE_ASSERT( data->messages );
-//                printf( "allocate messages %p (get data)\n", data->messages );
-            data->numMessages = numMessageIds;
-            for ( int i = 0; i < numMessageIds; ++i )
-            {
-                auto entry = m_sendQueue->Find( messageIds[i] );
-                CORE_ASSERT( entry );
-                CORE_ASSERT( entry->message );
-                data->messages[i] = entry->message;
-                m_config.messageFactory->AddRef( entry->message );
-            }
+        /*
+            Fill the packet with fragments from the oldest block first. Only fragments within
+            the window following the oldest unacked fragment of each block are sent, so a
+            few lost fragments can't cause the whole block to be resent while they are retried.
+        */
 
-//                printf( "sent %d messages in packet\n", data->messages.size() );
+        const float resendTime = GetResendTime();
 
-            return data;
-        }
-    }
+        int numFragments = 0;
 
-    bool ReliableMessageChannel::ProcessData( uint16_t /*sequence*/, ChannelData * channelData )
-    {
-        CORE_ASSERT( channelData );
+        for ( int i = 0; i < numActiveBlocks; ++i )
+        {
+            SendLargeBlockData * sendBlock = activeBlocks[i];
 
-//          printf( "process data %d\n", sequence );
+            const int windowEnd = core::min( sendBlock->firstUnackedFragment + m_config.fragmentWindowSize, sendBlock->numFragments );
 
-        auto data = static_cast<ReliableMessageChannelData*>( channelData );
+            for ( int fragmentId = sendBlock->firstUnackedFragment; fragmentId < windowEnd; ++fragmentId )
+            {
+                if ( numFragments == m_config.maxFragmentsPerPacket || availableBits < m_fragmentBits )
+                    return numFragments;
 
-//            printf( "process message channel data: %d\n", sequence );
+                if ( sendBlock->acked_fragment->GetBit( fragmentId ) )
+                    continue;
 
-        /*
-            IMPORTANT: If this is a large block but the message id is *older*
-            than the message id we are expecting, the sender has missed some acks
-            for packets we have actually received, due to extreme packet loss.
-            As a result the sender hasn't realized that we have fully received 
-            the large block, and they are still trying to send it to us.
+                double & timeLastSent = sendBlock->time_fragment_last_sent[fragmentId % m_config.fragmentWindowSize];
 
-            To resolve this situation, do nothing! The ack system will inform 
-            the sender that these fragments sent to us have been received, and 
-            once all fragments are acked the sender moves on to the next block
-            or message.
-        */
+                if ( timeLastSent >= 0.0 && timeLastSent + resendTime >= m_timeBase.time )
+                    continue;
 
-        if ( data->largeBlock && core::sequence_less_than( data->blockId, m_receiveQueue->GetSequence() ) )
-            return true;
+                timeLastSent = m_timeBase.time;
 
-        /*
-            If we are currently receiving a large block, discard any packets
-            that contain bitpacked messages or small blocks. It is necessary
-            to discard the packet so the sender doesn't think these messages
-            are acked, when in fact we were not able to process them 
-            (otherwise the sender may never resend them, and stall out...)
-        */
+                fragments[numFragments].blockId = sendBlock->blockId;
+                fragments[numFragments].fragmentId = fragmentId;
+                numFragments++;
 
-        if ( !data->largeBlock && m_receiveLargeBlock.active )
-        {
-//                printf( "received unexpected bitpacked message or small block while receiving large block\n" );
-            return false;
+                availableBits -= m_fragmentBits;
+            }
         }
 
-        // process the packet data according to its contents
+        return numFragments;
+    }
 
-        if ( data->largeBlock )
-        {
-            /*
-                Large block mode.
-                This packet includes a fragment for the large block currently 
-                being received. Only one large block is sent at a time.
-            */
+    ChannelData * ReliableMessageChannel::GetData( uint16_t sequence, int availableBits )
+    {
+        availableBits = core::min( availableBits, m_config.packetBudget * 8 );
 
-            if ( !m_receiveLargeBlock.active )
-            {
-                const uint16_t expectedBlockId = m_receiveQueue->GetSequence();
+        if ( !m_sendQueue->Find( m_oldestUnackedMessageId ) )
+            return nullptr;
 
-                if ( data->blockId != expectedBlockId )
-                {
-//                        printf( "unexpected large block id\n" );
-                    return false;
-                }
+        availableBits -= m_packetHeaderBits;
 
-                const int numFragments = (int) ceil( data->blockSize / (float)m_config.blockFragmentSize );
+        /*
+            Messages and small blocks go first because they are small and latency
+            sensitive. Whatever budget remains is filled with large block fragments,
+            so large block throughput scales with the packet budget, not the packet rate.
+        */
 
-                CORE_ASSERT( numFragments >= 0 );
-                CORE_ASSERT( numFragments <= m_maxBlockFragments );
+        uint16_t * messageIds = (uint16_t*) alloca( m_config.maxMessagesPerPacket * sizeof( uint16_t ) );
+        SentFragmentEntry * fragments = (SentFragmentEntry*) alloca( m_config.maxFragmentsPerPacket * sizeof( SentFragmentEntry ) );
 
-                if ( numFragments < 0 || numFragments > m_maxBlockFragments )
-                {
-                    //printf( "large block num fragments outside of range\n" );
-                    return false;
-                }
+        const int numMessageIds = GetMessagesToSend( messageIds, availableBits );
+        const int numFragments = GetFragmentsToSend( fragments, availableBits );
 
-//                    printf( "receiving large block %d (%d bytes)\n", data->blockId, data->blockSize );
+        // if there are no messages or fragments then we don't have any data to send
 
-                m_receiveLargeBlock.active = true;
-                m_receiveLargeBlock.numFragments = numFragments;
-                m_receiveLargeBlock.numReceivedFragments = 0;
-                m_receiveLargeBlock.blockId = data->blockId;
-                m_receiveLargeBlock.blockSize = data->blockSize;
+        if ( numMessageIds == 0 && numFragments == 0 )
+            return nullptr;
 
-                CORE_ASSERT( m_config.largeBlockAllocator );
-                uint8_t * blockData = (uint8_t*) m_config.largeBlockAllocator->Allocate( data->blockSize );
-                m_receiveLargeBlock.block.Connect( *m_config.largeBlockAllocator, blockData, data->blockSize );
-                
-                m_receiveLargeBlock.received_fragment->Clear();
-            }
+        // add sent packet data containing message ids and fragments included in this packet
 
-            CORE_ASSERT( m_receiveLargeBlock.active );
+        auto sentPacketData = m_sentPackets->Insert( sequence );
+        CORE_ASSERT( sentPacketData );
+        sentPacketData->acked = 0;
+        sentPacketData->timeSent = m_timeBase.time;
+        const int sentPacketIndex = m_sentPackets->GetIndex( sequence );
+        sentPacketData->messageIds = &m_sentPacketMessageIds[sentPacketIndex*m_config.maxMessagesPerPacket];
+        sentPacketData->numMessageIds = numMessageIds;
+        for ( int i = 0; i < numMessageIds; ++i )
+            sentPacketData->messageIds[i] = messageIds[i];
+        sentPacketData->fragments = &m_sentPacketFragments[sentPacketIndex*m_config.maxFragmentsPerPacket];
+        sentPacketData->numFragments = numFragments;
+        for ( int i = 0; i < numFragments; ++i )
+            sentPacketData->fragments[i] = fragments[i];
 
-            if ( data->blockId != m_receiveLargeBlock.blockId )
-            {
-//                    printf( "unexpected large block id. got %d but was expecting %d\n", data->blockId, m_receiveLargeBlock.blockId );
-                return false;
-            }
+        // update counter: num messages written
 
-            CORE_ASSERT( data->blockId == m_receiveLargeBlock.blockId );
-            CORE_ASSERT( data->blockSize == m_receiveLargeBlock.blockSize );
-            CORE_ASSERT( data->fragmentId < m_receiveLargeBlock.numFragments );
+        m_counters[RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_WRITTEN] += numMessageIds;
 
-            if ( data->blockId != m_receiveLargeBlock.blockId )
-            {
-//                    printf( "recieve large block id mismatch. got %d but was expecting %d\n", data->blockId, m_receiveLargeBlock.blockId );
-                return false;
-            }
+        // construct channel data for packet
 
-            if ( data->blockSize != m_receiveLargeBlock.blockSize )
-            {
-//                    printf( "large block size mismatch. got %d but was expecting %d\n", data->blockSize, m_receiveLargeBlock.blockSize );
-                return false;
-            }
+        core::Allocator & allocator = GetDataAllocator();
+
+        auto data = CORE_NEW( allocator, ReliableMessageChannelData, m_config );
+        data->SetAllocator( allocator );
 
-            if ( data->fragmentId >= m_receiveLargeBlock.numFragments )
+        if ( numMessageIds > 0 )
+        {
+            data->messages = (Message**) allocator.Allocate( numMessageIds * sizeof( Message* ) );
+            CORE_ASSERT( data->messages );
+//            printf( "allocate messages %p (get data)\n", data->messages );
+            data->numMessages = numMessageIds;
+            for ( int i = 0; i < numMessageIds; ++i )
             {
-//                    printf( "large block fragment out of bounds.\n" );
-                return false;
+                auto entry = m_sendQueue->Find( messageIds[i] );
+                CORE_ASSERT( entry );
+                CORE_ASSERT( entry->message );
+                data->messages[i] = entry->message;
+                m_config.messageFactory->AddRef( entry->message );
             }
+        }
 
-            if ( !m_receiveLargeBlock.received_fragment->GetBit( data->fragmentId ) )
+        if ( numFragments > 0 )
+        {
+            data->fragments = (BlockFragment*) allocator.Allocate( numFragments * sizeof( BlockFragment ) );
+            CORE_ASSERT( data->fragments );
+            data->numFragments = numFragments;
+            for ( int i = 0; i < numFragments; ++i )
             {
-/*
-                printf( "received fragment " << data->fragmentId << " of large block " << m_receiveLargeBlock.blockId
-                     << " (" << m_receiveLargeBlock.numReceivedFragments+1 << "/" << m_receiveLargeBlock.numFragments << ")" << endl;
-                     */
+                auto entry = m_sendQueue->Find( fragments[i].blockId );
+                CORE_ASSERT( entry );
+                CORE_ASSERT( entry->largeBlock );
 
-                m_receiveLargeBlock.received_fragment->SetBit( data->fragmentId );
+                Block & block = static_cast<BlockMessage*>( entry->message )->GetBlock();
 
-                Block & block = m_receiveLargeBlock.block;
+                BlockFragment & fragment = data->fragments[i];
+                fragment.blockId = fragments[i].blockId;
+                fragment.fragmentId = fragments[i].fragmentId;
+                fragment.blockSize = block.GetSize();
+                fragment.allocator = nullptr;
+                fragment.data = (uint8_t*) allocator.Allocate( m_config.blockFragmentSize );
+                CORE_ASSERT( fragment.data );
 
-                int fragmentBytes = m_config.blockFragmentSize;
-                int fragmentRemainder = block.GetSize() % m_config.blockFragmentSize;
-                if ( fragmentRemainder && data->fragmentId == m_receiveLargeBlock.numFragments - 1 )
-                    fragmentBytes = fragmentRemainder;
+                // the last fragment is padded with zeros, so no uninitialized memory goes out on the wire
 
-//                    printf( "fragment bytes = %d\n", fragmentBytes );
+                const int fragmentBytes = core::min( m_config.blockFragmentSize, block.GetSize() - fragment.fragmentId * m_config.blockFragmentSize );
 
-                CORE_ASSERT( fragmentBytes >= 0 );
+                CORE_ASSERT( fragmentBytes > 0 );
                 CORE_ASSERT( fragmentBytes <= m_config.blockFragmentSize );
-                uint8_t * src = data->fragment;
-                uint8_t * dst = &( block.GetData()[data->fragmentId*m_config.blockFragmentSize] );
-                memcpy( dst, src, fragmentBytes );
+                memcpy( fragment.data, &( block.GetData()[fragment.fragmentId*m_config.blockFragmentSize] ), fragmentBytes );
+                if ( fragmentBytes < m_config.blockFragmentSize )
+                    memset( fragment.data + fragmentBytes, 0, m_config.blockFragmentSize - fragmentBytes );
+            }
+        }
 
-                m_receiveLargeBlock.numReceivedFragments++;
+//        printf( "sent %d messages and %d fragments in packet\n", numMessageIds, numFragments );
 
-                if ( m_receiveLargeBlock.numReceivedFragments == m_receiveLargeBlock.numFragments )
-                {
-//                        printf( "received large block %d (%d bytes)\n", m_receiveLargeBlock.blockId, m_receiveLargeBlock.block->size() );
+        return data;
+    }
 
-                    auto blockMessage = (BlockMessage*) m_config.messageFactory->Create( BlockMessageType );
-                    CORE_ASSERT( blockMessage );
-                    blockMessage->Connect( m_receiveLargeBlock.block );
-                    blockMessage->SetId( m_receiveLargeBlock.blockId );
+    bool ReliableMessageChannel::ProcessData( uint16_t /*sequence*/, ChannelData * channelData )
+    {
+        CORE_ASSERT( channelData );
+
+//          printf( "process data %d\n", sequence );
 
-                    auto entry = m_receiveQueue->Insert( m_receiveLargeBlock.blockId );
-                    CORE_ASSERT( entry );
-                    entry->message = blockMessage;
+        auto data = static_cast<ReliableMessageChannelData*>( channelData );
 
-                    m_receiveLargeBlock.active = false;
+        /*
+            Packet data may contain both messages and large block fragments.
+            Everything that can be processed is, but if any of it can't be
+            then the packet is not acked, so the sender resends it. Processing
+            the same message or fragment twice is harmless.
+        */
 
-                    CORE_ASSERT( !m_receiveLargeBlock.block.IsValid() );
-                }
-            }
+        bool result = true;
+
+        for ( int i = 0; i < data->numFragments; ++i )
+        {
+            if ( !ProcessFragment( data->fragments[i] ) )
+                result = false;
         }
-        else
+
+        if ( data->numMessages > 0 )
         {
             /*
                 Bit-packed message and small block mode.
@@ -770,8 +771,6 @@ namespace protocol
                 be dequeued reliably and in-order.
             */
 
-            bool earlyMessage = false;
-
             const uint16_t minMessageId = m_receiveMessageId;
             const uint16_t maxMessageId = m_receiveMessageId + m_config.receiveQueueSize - 1;
 
@@ -794,7 +793,7 @@ namespace protocol
                 else if ( core::sequence_greater_than( messageId, maxMessageId ) )
                 {
                     m_counters[RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_EARLY]++;
-                    earlyMessage = true;
+                    result = false;
                 }
                 else if ( !m_receiveQueue->Find( messageId ) )
                 {
@@ -805,9 +804,126 @@ namespace protocol
                 
                 m_counters[RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_READ]++;
             }
+        }
 
-            if ( earlyMessage )
+        return result;
+    }
+
+    bool ReliableMessageChannel::ProcessFragment( const BlockFragment & fragment )
+    {
+        /*
+            IMPORTANT: If the block is older than the next message we expect
+            to receive, or it is already complete and waiting in the receive queue,
+            the sender has missed some acks for packets we have actually received, 
+            due to extreme packet loss. As a result the sender hasn't realized 
+            that we have fully received the large block, and they are still 
+            trying to send it to us.
+
+            To resolve this situation, do nothing! The ack system will inform 
+            the sender that these fragments sent to us have been received, and 
+            once all fragments are acked the sender stops sending the block.
+        */
+
+        if ( core::sequence_less_than( fragment.blockId, m_receiveMessageId ) || m_receiveQueue->Find( fragment.blockId ) )
+            return true;
+
+        // blocks past the end of the receive queue can't be inserted when complete, so ignore them
+
+        if ( core::sequence_greater_than( fragment.blockId, uint16_t( m_receiveMessageId + m_config.receiveQueueSize - 1 ) ) )
+        {
+//            printf( "unexpected large block id\n" );
+            return false;
+        }
+
+        ReceiveLargeBlockData * receiveBlock = FindReceiveLargeBlock( fragment.blockId );
+
+        if ( !receiveBlock )
+        {
+            const int numFragments = (int) ceil( fragment.blockSize / (float)m_config.blockFragmentSize );
+
+            if ( numFragments <= 0 || numFragments > m_maxBlockFragments )
+            {
+                //printf( "large block num fragments outside of range\n" );
                 return false;
+            }
+
+            for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+            {
+                if ( !m_receiveLargeBlocks[i].active )
+                {
+                    receiveBlock = &m_receiveLargeBlocks[i];
+                    break;
+                }
+            }
+
+            // the sender never has more blocks in flight than we have slots, but don't trust it
+
+            if ( !receiveBlock )
+                return false;
+
+//            printf( "receiving large block %d (%d bytes)\n", fragment.blockId, fragment.blockSize );
+
+            receiveBlock->active = true;
+            receiveBlock->numFragments = numFragments;
+            receiveBlock->numReceivedFragments = 0;
+            receiveBlock->blockId = fragment.blockId;
+            receiveBlock->blockSize = fragment.blockSize;
+
+            CORE_ASSERT( m_config.largeBlockAllocator );
+            uint8_t * blockData = (uint8_t*) m_config.largeBlockAllocator->Allocate( fragment.blockSize );
+            receiveBlock->block.Connect( *m_config.largeBlockAllocator, blockData, fragment.blockSize );
+            
+            receiveBlock->received_fragment->Clear();
+        }
+
+        CORE_ASSERT( receiveBlock->active );
+        CORE_ASSERT( receiveBlock->blockId == fragment.blockId );
+
+        if ( fragment.blockSize != receiveBlock->blockSize )
+        {
+//            printf( "large block size mismatch. got %d but was expecting %d\n", fragment.blockSize, receiveBlock->blockSize );
+            return false;
+        }
+
+        if ( fragment.fragmentId >= receiveBlock->numFragments )
+        {
+//            printf( "large block fragment out of bounds.\n" );
+            return false;
+        }
+
+        if ( receiveBlock->received_fragment->GetBit( fragment.fragmentId ) )
+            return true;
+
+//        printf( "received fragment %d of large block %d (%d/%d)\n", fragment.fragmentId, receiveBlock->blockId, receiveBlock->numReceivedFragments + 1, receiveBlock->numFragments );
+
+        receiveBlock->received_fragment->SetBit( fragment.fragmentId );
+
+        Block & block = receiveBlock->block;
+
+        const int fragmentBytes = core::min( m_config.blockFragmentSize, block.GetSize() - fragment.fragmentId * m_config.blockFragmentSize );
+
+        CORE_ASSERT( fragmentBytes > 0 );
+        CORE_ASSERT( fragmentBytes <= m_config.blockFragmentSize );
+        memcpy( &( block.GetData()[fragment.fragmentId*m_config.blockFragmentSize] ), fragment.data, fragmentBytes );
+
+        receiveBlock->numReceivedFragments++;
+
+        if ( receiveBlock->numReceivedFragments == receiveBlock->numFragments )
+        {
+//            printf( "received large block %d (%d bytes)\n", receiveBlock->blockId, receiveBlock->blockSize );
+
+            auto blockMessage = (BlockMessage*) m_config.messageFactory->Create( BlockMessageType );
+            CORE_ASSERT( blockMessage );
+            blockMessage->Connect( receiveBlock->block );
+            blockMessage->SetId( receiveBlock->blockId );
+
+            auto entry = m_receiveQueue->Insert( receiveBlock->blockId );
+            CORE_ASSERT( entry );
+            entry->message = blockMessage;
+
+            receiveBlock->active = false;
+
+            CORE_ASSERT( !receiveBlock->block.IsValid() );
         }
 
         return true;
@@ -840,63 +956,91 @@ namespace protocol
         if ( !sentPacket || sentPacket->acked )
             return;
 
-        if ( !sentPacket->largeBlock )
+        for ( int i = 0; i < sentPacket->numMessageIds; ++i )
         {
-            for ( int i = 0; i < sentPacket->numMessageIds; ++i )
-            {
-                const uint16_t messageId = sentPacket->messageIds[i];
+            const uint16_t messageId = sentPacket->messageIds[i];
 
-                auto sendQueueEntry = m_sendQueue->Find( messageId );
-                
-                if ( sendQueueEntry )
-                {
-                    CORE_ASSERT( sendQueueEntry->message );
-                    CORE_ASSERT( sendQueueEntry->message->GetId() == messageId );
+            auto sendQueueEntry = m_sendQueue->Find( messageId );
+            
+            if ( sendQueueEntry )
+            {
+                CORE_ASSERT( sendQueueEntry->message );
+                CORE_ASSERT( sendQueueEntry->message->GetId() == messageId );
 
-//                        printf( "acked message %d\n", messageId );
+//                printf( "acked message %d\n", messageId );
 
-                    m_config.messageFactory->Release( sendQueueEntry->message );
+                m_config.messageFactory->Release( sendQueueEntry->message );
 
-                    m_sendQueue->Remove( messageId );
-                }
+                m_sendQueue->Remove( messageId );
             }
-
-            UpdateOldestUnackedMessageId();
         }
-        else if ( m_sendLargeBlock.active && m_sendLargeBlock.blockId == sentPacket->blockId )
-        {
-            CORE_ASSERT( sentPacket->fragmentId < m_sendLargeBlock.numFragments );
 
-            if ( !m_sendLargeBlock.acked_fragment->GetBit( sentPacket->fragmentId ) )
-            {
-                /*
-                printf( "acked fragment " << sentPacket->fragmentId << " of large block " << m_sendLargeBlock.blockId 
-                     << " (" << m_sendLargeBlock.numAckedFragments+1 << "/" << m_sendLargeBlock.numFragments << ")" << endl;
-                     */
+        for ( int i = 0; i < sentPacket->numFragments; ++i )
+            ProcessFragmentAck( sentPacket->fragments[i].blockId, sentPacket->fragments[i].fragmentId );
 
-                m_sendLargeBlock.acked_fragment->SetBit( sentPacket->fragmentId );
-                
-                m_sendLargeBlock.numAckedFragments++;
+        UpdateOldestUnackedMessageId();
+        
+        sentPacket->acked = 1;
+    }
 
-                if ( m_sendLargeBlock.numAckedFragments == m_sendLargeBlock.numFragments )
-                {
-//                        printf( "acked large block %d\n", (int) m_sendLargeBlock.blockId );
+    void ReliableMessageChannel::ProcessFragmentAck( uint16_t blockId, uint16_t fragmentId )
+    {
+        SendLargeBlockData * sendBlock = FindSendLargeBlock( blockId );
+        if ( !sendBlock )
+            return;
 
-                    m_sendLargeBlock.active = false;
+        CORE_ASSERT( fragmentId < sendBlock->numFragments );
 
-                    auto sendQueueEntry = m_sendQueue->Find( sentPacket->blockId );
-                    CORE_ASSERT( sendQueueEntry );
+        if ( sendBlock->acked_fragment->GetBit( fragmentId ) )
+            return;
 
-                    m_config.messageFactory->Release( sendQueueEntry->message );                    
+//        printf( "acked fragment %d of large block %d (%d/%d)\n", fragmentId, blockId, sendBlock->numAckedFragments + 1, sendBlock->numFragments );
 
-                    m_sendQueue->Remove( sentPacket->blockId );
+        sendBlock->acked_fragment->SetBit( fragmentId );
 
-                    UpdateOldestUnackedMessageId();
-                }
-            }
+        sendBlock->numAckedFragments++;
+
+        // slide the window past acked fragments. the send time slot of each acked fragment is reused by the fragment entering the window
+
+        while ( sendBlock->firstUnackedFragment < sendBlock->numFragments && sendBlock->acked_fragment->GetBit( sendBlock->firstUnackedFragment ) )
+        {
+            sendBlock->time_fragment_last_sent[sendBlock->firstUnackedFragment % m_config.fragmentWindowSize] = -1.0;
+            sendBlock->firstUnackedFragment++;
+        }
+
+        if ( sendBlock->numAckedFragments == sendBlock->numFragments )
+        {
+//            printf( "acked large block %d\n", (int) blockId );
+
+            auto sendQueueEntry = m_sendQueue->Find( blockId );
+            CORE_ASSERT( sendQueueEntry );
+
+            m_config.messageFactory->Release( sendQueueEntry->message );
+
+            m_sendQueue->Remove( blockId );
+
+            sendBlock->Reset();
         }
-        
-        sentPacket->acked = 1;
+    }
+
+    ReliableMessageChannel::SendLargeBlockData * ReliableMessageChannel::FindSendLargeBlock( uint16_t blockId )
+    {
+        for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+        {
+            if ( m_sendLargeBlocks[i].active && m_sendLargeBlocks[i].blockId == blockId )
+                return &m_sendLargeBlocks[i];
+        }
+        return nullptr;
+    }
+
+    ReliableMessageChannel::ReceiveLargeBlockData * ReliableMessageChannel::FindReceiveLargeBlock( uint16_t blockId )
+    {
+        for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+        {
+            if ( m_receiveLargeBlocks[i].active && m_receiveLargeBlocks[i].blockId == blockId )
+                return &m_receiveLargeBlocks[i];
+        }
+        return nullptr;
     }
 
     void ReliableMessageChannel::Update( const core::TimeBase & timeBase )
@@ -911,25 +1055,61 @@ namespace protocol
         return m_counters[index];
     }
 
+    float ReliableMessageChannel::GetResendTime() const
+    {
+        const float rto = GetRTO();
+
+        if ( !m_config.adaptiveResendRate || rto <= 0.0f )
+            return m_config.resendRate;
+
+        return core::clamp( rto, m_config.minResendRate, m_config.maxResendRate );
+    }
+
     ReliableMessageChannel::SendLargeBlockStatus ReliableMessageChannel::GetSendLargeBlockStatus() const
     {
+        // with several blocks in flight, report the oldest
+
+        const SendLargeBlockData * sendBlock = nullptr;
+        for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+        {
+            if ( m_sendLargeBlocks[i].active && ( !sendBlock || core::sequence_less_than( m_sendLargeBlocks[i].blockId, sendBlock->blockId ) ) )
+                sendBlock = &m_sendLargeBlocks[i];
+        }
+
         SendLargeBlockStatus status;
-        status.sending = m_sendLargeBlock.active;
-        status.blockId = m_sendLargeBlock.blockId;
-        status.blockSize = m_sendLargeBlock.blockSize;
-        status.numFragments = m_sendLargeBlock.numFragments;
-        status.numAckedFragments = m_sendLargeBlock.numAckedFragments;
+        memset( &status, 0, sizeof( status ) );
+        if ( sendBlock )
+        {
+            status.sending = true;
+            status.blockId = sendBlock->blockId;
+            status.blockSize = sendBlock->blockSize;
+            status.numFragments = sendBlock->numFragments;
+            status.numAckedFragments = sendBlock->numAckedFragments;
+        }
         return status;
     }
 
     ReliableMessageChannel::ReceiveLargeBlockStatus ReliableMessageChannel::GetReceiveLargeBlockStatus() const
     {
+        // with several blocks in flight, report the oldest
+
+        const ReceiveLargeBlockData * receiveBlock = nullptr;
+        for ( int i = 0; i < m_config.maxConcurrentLargeBlocks; ++i )
+        {
+            if ( m_receiveLargeBlocks[i].active && ( !receiveBlock || core::sequence_less_than( m_receiveLargeBlocks[i].blockId, receiveBlock->blockId ) ) )
+                receiveBlock = &m_receiveLargeBlocks[i];
+        }
+
         ReceiveLargeBlockStatus status;
-        status.receiving = m_receiveLargeBlock.active;
-        status.blockId = m_receiveLargeBlock.blockId;
-        status.blockSize = m_receiveLargeBlock.blockSize;
-        status.numFragments = m_receiveLargeBlock.numFragments;
-        status.numReceivedFragments = m_receiveLargeBlock.numReceivedFragments;
+        memset( &status, 0, sizeof( status ) );
+        if ( receiveBlock )
+        {
+            status.receiving = true;
+            status.blockId = receiveBlock->blockId;
+            status.blockSize = receiveBlock->blockSize;
+            status.numFragments = receiveBlock->numFragments;
+            status.numReceivedFragments = receiveBlock->numReceivedFragments;
+        }
         return status;
     }
 }
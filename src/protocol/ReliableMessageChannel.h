@@ -40,6 +40,9 @@ namespace protocol
         {
             allocator = nullptr;
             resendRate = 0.1f;
+            adaptiveResendRate = true;
+            minResendRate = 0.01f;
+            maxResendRate = 0.5f;
             sendQueueSize = 1024;
             receiveQueueSize = 256;
             sentPacketsSize = 256;
@@ -48,6 +51,9 @@ namespace protocol
             maxSmallBlockSize = 64;
             maxLargeBlockSize = 256 * 1024;
             blockFragmentSize = 64;
+            maxFragmentsPerPacket = 16;
+            fragmentWindowSize = 256;
+            maxConcurrentLargeBlocks = 4;
             packetBudget = 128;
             giveUpBits = 128;
             align = true;
@@ -59,7 +65,10 @@ namespace protocol
 
         core::Allocator * allocator;    // allocator used for allocations matching life cycle of this object. if null falls back to default allocator.
 
-        float resendRate;               // message max resend rate in seconds, until acked.
+        float resendRate;               // message max resend rate in seconds, until acked. with adaptive resend, used until the connection has measured round trip time.
+        bool adaptiveResendRate;        // if true, resend after the connection's retransmission timeout (RTT + 4 * RTTVAR), doubling for each resend of the same message.
+        float minResendRate;            // adaptive resend time is clamped to [minResendRate,maxResendRate] seconds.
+        float maxResendRate;
         int sendQueueSize;              // send queue size in # of entries
         int receiveQueueSize;           // receive queue size in # of entries
         int sentPacketsSize;            // sent packets sliding window size in # of entries
@@ -68,7 +77,10 @@ namespace protocol
         int maxSmallBlockSize;          // maximum small block size allowed. messages above this size are fragmented and reassembled.
         int maxLargeBlockSize;          // maximum large block size. these blocks are split up into fragments.
         int blockFragmentSize;          // fragment size that large blocks are split up to for transmission.
-        int packetBudget;               // maximum number of bytes this channel may take per-packet. 
+        int maxFragmentsPerPacket;      // maximum number of large block fragments included in a packet, budget permitting.
+        int fragmentWindowSize;         // per-block sliding window. only fragments within this many of the oldest unacked fragment are sent.
+        int maxConcurrentLargeBlocks;   // maximum number of large blocks sent (and received) at the same time.
+        int packetBudget;               // maximum number of bytes this channel may take per-packet. the connection scheduler may offer less. must fit one block fragment.
         int giveUpBits;                 // give up trying to add more messages to packet if we have less than this # of bits available.
         bool align;                     // if true then insert align at key points, eg. before messages etc. good for dictionary based LZ compressors
 
@@ -79,6 +91,15 @@ namespace protocol
         core::Allocator * largeBlockAllocator;
     };
 
+    struct BlockFragment
+    {
+        uint8_t * data;                         // fragment data. always blockFragmentSize bytes, the last fragment in a block is padded.
+        core::Allocator * allocator;            // allocator the data is freed with. nullptr means the channel data allocator.
+        uint32_t blockSize;                     // size of the block this fragment belongs to in bytes.
+        uint16_t blockId;                       // message id of the block this fragment belongs to.
+        uint16_t fragmentId;                    // index of this fragment in the block.
+    };
+
     class ReliableMessageChannelData : public ChannelData
     {
         ReliableMessageChannelData( const ReliableMessageChannelData & other );
@@ -89,13 +110,10 @@ namespace protocol
         const ReliableMessageChannelConfig & config;
 
         Message ** messages;                    // array of messages.
-        uint8_t * fragment;                     // the  fragment data. only valid if sending large block.
-        uint64_t numMessages : 16;              // number of messages in array.
-        uint64_t fragmentId : 16;               // fragment id. valid if sending large block.
-        uint64_t blockSize : 32;                // block size in bytes. valid if sending large block.
-        uint64_t blockId : 16;                  // block id. valid if sending large block.
-        uint64_t largeBlock : 1;                // true if currently sending a large block.
-       
+        BlockFragment * fragments;              // array of large block fragments.
+        uint32_t numMessages : 16;              // number of messages in array.
+        uint32_t numFragments : 16;             // number of fragments in array.
+
         ReliableMessageChannelData( const ReliableMessageChannelConfig & _config );
 
         ~ReliableMessageChannelData();
@@ -117,19 +135,25 @@ namespace protocol
         {
             Message * message;
             double timeLastSent;
+            float resendTime;                            // time after the last send before this message is sent again
             uint32_t largeBlock : 1;
             uint32_t measuredBits : 30;
         };
 
+        struct SentFragmentEntry
+        {
+            uint16_t blockId;
+            uint16_t fragmentId;
+        };
+
         struct SentPacketEntry
         {
             double timeSent;
             uint16_t * messageIds;
+            SentFragmentEntry * fragments;
             uint64_t numMessageIds : 16;                 // number of messages in this packet
-            uint64_t blockId : 16;                       // block id. valid only when sending large block.
-            uint64_t fragmentId : 16;                    // fragment id. valid only when sending large block.
+            uint64_t numFragments : 16;                  // number of large block fragments in this packet
             uint64_t acked : 1;                          // 1 if this sent packet has been acked
-            uint64_t largeBlock : 1;                     // 1 if this sent packet contains a large block fragment
         };
 
         struct ReceiveQueueEntry
@@ -151,17 +175,19 @@ namespace protocol
                 active = false;
                 numFragments = 0;
                 numAckedFragments = 0;
+                firstUnackedFragment = 0;
                 blockId = 0;
                 blockSize = 0;
             }
 
-            bool active;                                // true if we are currently sending a large block
-            int numFragments;                           // number of fragments in the current large block being sent
-            int numAckedFragments;                      // number of acked fragments in current block being sent
+            bool active;                                // true if we are currently sending this large block
+            int numFragments;                           // number of fragments in the large block being sent
+            int numAckedFragments;                      // number of acked fragments in the block being sent
+            int firstUnackedFragment;                   // oldest unacked fragment. the fragment window starts here.
             int blockSize;                              // send block size in bytes
-            uint16_t blockId;                           // the message id for the current large block being sent
+            uint16_t blockId;                           // the message id for the large block being sent
             BitArray * acked_fragment;                  // has fragment n been received?
-            double * time_fragment_last_sent;           // time fragment last sent in seconds.
+            double * time_fragment_last_sent;           // time fragment last sent in seconds, indexed by fragment id modulo the fragment window size.
         };
 
         struct ReceiveLargeBlockData
@@ -182,7 +208,7 @@ namespace protocol
                 block.Destroy();
             }
 
-            bool active;                                // true if we are currently receiving a large block
+            bool active;                                // true if we are currently receiving this large block
             int numFragments;                           // number of fragments in this block
             int numReceivedFragments;                   // number of fragments received.
             uint16_t blockId;                           // block id being currently received.
@@ -221,6 +247,8 @@ namespace protocol
 
         int m_maxBlockFragments;                                            // maximum number of fragments per-block
         int m_messageOverheadBits;                                          // number of bits overhead per-serialized message
+        int m_fragmentBits;                                                 // worst case number of bits for a large block fragment in a packet
+        int m_packetHeaderBits;                                             // bits for the message and fragment counts, plus alignment
 
         core::TimeBase m_timeBase;                                          // current time base from last update
         uint16_t m_sendMessageId;                                           // id for next message added to send queue
@@ -231,16 +259,29 @@ namespace protocol
         SequenceBuffer<SentPacketEntry> * m_sentPackets;                    // sent packets (for acks)
         SequenceBuffer<ReceiveQueueEntry> * m_receiveQueue;                 // message receive queue
 
-        SendLargeBlockData m_sendLargeBlock;                                // data for large block being sent
-        ReceiveLargeBlockData m_receiveLargeBlock;                          // data for large block being received
+        SendLargeBlockData * m_sendLargeBlocks;                             // data for large blocks being sent. maxConcurrentLargeBlocks entries.
+        ReceiveLargeBlockData * m_receiveLargeBlocks;                       // data for large blocks being received. maxConcurrentLargeBlocks entries.
 
         uint16_t * m_sentPacketMessageIds;                                  // array of message ids, n ids per-sent packet
+        SentFragmentEntry * m_sentPacketFragments;                          // array of large block fragments, n fragments per-sent packet
 
         uint64_t m_counters[RELIABLE_MESSAGE_CHANNEL_COUNTER_NUM_COUNTERS]; // counters used for unit testing and validation
 
         ReliableMessageChannel( const ReliableMessageChannel & other );
         ReliableMessageChannel & operator = ( const ReliableMessageChannel & other );
 
+        SendLargeBlockData * FindSendLargeBlock( uint16_t blockId );
+
+        ReceiveLargeBlockData * FindReceiveLargeBlock( uint16_t blockId );
+
+        int GetMessagesToSend( uint16_t * messageIds, int & availableBits );
+
+        int GetFragmentsToSend( SentFragmentEntry * fragments, int & availableBits );
+
+        bool ProcessFragment( const BlockFragment & fragment );
+
+        void ProcessFragmentAck( uint16_t blockId, uint16_t fragmentId );
+
     public:
 
         ReliableMessageChannel( const ReliableMessageChannelConfig & config );
@@ -261,7 +302,9 @@ namespace protocol
 
         ChannelData * CreateData();
 
-        ChannelData * GetData( uint16_t sequence );
+        bool HasDataToSend() const;
+
+        ChannelData * GetData( uint16_t sequence, int availableBits );
 
         bool ProcessData( uint16_t sequence, ChannelData * channelData );
 
@@ -275,6 +318,8 @@ namespace protocol
 
         SendLargeBlockStatus GetSendLargeBlockStatus() const;
 
+        float GetResendTime() const;
+
         ReceiveLargeBlockStatus GetReceiveLargeBlockStatus() const;
     };
 }
@@ -28,6 +28,7 @@
 #include "core/Core.h"
 #include "core/Allocator.h"
 #include "protocol/BitArray.h"
+#include "protocol/ProtocolConstants.h"
 
 namespace protocol
 {
@@ -44,7 +45,7 @@ namespace protocol
             m_sequence = 0;
             m_allocator = &allocator;
             m_entry_sequence = (uint16_t*) allocator.Allocate( sizeof(uint16_t) * size );
-            m_entries = (T*) allocator.Allocate( sizeof(T) * size );
+            m_entries = (T*) allocator.Allocate( sizeof(T) * size, alignof(T) );
             Reset();
         }
 
@@ -62,6 +63,8 @@ namespace protocol
         {
             m_first_entry = true;
             m_sequence = 0;
+            m_recent[0] = 0;
+            m_recent[1] = 0;
             m_exists.Clear();
             memset( m_entry_sequence, 0, sizeof(uint16_t) * m_size );
             // IMPORTANT: actual entries are left alone as they may be very large!
@@ -76,6 +79,7 @@ namespace protocol
             }
             else if ( core::sequence_greater_than( sequence + 1, m_sequence ) )
             {
+                ShiftRecent( uint16_t( sequence + 1 - m_sequence ) );
                 m_sequence = sequence + 1;
             }
             else if ( core::sequence_less_than( sequence, m_sequence - m_size ) )
@@ -83,6 +87,8 @@ namespace protocol
                 return NULL;
             }
 
+            SetRecent( sequence, true );
+
             const int index = sequence % m_size;
 
             m_exists.SetBit( index );
@@ -94,6 +100,8 @@ namespace protocol
 
         void Remove( uint16_t sequence )
         {
+            SetRecent( sequence, false );
+
             const int index = sequence % m_size;
 
             m_exists.ClearBit( index );
@@ -146,12 +154,65 @@ namespace protocol
             return m_size;
         }
 
+        void GetRecent( uint32_t * bits, int numWords ) const
+        {
+            // bit n of the result is set if GetSequence() - 1 - n has been inserted
+
+            CORE_ASSERT( numWords > 0 );
+            CORE_ASSERT( numWords <= MaxAckWords );
+            for ( int i = 0; i < numWords; ++i )
+            {
+                bits[i] = uint32_t( m_recent[i/2] >> ( ( i & 1 ) * 32 ) );
+
+                // sequence numbers older than the buffer are no longer in it
+
+                const int valid = m_size - i * 32;
+                if ( valid <= 0 )
+                    bits[i] = 0;
+                else if ( valid < 32 )
+                    bits[i] &= ( 1U << valid ) - 1;
+            }
+        }
+
     private:
 
+        void ShiftRecent( int shift )
+        {
+            CORE_ASSERT( shift > 0 );
+            if ( shift >= 128 )
+            {
+                m_recent[0] = 0;
+                m_recent[1] = 0;
+            }
+            else if ( shift >= 64 )
+            {
+                m_recent[1] = m_recent[0] << ( shift - 64 );
+                m_recent[0] = 0;
+            }
+            else
+            {
+                m_recent[1] = ( m_recent[1] << shift ) | ( m_recent[0] >> ( 64 - shift ) );
+                m_recent[0] <<= shift;
+            }
+        }
+
+        void SetRecent( uint16_t sequence, bool value )
+        {
+            const uint16_t offset = m_sequence - 1 - sequence;
+            if ( offset >= MaxAckBits )
+                return;
+            const uint64_t mask = uint64_t(1) << ( offset & 63 );
+            if ( value )
+                m_recent[offset>>6] |= mask;
+            else
+                m_recent[offset>>6] &= ~mask;
+        }
+
         core::Allocator * m_allocator;
 
         bool m_first_entry;
         uint16_t m_sequence;
+        uint64_t m_recent[MaxAckBits/64];           // rolling mask of the most recently inserted sequence numbers, newest in bit 0
         int m_size;
         BitArray m_exists;
         uint16_t * m_entry_sequence;
@@ -163,16 +224,18 @@ namespace protocol
 
     template <typename T> void GenerateAckBits( const SequenceBuffer<T> & packets, 
                                                 uint16_t & ack,
-                                                uint32_t & ack_bits )
+                                                uint32_t * ack_bits,
+                                                int num_ack_words )
     {
         ack = packets.GetSequence() - 1;
-        ack_bits = 0;
-        for ( int i = 0; i < 32; ++i )
-        {
-            uint16_t sequence = ack - i;
-            if ( packets.Find( sequence ) )
-                ack_bits |= ( 1 << i );
-        }
+        packets.GetRecent( ack_bits, num_ack_words );
+    }
+
+    template <typename T> void GenerateAckBits( const SequenceBuffer<T> & packets, 
+                                                uint16_t & ack,
+                                                uint32_t & ack_bits )
+    {
+        GenerateAckBits( packets, ack, &ack_bits, 1 );
     }
 }
 
@@ -32,6 +32,7 @@
 #include "protocol/ProtocolEnums.h"
 #include "protocol/Block.h"
 #include "protocol/BitPacker.h"
+#include "protocol/PacketBuffer.h"
 
 namespace protocol
 {
@@ -61,6 +62,13 @@ namespace protocol
             m_writer.WriteBits( value, bits );
         }
 
+        void SerializeBitsArray( const uint32_t * values, int count, int bits )
+        {
+            CORE_ASSERT( bits > 0 );
+            CORE_ASSERT( bits <= 32 );
+            m_writer.WriteBitsArray( values, count, bits );
+        }
+
         void SerializeBytes( const uint8_t * data, int bytes )
         {
             Align();
@@ -160,7 +168,7 @@ namespace protocol
         enum { IsWriting = 0 };
         enum { IsReading = 1 };
 
-        ReadStream( uint8_t * buffer, int bytes ) : m_bitsRead(0), m_reader( buffer, bytes ), m_context( NULL ), m_aborted( false ) {}
+        ReadStream( uint8_t * buffer, int bytes ) : m_bitsRead(0), m_reader( buffer, bytes ), m_context( NULL ), m_packetBuffer( NULL ), m_aborted( false ) {}
 
         void SerializeInteger( int32_t & value, int32_t min, int32_t max )
         {
@@ -180,6 +188,14 @@ namespace protocol
             m_bitsRead += bits;
         }
 
+        void SerializeBitsArray( uint32_t * values, int count, int bits )
+        {
+            CORE_ASSERT( bits > 0 );
+            CORE_ASSERT( bits <= 32 );
+            m_reader.ReadBitsArray( values, count, bits );
+            m_bitsRead += count * bits;
+        }
+
         void SerializeBytes( uint8_t * data, int bytes )
         {
             Align();
@@ -187,6 +203,15 @@ namespace protocol
             m_bitsRead += bytes * 8;
         }
 
+        uint8_t * SerializeBytesInPlace( int bytes )
+        {
+            // IMPORTANT: the pointer returned is into the buffer passed to the constructor
+            Align();
+            uint8_t * data = m_reader.ReadBytesInPlace( bytes );
+            m_bitsRead += bytes * 8;
+            return data;
+        }
+
         void Align()
         {
             m_reader.ReadAlign();
@@ -233,6 +258,18 @@ namespace protocol
             return m_context ? m_context[index] : NULL;
         }
 
+        void SetPacketBuffer( PacketBuffer * packetBuffer )
+        {
+            // set when the buffer being read is a packet buffer. see serialize_owned_bytes
+            CORE_ASSERT( !packetBuffer || m_reader.GetBitsRead() == 0 );
+            m_packetBuffer = packetBuffer;
+        }
+
+        PacketBuffer * GetPacketBuffer() const
+        {
+            return m_packetBuffer;
+        }
+
         void Abort()
         {
             m_aborted = true;
@@ -253,6 +290,7 @@ namespace protocol
         int m_bitsRead;
         BitReader m_reader;
         const void ** m_context;
+        PacketBuffer * m_packetBuffer;
         bool m_aborted;
     };
 
@@ -285,6 +323,13 @@ namespace protocol
             m_bitsWritten += bits;
         }
 
+        void SerializeBitsArray( const uint32_t * /*values*/, int count, int bits )
+        {
+            CORE_ASSERT( bits > 0 );
+            CORE_ASSERT( bits <= 32 );
+            m_bitsWritten += count * bits;
+        }
+
         void SerializeBytes( const uint8_t * /*data*/, int bytes )
         {
             Align();
@@ -540,6 +585,11 @@ template <typename Stream> void serialize_double( Stream & stream, double & valu
         value = tmp.double_value;
 }
 
+template <typename Stream> void serialize_bits_array( Stream & stream, uint32_t * values, int count, int bits )
+{
+    stream.SerializeBitsArray( values, count, bits );
+}
+
 template <typename Stream> void serialize_bytes( Stream & stream, uint8_t * data, int bytes )
 {
     stream.SerializeBytes( data, bytes );        
@@ -559,6 +609,45 @@ template <typename Stream> void serialize_string( Stream & stream, char * string
         string[length] = '\0';
 }
 
+/*
+    Serialize bytes held in memory owned by the caller, eg. a fragment.
+
+    On read, data is set to memory the caller frees with allocator. If the stream
+    is reading a packet buffer the bytes are not copied: data points into the
+    packet buffer and allocator is set to the packet buffer, so freeing data
+    just releases a reference. Otherwise data is allocated with allocator.
+*/
+
+template <typename Stream> void serialize_owned_bytes( Stream & stream, uint8_t * & data, int bytes, core::Allocator * & allocator )
+{
+    (void)allocator;
+    CORE_ASSERT( data );
+    stream.SerializeBytes( data, bytes );
+}
+
+inline void serialize_owned_bytes( protocol::ReadStream & stream, uint8_t * & data, int bytes, core::Allocator * & allocator )
+{
+    CORE_ASSERT( !data );
+    CORE_ASSERT( allocator );
+
+    protocol::PacketBuffer * packetBuffer = stream.GetPacketBuffer();
+
+    if ( packetBuffer )
+    {
+        data = stream.SerializeBytesInPlace( bytes );
+        if ( !data )
+            return;
+        CORE_ASSERT( packetBuffer->Contains( data ) );
+        packetBuffer->AddRef();
+        allocator = packetBuffer;
+    }
+    else
+    {
+        data = (uint8_t*) allocator->Allocate( bytes );
+        stream.SerializeBytes( data, bytes );
+    }
+}
+
 template <typename Stream> void serialize_block( Stream & stream, protocol::Block & block, int maxBytes )
 { 
     stream.Align();
@@ -579,12 +668,15 @@ template <typename Stream> void serialize_block( Stream & stream, protocol::Bloc
         CORE_ASSERT( numBytes > 0 );
         CORE_ASSERT( numBytes <= maxBytes );
         core::Allocator * allocator = block.GetAllocator();
-        CORE_ASSERT( allocator );
-        uint8_t * data = (uint8_t*) allocator->Allocate( numBytes );
-        block.Connect( *allocator, data, numBytes );
+        uint8_t * data = nullptr;
+        serialize_owned_bytes( stream, data, numBytes, allocator );
+        if ( data )
+            block.Connect( *allocator, data, numBytes );
+    }
+    else
+    {
+        stream.SerializeBytes( block.GetData(), numBytes );
     }
-    
-    stream.SerializeBytes( block.GetData(), numBytes );
 }
 
 template <typename Stream, typename T> void serialize_int_relative( Stream & stream, T previous, T & current )
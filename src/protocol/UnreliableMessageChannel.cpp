@@ -0,0 +1,356 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "protocol/UnreliableMessageChannel.h"
+#include "core/Memory.h"
+#include "core/Queue.h"
+
+namespace protocol
+{
+    UnreliableMessageChannelData::UnreliableMessageChannelData( const UnreliableMessageChannelConfig & _config ) 
+        : config( _config ), messages( NULL ), numMessages( 0 ) {}
+
+    UnreliableMessageChannelData::~UnreliableMessageChannelData()
+    {
+        if ( messages )
+        {
+            // IMPORTANT: messages may be null if a read failed part way through, or if ownership moved to the receive queue
+
+            for ( int i = 0; i < numMessages; ++i )
+            {
+                if ( messages[i] )
+                    config.messageFactory->Release( messages[i] );
+            }
+
+            GetAllocator().Free( messages );
+            messages = nullptr;
+        }
+    }
+
+    template <typename Stream> void UnreliableMessageChannelData::Serialize( Stream & stream )
+    {
+        CORE_ASSERT( config.messageFactory );
+
+        if ( Stream::IsWriting )
+            CORE_ASSERT( numMessages > 0 );
+
+        serialize_int( stream, numMessages, 1, config.maxMessagesPerPacket );
+
+        if ( Stream::IsReading )
+        {
+            messages = (Message**) GetAllocator().Allocate( numMessages * sizeof( Message* ) );
+            CORE_ASSERT( messages );
+            memset( messages, 0, numMessages * sizeof( Message* ) );
+        }
+
+        const int maxMessageType = config.messageFactory->GetNumTypes() - 1;
+
+        for ( int i = 0; i < numMessages; ++i )
+        {
+            if ( config.align )
+                stream.Align();
+
+            int messageType = 0;
+            if ( Stream::IsWriting )
+            {
+                CORE_ASSERT( messages[i] );
+                messageType = messages[i]->GetType();
+            }
+
+            serialize_int( stream, messageType, 0, maxMessageType );
+
+            if ( config.align )
+                stream.Align();
+
+            if ( Stream::IsReading )
+            {
+                messages[i] = config.messageFactory->Create( messageType );
+
+                CORE_ASSERT( messages[i] );
+                CORE_ASSERT( messages[i]->GetType() == messageType );
+
+                if ( messageType == BlockMessageType )
+                {
+                    CORE_ASSERT( config.smallBlockAllocator );
+                    BlockMessage * blockMessage = static_cast<BlockMessage*>( messages[i] );
+                    blockMessage->SetAllocator( *config.smallBlockAllocator );
+                }
+            }
+
+            serialize_object( stream, *messages[i] );
+        }
+    }
+
+    void UnreliableMessageChannelData::SerializeRead( ReadStream & stream )
+    {
+        Serialize( stream );
+    }
+
+    void UnreliableMessageChannelData::SerializeWrite( WriteStream & stream )
+    {
+        Serialize( stream );
+    }
+
+    void UnreliableMessageChannelData::SerializeMeasure( MeasureStream & stream )
+    {
+        Serialize( stream );
+    }
+
+    // ----------------------------------------------------------------
+
+    UnreliableMessageChannel::UnreliableMessageChannel( const UnreliableMessageChannelConfig & config ) 
+        : m_config( config ),
+          m_sendQueue( config.allocator ? *config.allocator : core::memory::default_allocator() ),
+          m_receiveQueue( config.allocator ? *config.allocator : core::memory::default_allocator() )
+    {
+        CORE_ASSERT( config.messageFactory );
+        CORE_ASSERT( config.smallBlockAllocator );
+        CORE_ASSERT( config.maxSmallBlockSize <= MaxSmallBlockSize );
+        CORE_ASSERT( config.sendQueueSize > 0 );
+        CORE_ASSERT( config.receiveQueueSize > 0 );
+
+        m_allocator = config.allocator ? config.allocator : &core::memory::default_allocator();
+
+        core::queue::reserve( m_sendQueue, m_config.sendQueueSize );
+        core::queue::reserve( m_receiveQueue, m_config.receiveQueueSize );
+
+        const int maxMessageType = m_config.messageFactory->GetNumTypes() - 1;
+        const int MessageTypeBits = core::bits_required( 0, maxMessageType );
+        const int MessageAlignOverhead = m_config.align ? 14 : 0;
+
+        m_messageOverheadBits = MessageTypeBits + MessageAlignOverhead;
+
+        Reset();
+    }
+
+    UnreliableMessageChannel::~UnreliableMessageChannel()
+    {
+        Reset();
+    }
+
+    void UnreliableMessageChannel::Reset()
+    {
+        for ( int i = 0; i < (int) core::queue::size( m_sendQueue ); ++i )
+            m_config.messageFactory->Release( m_sendQueue[i].message );
+
+        for ( int i = 0; i < (int) core::queue::size( m_receiveQueue ); ++i )
+            m_config.messageFactory->Release( m_receiveQueue[i] );
+
+        core::queue::clear( m_sendQueue );
+        core::queue::clear( m_receiveQueue );
+
+        m_received = false;
+        m_receiveSequence = 0;
+
+        m_timeBase = core::TimeBase();
+
+        memset( m_counters, 0, sizeof( m_counters ) );
+    }
+
+    bool UnreliableMessageChannel::CanSendMessage() const
+    {
+        return (int) core::queue::size( m_sendQueue ) < m_config.sendQueueSize;
+    }
+
+    void UnreliableMessageChannel::SendMessage( Message * message )
+    {
+        CORE_ASSERT( message );
+
+        if ( !CanSendMessage() )
+        {
+            m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_SEND_QUEUE_FULL]++;
+            m_config.messageFactory->Release( message );
+            return;
+        }
+
+        CORE_ASSERT( !message->IsBlock() || static_cast<BlockMessage*>( message )->GetBlock().GetSize() <= m_config.maxSmallBlockSize );
+
+        const int SmallBlockOverhead = 8;
+
+        MeasureStream measureStream( core::max( m_config.maxMessageSize, m_config.maxSmallBlockSize + SmallBlockOverhead ) );
+        measureStream.SetContext( GetContext() );
+        message->SerializeMeasure( measureStream );
+        if ( measureStream.IsOverflow() )
+        {
+            printf( "measure stream overflow on message type %d: %d bits written, max is %d\n", message->GetType(), measureStream.GetBitsProcessed(), measureStream.GetTotalBits() );
+        }
+
+        CORE_ASSERT( !measureStream.IsOverflow() );
+
+        SendQueueEntry entry;
+        entry.message = message;
+        entry.measuredBits = measureStream.GetBitsProcessed() + m_messageOverheadBits;
+
+        // a message that can't fit in the packet budget would sit at the head of the send queue forever, blocking everything behind it
+
+        if ( entry.measuredBits > m_config.packetBudget * 8 - core::bits_required( 1, m_config.maxMessagesPerPacket ) )
+        {
+            m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_TOO_LARGE]++;
+            m_config.messageFactory->Release( message );
+            return;
+        }
+
+        core::queue::push_back( m_sendQueue, entry );
+
+        m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_SENT]++;
+    }
+
+    void UnreliableMessageChannel::SendBlock( Block & block )
+    {
+        auto blockMessage = (BlockMessage*) m_config.messageFactory->Create( BlockMessageType );
+        CORE_ASSERT( blockMessage );
+        blockMessage->Connect( block );
+
+        SendMessage( blockMessage );
+    }
+
+    Message * UnreliableMessageChannel::ReceiveMessage()
+    {
+        if ( core::queue::size( m_receiveQueue ) == 0 )
+            return nullptr;
+
+        Message * message = m_receiveQueue[0];
+
+        core::queue::pop_front( m_receiveQueue );
+
+        m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_RECEIVED]++;
+
+        return message;
+    }
+
+    int UnreliableMessageChannel::GetError() const
+    {
+        return 0;
+    }
+
+    bool UnreliableMessageChannel::HasDataToSend() const
+    {
+        return core::queue::size( m_sendQueue ) != 0;
+    }
+
+    ChannelData * UnreliableMessageChannel::GetData( uint16_t /*sequence*/, int availableBits )
+    {
+        if ( core::queue::size( m_sendQueue ) == 0 )
+            return nullptr;
+
+        availableBits = core::min( availableBits, m_config.packetBudget * 8 );
+
+        availableBits -= core::bits_required( 1, m_config.maxMessagesPerPacket );
+
+        // take messages from the front of the send queue while they fit. keep send order,
+        // so a message that doesn't fit waits for the next packet along with everything behind it.
+
+        int numMessages = 0;
+        while ( numMessages < m_config.maxMessagesPerPacket && numMessages < (int) core::queue::size( m_sendQueue ) )
+        {
+            const SendQueueEntry & entry = m_sendQueue[numMessages];
+            if ( entry.measuredBits > availableBits )
+                break;
+            availableBits -= entry.measuredBits;
+            numMessages++;
+        }
+
+        if ( numMessages == 0 )
+            return nullptr;
+
+        core::Allocator & allocator = GetDataAllocator();
+
+        auto data = CORE_NEW( allocator, UnreliableMessageChannelData, m_config );
+        data->SetAllocator( allocator );
+
+        data->messages = (Message**) allocator.Allocate( numMessages * sizeof( Message* ) );
+        CORE_ASSERT( data->messages );
+        data->numMessages = numMessages;
+
+        // the send queue reference moves to the channel data, which releases it once the packet is destroyed
+
+        for ( int i = 0; i < numMessages; ++i )
+            data->messages[i] = m_sendQueue[i].message;
+
+        core::queue::consume( m_sendQueue, numMessages );
+
+        m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_WRITTEN] += numMessages;
+
+        return data;
+    }
+
+    bool UnreliableMessageChannel::ProcessData( uint16_t sequence, ChannelData * channelData )
+    {
+        CORE_ASSERT( channelData );
+
+        auto data = static_cast<UnreliableMessageChannelData*>( channelData );
+
+        m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_READ] += data->numMessages;
+
+        if ( m_config.sequenced )
+        {
+            if ( m_received && !core::sequence_greater_than( sequence, m_receiveSequence ) )
+            {
+                m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_LATE] += data->numMessages;
+                return true;
+            }
+
+            m_received = true;
+            m_receiveSequence = sequence;
+        }
+
+        // move messages from the channel data into the receive queue
+
+        for ( int i = 0; i < data->numMessages; ++i )
+        {
+            CORE_ASSERT( data->messages[i] );
+
+            if ( (int) core::queue::size( m_receiveQueue ) == m_config.receiveQueueSize )
+            {
+                m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_RECEIVE_QUEUE_FULL]++;
+                continue;
+            }
+
+            core::queue::push_back( m_receiveQueue, data->messages[i] );
+
+            data->messages[i] = nullptr;
+        }
+
+        // IMPORTANT: never discard the packet. dropping messages must not stop the packet from being acked
+
+        return true;
+    }
+
+    void UnreliableMessageChannel::ProcessAck( uint16_t /*ack*/ )
+    {
+        // unreliable messages have no ack state
+    }
+
+    void UnreliableMessageChannel::Update( const core::TimeBase & timeBase )
+    {
+        m_timeBase = timeBase;
+    }
+
+    uint64_t UnreliableMessageChannel::GetCounter( int index ) const
+    {
+        CORE_ASSERT( index >= 0 );
+        CORE_ASSERT( index < UNRELIABLE_MESSAGE_CHANNEL_COUNTER_NUM_COUNTERS );
+        return m_counters[index];
+    }
+}
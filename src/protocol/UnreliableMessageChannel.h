@@ -0,0 +1,161 @@
+/*
+    Networked Physics Demo
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PROTOCOL_UNRELIABLE_MESSAGE_CHANNEL_H
+#define PROTOCOL_UNRELIABLE_MESSAGE_CHANNEL_H
+
+#include "Message.h"
+#include "BlockMessage.h"
+#include "MessageFactory.h"
+#include "MessageChannel.h"
+#include "core/Types.h"
+
+namespace protocol
+{
+    struct UnreliableMessageChannelConfig
+    {
+        UnreliableMessageChannelConfig()
+        {
+            allocator = nullptr;
+            sendQueueSize = 1024;
+            receiveQueueSize = 1024;
+            maxMessagesPerPacket = 32;
+            maxMessageSize = 64;
+            maxSmallBlockSize = 64;
+            packetBudget = 128;
+            align = true;
+            sequenced = false;
+            messageFactory = NULL;
+            smallBlockAllocator = NULL;
+        }
+
+        core::Allocator * allocator;    // allocator used for allocations matching life cycle of this object. if null falls back to default allocator.
+
+        int sendQueueSize;              // send queue size in # of messages. messages sent while the queue is full are dropped.
+        int receiveQueueSize;           // receive queue size in # of messages. messages received while the queue is full are dropped.
+        int maxMessagesPerPacket;       // maximum number of messages included in a packet
+        int maxMessageSize;             // maximum message size allowed in serialized bytes, eg. post bitpacker
+        int maxSmallBlockSize;          // maximum block size allowed. there are no large blocks on an unreliable channel.
+        int packetBudget;               // maximum number of bytes this channel may take per-packet. the connection scheduler may offer less. messages too large for it are dropped.
+        bool align;                     // if true then insert align at key points, eg. before messages etc. good for dictionary based LZ compressors
+        bool sequenced;                 // if true then messages in packets older than the most recent packet received are dropped
+
+        MessageFactory * messageFactory;
+
+        core::Allocator * smallBlockAllocator;
+    };
+
+    class UnreliableMessageChannelData : public ChannelData
+    {
+        UnreliableMessageChannelData( const UnreliableMessageChannelData & other );
+        UnreliableMessageChannelData & operator = ( const UnreliableMessageChannelData & other );
+
+    public:
+
+        const UnreliableMessageChannelConfig & config;
+
+        Message ** messages;                    // array of messages. owned by this object.
+        int numMessages;                        // number of messages in array.
+
+        UnreliableMessageChannelData( const UnreliableMessageChannelConfig & _config );
+
+        ~UnreliableMessageChannelData();
+
+        template <typename Stream> void Serialize( Stream & stream );
+
+        void SerializeRead( ReadStream & stream );
+
+        void SerializeWrite( WriteStream & stream );
+
+        void SerializeMeasure( MeasureStream & stream );
+    };
+
+    /*
+        Fire and forget messages. There are no message ids, no sent packet
+        tracking and no resends: each message is written into exactly one
+        packet and costs only its serialized bits plus its type. Messages
+        that don't fit in this packet's budget wait in the send queue for
+        the next packet. If the packet is lost, so are its messages.
+    */
+
+    class UnreliableMessageChannel : public MessageChannel
+    {
+        struct SendQueueEntry
+        {
+            Message * message;
+            int measuredBits;
+        };
+
+        const UnreliableMessageChannelConfig m_config;                      // constant configuration data
+
+        core::Allocator * m_allocator;                                      // allocator for allocations matching life cycle of object.
+
+        int m_messageOverheadBits;                                          // number of bits overhead per-serialized message
+
+        core::TimeBase m_timeBase;                                          // current time base from last update
+
+        bool m_received;                                                    // true once a packet with data has been processed. sequenced only.
+        uint16_t m_receiveSequence;                                         // most recent packet sequence processed. sequenced only.
+
+        core::Queue<SendQueueEntry> m_sendQueue;                            // messages waiting to be written to a packet
+        core::Queue<Message*> m_receiveQueue;                               // messages waiting to be received
+
+        uint64_t m_counters[UNRELIABLE_MESSAGE_CHANNEL_COUNTER_NUM_COUNTERS];   // counters used for unit testing and validation
+
+        UnreliableMessageChannel( const UnreliableMessageChannel & other );
+        UnreliableMessageChannel & operator = ( const UnreliableMessageChannel & other );
+
+    public:
+
+        UnreliableMessageChannel( const UnreliableMessageChannelConfig & config );
+
+        ~UnreliableMessageChannel();
+
+        void Reset();
+
+        bool CanSendMessage() const;
+
+        void SendMessage( Message * message );
+
+        void SendBlock( Block & block );
+
+        Message * ReceiveMessage();
+
+        int GetError() const;
+
+        bool HasDataToSend() const;
+
+        ChannelData * GetData( uint16_t sequence, int availableBits );
+
+        bool ProcessData( uint16_t sequence, ChannelData * channelData );
+
+        void ProcessAck( uint16_t ack );
+
+        void Update( const core::TimeBase & timeBase );
+
+        uint64_t GetCounter( int index ) const;
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "clientServer/ClientServerContext.h"
+#include "core/Memory.h"
+#include "tests/Profile.h"
+
+const int NumLookups = 100000;
+const int NumChurn = 10000;
+
+// reference: the linear scan the context used before it was indexed
+
+static int linear_find_client( const clientServer::ClientServerContext & context, const network::Address & address, uint16_t clientId, uint16_t serverId )
+{
+    for ( int i = 0; i < context.numClients; ++i )
+    {
+        const auto & client = context.clientInfo[i];
+        if ( client.connected && client.address == address && client.clientId == clientId && client.serverId == serverId )
+            return i;
+    }
+    return -1;
+}
+
+static network::Address client_address( int index )
+{
+    return network::Address( 10, 0, ( index >> 8 ) & 0xFF, index & 0xFF, 40000 + index );
+}
+
+static void profile_client_lookup( bool csv, int numClients )
+{
+    clientServer::ClientServerContext context;
+    context.Initialize( core::memory::default_allocator(), numClients );
+
+    for ( int i = 0; i < numClients; ++i )
+        context.AddClient( i, client_address( i ), 1000 + i, 2000 + i );
+
+    ProfileSamples lookup( NumLookups );
+    ProfileSamples linear( NumLookups );
+    ProfileSamples filter( NumLookups );
+    ProfileSamples churn( NumChurn );
+
+    int mismatches = 0;
+
+    // look up clients in random order, the way packets arrive
+
+    for ( int i = 0; i < NumLookups; ++i )
+    {
+        const int index = rand() % numClients;
+        const network::Address address = client_address( index );
+
+        uint64_t start = core::nanoseconds();
+        const int a = context.FindClient( address, 1000 + index, 2000 + index );
+        lookup.Add( core::nanoseconds() - start );
+
+        start = core::nanoseconds();
+        const int b = linear_find_client( context, address, 1000 + index, 2000 + index );
+        linear.Add( core::nanoseconds() - start );
+
+        start = core::nanoseconds();
+        const bool exists = context.ClientPotentiallyExists( 1000 + index, 2000 + index );
+        filter.Add( core::nanoseconds() - start );
+
+        if ( a != index || b != index || !exists )
+            mismatches++;
+    }
+
+    // disconnect and reconnect clients through the free list
+
+    const uint64_t startAllocations = core::memory::num_allocations();
+
+    for ( int i = 0; i < NumChurn; ++i )
+    {
+        const int index = rand() % numClients;
+
+        uint64_t start = core::nanoseconds();
+        context.RemoveClient( index );
+        const int freeSlot = context.FindFreeSlot();
+        context.AddClient( freeSlot, client_address( index ), 1000 + index, 2000 + index );
+        churn.Add( core::nanoseconds() - start );
+
+        if ( freeSlot != index )
+            mismatches++;
+    }
+
+    const uint64_t numAllocations = core::memory::num_allocations() - startAllocations;
+
+    {
+        char name[64];
+        snprintf( name, sizeof( name ), "client_lookup_%d", numClients );
+
+        ProfileReport report( name, csv );
+        report.Value( "clients", numClients );
+        report.Value( "mismatches", mismatches );
+        report.Value( "allocations", (double) numAllocations );
+        report.Samples( "lookup_ns", lookup );
+        report.Samples( "linear_ns", linear );
+        report.Samples( "filter_ns", filter );
+        report.Samples( "churn_ns", churn );
+        report.Value( "speedup", linear.GetMean() / lookup.GetMean() );
+    }
+
+    CORE_CHECK( mismatches == 0 );
+    CORE_CHECK( numAllocations == 0 );
+
+    context.Free( core::memory::default_allocator() );
+}
+
+int main( int argc, char ** argv )
+{
+    srand( 0 );
+
+    core::memory::initialize();
+
+    const bool csv = profile_csv_output( argc, argv );
+
+    profile_client_lookup( csv, 16 );
+    profile_client_lookup( csv, 256 );
+    profile_client_lookup( csv, 4096 );
+
+    core::memory::shutdown();
+
+    return 0;
+}
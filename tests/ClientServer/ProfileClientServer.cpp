@@ -1,3 +1,335 @@
-#define PROFILE 1
+#include "protocol/Connection.h"
+#include "protocol/ReliableMessageChannel.h"
+#include "network/BSDSocket.h"
+#include "network/Network.h"
+#include "network/Compressor.h"
+#include "clientServer/Server.h"
+#include "clientServer/Client.h"
+#include "TestMessages.h"
+#include "TestPackets.h"
+#include "TestChannelStructure.h"
+#include "tests/Profile.h"
 
-#include "SoakClientServer.cpp"
\ No newline at end of file
+const int NumClients = 32;
+const int ServerPort = 10000;
+const int MaxMessagesPerTick = 4;
+const int MaxConnectTicks = 60 * 30;
+const int NumWarmupTicks = 60;
+const int NumTicks = 60 * 60;
+const int MaxCapturePackets = 64 * 1024;
+const int MaxDictionaryBytes = 64 * 1024;
+
+struct ProfileOptions
+{
+    bool threaded = false;                      // profile the server in threaded mode
+    bool compression = false;                   // compress packets and report compression stats per packet type
+    const char * captureFilename = nullptr;     // capture packets sent by the server to this file, for DictionaryTool
+    const char * dictionaryFilename = nullptr;  // compress with the dictionary in this file (implies compression)
+};
+
+static uint64_t get_socket_counter( network::BSDSocket & serverInterface, network::BSDSocket ** clientInterface, int index )
+{
+    uint64_t value = serverInterface.GetCounter( index );
+    for ( int i = 0; i < NumClients; ++i )
+        value += clientInterface[i]->GetCounter( index );
+    return value;
+}
+
+static void report_compression_stats( bool csv, network::BSDSocket & serverInterface, network::BSDSocket ** clientInterface, int numPacketTypes )
+{
+    for ( int type = 0; type < numPacketTypes; ++type )
+    {
+        network::BSDSocketCompressionStats stats;
+        memset( &stats, 0, sizeof( stats ) );
+
+        for ( int i = -1; i < NumClients; ++i )
+        {
+            const network::BSDSocketCompressionStats & socketStats = ( i < 0 ? serverInterface : *clientInterface[i] ).GetCompressionStats( type );
+            stats.packetsCompressed += socketStats.packetsCompressed;
+            stats.packetsDecompressed += socketStats.packetsDecompressed;
+            stats.uncompressedBytes += socketStats.uncompressedBytes;
+            stats.compressedBytes += socketStats.compressedBytes;
+            stats.compressNanoseconds += socketStats.compressNanoseconds;
+            stats.decompressNanoseconds += socketStats.decompressNanoseconds;
+        }
+
+        if ( stats.packetsCompressed == 0 )
+            continue;
+
+        char name[64];
+        snprintf( name, sizeof( name ), "compression_packet_type_%d", type );
+
+        ProfileReport report( name, csv );
+        report.Value( "packets", (double) stats.packetsCompressed );
+        report.Value( "bytes_per_packet", stats.uncompressedBytes / double( stats.packetsCompressed ) );
+        report.Value( "compressed_bytes_per_packet", stats.compressedBytes / double( stats.packetsCompressed ) );
+        report.Value( "compression_ratio", stats.uncompressedBytes / double( stats.compressedBytes ) );
+        report.Value( "compress_ns_per_packet", stats.compressNanoseconds / double( stats.packetsCompressed ) );
+        report.Value( "decompress_ns_per_packet", stats.packetsDecompressed ? stats.decompressNanoseconds / double( stats.packetsDecompressed ) : 0.0 );
+    }
+}
+
+void profile_client_server( bool csv, const ProfileOptions & options )
+{
+    const bool threaded = options.threaded;
+
+    TestMessageFactory messageFactory( core::memory::default_allocator() );
+
+    TestChannelStructure channelStructure( messageFactory );
+
+    TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+    network::BSDSocketConfig bsdSocketConfig;
+    bsdSocketConfig.port = ServerPort;
+    bsdSocketConfig.maxPacketSize = 1200;
+    bsdSocketConfig.packetFactory = &packetFactory;
+
+    // IMPORTANT: the capture and dictionary are malloc'd so they don't count towards allocations per packet
+
+    network::PacketCapture * capture = nullptr;
+    if ( options.captureFilename )
+    {
+        capture = new ( malloc( sizeof( network::PacketCapture ) ) ) network::PacketCapture( core::memory::default_allocator(), MaxCapturePackets, bsdSocketConfig.maxPacketSize );
+        bsdSocketConfig.capture = capture;
+    }
+
+    uint8_t * dictionary = nullptr;
+    int dictionaryBytes = 0;
+    if ( options.dictionaryFilename )
+    {
+        FILE * file = fopen( options.dictionaryFilename, "rb" );
+        CORE_CHECK( file );
+        dictionary = (uint8_t*) malloc( MaxDictionaryBytes );
+        dictionaryBytes = (int) fread( dictionary, 1, MaxDictionaryBytes, file );
+        fclose( file );
+    }
+
+    bsdSocketConfig.compression = options.compression || dictionary;
+    bsdSocketConfig.compressionDictionary = dictionary;
+    bsdSocketConfig.compressionDictionaryBytes = dictionaryBytes;
+
+    network::BSDSocket serverInterface( bsdSocketConfig );
+
+    clientServer::ServerConfig serverConfig;
+    serverConfig.maxClients = NumClients;
+    serverConfig.channelStructure = &channelStructure;
+    serverConfig.networkInterface = &serverInterface;
+    serverConfig.threaded = threaded;
+
+    clientServer::Server server( serverConfig );
+
+    network::Address serverAddress( "::1" );
+    serverAddress.SetPort( ServerPort );
+
+    clientServer::Client * clients[NumClients];
+    network::BSDSocket * clientInterface[NumClients];
+
+    bsdSocketConfig.port = 0;
+    bsdSocketConfig.capture = nullptr;
+
+    for ( int i = 0; i < NumClients; ++i )
+    {
+        clientInterface[i] = CORE_NEW( core::memory::default_allocator(), network::BSDSocket, bsdSocketConfig );
+
+        clientServer::ClientConfig clientConfig;
+        clientConfig.channelStructure = &channelStructure;
+        clientConfig.networkInterface = clientInterface[i];
+
+        clients[i] = CORE_NEW( core::memory::default_allocator(), clientServer::Client, clientConfig );
+
+        clients[i]->Connect( serverAddress );
+    }
+
+    core::TimeBase timeBase;
+    timeBase.deltaTime = 1.0 / 60.0;
+
+    // connect all clients before measuring anything
+
+    for ( int tick = 0; tick < MaxConnectTicks; ++tick )
+    {
+        server.Update( timeBase );
+
+        int numConnected = 0;
+
+        for ( int i = 0; i < NumClients; ++i )
+        {
+            clients[i]->Update( timeBase );
+            if ( clients[i]->IsConnected() )
+                numConnected++;
+        }
+
+        if ( numConnected == NumClients )
+            break;
+
+        timeBase.time += timeBase.deltaTime;
+    }
+
+    for ( int i = 0; i < NumClients; ++i )
+        CORE_CHECK( clients[i]->IsConnected() );
+
+    ProfileSamples serverUpdate;
+    ProfileSamples clientUpdate;
+
+    uint16_t sendSequence[NumClients];
+    memset( sendSequence, 0, sizeof( sendSequence ) );
+
+    uint64_t numMessagesReceived = 0;
+    uint64_t startAllocations = 0;
+    uint64_t startTime = 0;
+    uint64_t startPackets = 0;
+    uint64_t startBytes = 0;
+
+    for ( int tick = 0; tick < NumWarmupTicks + NumTicks; ++tick )
+    {
+        if ( tick == NumWarmupTicks )
+        {
+            serverUpdate.Reset();
+            clientUpdate.Reset();
+            numMessagesReceived = 0;
+            startAllocations = core::memory::num_allocations();
+            startPackets = get_socket_counter( serverInterface, clientInterface, network::BSD_SOCKET_COUNTER_PACKETS_SENT );
+            startBytes = get_socket_counter( serverInterface, clientInterface, network::BSD_SOCKET_COUNTER_BYTES_SENT );
+            startTime = core::nanoseconds();
+        }
+
+        uint64_t start = core::nanoseconds();
+
+        server.Update( timeBase );
+
+        // echo every message received by the server back to the client that sent it
+
+        for ( int i = 0; i < NumClients; ++i )
+        {
+            if ( server.GetClientState( i ) != clientServer::SERVER_CLIENT_STATE_CONNECTED )
+                continue;
+
+            auto messageChannel = static_cast<protocol::ReliableMessageChannel*>( server.GetClientConnection( i )->GetChannel( 0 ) );
+
+            while ( messageChannel->CanSendMessage() )
+            {
+                auto message = messageChannel->ReceiveMessage();
+                if ( !message )
+                    break;
+
+                numMessagesReceived++;
+
+                auto reply = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+                reply->sequence = static_cast<TestMessage*>( message )->sequence;
+                messageChannel->SendMessage( reply );
+
+                messageFactory.Release( message );
+            }
+        }
+
+        serverUpdate.Add( core::nanoseconds() - start );
+
+        for ( int i = 0; i < NumClients; ++i )
+        {
+            start = core::nanoseconds();
+
+            CORE_CHECK( clients[i]->IsConnected() );
+
+            auto messageChannel = static_cast<protocol::ReliableMessageChannel*>( clients[i]->GetConnection()->GetChannel( 0 ) );
+
+            for ( int j = 0; j < MaxMessagesPerTick && messageChannel->CanSendMessage(); ++j )
+            {
+                auto message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+                message->sequence = sendSequence[i]++;
+                messageChannel->SendMessage( message );
+            }
+
+            clients[i]->Update( timeBase );
+
+            while ( true )
+            {
+                auto message = messageChannel->ReceiveMessage();
+                if ( !message )
+                    break;
+                numMessagesReceived++;
+                messageFactory.Release( message );
+            }
+
+            clientUpdate.Add( core::nanoseconds() - start );
+        }
+
+        timeBase.time += timeBase.deltaTime;
+    }
+
+    const double seconds = ( core::nanoseconds() - startTime ) / 1000000000.0;
+    const uint64_t numAllocations = core::memory::num_allocations() - startAllocations;
+    const uint64_t numPackets = get_socket_counter( serverInterface, clientInterface, network::BSD_SOCKET_COUNTER_PACKETS_SENT ) - startPackets;
+    const uint64_t numBytes = get_socket_counter( serverInterface, clientInterface, network::BSD_SOCKET_COUNTER_BYTES_SENT ) - startBytes;
+
+    {
+        ProfileReport report( threaded ? "client_server_threaded" : "client_server", csv );
+
+        report.Value( "clients", NumClients );
+        report.Value( "ticks", NumTicks );
+        report.Value( "seconds", seconds );
+        report.Value( "packets_per_second", numPackets / seconds );
+        report.Value( "messages_per_second", numMessagesReceived / seconds );
+        report.Value( "bytes_per_second", numBytes / seconds );
+        report.Value( "allocations", (double) numAllocations );
+        report.Value( "allocations_per_packet", numPackets ? numAllocations / double( numPackets ) : 0.0 );
+        report.Samples( "server_update_ns", serverUpdate );
+        report.Samples( "client_update_ns", clientUpdate );
+    }
+
+    if ( bsdSocketConfig.compression )
+        report_compression_stats( csv, serverInterface, clientInterface, packetFactory.GetNumTypes() );
+
+    if ( capture )
+    {
+        CORE_CHECK( capture->Save( options.captureFilename ) );
+        printf( "captured %d packets to \"%s\"\n", capture->GetNumPackets(), options.captureFilename );
+        capture->~PacketCapture();
+        free( capture );
+    }
+
+    for ( int i = 0; i < NumClients; ++i )
+    {
+        CORE_DELETE( core::memory::default_allocator(), Client, clients[i] );
+        CORE_DELETE( core::memory::default_allocator(), BSDSocket, clientInterface[i] );
+    }
+
+    free( dictionary );
+}
+
+int main( int argc, char ** argv )
+{
+    srand( 0 );
+
+    core::memory::initialize();
+
+    if ( !network::InitializeNetwork() )
+    {
+        printf( "failed to initialize network\n" );
+        return 1;
+    }
+
+    CORE_ASSERT( network::IsNetworkInitialized() );
+
+    // run with --threaded to profile the server in threaded mode, --capture <file> to capture server packets for DictionaryTool,
+    // and --compress or --dictionary <file> to profile with packet compression
+
+    ProfileOptions options;
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--threaded" ) == 0 )
+            options.threaded = true;
+        else if ( strcmp( argv[i], "--compress" ) == 0 )
+            options.compression = true;
+        else if ( strcmp( argv[i], "--capture" ) == 0 && i + 1 < argc )
+            options.captureFilename = argv[++i];
+        else if ( strcmp( argv[i], "--dictionary" ) == 0 && i + 1 < argc )
+            options.dictionaryFilename = argv[++i];
+    }
+
+    profile_client_server( profile_csv_output( argc, argv ), options );
+
+    network::ShutdownNetwork();
+
+    core::memory::shutdown();
+
+    return 0;
+}
@@ -62,11 +62,7 @@ struct ServerInfo
 
 void soak_test()
 {
-#if PROFILE
-    printf( "[profile client server]\n" );
-#else
     printf( "[soak client server]\n" );
-#endif
 
     TestMessageFactory messageFactory( core::memory::default_allocator() );
 
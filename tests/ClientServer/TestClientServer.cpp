@@ -2317,6 +2317,128 @@ void test_server_data_too_large()
     core::memory::shutdown();
 }
 
+void test_server_data_zero_copy()
+{
+    printf( "test_server_data_zero_copy\n" );
+
+    core::memory::initialize();
+    {
+        TestMessageFactory messageFactory( core::memory::default_allocator() );
+
+        TestChannelStructure channelStructure( messageFactory );
+
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        // create a server and set it up with some server data
+
+        const int ServerDataSize = 10 * 1024 + 11;
+
+        protocol::Block serverData( core::memory::default_allocator(), ServerDataSize );
+        {
+            uint8_t * data = serverData.GetData();
+            for ( int i = 0; i < ServerDataSize; ++i )
+                data[i] = ( 10 + i ) % 256;
+        }
+
+        network::BSDSocketConfig bsdSocketConfig;
+        bsdSocketConfig.port = 10000;
+        bsdSocketConfig.maxPacketSize = 1200;
+        bsdSocketConfig.packetFactory = &packetFactory;
+        bsdSocketConfig.zeroCopy = true;
+
+        network::BSDSocket serverNetworkInterface( bsdSocketConfig );
+
+        clientServer::ServerConfig serverConfig;
+        serverConfig.serverData = &serverData;
+        serverConfig.channelStructure = &channelStructure;
+        serverConfig.networkInterface = &serverNetworkInterface;
+
+        clientServer::Server server( serverConfig );
+
+        CORE_CHECK( server.IsOpen() );
+
+        // connect a client to the server and wait the connect to complete
+
+        bsdSocketConfig.port = 10001;
+        bsdSocketConfig.maxPacketSize = 1200;
+        bsdSocketConfig.packetFactory = &packetFactory;
+
+        network::BSDSocket clientNetworkInterface( bsdSocketConfig );
+
+        clientServer::ClientConfig clientConfig;
+        clientConfig.channelStructure = &channelStructure;
+        clientConfig.networkInterface = &clientNetworkInterface;
+
+        clientServer::Client client( clientConfig );
+
+        client.Connect( "[::1]:10000" );
+
+        CORE_CHECK( client.IsConnecting() );
+        CORE_CHECK( !client.IsDisconnected() );
+        CORE_CHECK( !client.IsConnected() );
+        CORE_CHECK( !client.HasError() );
+        CORE_CHECK( client.GetState() == clientServer::CLIENT_STATE_SENDING_CONNECTION_REQUEST );
+
+        core::TimeBase timeBase;
+        timeBase.deltaTime = 0.01f;
+
+        const int clientIndex = 0;
+
+        int iteration = 0;
+
+        while ( true )
+        {
+            if ( client.GetState() == clientServer::CLIENT_STATE_CONNECTED && server.GetClientState( clientIndex ) == clientServer::SERVER_CLIENT_STATE_CONNECTED )
+                break;
+
+            client.Update( timeBase );
+
+            server.Update( timeBase );
+
+            timeBase.time += timeBase.deltaTime;
+
+            sleep_after_too_many_iterations( iteration );
+        }
+
+        CORE_CHECK( server.GetClientState( clientIndex ) == clientServer::SERVER_CLIENT_STATE_CONNECTED );
+        CORE_CHECK( !client.IsDisconnected() );
+        CORE_CHECK( !client.IsConnecting() );
+        CORE_CHECK( client.IsConnected() );
+        CORE_CHECK( !client.HasError() );
+        CORE_CHECK( client.GetState() == clientServer::CLIENT_STATE_CONNECTED );
+        CORE_CHECK( client.GetError() == clientServer::CLIENT_ERROR_NONE );
+        CORE_CHECK( client.GetExtendedError() == 0 );
+
+        // verify there is no client data on the server
+
+        CORE_CHECK( server.GetClientData( clientIndex ) == nullptr );
+
+        // verify the client has received the server block
+
+        const protocol::Block * clientServerData = client.GetServerData();
+
+        CORE_CHECK( clientServerData );
+        CORE_CHECK( clientServerData->IsValid() );
+        CORE_CHECK( clientServerData->GetData() );
+        CORE_CHECK( clientServerData->GetSize() == ServerDataSize );
+        {
+            const uint8_t * data = clientServerData->GetData();
+            for ( int i = 0; i < ServerDataSize; ++i )
+                CORE_CHECK( data[i] == ( 10 + i ) % 256 );
+        }
+
+        // fragments were read in place, and packet buffers are reused once the packets read from them are destroyed
+
+        const uint64_t numBuffersAllocated = clientNetworkInterface.GetCounter( network::BSD_SOCKET_COUNTER_RECEIVE_BUFFERS_ALLOCATED );
+        const uint64_t numPacketsReceived = clientNetworkInterface.GetCounter( network::BSD_SOCKET_COUNTER_PACKETS_RECEIVED );
+
+        CORE_CHECK( numBuffersAllocated > 0 );
+        CORE_CHECK( numBuffersAllocated < numPacketsReceived );
+    }
+
+    core::memory::shutdown();
+}
+
 void test_client_server_user_context()
 {
     printf( "test_client_server_user_context\n" );
@@ -2474,6 +2596,213 @@ void test_client_server_user_context()
     }
 }
 
+void test_server_threaded()
+{
+    printf( "test_server_threaded\n" );
+
+    core::memory::initialize();
+    {
+        TestMessageFactory messageFactory( core::memory::default_allocator() );
+
+        TestChannelStructure channelStructure( messageFactory );
+
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        // create a threaded server on port 10000 with more clients than shards
+
+        network::BSDSocketConfig bsdSocketConfig;
+        bsdSocketConfig.port = 10000;
+        bsdSocketConfig.maxPacketSize = 1200;
+        bsdSocketConfig.packetFactory = &packetFactory;
+
+        network::BSDSocket serverNetworkInterface( bsdSocketConfig );
+
+        const int NumClients = 5;
+
+        const int ServerDataSize = 2 * 1024 + 11;
+
+        protocol::Block serverData( core::memory::default_allocator(), ServerDataSize );
+        {
+            uint8_t * data = serverData.GetData();
+            for ( int i = 0; i < ServerDataSize; ++i )
+                data[i] = ( 10 + i ) % 256;
+        }
+
+        clientServer::ServerConfig serverConfig;
+        serverConfig.serverData = &serverData;
+        serverConfig.maxClients = NumClients;
+        serverConfig.channelStructure = &channelStructure;
+        serverConfig.networkInterface = &serverNetworkInterface;
+        serverConfig.threaded = true;
+        serverConfig.numWorkerThreads = 2;
+
+        clientServer::Server server( serverConfig );
+
+        CORE_CHECK( server.IsOpen() );
+
+        clientServer::Client * clients[NumClients];
+
+        network::Interface * clientInterface[NumClients];
+
+        bsdSocketConfig.port = 0;
+
+        for ( int i = 0; i < NumClients; ++i )
+        {
+            clientInterface[i] = CORE_NEW( core::memory::default_allocator(), network::BSDSocket, bsdSocketConfig );
+
+            clientServer::ClientConfig clientConfig;
+            clientConfig.channelStructure = &channelStructure;
+            clientConfig.networkInterface = clientInterface[i];
+
+            clients[i] = CORE_NEW( core::memory::default_allocator(), clientServer::Client, clientConfig );
+
+            clients[i]->Connect( "[::1]:10000" );
+        }
+
+        core::TimeBase timeBase;
+        timeBase.deltaTime = 0.01f;
+
+        int iteration = 0;
+
+        while ( true )
+        {
+            int numConnectedClients = 0;
+            for ( int i = 0; i < NumClients; ++i )
+            {
+                if ( clients[i]->IsConnected() && server.GetClientState( i ) == clientServer::SERVER_CLIENT_STATE_CONNECTED )
+                    numConnectedClients++;
+
+                clients[i]->Update( timeBase );
+            }
+
+            if ( numConnectedClients == NumClients )
+                break;
+
+            server.Update( timeBase );
+
+            timeBase.time += timeBase.deltaTime;
+
+            sleep_after_too_many_iterations( iteration );
+        }
+
+        for ( int i = 0; i < NumClients; ++i )
+        {
+            const protocol::Block * clientServerData = clients[i]->GetServerData();
+            CORE_CHECK( clientServerData );
+            CORE_CHECK( clientServerData->GetSize() == ServerDataSize );
+            const uint8_t * data = clientServerData->GetData();
+            for ( int j = 0; j < ServerDataSize; ++j )
+                CORE_CHECK( data[j] == ( 10 + j ) % 256 );
+        }
+
+        // exchange messages both ways with every client. server connections are updated on worker threads
+
+        const int NumMessagesSent = 64;
+
+        int numMessagesReceivedOnClient[NumClients];
+        int numMessagesReceivedOnServer[NumClients];
+
+        for ( int i = 0; i < NumClients; ++i )
+        {
+            auto clientMessageChannel = static_cast<protocol::ReliableMessageChannel*>( clients[i]->GetConnection()->GetChannel( 0 ) );
+            auto serverMessageChannel = static_cast<protocol::ReliableMessageChannel*>( server.GetClientConnection( i )->GetChannel( 0 ) );
+
+            for ( int j = 0; j < NumMessagesSent; ++j )
+            {
+                auto message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+                message->sequence = j;
+                clientMessageChannel->SendMessage( message );
+
+                message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+                message->sequence = j;
+                serverMessageChannel->SendMessage( message );
+            }
+
+            numMessagesReceivedOnClient[i] = 0;
+            numMessagesReceivedOnServer[i] = 0;
+        }
+
+        iteration = 0;
+
+        while ( true )
+        {
+            bool done = true;
+
+            for ( int i = 0; i < NumClients; ++i )
+            {
+                clients[i]->Update( timeBase );
+
+                CORE_CHECK( clients[i]->IsConnected() );
+
+                auto clientMessageChannel = static_cast<protocol::ReliableMessageChannel*>( clients[i]->GetConnection()->GetChannel( 0 ) );
+
+                while ( auto message = clientMessageChannel->ReceiveMessage() )
+                {
+                    CORE_CHECK( static_cast<TestMessage*>( message )->sequence == numMessagesReceivedOnClient[i] );
+                    ++numMessagesReceivedOnClient[i];
+                    messageFactory.Release( message );
+                }
+            }
+
+            server.Update( timeBase );
+
+            for ( int i = 0; i < NumClients; ++i )
+            {
+                CORE_CHECK( server.GetClientState( i ) == clientServer::SERVER_CLIENT_STATE_CONNECTED );
+
+                auto serverMessageChannel = static_cast<protocol::ReliableMessageChannel*>( server.GetClientConnection( i )->GetChannel( 0 ) );
+
+                while ( auto message = serverMessageChannel->ReceiveMessage() )
+                {
+                    CORE_CHECK( static_cast<TestMessage*>( message )->sequence == numMessagesReceivedOnServer[i] );
+                    ++numMessagesReceivedOnServer[i];
+                    messageFactory.Release( message );
+                }
+
+                if ( numMessagesReceivedOnClient[i] != NumMessagesSent || numMessagesReceivedOnServer[i] != NumMessagesSent )
+                    done = false;
+            }
+
+            if ( done )
+                break;
+
+            timeBase.time += timeBase.deltaTime;
+
+            sleep_after_too_many_iterations( iteration );
+        }
+
+        // disconnect one client and make sure the server frees its slot on the main thread
+
+        clients[0]->Disconnect();
+
+        iteration = 0;
+
+        while ( server.GetClientState( 0 ) != clientServer::SERVER_CLIENT_STATE_DISCONNECTED )
+        {
+            for ( int i = 1; i < NumClients; ++i )
+                clients[i]->Update( timeBase );
+
+            server.Update( timeBase );
+
+            timeBase.time += timeBase.deltaTime;
+
+            sleep_after_too_many_iterations( iteration );
+        }
+
+        for ( int i = 1; i < NumClients; ++i )
+            CORE_CHECK( server.GetClientState( i ) == clientServer::SERVER_CLIENT_STATE_CONNECTED );
+
+        for ( int i = 0; i < NumClients; ++i )
+        {
+            typedef network::Interface NetworkInterface;
+            CORE_DELETE( core::memory::default_allocator(), Client, clients[i] );
+            CORE_DELETE( core::memory::default_allocator(), NetworkInterface, clientInterface[i] );
+        }
+    }
+
+    core::memory::shutdown(); 
+}
+
 int main()
 {
     srand( time( nullptr ) );
@@ -2513,9 +2842,12 @@ int main()
     test_client_and_server_data_reconnect();
     test_client_and_server_data_multiple_clients();
     test_server_data_too_large();
+    test_server_data_zero_copy();
 
     test_client_server_user_context();
 
+    test_server_threaded();
+
     network::ShutdownNetwork();
 
     return 0;
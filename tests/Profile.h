@@ -0,0 +1,137 @@
+#ifndef TESTS_PROFILE_H
+#define TESTS_PROFILE_H
+
+#include "core/Core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+/*
+    Helpers shared by the Profile* executables.
+
+    Results are written to stdout as a single JSON object, or as "name,metric,value"
+    CSV lines when run with --csv, so runs from different builds can be diffed by script.
+*/
+
+inline bool profile_csv_output( int argc, char ** argv )
+{
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--csv" ) == 0 )
+            return true;
+    }
+    return false;
+}
+
+class ProfileSamples
+{
+    // IMPORTANT: samples are stored with malloc directly so profile bookkeeping does not show up in core::memory::num_allocations
+
+    uint64_t * m_samples;
+    int m_numSamples;
+    int m_maxSamples;
+    uint64_t m_total;
+    uint64_t m_count;
+
+    ProfileSamples( const ProfileSamples & other );
+    ProfileSamples & operator = ( const ProfileSamples & other );
+
+public:
+
+    ProfileSamples( int maxSamples = 1024 * 1024 )
+    {
+        CORE_ASSERT( maxSamples > 0 );
+        m_samples = (uint64_t*) malloc( sizeof( uint64_t ) * maxSamples );
+        m_maxSamples = maxSamples;
+        Reset();
+    }
+
+    ~ProfileSamples()
+    {
+        free( m_samples );
+        m_samples = nullptr;
+    }
+
+    void Reset()
+    {
+        m_numSamples = 0;
+        m_total = 0;
+        m_count = 0;
+    }
+
+    void Add( uint64_t value )
+    {
+        // once the sample buffer is full, overwrite samples round robin so percentiles track the whole run
+
+        if ( m_numSamples < m_maxSamples )
+            m_samples[m_numSamples++] = value;
+        else
+            m_samples[m_count % m_maxSamples] = value;
+
+        m_total += value;
+        m_count++;
+    }
+
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+
+    double GetMean() const
+    {
+        return m_count ? m_total / double( m_count ) : 0.0;
+    }
+
+    uint64_t GetPercentile( double percentile )
+    {
+        if ( m_numSamples == 0 )
+            return 0;
+        int index = int( percentile / 100.0 * ( m_numSamples - 1 ) + 0.5 );
+        index = core::clamp( index, 0, m_numSamples - 1 );
+        std::nth_element( m_samples, m_samples + index, m_samples + m_numSamples );
+        return m_samples[index];
+    }
+};
+
+class ProfileReport
+{
+    const char * m_name;
+    bool m_csv;
+
+public:
+
+    ProfileReport( const char * name, bool csv ) : m_name( name ), m_csv( csv )
+    {
+        if ( !m_csv )
+            printf( "{\n    \"name\": \"%s\"", m_name );
+    }
+
+    ~ProfileReport()
+    {
+        if ( !m_csv )
+            printf( "\n}\n" );
+        fflush( stdout );
+    }
+
+    void Value( const char * metric, double value )
+    {
+        if ( m_csv )
+            printf( "%s,%s,%.3f\n", m_name, metric, value );
+        else
+            printf( ",\n    \"%s\": %.3f", metric, value );
+    }
+
+    void Samples( const char * metric, ProfileSamples & samples )
+    {
+        char buffer[256];
+        snprintf( buffer, sizeof( buffer ), "%s_mean", metric );
+        Value( buffer, samples.GetMean() );
+        snprintf( buffer, sizeof( buffer ), "%s_p50", metric );
+        Value( buffer, (double) samples.GetPercentile( 50.0 ) );
+        snprintf( buffer, sizeof( buffer ), "%s_p99", metric );
+        Value( buffer, (double) samples.GetPercentile( 99.0 ) );
+    }
+};
+
+#endif
@@ -3,9 +3,13 @@
 #include "core/Array.h"
 #include "core/Hash.h"
 #include "core/Queue.h"
+#include "core/PoolAllocator.h"
+#include "core/JobSystem.h"
 #include <string.h>
 #include <algorithm>
 #include <time.h>
+#include <thread>
+#include <atomic>
 
 void test_sequence()
 {
@@ -241,6 +245,27 @@ void test_multi_hash()
         CORE_CHECK( core::multi_hash::count( h, 0 ) == 2 );
         core::multi_hash::remove_all( h, 0 );
         CORE_CHECK( core::multi_hash::count( h, 0 ) == 0 );
+
+        // removing entries from the middle must keep every other entry reachable and not grow the data
+
+        for ( int i = 0; i < 8; ++i )
+            core::multi_hash::insert( h, i % 2, i );
+
+        for ( int i = 0; i < 100; ++i )
+        {
+            auto e = core::multi_hash::find_first( h, 0 );
+            const int value = e->value;
+            core::multi_hash::remove( h, e );
+            core::multi_hash::insert( h, 0, value );
+            CORE_CHECK( core::array::size( h._data ) == 8 );
+            CORE_CHECK( core::multi_hash::count( h, 0 ) == 4 );
+            CORE_CHECK( core::multi_hash::count( h, 1 ) == 4 );
+        }
+
+        core::array::clear( a );
+        core::multi_hash::get( h, 1, a );
+        std::sort( core::array::begin(a), core::array::end(a) );
+        CORE_CHECK( a[0] == 1 && a[1] == 3 && a[2] == 5 && a[3] == 7 );
     }
     core::memory::shutdown();
 }
@@ -315,6 +340,246 @@ void test_pointer_arithmetic()
     }
 }
 
+void test_pool_allocator()
+{
+    printf( "test_pool_allocator\n" );
+
+    core::memory::initialize();
+    {
+        core::PoolAllocator pool( core::memory::default_allocator(), 1024, 4096 );
+
+        const int NumBlocks = 256;
+
+        void * blocks[NumBlocks];
+
+        for ( int i = 0; i < NumBlocks; ++i )
+        {
+            const uint32_t size = 1 + ( i * 7 ) % 1024;
+            blocks[i] = pool.Allocate( size, 16 );
+            CORE_CHECK( blocks[i] );
+            CORE_CHECK( ( uintptr_t( blocks[i] ) % 16 ) == 0 );
+            CORE_CHECK( pool.GetAllocatedSize( blocks[i] ) >= size );
+            memset( blocks[i], i & 0xFF, size );
+        }
+
+        for ( int i = 0; i < NumBlocks; ++i )
+        {
+            const uint32_t size = 1 + ( i * 7 ) % 1024;
+            const uint8_t * data = (const uint8_t*) blocks[i];
+            for ( uint32_t j = 0; j < size; ++j )
+                CORE_CHECK( data[j] == ( i & 0xFF ) );
+        }
+
+        for ( int i = 0; i < NumBlocks; ++i )
+            pool.Free( blocks[i] );
+
+        CORE_CHECK( pool.GetTotalAllocated() == 0 );
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_ALLOCATIONS ) == NumBlocks );
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_FREES ) == NumBlocks );
+
+        // once the working set has been allocated, freed blocks are reused without growing
+
+        const uint64_t numChunks = pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_CHUNK_ALLOCATIONS );
+        const uint64_t numAllocations = core::memory::num_allocations();
+
+        for ( int i = 0; i < NumBlocks; ++i )
+            blocks[i] = pool.Allocate( 1 + ( i * 7 ) % 1024 );
+
+        for ( int i = 0; i < NumBlocks; ++i )
+            pool.Free( blocks[i] );
+
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_CHUNK_ALLOCATIONS ) == numChunks );
+        CORE_CHECK( core::memory::num_allocations() == numAllocations );
+
+        // allocations larger than the largest size class pass through to the backing allocator
+
+        void * large = pool.Allocate( 64 * 1024 );
+        CORE_CHECK( large );
+        CORE_CHECK( pool.GetAllocatedSize( large ) == 64 * 1024 );
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_OVERSIZE_ALLOCATIONS ) == 1 );
+        pool.Free( large );
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_OVERSIZE_FREES ) == 1 );
+
+        // so do allocations needing more than header alignment, however small
+
+        for ( uint32_t align = 32; align <= 256; align *= 2 )
+        {
+            void * aligned = pool.Allocate( 40, align );
+            CORE_CHECK( aligned );
+            CORE_CHECK( ( uintptr_t( aligned ) & ( align - 1 ) ) == 0 );
+            CORE_CHECK( pool.GetAllocatedSize( aligned ) == 40 );
+            memset( aligned, 0xFF, 40 );
+            pool.Free( aligned );
+        }
+
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_OVERSIZE_ALLOCATIONS ) == 5 );
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_OVERSIZE_FREES ) == 5 );
+
+        CORE_CHECK( pool.GetTotalAllocated() == 0 );
+    }
+    core::memory::shutdown();
+}
+
+void test_pool_allocator_threads()
+{
+    printf( "test_pool_allocator_threads\n" );
+
+    core::memory::initialize();
+    {
+        core::PoolAllocator pool( core::memory::default_allocator(), 256, 1024 );
+
+        const int NumThreads = 4;
+        const int NumIterations = 20000;
+
+        std::atomic<int> numErrors( 0 );
+
+        std::thread threads[NumThreads];
+
+        for ( int t = 0; t < NumThreads; ++t )
+        {
+            threads[t] = std::thread( [&pool, &numErrors, t]()
+            {
+                const int MaxLive = 32;
+                uint32_t * live[MaxLive];
+                memset( live, 0, sizeof( live ) );
+
+                for ( int i = 0; i < NumIterations; ++i )
+                {
+                    const int index = ( i * 13 + t ) % MaxLive;
+
+                    if ( live[index] )
+                    {
+                        if ( live[index][0] != uint32_t( t ) || live[index][1] != uint32_t( index ) )
+                            numErrors++;
+                        pool.Free( live[index] );
+                        live[index] = nullptr;
+                    }
+                    else
+                    {
+                        live[index] = (uint32_t*) pool.Allocate( 8 + ( i % 200 ) );
+                        live[index][0] = t;
+                        live[index][1] = index;
+                    }
+                }
+
+                for ( int i = 0; i < MaxLive; ++i )
+                    pool.Free( live[i] );
+            } );
+        }
+
+        for ( int t = 0; t < NumThreads; ++t )
+            threads[t].join();
+
+        CORE_CHECK( numErrors == 0 );
+        CORE_CHECK( pool.GetTotalAllocated() == 0 );
+        CORE_CHECK( pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_ALLOCATIONS ) == pool.GetCounter( core::POOL_ALLOCATOR_COUNTER_FREES ) );
+    }
+    core::memory::shutdown();
+}
+
+struct JobTestData
+{
+    core::JobSystem * jobSystem;
+    std::atomic<int> * runs;
+    std::atomic<int> numNestedRuns;
+};
+
+static void job_test_count( void * data, int index )
+{
+    auto testData = (JobTestData*) data;
+    testData->runs[index]++;
+}
+
+static void job_test_nested( void * data, int index )
+{
+    // jobs may add jobs and wait for them from inside a job
+
+    auto testData = (JobTestData*) data;
+    testData->runs[index]++;
+
+    core::JobCounter counter;
+    testData->jobSystem->Run( []( void * data, int ) { ( (JobTestData*) data )->numNestedRuns++; }, data, 8, counter );
+    testData->jobSystem->Wait( counter );
+}
+
+void test_job_system()
+{
+    printf( "test_job_system\n" );
+
+    core::memory::initialize();
+    {
+        const int NumJobs = 10000;
+
+        std::atomic<int> * runs = new std::atomic<int>[NumJobs];
+
+        const int numThreads[] = { 1, 2, 4, 0 };
+
+        for ( int i = 0; i < int( sizeof( numThreads ) / sizeof( int ) ); ++i )
+        {
+            core::JobSystemConfig config;
+            config.numThreads = numThreads[i];
+            config.queueSize = 256;
+
+            core::JobSystem jobSystem( config );
+
+            CORE_CHECK( jobSystem.GetNumThreads() >= 1 );
+            if ( numThreads[i] > 0 )
+                CORE_CHECK( jobSystem.GetNumThreads() == numThreads[i] );
+
+            JobTestData data;
+            data.jobSystem = &jobSystem;
+            data.runs = runs;
+            data.numNestedRuns = 0;
+
+            // more jobs than fit in the queues, so some run inline
+
+            for ( int j = 0; j < NumJobs; ++j )
+                runs[j] = 0;
+
+            jobSystem.ParallelFor( job_test_count, &data, NumJobs );
+
+            for ( int j = 0; j < NumJobs; ++j )
+                CORE_CHECK( runs[j] == 1 );
+
+            CORE_CHECK( jobSystem.GetCounter( core::JOB_SYSTEM_COUNTER_QUEUE_FULL ) > 0 );
+
+            // two counters in flight at once
+
+            for ( int j = 0; j < NumJobs; ++j )
+                runs[j] = 0;
+
+            core::JobCounter a, b;
+            jobSystem.Run( job_test_count, &data, 100, a );
+            jobSystem.Run( job_test_count, &data, 200, b );
+            jobSystem.Wait( b );
+            jobSystem.Wait( a );
+
+            for ( int j = 0; j < 200; ++j )
+                CORE_CHECK( runs[j] == ( j < 100 ? 2 : 1 ) );
+
+            CORE_CHECK( a.value == 0 );
+            CORE_CHECK( b.value == 0 );
+
+            // nested jobs
+
+            for ( int j = 0; j < NumJobs; ++j )
+                runs[j] = 0;
+
+            jobSystem.ParallelFor( job_test_nested, &data, 64 );
+
+            for ( int j = 0; j < 64; ++j )
+                CORE_CHECK( runs[j] == 1 );
+
+            CORE_CHECK( data.numNestedRuns == 64 * 8 );
+
+            jobSystem.ParallelFor( job_test_count, &data, 0 );
+        }
+
+        delete [] runs;
+    }
+    core::memory::shutdown();
+}
+
 int main()
 {
     srand( (uint32_t) time( nullptr ) );
@@ -322,6 +587,9 @@ int main()
     test_memory();
     test_scratch();
     test_temp_allocator();
+    test_pool_allocator();
+    test_pool_allocator_threads();
+    test_job_system();
     test_array();
     test_hash();
     test_multi_hash();
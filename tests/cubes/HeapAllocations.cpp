@@ -0,0 +1,42 @@
+#include "HeapAllocations.h"
+#include <new>
+#include <stdlib.h>
+
+// replaces the global operators to count heap allocations. kept in its own file so the
+// compiler never sees operator new and free together and warns about mismatched pairs
+
+std::atomic<uint64_t> num_heap_allocations( 0 );
+
+void * operator new( size_t size )
+{
+	num_heap_allocations++;
+	void * p = malloc( size ? size : 1 );
+	if ( !p )
+		throw std::bad_alloc();
+	return p;
+}
+
+void * operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+void operator delete( void * p ) noexcept
+{
+	free( p );
+}
+
+void operator delete[]( void * p ) noexcept
+{
+	operator delete( p );
+}
+
+void operator delete( void * p, size_t ) noexcept
+{
+	operator delete( p );
+}
+
+void operator delete[]( void * p, size_t ) noexcept
+{
+	operator delete( p );
+}
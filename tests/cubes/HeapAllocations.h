@@ -0,0 +1,11 @@
+#ifndef TEST_CUBES_HEAP_ALLOCATIONS_H
+#define TEST_CUBES_HEAP_ALLOCATIONS_H
+
+#include <atomic>
+#include <stdint.h>
+
+// number of global operator new calls so far, so benchmarks can check for per-frame heap traffic
+
+extern std::atomic<uint64_t> num_heap_allocations;
+
+#endif
@@ -2,6 +2,10 @@
 #include "cubes/Activation.h"
 #include "cubes/Engine.h"
 #include "cubes/Game.h"
+#include "cubes/Hypercube.h"
+#include "tests/Profile.h"
+#include "HeapAllocations.h"
+#include <time.h>
 
 // todo: convert from cubes to hypercube
 
@@ -801,7 +805,604 @@ int main()
 }
 */
 
+typedef game::Instance<hypercube::DatabaseObject, hypercube::ActiveObject> HypercubeInstance;
+
+class ProfileInstance : public HypercubeInstance
+{
+public:
+
+	ProfileInstance( const game::Config & config ) : HypercubeInstance( config ) {}
+
+	using HypercubeInstance::UpdateAuthority;
+};
+
+static void add_hypercube( HypercubeInstance * gameInstance, bool player, const math::Vector & position )
+{
+	hypercube::DatabaseObject object;
+	cubes::CompressPosition( position, object.position );
+	cubes::CompressOrientation( math::Quaternion(1,0,0,0), object.orientation );
+	object.enabled = 1;
+	object.session = 0;
+	object.player = player;
+	gameInstance->AddObject( object, position.x, position.y );
+}
+
+static ProfileInstance * create_pile_world( int pileSize, int pileLayers )
+{
+	// one pile of cubes per player with the player cube sitting on top, so pushing floods authority through the whole pile
+
+	const float spacing = hypercube::NonPlayerCubeSize * 1.05f;
+	const float pileWidth = pileSize * spacing;
+	const int numCubes = MaxPlayers * pileSize * pileSize * pileLayers;
+
+	game::Config config;
+	config.maxObjects = numCubes + MaxPlayers + 1;
+	config.initialActiveObjects = config.maxObjects;
+	config.initialObjectsPerCell = 256;
+	config.activationDistance = 1000.0f;
+	config.cellSize = 4.0f;
+	config.cellWidth = int( ( pileWidth + 4.0f ) * MaxPlayers / config.cellSize ) * 2 + 4;
+	config.cellHeight = int( ( pileWidth + 4.0f ) / config.cellSize ) * 2 + 4;
+
+	auto gameInstance = new ProfileInstance( config );
+
+	gameInstance->InitializeBegin();
+
+	gameInstance->AddPlane( math::Vector(0,0,1), 0 );
+
+	const float pileOrigin = - ( pileWidth + 4.0f ) * MaxPlayers / 2.0f;
+
+	for ( int playerId = 0; playerId < MaxPlayers; ++playerId )
+	{
+		const float x = pileOrigin + ( pileWidth + 4.0f ) * playerId + pileWidth / 2;
+		add_hypercube( gameInstance, true, math::Vector( x, 0, pileLayers * spacing + hypercube::PlayerCubeSize / 2 ) );
+	}
+
+	for ( int playerId = 0; playerId < MaxPlayers; ++playerId )
+	{
+		const float x0 = pileOrigin + ( pileWidth + 4.0f ) * playerId;
+		for ( int z = 0; z < pileLayers; ++z )
+			for ( int y = 0; y < pileSize; ++y )
+				for ( int x = 0; x < pileSize; ++x )
+					add_hypercube( gameInstance, false, math::Vector( x0 + ( x + 0.5f ) * spacing, ( y + 0.5f ) * spacing - pileWidth / 2, ( z + 0.5f ) * spacing ) );
+	}
+
+	gameInstance->InitializeEnd();
+
+	for ( int playerId = 0; playerId < MaxPlayers; ++playerId )
+	{
+		gameInstance->OnPlayerJoined( playerId );
+		gameInstance->SetPlayerFocus( playerId, playerId + 1 );
+	}
+
+	gameInstance->SetLocalPlayer( 0 );
+	gameInstance->SetFlag( game::FLAG_Push );
+
+	return gameInstance;
+}
+
+void profile_authority()
+{
+	printf( "profile_authority\n" );
+
+	const int NumWarmupFrames = 10;
+	const int NumFrames = 30;
+
+	auto gameInstance = create_pile_world( 40, 2 );
+
+	game::Input input;
+	input.push = true;
+	input.right = true;
+	for ( int playerId = 0; playerId < MaxPlayers; ++playerId )
+		gameInstance->SetPlayerInput( playerId, input );
+
+	for ( int i = 0; i < NumWarmupFrames; ++i )
+		gameInstance->Update( 1.0f / 60.0f );
+
+	ProfileSamples authority;
+	uint64_t allocations = 0;
+
+	for ( int i = 0; i < NumFrames; ++i )
+	{
+		gameInstance->Update( 1.0f / 60.0f );
+
+		const uint64_t startAllocations = num_heap_allocations;
+		const uint64_t start = core::nanoseconds();
+		gameInstance->UpdateAuthority( 1.0f / 60.0f );
+		authority.Add( core::nanoseconds() - start );
+		allocations += num_heap_allocations - startAllocations;
+	}
+
+	int numPlayerAuthority = 0;
+	for ( int i = 0; i < gameInstance->GetNumActiveObjects(); ++i )
+	{
+		if ( gameInstance->GetActiveObject( i ).authority < MaxPlayers )
+			numPlayerAuthority++;
+	}
+
+	{
+		ProfileReport report( "update_authority", false );
+		report.Value( "players", MaxPlayers );
+		report.Value( "active_objects", gameInstance->GetNumActiveObjects() );
+		report.Value( "player_authority_objects", numPlayerAuthority );
+		report.Value( "heap_allocations", (double) allocations );
+		report.Samples( "update_authority_ns", authority );
+	}
+
+	// the pile is touching the player cube, so authority must have flooded out past the player cubes
+
+	CORE_CHECK( numPlayerAuthority > MaxPlayers );
+	CORE_CHECK( allocations == 0 );
+
+	delete gameInstance;
+}
+
+void profile_interactions()
+{
+	printf( "profile_interactions\n" );
+
+	const int NumWarmupFrames = 10;
+	const int NumFrames = 30;
+
+	auto gameInstance = create_pile_world( 40, 2 );
+
+	game::Input input;
+	input.push = true;
+	for ( int playerId = 0; playerId < MaxPlayers; ++playerId )
+		gameInstance->SetPlayerInput( playerId, input );
+
+	for ( int i = 0; i < NumWarmupFrames; ++i )
+		gameInstance->Update( 1.0f / 60.0f );
+
+	cubes::Simulation * simulation = gameInstance->GetSimulation();
+
+	ProfileSamples update;
+	uint64_t allocations = 0;
+
+	for ( int i = 0; i < NumFrames; ++i )
+	{
+		const uint64_t startAllocations = num_heap_allocations;
+		const uint64_t start = core::nanoseconds();
+		simulation->Update( 1.0f / 60.0f );
+		update.Add( core::nanoseconds() - start );
+		allocations += num_heap_allocations - startAllocations;
+	}
+
+	// every pair must show up once in the interaction list of each object in it
+
+	const int numPairs = simulation->GetNumInteractionPairs();
+
+	int numInteractions = 0;
+	for ( int i = 0; i < gameInstance->GetNumActiveObjects(); ++i )
+	{
+		const int activeId = gameInstance->GetActiveObject( i ).activeId;
+		const cubes::ObjectInteractions interactions = simulation->GetObjectInteractions( activeId );
+		for ( int j = 0; j < interactions.size(); ++j )
+		{
+			const cubes::ObjectInteractions other = simulation->GetObjectInteractions( interactions[j] );
+			bool found = false;
+			for ( uint16_t id : other )
+				found |= id == activeId;
+			CORE_CHECK( found );
+		}
+		numInteractions += interactions.size();
+	}
+
+	{
+		ProfileReport report( "simulation_interactions", false );
+		report.Value( "active_objects", gameInstance->GetNumActiveObjects() );
+		report.Value( "interaction_pairs", numPairs );
+		report.Value( "heap_allocations", (double) allocations );
+		report.Samples( "simulation_update_ns", update );
+	}
+
+	CORE_CHECK( numPairs > 0 );
+	CORE_CHECK( numInteractions == numPairs * 2 );
+	CORE_CHECK( allocations == 0 );
+
+	delete gameInstance;
+}
+
+void test_activation_incremental()
+{
+	printf( "test_activation_incremental\n" );
+
+	// wander the activation point around with the odd jump while objects move, and check
+	// the active set always matches a brute force distance test against every object
+
+	const float activation_radius = 10.0f;
+	const int grid_width = 64;
+	const int grid_height = 64;
+	const float cell_size = 1.0f;
+	const int NumObjects = 1000;
+	const float range = 30.0f;
+
+	activation::ActivationSystem activationSystem( NumObjects + 1, activation_radius, grid_width, grid_height, cell_size, 4, 32 );
+
+	std::vector<float> x( NumObjects + 1 );
+	std::vector<float> y( NumObjects + 1 );
+
+	for ( int id = 1; id <= NumObjects; ++id )
+	{
+		x[id] = math::random_float( -range, +range );
+		y[id] = math::random_float( -range, +range );
+		activationSystem.InsertObject( id, x[id], y[id] );
+	}
+
+	float activation_x = 0.0f;
+	float activation_y = 0.0f;
+
+	for ( int i = 0; i < 200; ++i )
+	{
+		if ( math::random( 20 ) == 0 )
+		{
+			activation_x = math::random_float( -range, +range );
+			activation_y = math::random_float( -range, +range );
+		}
+		else
+		{
+			activation_x = math::clamp( activation_x + math::random_float( -1.0f, +1.0f ), -range, +range );
+			activation_y = math::clamp( activation_y + math::random_float( -1.0f, +1.0f ), -range, +range );
+		}
+
+		activationSystem.MoveActivationPoint( activation_x, activation_y );
+
+		const int numMoves = math::random( 20 );
+		for ( int j = 0; j < numMoves; ++j )
+		{
+			const int id = 1 + math::random( NumObjects );
+			x[id] = math::clamp( x[id] + math::random_float( -5.0f, +5.0f ), -range, +range );
+			y[id] = math::clamp( y[id] + math::random_float( -5.0f, +5.0f ), -range, +range );
+			activationSystem.MoveObject( id, x[id], y[id] );
+		}
+
+		activationSystem.Update( 0.1f );
+		activationSystem.ClearEvents();
+
+		int numInside = 0;
+		for ( int id = 1; id <= NumObjects; ++id )
+		{
+			const float dx = x[id] - activation_x;
+			const float dy = y[id] - activation_y;
+			const bool inside = dx*dx + dy*dy < activation_radius * activation_radius;
+			CORE_CHECK( activationSystem.IsActive( id ) == inside );
+			if ( inside )
+				numInside++;
+		}
+		CORE_CHECK( activationSystem.GetActiveCount() == numInside );
+	}
+}
+
+void test_activation_points()
+{
+	printf( "test_activation_points\n" );
+
+	// several activation points wander around, jump and switch on and off while objects move. the active set
+	// must always match a brute force test against every enabled circle, and each object must alternate
+	// between activate and deactivate events however many circles contain it
+
+	const float activation_radius = 8.0f;
+	const int grid_width = 64;
+	const int grid_height = 64;
+	const float cell_size = 1.0f;
+	const int NumObjects = 1000;
+	const int NumPoints = 8;
+	const float range = 30.0f;
+
+	activation::ActivationSystem activationSystem( NumObjects + 1, activation_radius, grid_width, grid_height, cell_size, 4, 32, 0.0f, NumPoints );
+
+	CORE_CHECK( activationSystem.GetNumActivationPoints() == NumPoints );
+
+	std::vector<float> x( NumObjects + 1 );
+	std::vector<float> y( NumObjects + 1 );
+	std::vector<bool> activated( NumObjects + 1, false );
+
+	for ( int id = 1; id <= NumObjects; ++id )
+	{
+		x[id] = math::random_float( -range, +range );
+		y[id] = math::random_float( -range, +range );
+		activationSystem.InsertObject( id, x[id], y[id] );
+	}
+
+	for ( int i = 0; i < 200; ++i )
+	{
+		for ( int j = 0; j < NumPoints; ++j )
+		{
+			if ( math::random( 10 ) == 0 )
+				activationSystem.SetActivationPointEnabled( j, !activationSystem.IsActivationPointEnabled( j ) );
+
+			if ( math::random( 20 ) == 0 )
+				activationSystem.MoveActivationPoint( j, math::random_float( -range, +range ), math::random_float( -range, +range ) );
+			else
+				activationSystem.MoveActivationPoint( j, math::clamp( activationSystem.GetX( j ) + math::random_float( -1.0f, +1.0f ), -range, +range ),
+				                                         math::clamp( activationSystem.GetY( j ) + math::random_float( -1.0f, +1.0f ), -range, +range ) );
+		}
+
+		const int numMoves = math::random( 20 );
+		for ( int j = 0; j < numMoves; ++j )
+		{
+			const int id = 1 + math::random( NumObjects );
+			x[id] = math::clamp( x[id] + math::random_float( -5.0f, +5.0f ), -range, +range );
+			y[id] = math::clamp( y[id] + math::random_float( -5.0f, +5.0f ), -range, +range );
+			activationSystem.MoveObject( id, x[id], y[id] );
+		}
+
+		activationSystem.Update( 0.1f );
+
+		for ( int j = 0; j < activationSystem.GetEventCount(); ++j )
+		{
+			const activation::Event & event = activationSystem.GetEvent( j );
+			CORE_CHECK( event.id >= 1 );
+			CORE_CHECK( event.id <= (activation::ObjectId) NumObjects );
+			CORE_CHECK( activated[event.id] == ( event.type == activation::Event::Deactivate ) );
+			activated[event.id] = event.type == activation::Event::Activate;
+		}
+		activationSystem.ClearEvents();
+
+		int numInside = 0;
+		for ( int id = 1; id <= NumObjects; ++id )
+		{
+			bool inside = false;
+			for ( int j = 0; j < NumPoints; ++j )
+			{
+				const float dx = x[id] - activationSystem.GetX( j );
+				const float dy = y[id] - activationSystem.GetY( j );
+				inside |= activationSystem.IsActivationPointEnabled( j ) && dx*dx + dy*dy < activation_radius * activation_radius;
+			}
+			CORE_CHECK( activationSystem.IsActive( id ) == inside );
+			CORE_CHECK( activated[id] == inside );
+			if ( inside )
+				numInside++;
+		}
+		CORE_CHECK( activationSystem.GetActiveCount() == numInside );
+	}
+
+	// disabling the activation system deactivates everything, and enabling it brings the circles back
+
+	activationSystem.SetEnabled( false );
+	activationSystem.Update( 0.1f );
+	CORE_CHECK( activationSystem.GetActiveCount() == 0 );
+
+	activationSystem.SetEnabled( true );
+	activationSystem.Update( 0.1f );
+	int numInside = 0;
+	for ( int id = 1; id <= NumObjects; ++id )
+	{
+		bool inside = false;
+		for ( int j = 0; j < NumPoints; ++j )
+		{
+			const float dx = x[id] - activationSystem.GetX( j );
+			const float dy = y[id] - activationSystem.GetY( j );
+			inside |= activationSystem.IsActivationPointEnabled( j ) && dx*dx + dy*dy < activation_radius * activation_radius;
+		}
+		CORE_CHECK( activationSystem.IsActive( id ) == inside );
+		if ( inside )
+			numInside++;
+	}
+	CORE_CHECK( activationSystem.GetActiveCount() == numInside );
+
+	// objects moved while disabled come back active only if they are re-enabled inside a circle
+
+	for ( int id = 1; id <= NumObjects; ++id )
+		activationSystem.DisableObject( id );
+	activationSystem.Update( 0.1f );
+	CORE_CHECK( activationSystem.GetActiveCount() == 0 );
+
+	for ( int id = 1; id <= NumObjects; ++id )
+	{
+		x[id] = math::random_float( -range, +range );
+		y[id] = math::random_float( -range, +range );
+		activationSystem.MoveObject( id, x[id], y[id] );
+	}
+	activationSystem.Update( 0.1f );
+
+	for ( int id = 1; id <= NumObjects; ++id )
+		activationSystem.EnableObject( id );
+	activationSystem.Update( 0.1f );
+
+	numInside = 0;
+	for ( int id = 1; id <= NumObjects; ++id )
+	{
+		bool inside = false;
+		for ( int j = 0; j < NumPoints; ++j )
+		{
+			const float dx = x[id] - activationSystem.GetX( j );
+			const float dy = y[id] - activationSystem.GetY( j );
+			inside |= activationSystem.IsActivationPointEnabled( j ) && dx*dx + dy*dy < activation_radius * activation_radius;
+		}
+		CORE_CHECK( activationSystem.IsActive( id ) == inside );
+		if ( inside )
+			numInside++;
+	}
+	CORE_CHECK( numInside > 0 );
+	CORE_CHECK( numInside < NumObjects );
+	CORE_CHECK( activationSystem.GetActiveCount() == numInside );
+}
+
+void profile_activation()
+{
+	printf( "profile_activation\n" );
+
+	// dense world with a big activation radius and a slowly moving activation point
+
+	const float activation_radius = 32.0f;
+	const int grid_width = 64;
+	const int grid_height = 64;
+	const float cell_size = 4.0f;
+	const int NumObjects = 200000;
+	const int NumFrames = 500;
+
+	activation::ActivationSystem activationSystem( NumObjects + 1, activation_radius, grid_width, grid_height, cell_size, 64, 4096 );
+
+	const float range = grid_width / 2 * cell_size;
+
+	for ( int id = 1; id <= NumObjects; ++id )
+		activationSystem.InsertObject( id, math::random_float( -range, +range ), math::random_float( -range, +range ) );
+
+	activationSystem.Update( 0.1f );
+	activationSystem.ClearEvents();
+
+	ProfileSamples update;
+
+	for ( int i = 0; i < NumFrames; ++i )
+	{
+		// the move is applied by the update, so time them together
+		const float angle = i * 0.002f;
+		const uint64_t start = core::nanoseconds();
+		activationSystem.MoveActivationPoint( 50.0f * cosf( angle ), 50.0f * sinf( angle ) );
+		activationSystem.Update( 1.0f / 60.0f );
+		update.Add( core::nanoseconds() - start );
+		activationSystem.ClearEvents();
+	}
+
+	ProfileReport report( "activation", false );
+	report.Value( "objects", NumObjects );
+	report.Value( "active_objects", activationSystem.GetActiveCount() );
+	report.Samples( "update_ns", update );
+}
+
+void profile_activation_points( int numPoints, float spread )
+{
+	printf( "profile_activation_points\n" );
+
+	// players wander around a shared center with the given spread. with a small spread their circles
+	// mostly overlap, so the grid work should follow the area they cover together, not the player count
+
+	const float activation_radius = 32.0f;
+	const int grid_width = 64;
+	const int grid_height = 64;
+	const float cell_size = 4.0f;
+	const int NumObjects = 200000;
+	const int NumFrames = 200;
+
+	activation::ActivationSystem activationSystem( NumObjects + 1, activation_radius, grid_width, grid_height, cell_size, 64, 4096, 0.0f, numPoints );
+
+	const float range = grid_width / 2 * cell_size;
+
+	for ( int id = 1; id <= NumObjects; ++id )
+		activationSystem.InsertObject( id, math::random_float( -range, +range ), math::random_float( -range, +range ) );
+
+	std::vector<float> offset_x( numPoints );
+	std::vector<float> offset_y( numPoints );
+	for ( int i = 0; i < numPoints; ++i )
+	{
+		offset_x[i] = math::random_float( -spread, +spread );
+		offset_y[i] = math::random_float( -spread, +spread );
+		activationSystem.MoveActivationPoint( i, offset_x[i], offset_y[i] );
+	}
+
+	activationSystem.Update( 0.1f );
+	activationSystem.ClearEvents();
+
+	ProfileSamples update;
+
+	for ( int i = 0; i < NumFrames; ++i )
+	{
+		const float angle = i * 0.002f;
+		const uint64_t start = core::nanoseconds();
+		for ( int j = 0; j < numPoints; ++j )
+			activationSystem.MoveActivationPoint( j, 20.0f * cosf( angle ) + offset_x[j], 20.0f * sinf( angle ) + offset_y[j] );
+		activationSystem.Update( 1.0f / 60.0f );
+		update.Add( core::nanoseconds() - start );
+		activationSystem.ClearEvents();
+	}
+
+	ProfileReport report( "activation_points", false );
+	report.Value( "points", numPoints );
+	report.Value( "spread", spread );
+	report.Value( "active_objects", activationSystem.GetActiveCount() );
+	report.Samples( "update_ns", update );
+}
+
+static void profile_broadphase( int numCubes, cubes::SimulationBroadphase broadphase, const char * name )
+{
+	// cubes dropped in loose layers onto the ground, tumbling into each other as they land. measures only the simulation
+
+	printf( "profile_broadphase\n" );
+
+	const int NumWarmupFrames = 5;
+	const int NumFrames = 20;
+	const int NumLayers = 4;
+
+	const float size = hypercube::NonPlayerCubeSize;
+	const float spacing = size * 1.5f;
+	const int pileSize = (int) math::ceiling( math::sqrt( numCubes / float( NumLayers ) ) );
+	const float pileWidth = pileSize * spacing;
+
+	cubes::SimulationConfig config;
+	config.Broadphase = broadphase;
+	config.QuadTreeExtents = math::maximum( 100.0f, pileWidth );
+
+	cubes::Simulation simulation;
+	simulation.Initialize( config );
+	simulation.AddPlane( math::Vector(0,0,1), 0 );
+
+	const math::Vector axis = math::Vector(1,1,1) / math::sqrt( 3.0f );
+
+	for ( int i = 0; i < numCubes; ++i )
+	{
+		const int x = i % pileSize;
+		const int y = ( i / pileSize ) % pileSize;
+		const int z = i / ( pileSize * pileSize );
+
+		cubes::SimulationObjectState state;
+		state.enabled = true;
+		state.scale = size;
+		state.position = math::Vector( ( x + 0.5f ) * spacing - pileWidth / 2, ( y + 0.5f ) * spacing - pileWidth / 2, size + z * spacing );
+		state.orientation = math::Quaternion( math::random_float( 0.0f, 6.28f ), axis );
+		state.linearVelocity = math::Vector(0,0,0);
+		state.angularVelocity = math::Vector(0,0,0);
+		simulation.AddObject( state );
+	}
+
+	for ( int i = 0; i < NumWarmupFrames; ++i )
+		simulation.Update( 1.0f / 60.0f );
+
+	ProfileSamples collision;
+	ProfileSamples solver;
+	int interactionPairs = 0;
+
+	for ( int i = 0; i < NumFrames; ++i )
+	{
+		simulation.Update( 1.0f / 60.0f );
+		collision.Add( simulation.GetCollisionTime() );
+		solver.Add( simulation.GetSolverTime() );
+		interactionPairs += simulation.GetNumInteractionPairs();
+	}
+
+	ProfileReport report( name, false );
+	report.Value( "cubes", numCubes );
+	report.Value( "interaction_pairs", interactionPairs / float( NumFrames ) );
+	report.Samples( "collision_ns", collision );
+	report.Samples( "solver_ns", solver );
+}
+
 int main()
 {
+	srand( time( nullptr ) );
+
+	test_activation_incremental();
+
+	test_activation_points();
+
+	profile_activation();
+
+	profile_activation_points( 1, 8.0f );
+	profile_activation_points( 16, 8.0f );
+	profile_activation_points( 64, 8.0f );
+	profile_activation_points( 16, 100.0f );
+
+	profile_authority();
+
+	profile_interactions();
+
+	const int broadphaseCubes[] = { 1000, 10000, 50000 };
+	for ( int i = 0; i < 3; ++i )
+	{
+		profile_broadphase( broadphaseCubes[i], cubes::BROADPHASE_QuadTree, "broadphase_quadtree" );
+		profile_broadphase( broadphaseCubes[i], cubes::BROADPHASE_Hash, "broadphase_hash" );
+		profile_broadphase( broadphaseCubes[i], cubes::BROADPHASE_SweepAndPrune, "broadphase_sweep_and_prune" );
+	}
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,572 @@
+#include "game/Snapshot.h"
+#include "game/SnapshotDeltaEncoder.h"
+#include "core/JobSystem.h"
+#include "tests/Profile.h"
+
+const int NumIterations = 2000;
+
+const int NumDeltaClients = 16;
+const int NumDeltaIterations = 500;
+const int DeltaHistorySize = 32;
+const int DeltaPacketLossPercent = 5;
+const int MaxDeltaPacketSize = 64 * 1024;
+const int NumDeltaModes = 2;
+
+const int MaxEncodeClients = 64;
+const int NumEncodeFrames = 60;
+
+static float random_float( float min, float max )
+{
+    return min + ( max - min ) * ( rand() / float( RAND_MAX ) );
+}
+
+static void generate_active_objects( hypercube::ActiveObject * active_objects, int num_active_objects )
+{
+    int ids[NumCubes];
+    for ( int i = 0; i < NumCubes; ++i )
+        ids[i] = i + 1;
+    for ( int i = NumCubes - 1; i > 0; --i )
+        std::swap( ids[i], ids[rand() % ( i + 1 )] );
+
+    for ( int i = 0; i < num_active_objects; ++i )
+    {
+        auto & object = active_objects[i];
+
+        object = hypercube::ActiveObject();
+
+        object.id = ids[i];
+        object.authority = rand() % ( MaxPlayers + 1 );
+
+        object.position = math::Vector( random_float( -PositionBoundXY, PositionBoundXY ),
+                                        random_float( -PositionBoundXY, PositionBoundXY ),
+                                        random_float( 0, PositionBoundZ ) );
+
+        object.linearVelocity = math::Vector( random_float( -MaxLinearSpeed, MaxLinearSpeed ),
+                                              random_float( -MaxLinearSpeed, MaxLinearSpeed ),
+                                              random_float( -MaxLinearSpeed, MaxLinearSpeed ) );
+
+        object.angularVelocity = math::Vector( random_float( -MaxAngularSpeed, MaxAngularSpeed ),
+                                               random_float( -MaxAngularSpeed, MaxAngularSpeed ),
+                                               random_float( -MaxAngularSpeed, MaxAngularSpeed ) );
+
+        vectorial::quat4f q = vectorial::normalize( vectorial::quat4f( random_float( -1, 1 ), random_float( -1, 1 ), random_float( -1, 1 ), random_float( -1, 1 ) ) );
+
+        // edge cases: resting cubes, ties between the largest components and negative zero
+
+        switch ( i % 16 )
+        {
+            case 1: q = vectorial::quat4f( 0, 0, 0, 1 ); break;
+            case 2: q = vectorial::quat4f( 0.5f, -0.5f, 0.5f, -0.5f ); break;
+            case 3: q = vectorial::quat4f( -0.7071068f, 0, 0.7071068f, -0.0f ); break;
+            case 4: q = vectorial::quat4f( -0.0f, -1, -0.0f, 0 ); break;
+            case 5: object.position = math::Vector( -0.5f / UnitsPerMeter, 0.5f / UnitsPerMeter, 0 ); break;
+            default: break;
+        }
+
+        object.orientation.x = q.x();
+        object.orientation.y = q.y();
+        object.orientation.z = q.z();
+        object.orientation.w = q.w();
+    }
+}
+
+static bool same_bits( const vectorial::vec4f & a, const vectorial::vec4f & b )
+{
+    float values_a[4], values_b[4];
+    a.store( values_a );
+    b.store( values_b );
+    return memcmp( values_a, values_b, sizeof( values_a ) ) == 0;
+}
+
+static bool same_bits( const vectorial::vec3f & a, const vectorial::vec3f & b )
+{
+    float values_a[3], values_b[3];
+    a.store( values_a );
+    b.store( values_b );
+    return memcmp( values_a, values_b, sizeof( values_a ) ) == 0;
+}
+
+static int count_mismatches( const QuantizedSnapshot & a, const QuantizedSnapshot & b )
+{
+    int mismatches = 0;
+    for ( int i = 0; i < NumCubes; ++i )
+    {
+        if ( a.cubes[i] != b.cubes[i] ||
+             !same_bits( a.cubes[i].original_position, b.cubes[i].original_position ) ||
+             !same_bits( a.cubes[i].original_orientation, b.cubes[i].original_orientation ) )
+            mismatches++;
+    }
+    return mismatches;
+}
+
+static int count_mismatches( const QuantizedSnapshotWithVelocity & a, const QuantizedSnapshotWithVelocity & b )
+{
+    int mismatches = 0;
+    for ( int i = 0; i < NumCubes; ++i )
+    {
+        if ( a.cubes[i] != b.cubes[i] ||
+             !same_bits( a.cubes[i].original_position, b.cubes[i].original_position ) ||
+             !same_bits( a.cubes[i].original_orientation, b.cubes[i].original_orientation ) )
+            mismatches++;
+    }
+    return mismatches;
+}
+
+static int count_mismatches( const QuantizedSnapshot_HighPrecision & a, const QuantizedSnapshot_HighPrecision & b )
+{
+    int mismatches = 0;
+    for ( int i = 0; i < NumCubes; ++i )
+    {
+        if ( a.cubes[i] != b.cubes[i] || !same_bits( a.cubes[i].original_orientation, b.cubes[i].original_orientation ) )
+            mismatches++;
+    }
+    return mismatches;
+}
+
+static int count_mismatches( const Snapshot & a, const Snapshot & b )
+{
+    int mismatches = 0;
+    for ( int i = 0; i < NumCubes; ++i )
+    {
+        if ( a.cubes[i].interacting != b.cubes[i].interacting ||
+             !same_bits( a.cubes[i].position, b.cubes[i].position ) ||
+             !same_bits( a.cubes[i].orientation, b.cubes[i].orientation ) ||
+             !same_bits( a.cubes[i].linear_velocity, b.cubes[i].linear_velocity ) )
+            mismatches++;
+    }
+    return mismatches;
+}
+
+template <typename QuantizedSnapshotType> static void profile_quantize( const char * name, bool csv, const hypercube::ActiveObject * active_objects, int num_active_objects )
+{
+    QuantizedSnapshotType * scalar_snapshot = (QuantizedSnapshotType*) calloc( 1, sizeof( QuantizedSnapshotType ) );
+    QuantizedSnapshotType * batch_snapshot = (QuantizedSnapshotType*) calloc( 1, sizeof( QuantizedSnapshotType ) );
+
+    QuantizeCubes_Scalar( active_objects, 0, num_active_objects, *scalar_snapshot );
+    QuantizeCubes( active_objects, num_active_objects, *batch_snapshot );
+
+    const int mismatches = count_mismatches( *scalar_snapshot, *batch_snapshot );
+
+    ProfileSamples scalar;
+    ProfileSamples batch;
+
+    for ( int i = 0; i < NumIterations; ++i )
+    {
+        uint64_t start = core::nanoseconds();
+        QuantizeCubes_Scalar( active_objects, 0, num_active_objects, *scalar_snapshot );
+        scalar.Add( core::nanoseconds() - start );
+
+        start = core::nanoseconds();
+        QuantizeCubes( active_objects, num_active_objects, *batch_snapshot );
+        batch.Add( core::nanoseconds() - start );
+    }
+
+    {
+        ProfileReport report( name, csv );
+        report.Value( "cubes", num_active_objects );
+        report.Value( "mismatches", mismatches );
+        report.Samples( "scalar_ns", scalar );
+        report.Samples( "batch_ns", batch );
+        report.Value( "speedup", scalar.GetMean() / batch.GetMean() );
+    }
+
+    CORE_CHECK( mismatches == 0 );
+
+    free( scalar_snapshot );
+    free( batch_snapshot );
+}
+
+static void profile_dequantize( bool csv, const hypercube::ActiveObject * active_objects, int num_active_objects )
+{
+    QuantizedSnapshot * quantized_snapshot = (QuantizedSnapshot*) calloc( 1, sizeof( QuantizedSnapshot ) );
+    Snapshot * scalar_snapshot = (Snapshot*) calloc( 1, sizeof( Snapshot ) );
+    Snapshot * batch_snapshot = (Snapshot*) calloc( 1, sizeof( Snapshot ) );
+
+    QuantizeCubes( active_objects, num_active_objects, *quantized_snapshot );
+
+    DequantizeSnapshot_Scalar( *quantized_snapshot, *scalar_snapshot );
+    DequantizeSnapshot( *quantized_snapshot, *batch_snapshot );
+
+    const int mismatches = count_mismatches( *scalar_snapshot, *batch_snapshot );
+
+    ProfileSamples scalar;
+    ProfileSamples batch;
+
+    for ( int i = 0; i < NumIterations; ++i )
+    {
+        uint64_t start = core::nanoseconds();
+        DequantizeSnapshot_Scalar( *quantized_snapshot, *scalar_snapshot );
+        scalar.Add( core::nanoseconds() - start );
+
+        start = core::nanoseconds();
+        DequantizeSnapshot( *quantized_snapshot, *batch_snapshot );
+        batch.Add( core::nanoseconds() - start );
+    }
+
+    {
+        ProfileReport report( "dequantize_snapshot", csv );
+        report.Value( "cubes", NumCubes );
+        report.Value( "mismatches", mismatches );
+        report.Samples( "scalar_ns", scalar );
+        report.Samples( "batch_ns", batch );
+        report.Value( "speedup", scalar.GetMean() / batch.GetMean() );
+    }
+
+    CORE_CHECK( mismatches == 0 );
+
+    free( quantized_snapshot );
+    free( scalar_snapshot );
+    free( batch_snapshot );
+}
+
+enum ProfileDeltaContext
+{
+    PROFILE_DELTA_CONTEXT_ENCODER,
+    PROFILE_DELTA_CONTEXT_RECEIVE_BUFFER,
+    PROFILE_DELTA_CONTEXT_INITIAL_SNAPSHOT
+};
+
+struct ProfileDeltaPacket : public protocol::Object
+{
+    uint16_t sequence;
+    uint16_t base_sequence;
+    bool initial;
+    int delta_mode;
+
+    ProfileDeltaPacket() : sequence(0), base_sequence(0), initial(true), delta_mode(0) {}
+
+    PROTOCOL_SERIALIZE_OBJECT( stream )
+    {
+        auto encoder = (const SnapshotDeltaEncoder*) stream.GetContext( PROFILE_DELTA_CONTEXT_ENCODER );
+        auto receive_buffer = (protocol::SequenceBuffer<QuantizedSnapshot>*) stream.GetContext( PROFILE_DELTA_CONTEXT_RECEIVE_BUFFER );
+        auto initial_snapshot = (const QuantizedSnapshot*) stream.GetContext( PROFILE_DELTA_CONTEXT_INITIAL_SNAPSHOT );
+
+        serialize_uint16( stream, sequence );
+
+        serialize_int( stream, delta_mode, 0, NumDeltaModes - 1 );
+
+        serialize_bool( stream, initial );
+
+        if ( !initial )
+            serialize_uint16( stream, base_sequence );
+
+        QuantizedCubeState * cubes = nullptr;
+        const QuantizedCubeState * base_cubes = initial_snapshot->cubes;
+
+        if ( Stream::IsWriting )
+        {
+            cubes = (QuantizedCubeState*) encoder->GetSnapshot( sequence ).cubes;
+            if ( !initial )
+                base_cubes = encoder->GetSnapshot( base_sequence ).cubes;
+        }
+        else
+        {
+            if ( !initial )
+            {
+                auto base = receive_buffer->Find( base_sequence );
+                CORE_CHECK( base );
+                base_cubes = base->cubes;
+            }
+            auto entry = receive_buffer->Insert( sequence );
+            CORE_CHECK( entry );
+            cubes = entry->cubes;
+        }
+
+        for ( int i = 0; i < NumCubes; ++i )
+        {
+            bool changed = false;
+
+            // mode 1 ignores the baseline and sends every cube
+
+            if ( Stream::IsWriting )
+                changed = delta_mode == 1 || cubes[i] != base_cubes[i];
+
+            serialize_bool( stream, changed );
+
+            if ( changed )
+            {
+                serialize_bool( stream, cubes[i].interacting );
+                serialize_int( stream, cubes[i].position_x, -QuantizedPositionBoundXY, +QuantizedPositionBoundXY - 1 );
+                serialize_int( stream, cubes[i].position_y, -QuantizedPositionBoundXY, +QuantizedPositionBoundXY - 1 );
+                serialize_int( stream, cubes[i].position_z, 0, +QuantizedPositionBoundZ - 1 );
+                serialize_object( stream, cubes[i].orientation );
+            }
+            else if ( Stream::IsReading )
+                cubes[i] = base_cubes[i];
+        }
+    }
+};
+
+static void move_cubes( QuantizedSnapshot & snapshot, int num_moving )
+{
+    for ( int i = 0; i < num_moving; ++i )
+    {
+        auto & cube = snapshot.cubes[rand() % NumCubes];
+        cube.position_x = core::clamp( cube.position_x + rand() % 9 - 4, -QuantizedPositionBoundXY, QuantizedPositionBoundXY - 1 );
+        cube.position_y = core::clamp( cube.position_y + rand() % 9 - 4, -QuantizedPositionBoundXY, QuantizedPositionBoundXY - 1 );
+        cube.position_z = core::clamp( cube.position_z + rand() % 9 - 4, 0, QuantizedPositionBoundZ - 1 );
+    }
+}
+
+static void profile_delta_encoder( const char * name, bool csv, const hypercube::ActiveObject * active_objects, int num_active_objects, int cache_size )
+{
+    // one encoder shared by all clients. each client receives with its own loss and acks, and joins at a different time
+
+    core::Allocator & allocator = core::memory::default_allocator();
+
+    SnapshotDeltaEncoderConfig config;
+    config.allocator = &allocator;
+    config.maxClients = NumDeltaClients;
+    config.historySize = DeltaHistorySize;
+    config.cacheSize = cache_size;
+    config.maxPacketSize = MaxDeltaPacketSize;
+
+    SnapshotDeltaEncoder encoder( config );
+
+    QuantizedSnapshot * initial_snapshot = (QuantizedSnapshot*) calloc( 1, sizeof( QuantizedSnapshot ) );
+    QuantizedSnapshot * current_snapshot = (QuantizedSnapshot*) calloc( 1, sizeof( QuantizedSnapshot ) );
+
+    QuantizeCubes( active_objects, num_active_objects, *current_snapshot );
+
+    protocol::SequenceBuffer<QuantizedSnapshot> * receive_buffers[NumDeltaClients];
+    for ( int i = 0; i < NumDeltaClients; ++i )
+        receive_buffers[i] = CORE_NEW( allocator, protocol::SequenceBuffer<QuantizedSnapshot>, allocator, DeltaHistorySize );
+
+    const void * context[protocol::MaxContexts];
+    memset( context, 0, sizeof( context ) );
+    context[PROFILE_DELTA_CONTEXT_ENCODER] = &encoder;
+    context[PROFILE_DELTA_CONTEXT_INITIAL_SNAPSHOT] = initial_snapshot;
+
+    uint8_t * buffer = (uint8_t*) malloc( MaxDeltaPacketSize );
+
+    ProfileSamples encode;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t initial_packets = 0;
+    int mismatches = 0;
+
+    for ( int iteration = 0; iteration < NumDeltaIterations; ++iteration )
+    {
+        move_cubes( *current_snapshot, NumCubes / 10 );
+
+        uint16_t sequence;
+        encoder.InsertSnapshot( sequence ) = *current_snapshot;
+
+        for ( int i = 0; i < NumDeltaClients; ++i )
+        {
+            if ( iteration < i * 4 )
+                continue;
+
+            ProfileDeltaPacket write_packet;
+            uint64_t start = core::nanoseconds();
+            const int packet_bytes = encoder.EncodePacket( i, i % NumDeltaModes, write_packet, buffer, MaxDeltaPacketSize, context );
+            encode.Add( core::nanoseconds() - start );
+
+            CORE_CHECK( packet_bytes > 0 );
+
+            packets++;
+            bytes += packet_bytes;
+            if ( write_packet.initial )
+                initial_packets++;
+
+            if ( ( rand() % 100 ) < DeltaPacketLossPercent )
+                continue;
+
+            ProfileDeltaPacket read_packet;
+            {
+                protocol::ReadStream stream( buffer, MaxDeltaPacketSize );
+                context[PROFILE_DELTA_CONTEXT_RECEIVE_BUFFER] = receive_buffers[i];
+                stream.SetContext( context );
+                read_packet.SerializeRead( stream );
+                CORE_CHECK( !stream.IsOverflow() );
+            }
+
+            CORE_CHECK( read_packet.sequence == sequence );
+
+            auto received = receive_buffers[i]->Find( sequence );
+            CORE_CHECK( received );
+            for ( int j = 0; j < NumCubes; ++j )
+            {
+                if ( received->cubes[j] != current_snapshot->cubes[j] )
+                    mismatches++;
+            }
+
+            if ( ( rand() % 100 ) >= DeltaPacketLossPercent )
+                encoder.ProcessAck( i, sequence );
+        }
+    }
+
+    {
+        ProfileReport report( name, csv );
+        report.Value( "clients", NumDeltaClients );
+        report.Value( "history", DeltaHistorySize );
+        report.Value( "cache_size", cache_size );
+        report.Value( "history_bytes", (double) ( sizeof( QuantizedSnapshot ) * DeltaHistorySize ) );
+        report.Value( "client_bytes", (double) ( sizeof( SnapshotDeltaClient ) * NumDeltaClients ) );
+        report.Value( "packets", (double) packets );
+        report.Value( "initial_packets", (double) initial_packets );
+        report.Value( "bytes_per_packet", bytes / double( packets ) );
+        report.Value( "cache_hits", (double) encoder.GetCounter( SNAPSHOT_DELTA_ENCODER_COUNTER_CACHE_HITS ) );
+        report.Value( "cache_misses", (double) encoder.GetCounter( SNAPSHOT_DELTA_ENCODER_COUNTER_CACHE_MISSES ) );
+        report.Value( "mismatches", mismatches );
+        report.Samples( "encode_ns", encode );
+    }
+
+    CORE_CHECK( mismatches == 0 );
+
+    for ( int i = 0; i < NumDeltaClients; ++i )
+        CORE_DELETE( allocator, SequenceBuffer<QuantizedSnapshot>, receive_buffers[i] );
+
+    free( buffer );
+    free( initial_snapshot );
+    free( current_snapshot );
+}
+
+struct ParallelEncodeData
+{
+    const SnapshotDeltaEncoder * encoder;
+    const void ** context;
+    uint8_t * buffers[MaxEncodeClients];
+    int bytes[MaxEncodeClients];
+};
+
+static void encode_client_job( void * data, int clientIndex )
+{
+    auto encodeData = (ParallelEncodeData*) data;
+    ProfileDeltaPacket packet;
+    encodeData->bytes[clientIndex] = encodeData->encoder->WritePacket( clientIndex, 0, packet, encodeData->buffers[clientIndex], MaxDeltaPacketSize, encodeData->context );
+}
+
+static void profile_parallel_encode( bool csv, const hypercube::ActiveObject * active_objects, int num_active_objects, int num_threads, int num_clients )
+{
+    // per-client encodes fan out across the job system and join before the packets would be sent
+
+    core::Allocator & allocator = core::memory::default_allocator();
+
+    core::JobSystemConfig jobConfig;
+    jobConfig.allocator = &allocator;
+    jobConfig.numThreads = num_threads;
+
+    core::JobSystem jobSystem( jobConfig );
+
+    SnapshotDeltaEncoderConfig config;
+    config.allocator = &allocator;
+    config.maxClients = num_clients;
+    config.historySize = DeltaHistorySize;
+
+    SnapshotDeltaEncoder encoder( config );
+
+    QuantizedSnapshot * initial_snapshot = (QuantizedSnapshot*) calloc( 1, sizeof( QuantizedSnapshot ) );
+    QuantizedSnapshot * current_snapshot = (QuantizedSnapshot*) calloc( 1, sizeof( QuantizedSnapshot ) );
+
+    QuantizeCubes( active_objects, num_active_objects, *current_snapshot );
+
+    const void * context[protocol::MaxContexts];
+    memset( context, 0, sizeof( context ) );
+    context[PROFILE_DELTA_CONTEXT_ENCODER] = &encoder;
+    context[PROFILE_DELTA_CONTEXT_INITIAL_SNAPSHOT] = initial_snapshot;
+
+    ParallelEncodeData data;
+    data.encoder = &encoder;
+    data.context = context;
+    for ( int i = 0; i < num_clients; ++i )
+        data.buffers[i] = (uint8_t*) malloc( MaxDeltaPacketSize );
+
+    ProfileSamples frame;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+
+    for ( int iteration = 0; iteration < NumEncodeFrames; ++iteration )
+    {
+        move_cubes( *current_snapshot, NumCubes / 10 );
+
+        uint16_t sequence;
+        encoder.InsertSnapshot( sequence ) = *current_snapshot;
+
+        const uint64_t start = core::nanoseconds();
+        jobSystem.ParallelFor( encode_client_job, &data, num_clients );
+        frame.Add( core::nanoseconds() - start );
+
+        for ( int i = 0; i < num_clients; ++i )
+        {
+            CORE_CHECK( data.bytes[i] > 0 );
+            packets++;
+            bytes += data.bytes[i];
+            if ( ( rand() % 100 ) >= DeltaPacketLossPercent * 2 )
+                encoder.ProcessAck( i, sequence );
+        }
+    }
+
+    const double seconds = frame.GetMean() * NumEncodeFrames / 1000000000.0;
+
+    {
+        ProfileReport report( "parallel_encode", csv );
+        report.Value( "threads", jobSystem.GetNumThreads() );
+        report.Value( "clients", num_clients );
+        report.Value( "packets_per_second", packets / seconds );
+        report.Value( "megabytes_per_second", bytes / seconds / ( 1024.0 * 1024.0 ) );
+        report.Value( "jobs_stolen", (double) jobSystem.GetCounter( core::JOB_SYSTEM_COUNTER_JOBS_STOLEN ) );
+        report.Samples( "frame_ns", frame );
+    }
+
+    for ( int i = 0; i < num_clients; ++i )
+        free( data.buffers[i] );
+
+    free( initial_snapshot );
+    free( current_snapshot );
+}
+
+int main( int argc, char ** argv )
+{
+    srand( 0 );
+
+    core::memory::initialize();
+
+    const bool csv = profile_csv_output( argc, argv );
+
+    hypercube::ActiveObject * active_objects = (hypercube::ActiveObject*) malloc( sizeof( hypercube::ActiveObject ) * NumCubes );
+
+    generate_active_objects( active_objects, NumCubes );
+
+    profile_quantize<QuantizedSnapshot>( "quantize_snapshot", csv, active_objects, NumCubes );
+    profile_quantize<QuantizedSnapshotWithVelocity>( "quantize_snapshot_with_velocity", csv, active_objects, NumCubes );
+    profile_quantize<QuantizedSnapshot_HighPrecision>( "quantize_snapshot_high_precision", csv, active_objects, NumCubes );
+
+    // partial snapshot: only some cubes active, count not a multiple of the batch or lane size
+
+    profile_quantize<QuantizedSnapshot>( "quantize_snapshot_partial", csv, active_objects, 101 );
+
+    profile_dequantize( csv, active_objects, NumCubes );
+
+    // same packets with and without the encode cache, so only the encode times differ
+
+    srand( 1 );
+
+    profile_delta_encoder( "delta_encoder", csv, active_objects, NumCubes, 0 );
+
+    srand( 1 );
+
+    profile_delta_encoder( "delta_encoder_cached", csv, active_objects, NumCubes, NumDeltaClients );
+
+    // encode throughput for 1 to 64 clients, per thread count up to every hardware thread
+
+    const int hardware_threads = std::max( 1, (int) std::thread::hardware_concurrency() );
+
+    for ( int num_threads = 1; ; num_threads *= 2 )
+    {
+        if ( num_threads > hardware_threads )
+            num_threads = hardware_threads;
+
+        for ( int num_clients = 1; num_clients <= MaxEncodeClients; num_clients *= 2 )
+            profile_parallel_encode( csv, active_objects, NumCubes, num_threads, num_clients );
+
+        if ( num_threads == hardware_threads )
+            break;
+    }
+
+    free( active_objects );
+
+    core::memory::shutdown();
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "network/Simulator.h"
+#include "protocol/Stream.h"
+#include "protocol/PacketFactory.h"
+#include <time.h>
+
+// packets are never serialized here, so use a bare packet rather than TestPackets.h, which pulls in client server
+
+enum ProfilePacketTypes
+{
+    PROFILE_PACKET,
+    NUM_PROFILE_PACKET_TYPES
+};
+
+struct ProfilePacket : public protocol::Packet
+{
+    ProfilePacket() : Packet( PROFILE_PACKET ) {}
+
+    PROTOCOL_SERIALIZE_OBJECT( stream )
+    {
+        (void) stream;
+    }
+};
+
+class ProfilePacketFactory : public protocol::PacketFactory
+{
+    core::Allocator * m_allocator;
+
+public:
+
+    ProfilePacketFactory( core::Allocator & allocator )
+        : PacketFactory( allocator, NUM_PROFILE_PACKET_TYPES )
+    {
+        m_allocator = &allocator;
+    }
+
+protected:
+
+    protocol::Packet * CreateInternal( int type )
+    {
+        return type == PROFILE_PACKET ? CORE_NEW( *m_allocator, ProfilePacket ) : nullptr;
+    }
+};
+
+static double profile_drain( ProfilePacketFactory & packetFactory, int numPackets, bool linearReceive )
+{
+    network::SimulatorConfig simulatorConfig;
+    simulatorConfig.packetFactory = &packetFactory;
+    simulatorConfig.numPackets = numPackets;
+    simulatorConfig.serializePackets = false;
+    simulatorConfig.linearReceive = linearReceive;
+
+    network::Simulator simulator( simulatorConfig );
+    simulator.AddState( network::SimulatorState( 0.5f, 0.5f, 0.0f ) );
+
+    network::Address address( "::1" );
+    address.SetPort( 10000 );
+
+    core::TimeBase timeBase;
+
+    simulator.Update( timeBase );
+
+    for ( int i = 0; i < numPackets; ++i )
+        simulator.SendPacket( address, packetFactory.Create( PROFILE_PACKET ) );
+
+    // every buffered packet is now deliverable. time how long it takes to drain them all
+
+    timeBase.time = 2.0;
+
+    simulator.Update( timeBase );
+
+    const uint64_t start = core::nanoseconds();
+
+    int numReceived = 0;
+
+    while ( true )
+    {
+        auto packet = simulator.ReceivePacket();
+        if ( !packet )
+            break;
+        packetFactory.Destroy( packet );
+        numReceived++;
+    }
+
+    const uint64_t finish = core::nanoseconds();
+
+    CORE_CHECK( numReceived == numPackets );
+
+    return ( finish - start ) / double( numPackets );
+}
+
+int main()
+{
+    srand( time( nullptr ) );
+
+    core::memory::initialize();
+    {
+        printf( "[profile simulator]\n" );
+
+        ProfilePacketFactory packetFactory( core::memory::default_allocator() );
+
+        const int NumPacketCounts = 3;
+        const int packetCounts[] = { 1024, 16 * 1024, 64 * 1024 };
+
+        printf( "packets,linear_ns_per_packet,heap_ns_per_packet,speedup\n" );
+
+        for ( int i = 0; i < NumPacketCounts; ++i )
+        {
+            const double linear = profile_drain( packetFactory, packetCounts[i], true );
+            const double heap = profile_drain( packetFactory, packetCounts[i], false );
+            printf( "%d,%.1f,%.1f,%.1f\n", packetCounts[i], linear, heap, linear / heap );
+        }
+    }
+    core::memory::shutdown();
+
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "network/Network.h"
 #include "network/BSDSocket.h"
+#include "network/Config.h"
+#include "network/Compressor.h"
 #include "TestPackets.h"
 
 void test_bsd_socket_send_and_receive_ipv4()
@@ -438,3 +440,385 @@ void test_bsd_socket_send_and_receive_multiple_ipv6()
     }
     core::memory::shutdown();
 }
+
+void test_bsd_socket_send_and_receive_batched()
+{
+    printf( "test_bsd_socket_send_and_receive_batched\n" );
+
+    core::memory::initialize();
+    {
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const int BatchSize = 16;
+        const int NumPackets = 64;
+
+        network::BSDSocketConfig sender_config;
+        sender_config.port = 10000;
+        sender_config.ipv6 = false;
+        sender_config.maxPacketSize = 1024;
+        sender_config.packetFactory = &packetFactory;
+        sender_config.batchSize = BatchSize;
+
+        network::BSDSocket interface_sender( sender_config );
+        
+        network::BSDSocketConfig receiver_config;
+        receiver_config.port = 10001;
+        receiver_config.ipv6 = false;
+        receiver_config.maxPacketSize = 1024;
+        receiver_config.packetFactory = &packetFactory;
+        receiver_config.batchSize = BatchSize;
+
+        network::BSDSocket interface_receiver( receiver_config );
+
+        network::Address sender_address( "[127.0.0.1]:10000" );
+        network::Address receiver_address( "[127.0.0.1]:10001" );
+
+        core::TimeBase timeBase;
+        timeBase.deltaTime = 0.01f;
+
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            auto updatePacket = (UpdatePacket*) packetFactory.Create( PACKET_UPDATE );
+            updatePacket->timestamp = i;
+            interface_sender.SendPacket( receiver_address, updatePacket );
+        }
+
+        bool received[NumPackets];
+        memset( received, 0, sizeof( received ) );
+        int numReceived = 0;
+
+        for ( int iteration = 0; iteration < 100 && numReceived < NumPackets; ++iteration )
+        {
+            interface_sender.Update( timeBase );
+            interface_receiver.Update( timeBase );
+
+            while ( true )
+            {
+                auto packet = interface_receiver.ReceivePacket();
+                if ( !packet )
+                    break;
+
+                CORE_CHECK( packet->GetAddress() == sender_address );
+                CORE_CHECK( packet->GetType() == PACKET_UPDATE );
+
+                auto updatePacket = static_cast<UpdatePacket*>( packet );
+                CORE_CHECK( updatePacket->timestamp < NumPackets );
+                CORE_CHECK( !received[updatePacket->timestamp] );
+                received[updatePacket->timestamp] = true;
+                numReceived++;
+
+                packetFactory.Destroy( packet );
+            }
+
+            timeBase.time += timeBase.deltaTime;
+        }
+
+#if NETWORK_HAS_BATCHED_IO
+        CORE_CHECK( interface_sender.GetCounter( network::BSD_SOCKET_COUNTER_SEND_BATCHES ) == NumPackets / BatchSize );
+        CORE_CHECK( interface_sender.GetCounter( network::BSD_SOCKET_COUNTER_MAX_SEND_BATCH_SIZE ) == BatchSize );
+        CORE_CHECK( interface_receiver.GetCounter( network::BSD_SOCKET_COUNTER_RECEIVE_BATCHES ) > 0 );
+        CORE_CHECK( interface_receiver.GetCounter( network::BSD_SOCKET_COUNTER_MAX_RECEIVE_BATCH_SIZE ) <= BatchSize );
+#endif
+
+        CORE_CHECK( interface_sender.GetCounter( network::BSD_SOCKET_COUNTER_PACKETS_SENT ) == NumPackets );
+        CORE_CHECK( interface_sender.GetCounter( network::BSD_SOCKET_COUNTER_SEND_FAILURES ) == 0 );
+        CORE_CHECK( interface_receiver.GetCounter( network::BSD_SOCKET_COUNTER_PACKETS_RECEIVED ) == NumPackets );
+        CORE_CHECK( numReceived == NumPackets );
+    }
+    core::memory::shutdown();
+}
+
+static int generate_test_packet( uint8_t * data, int sequence )
+{
+    // mostly constant header and layout, with a few values that change every packet
+
+    const int bytes = 64 + sequence % 64;
+    for ( int i = 0; i < bytes; ++i )
+        data[i] = uint8_t( i * 7 );
+    data[4] = uint8_t( sequence );
+    data[5] = uint8_t( sequence >> 8 );
+    data[20] = uint8_t( rand() );
+    data[bytes - 1] = uint8_t( rand() );
+    return bytes;
+}
+
+void test_compressor()
+{
+    printf( "test_compressor\n" );
+
+    core::memory::initialize();
+    {
+        const int MaxPacketSize = 1024;
+        const int NumPackets = 256;
+        const int DictionaryBytes = 1024;
+
+        network::PacketCapture capture( core::memory::default_allocator(), NumPackets, MaxPacketSize );
+
+        uint8_t packet[MaxPacketSize];
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            const int bytes = generate_test_packet( packet, i );
+            capture.AddPacket( packet, bytes );
+        }
+
+        CORE_CHECK( capture.GetNumPackets() == NumPackets );
+
+        uint8_t dictionary[DictionaryBytes];
+        const int dictionaryBytes = network::TrainDictionary( capture, dictionary, DictionaryBytes );
+        CORE_CHECK( dictionaryBytes > 0 );
+        CORE_CHECK( dictionaryBytes <= DictionaryBytes );
+
+        network::Compressor compressor( core::memory::default_allocator() );
+        network::Compressor dictionaryCompressor( core::memory::default_allocator(), dictionary, dictionaryBytes );
+
+        CORE_CHECK( compressor.GetDictionaryBytes() == 0 );
+        CORE_CHECK( dictionaryCompressor.GetDictionaryBytes() == dictionaryBytes );
+
+        uint8_t compressed[MaxPacketSize];
+        uint8_t decompressed[MaxPacketSize];
+
+        int uncompressedBytes = 0;
+        int compressedBytes = 0;
+        int dictionaryCompressedBytes = 0;
+
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            const int bytes = generate_test_packet( packet, NumPackets + i );
+            uncompressedBytes += bytes;
+
+            int result = compressor.Compress( packet, bytes, compressed, MaxPacketSize );
+            CORE_CHECK( result > 0 );
+            CORE_CHECK( result <= network::Compressor::GetMaxCompressedBytes( bytes ) );
+            compressedBytes += result;
+            CORE_CHECK( compressor.Decompress( compressed, result, decompressed, MaxPacketSize ) == bytes );
+            CORE_CHECK( memcmp( packet, decompressed, bytes ) == 0 );
+
+            // a packet compressed against the dictionary can't be decompressed without it
+
+            result = dictionaryCompressor.Compress( packet, bytes, compressed, MaxPacketSize );
+            CORE_CHECK( result > 0 );
+            dictionaryCompressedBytes += result;
+            CORE_CHECK( dictionaryCompressor.Decompress( compressed, result, decompressed, MaxPacketSize ) == bytes );
+            CORE_CHECK( memcmp( packet, decompressed, bytes ) == 0 );
+            CORE_CHECK( compressor.Decompress( compressed, result, decompressed, MaxPacketSize ) != bytes || memcmp( packet, decompressed, bytes ) != 0 );
+
+            // truncated output and malformed input must fail rather than overrun
+
+            CORE_CHECK( dictionaryCompressor.Decompress( compressed, result, decompressed, bytes - 1 ) < 0 );
+            CORE_CHECK( dictionaryCompressor.Decompress( compressed, result - 1, decompressed, MaxPacketSize ) != bytes || memcmp( packet, decompressed, bytes ) != 0 );
+        }
+
+        CORE_CHECK( dictionaryCompressedBytes < compressedBytes );
+        CORE_CHECK( dictionaryCompressedBytes * 3 < uncompressedBytes );
+
+        for ( int i = 0; i < 1000; ++i )
+        {
+            const int bytes = 1 + rand() % 64;
+            for ( int j = 0; j < bytes; ++j )
+                compressed[j] = uint8_t( rand() );
+            const int result = dictionaryCompressor.Decompress( compressed, bytes, decompressed, MaxPacketSize );
+            CORE_CHECK( result <= MaxPacketSize );
+        }
+
+        // incompressible input must not overflow an output buffer of the maximum compressed size
+
+        for ( int i = 0; i < MaxPacketSize; ++i )
+            packet[i] = uint8_t( rand() );
+        uint8_t worstCase[MaxPacketSize * 2];
+        const int result = compressor.Compress( packet, MaxPacketSize, worstCase, network::Compressor::GetMaxCompressedBytes( MaxPacketSize ) );
+        CORE_CHECK( result > 0 );
+        CORE_CHECK( compressor.Decompress( worstCase, result, decompressed, MaxPacketSize ) == MaxPacketSize );
+        CORE_CHECK( memcmp( packet, decompressed, MaxPacketSize ) == 0 );
+        CORE_CHECK( compressor.Compress( packet, MaxPacketSize, compressed, MaxPacketSize / 2 ) == 0 );
+    }
+    core::memory::shutdown();
+}
+
+static void test_bsd_socket_compression( bool zeroCopy )
+{
+    core::memory::initialize();
+    {
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const int NumPackets = 32;
+
+        network::PacketCapture capture( core::memory::default_allocator(), NumPackets, 1024 );
+
+        uint8_t dictionary[256];
+        memset( dictionary, 0, sizeof( dictionary ) );
+
+        network::BSDSocketConfig sender_config;
+        sender_config.port = 10000;
+        sender_config.ipv6 = false;
+        sender_config.maxPacketSize = 1024;
+        sender_config.packetFactory = &packetFactory;
+        sender_config.compression = true;
+        sender_config.compressionDictionary = dictionary;
+        sender_config.compressionDictionaryBytes = sizeof( dictionary );
+        sender_config.capture = &capture;
+
+        network::BSDSocket interface_sender( sender_config );
+
+        network::BSDSocketConfig receiver_config = sender_config;
+        receiver_config.port = 10001;
+        receiver_config.zeroCopy = zeroCopy;
+        receiver_config.capture = nullptr;
+
+        network::BSDSocket interface_receiver( receiver_config );
+
+        network::Address sender_address( "[127.0.0.1]:10000" );
+        network::Address receiver_address( "[127.0.0.1]:10001" );
+
+        core::TimeBase timeBase;
+        timeBase.deltaTime = 0.01f;
+
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            if ( i % 2 )
+            {
+                auto connectPacket = (ConnectPacket*) packetFactory.Create( PACKET_CONNECT );
+                connectPacket->a = i % 10;
+                interface_sender.SendPacket( receiver_address, connectPacket );
+            }
+            else
+            {
+                auto updatePacket = (UpdatePacket*) packetFactory.Create( PACKET_UPDATE );
+                updatePacket->timestamp = i;
+                interface_sender.SendPacket( receiver_address, updatePacket );
+            }
+        }
+
+        bool received[NumPackets];
+        memset( received, 0, sizeof( received ) );
+        int numReceived = 0;
+        int numConnectReceived = 0;
+
+        for ( int iteration = 0; iteration < 100 && numReceived < NumPackets; ++iteration )
+        {
+            interface_sender.Update( timeBase );
+            interface_receiver.Update( timeBase );
+
+            while ( true )
+            {
+                auto packet = interface_receiver.ReceivePacket();
+                if ( !packet )
+                    break;
+
+                CORE_CHECK( packet->GetAddress() == sender_address );
+
+                if ( packet->GetType() == PACKET_UPDATE )
+                {
+                    const int index = static_cast<UpdatePacket*>( packet )->timestamp;
+                    CORE_CHECK( index < NumPackets );
+                    CORE_CHECK( index % 2 == 0 );
+                    CORE_CHECK( !received[index] );
+                    received[index] = true;
+                }
+                else
+                {
+                    CORE_CHECK( packet->GetType() == PACKET_CONNECT );
+                    auto connectPacket = static_cast<ConnectPacket*>( packet );
+                    CORE_CHECK( connectPacket->a >= 0 && connectPacket->a < 10 );
+                    CORE_CHECK( connectPacket->b == 2 );
+                    CORE_CHECK( connectPacket->c == 3 );
+                    numConnectReceived++;
+                }
+
+                numReceived++;
+
+                packetFactory.Destroy( packet );
+            }
+
+            timeBase.time += timeBase.deltaTime;
+        }
+
+        CORE_CHECK( numReceived == NumPackets );
+        CORE_CHECK( numConnectReceived == NumPackets / 2 );
+        CORE_CHECK( capture.GetNumPackets() == NumPackets );
+
+        const network::BSDSocketCompressionStats & updateStats = interface_sender.GetCompressionStats( PACKET_UPDATE );
+        const network::BSDSocketCompressionStats & connectStats = interface_sender.GetCompressionStats( PACKET_CONNECT );
+        CORE_CHECK( updateStats.packetsCompressed == NumPackets / 2 );
+        CORE_CHECK( connectStats.packetsCompressed == NumPackets / 2 );
+        CORE_CHECK( updateStats.compressedBytes <= updateStats.uncompressedBytes + updateStats.packetsCompressed );
+        CORE_CHECK( interface_receiver.GetCompressionStats( PACKET_UPDATE ).packetsDecompressed == NumPackets / 2 );
+        CORE_CHECK( interface_receiver.GetCompressionStats( PACKET_CONNECT ).packetsDecompressed == NumPackets / 2 );
+
+        CORE_CHECK( interface_receiver.GetCounter( network::BSD_SOCKET_COUNTER_DECOMPRESS_FAILURES ) == 0 );
+    }
+    core::memory::shutdown();
+}
+
+void test_bsd_socket_compression()
+{
+    printf( "test_bsd_socket_compression\n" );
+
+    test_bsd_socket_compression( false );
+    test_bsd_socket_compression( true );
+}
+
+void test_bsd_socket_zero_copy_outlives_socket()
+{
+    printf( "test_bsd_socket_zero_copy_outlives_socket\n" );
+
+    core::memory::initialize();
+    {
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const int BlockSize = 100;
+
+        network::BSDSocketConfig sender_config;
+        sender_config.port = 10000;
+        sender_config.ipv6 = false;
+        sender_config.maxPacketSize = 1024;
+        sender_config.packetFactory = &packetFactory;
+
+        network::BSDSocket interface_sender( sender_config );
+
+        network::Address receiver_address( "[127.0.0.1]:10001" );
+
+        auto sendPacket = (BlockPacket*) packetFactory.Create( PACKET_BLOCK );
+        sendPacket->block.Connect( core::memory::default_allocator(), (uint8_t*) core::memory::default_allocator().Allocate( BlockSize ), BlockSize );
+        for ( int i = 0; i < BlockSize; ++i )
+            sendPacket->block.GetData()[i] = i + 1;
+        interface_sender.SendPacket( receiver_address, sendPacket );
+
+        BlockPacket * receivedPacket = nullptr;
+        {
+            network::BSDSocketConfig receiver_config = sender_config;
+            receiver_config.port = 10001;
+            receiver_config.zeroCopy = true;
+
+            network::BSDSocket interface_receiver( receiver_config );
+
+            core::TimeBase timeBase;
+            timeBase.deltaTime = 0.01f;
+
+            for ( int iteration = 0; iteration < 100 && !receivedPacket; ++iteration )
+            {
+                interface_sender.Update( timeBase );
+                interface_receiver.Update( timeBase );
+
+                auto packet = interface_receiver.ReceivePacket();
+                if ( packet )
+                {
+                    CORE_CHECK( packet->GetType() == PACKET_BLOCK );
+                    receivedPacket = static_cast<BlockPacket*>( packet );
+                }
+
+                timeBase.time += timeBase.deltaTime;
+            }
+
+            CORE_CHECK( receivedPacket );
+            CORE_CHECK( receivedPacket->block.GetSize() == BlockSize );
+        }
+
+        // the block is a slice of the receive packet buffer. it must stay valid after the socket is gone
+
+        for ( int i = 0; i < BlockSize; ++i )
+            CORE_CHECK( receivedPacket->block.GetData()[i] == i + 1 );
+
+        packetFactory.Destroy( receivedPacket );
+    }
+    core::memory::shutdown();
+}
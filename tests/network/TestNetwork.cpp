@@ -11,6 +11,12 @@ extern void test_bsd_socket_send_and_receive_ipv4();
 extern void test_bsd_socket_send_and_receive_ipv6();
 extern void test_bsd_socket_send_and_receive_multiple_ipv4();
 extern void test_bsd_socket_send_and_receive_multiple_ipv6();
+extern void test_bsd_socket_send_and_receive_batched();
+extern void test_compressor();
+extern void test_bsd_socket_compression();
+extern void test_bsd_socket_zero_copy_outlives_socket();
+
+extern void test_simulator_receive_order();
 
 #if PROTOCOL_USE_RESOLVER
 extern void test_dns_resolve();
@@ -37,6 +43,12 @@ int main()
     test_bsd_socket_send_and_receive_ipv6();
     test_bsd_socket_send_and_receive_multiple_ipv4();
     test_bsd_socket_send_and_receive_multiple_ipv6();
+    test_bsd_socket_send_and_receive_batched();
+    test_compressor();
+    test_bsd_socket_compression();
+    test_bsd_socket_zero_copy_outlives_socket();
+
+    test_simulator_receive_order();
 
 #if PROTOCOL_USE_RESOLVER
     test_dns_resolve();
@@ -14,6 +14,7 @@ enum PacketTypes
     PACKET_CONNECT,
     PACKET_UPDATE,
     PACKET_DISCONNECT,
+    PACKET_BLOCK,
 
     NUM_PACKET_TYPES
 };
@@ -117,6 +118,21 @@ struct DisconnectPacket : public protocol::Packet
     }
 };
 
+struct BlockPacket : public protocol::Packet
+{
+    protocol::Block block;
+
+    BlockPacket() : Packet( PACKET_BLOCK )
+    {
+        block.SetAllocator( core::memory::default_allocator() );
+    }
+
+    PROTOCOL_SERIALIZE_OBJECT( stream )
+    {
+        serialize_block( stream, block, 256 );
+    }
+};
+
 class TestPacketFactory : public protocol::PacketFactory
 {
     core::Allocator * m_allocator;
@@ -139,6 +155,7 @@ protected:
             case PACKET_CONNECT:        return CORE_NEW( *m_allocator, ConnectPacket );
             case PACKET_UPDATE:         return CORE_NEW( *m_allocator, UpdatePacket );
             case PACKET_DISCONNECT:     return CORE_NEW( *m_allocator, DisconnectPacket );
+            case PACKET_BLOCK:          return CORE_NEW( *m_allocator, BlockPacket );
 
             default:
                 return nullptr;
@@ -0,0 +1,81 @@
+#include "network/Simulator.h"
+#include "TestPackets.h"
+
+static void simulator_send_and_receive( network::Simulator & simulator, TestPacketFactory & packetFactory, int numPackets, uint16_t * output )
+{
+    network::Address address( "::1" );
+    address.SetPort( 10000 );
+
+    core::TimeBase timeBase;
+    timeBase.deltaTime = 0.01;
+
+    simulator.Update( timeBase );
+
+    for ( int i = 0; i < numPackets; ++i )
+    {
+        auto packet = (UpdatePacket*) packetFactory.Create( PACKET_UPDATE );
+        packet->timestamp = i;
+        simulator.SendPacket( address, packet );
+    }
+
+    int numReceived = 0;
+
+    while ( numReceived < numPackets )
+    {
+        timeBase.time += timeBase.deltaTime;
+
+        simulator.Update( timeBase );
+
+        while ( true )
+        {
+            auto packet = simulator.ReceivePacket();
+            if ( !packet )
+                break;
+
+            CORE_CHECK( packet->GetType() == PACKET_UPDATE );
+            CORE_CHECK( numReceived < numPackets );
+
+            output[numReceived++] = static_cast<UpdatePacket*>( packet )->timestamp;
+
+            packetFactory.Destroy( packet );
+        }
+    }
+}
+
+void test_simulator_receive_order()
+{
+    printf( "test_simulator_receive_order\n" );
+
+    core::memory::initialize();
+    {
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const int NumPackets = 1000;
+
+        uint16_t heapOrder[NumPackets];
+        uint16_t linearOrder[NumPackets];
+
+        const unsigned int seed = (unsigned int) rand();
+
+        // the heap path must deliver packets in exactly the same order as the linear scan
+
+        for ( int pass = 0; pass < 2; ++pass )
+        {
+            network::SimulatorConfig simulatorConfig;
+            simulatorConfig.packetFactory = &packetFactory;
+            simulatorConfig.numPackets = NumPackets;
+            simulatorConfig.linearReceive = pass == 1;
+
+            network::Simulator simulator( simulatorConfig );
+            simulator.AddState( network::SimulatorState( 0.1f, 0.1f, 0.0f ) );
+
+            srand( seed );
+
+            simulator_send_and_receive( simulator, packetFactory, NumPackets, pass == 0 ? heapOrder : linearOrder );
+        }
+
+        for ( int i = 0; i < NumPackets; ++i )
+            CORE_CHECK( heapOrder[i] == linearOrder[i] );
+    }
+    core::memory::shutdown();
+}
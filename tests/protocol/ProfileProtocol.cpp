@@ -1,3 +1,276 @@
-#define PROFILE 1
+#include "protocol/Connection.h"
+#include "protocol/ReliableMessageChannel.h"
+#include "core/PoolAllocator.h"
+#include "TestMessages.h"
+#include "TestPackets.h"
+#include "tests/Profile.h"
 
-#include "SoakProtocol.cpp"
\ No newline at end of file
+const int MaxPacketSize = 4096;
+const int NumWarmupIterations = 1000;
+const int NumIterations = 20000;
+const int PacketLossPercent = 1;
+
+class ProfileChannelStructure : public protocol::ChannelStructure
+{
+    protocol::ReliableMessageChannelConfig m_config;
+
+public:
+
+    ProfileChannelStructure( protocol::MessageFactory & messageFactory, core::Allocator & allocator )
+        : ChannelStructure( core::memory::default_allocator(), allocator, 1 )
+    {
+        m_config.maxMessagesPerPacket = 256;
+        m_config.sendQueueSize = 2048;
+        m_config.receiveQueueSize = 512;
+        m_config.packetBudget = 4000;
+        m_config.maxMessageSize = 1024;
+        m_config.blockFragmentSize = 3900;
+        m_config.messageFactory = &messageFactory;
+        m_config.messageAllocator = &allocator;
+        m_config.smallBlockAllocator = &allocator;
+        m_config.largeBlockAllocator = &allocator;
+    }
+
+protected:
+
+    const char * GetChannelNameInternal( int /*channelIndex*/ ) const
+    {
+        return "reliable message channel";
+    }
+
+    protocol::Channel * CreateChannelInternal( int /*channelIndex*/ )
+    {
+        return CORE_NEW( GetChannelAllocator(), protocol::ReliableMessageChannel, m_config );
+    }
+
+    protocol::ChannelData * CreateChannelDataInternal( int /*channelIndex*/ )
+    {
+        return CORE_NEW( GetChannelDataAllocator(), protocol::ReliableMessageChannelData, m_config );
+    }
+};
+
+struct ProfileStats
+{
+    ProfileSamples writePacket;
+    ProfileSamples readPacket;
+    ProfileSamples serializeWrite;
+    ProfileSamples serializeRead;
+    uint64_t packets;
+    uint64_t bytes;
+
+    ProfileStats() : packets(0), bytes(0) {}
+
+    void Reset()
+    {
+        writePacket.Reset();
+        readPacket.Reset();
+        serializeWrite.Reset();
+        serializeRead.Reset();
+        packets = 0;
+        bytes = 0;
+    }
+};
+
+static void send_packet( protocol::Connection & sender,
+                         protocol::Connection & receiver,
+                         TestPacketFactory & packetFactory,
+                         const void ** context,
+                         uint8_t * buffer,
+                         ProfileStats & stats )
+{
+    uint64_t start = core::nanoseconds();
+    protocol::ConnectionPacket * packet = sender.WritePacket();
+    stats.writePacket.Add( core::nanoseconds() - start );
+
+    CORE_CHECK( packet );
+
+    int bytes = 0;
+    {
+        protocol::WriteStream stream( buffer, MaxPacketSize );
+        stream.SetContext( context );
+        start = core::nanoseconds();
+        packet->SerializeWrite( stream );
+        stream.Flush();
+        stats.serializeWrite.Add( core::nanoseconds() - start );
+        CORE_CHECK( !stream.IsOverflow() );
+        bytes = stream.GetBytesProcessed();
+    }
+
+    packetFactory.Destroy( packet );
+
+    stats.packets++;
+    stats.bytes += bytes;
+
+    if ( ( rand() % 100 ) < PacketLossPercent )
+        return;
+
+    auto readPacket = (protocol::ConnectionPacket*) packetFactory.Create( PACKET_CONNECTION );
+    {
+        protocol::ReadStream stream( buffer, MaxPacketSize );
+        stream.SetContext( context );
+        start = core::nanoseconds();
+        readPacket->SerializeRead( stream );
+        stats.serializeRead.Add( core::nanoseconds() - start );
+        CORE_CHECK( !stream.IsOverflow() );
+    }
+
+    start = core::nanoseconds();
+    receiver.ReadPacket( readPacket );
+    stats.readPacket.Add( core::nanoseconds() - start );
+
+    packetFactory.Destroy( readPacket );
+}
+
+void profile_protocol( bool csv, core::PoolAllocator * pool )
+{
+    // with a pool, packets, messages, channel data and blocks all come from it
+
+    core::Allocator & allocator = pool ? *pool : core::memory::default_allocator();
+
+    TestMessageFactory messageFactory( allocator );
+
+    ProfileChannelStructure channelStructure( messageFactory, pool ? *pool : core::memory::scratch_allocator() );
+
+    TestPacketFactory packetFactory( allocator );
+
+    const void * context[protocol::MaxContexts];
+    memset( context, 0, sizeof( context ) );
+    context[protocol::CONTEXT_CONNECTION] = &channelStructure;
+
+    protocol::ConnectionConfig connectionConfig;
+    connectionConfig.maxPacketSize = MaxPacketSize;
+    connectionConfig.packetFactory = &packetFactory;
+    connectionConfig.slidingWindowSize = 1024;
+    connectionConfig.channelStructure = &channelStructure;
+
+    protocol::Connection sender( connectionConfig );
+    protocol::Connection receiver( connectionConfig );
+
+    auto senderChannel = static_cast<protocol::ReliableMessageChannel*>( sender.GetChannel( 0 ) );
+    auto receiverChannel = static_cast<protocol::ReliableMessageChannel*>( receiver.GetChannel( 0 ) );
+
+    uint8_t * buffer = (uint8_t*) malloc( MaxPacketSize );
+
+    ProfileStats stats;
+    ProfileStats ackStats;
+
+    uint16_t sendMessageId = 0;
+    uint64_t numMessagesReceived = 0;
+    uint64_t startAllocations = 0;
+    uint64_t startTime = 0;
+    uint64_t startPoolAllocations = 0;
+    uint64_t startChunkAllocations = 0;
+
+    core::TimeBase timeBase;
+    timeBase.deltaTime = 0.01;
+
+    for ( int iteration = 0; iteration < NumWarmupIterations + NumIterations; ++iteration )
+    {
+        if ( iteration == NumWarmupIterations )
+        {
+            stats.Reset();
+            ackStats.Reset();
+            numMessagesReceived = 0;
+            startAllocations = core::memory::num_allocations();
+            if ( pool )
+            {
+                startPoolAllocations = pool->GetCounter( core::POOL_ALLOCATOR_COUNTER_ALLOCATIONS );
+                startChunkAllocations = pool->GetCounter( core::POOL_ALLOCATOR_COUNTER_CHUNK_ALLOCATIONS );
+            }
+            startTime = core::nanoseconds();
+        }
+
+        const int numMessagesToSend = 1 + rand() % 32;
+
+        for ( int i = 0; i < numMessagesToSend; ++i )
+        {
+            if ( !senderChannel->CanSendMessage() )
+                break;
+
+            if ( rand() % 10 )
+            {
+                auto message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+                CORE_CHECK( message );
+                message->sequence = sendMessageId;
+                senderChannel->SendMessage( message );
+            }
+            else
+            {
+                protocol::Block block( allocator, 1 + sendMessageId % 32 );
+                memset( block.GetData(), sendMessageId & 0xFF, block.GetSize() );
+                senderChannel->SendBlock( block );
+            }
+
+            sendMessageId++;
+        }
+
+        send_packet( sender, receiver, packetFactory, context, buffer, stats );
+
+        send_packet( receiver, sender, packetFactory, context, buffer, ackStats );
+
+        sender.Update( timeBase );
+        receiver.Update( timeBase );
+
+        while ( true )
+        {
+            auto message = receiverChannel->ReceiveMessage();
+            if ( !message )
+                break;
+            numMessagesReceived++;
+            messageFactory.Release( message );
+        }
+
+        timeBase.time += timeBase.deltaTime;
+    }
+
+    const double seconds = ( core::nanoseconds() - startTime ) / 1000000000.0;
+    const uint64_t numAllocations = core::memory::num_allocations() - startAllocations;
+
+    free( buffer );
+
+    ProfileReport report( pool ? "protocol_pool" : "protocol", csv );
+
+    report.Value( "iterations", NumIterations );
+    report.Value( "seconds", seconds );
+    report.Value( "packets_per_second", stats.packets / seconds );
+    report.Value( "messages_per_second", numMessagesReceived / seconds );
+    report.Value( "bytes_per_second", stats.bytes / seconds );
+    report.Value( "bytes_per_packet", stats.bytes / double( stats.packets ) );
+    report.Value( "allocations", (double) numAllocations );
+    report.Value( "allocations_per_packet", numAllocations / double( stats.packets + ackStats.packets ) );
+    if ( pool )
+    {
+        report.Value( "pool_allocations_per_packet", ( pool->GetCounter( core::POOL_ALLOCATOR_COUNTER_ALLOCATIONS ) - startPoolAllocations ) / double( stats.packets + ackStats.packets ) );
+        report.Value( "pool_chunk_allocations", (double) ( pool->GetCounter( core::POOL_ALLOCATOR_COUNTER_CHUNK_ALLOCATIONS ) - startChunkAllocations ) );
+        report.Value( "pool_oversize_allocations", (double) pool->GetCounter( core::POOL_ALLOCATOR_COUNTER_OVERSIZE_ALLOCATIONS ) );
+    }
+    report.Samples( "write_packet_ns", stats.writePacket );
+    report.Samples( "read_packet_ns", stats.readPacket );
+    report.Samples( "serialize_write_ns", stats.serializeWrite );
+    report.Samples( "serialize_read_ns", stats.serializeRead );
+    report.Samples( "ack_write_packet_ns", ackStats.writePacket );
+    report.Samples( "ack_read_packet_ns", ackStats.readPacket );
+}
+
+int main( int argc, char ** argv )
+{
+    srand( 0 );
+
+    core::memory::initialize();
+
+    const bool csv = profile_csv_output( argc, argv );
+
+    profile_protocol( csv, nullptr );
+
+    srand( 0 );
+
+    {
+        core::PoolAllocator pool( core::memory::default_allocator() );
+
+        profile_protocol( csv, &pool );
+    }
+
+    core::memory::shutdown();
+
+    return 0;
+}
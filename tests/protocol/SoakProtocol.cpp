@@ -60,11 +60,7 @@ protected:
 
 void soak_test()
 {
-#if PROFILE
-    printf( "[profile protocol]\n" );
-#else
     printf( "[soak protocol]\n" );
-#endif
 
     TestMessageFactory messageFactory( core::memory::default_allocator() );
 
@@ -189,9 +185,7 @@ void soak_test()
 
             if ( message->GetType() == MESSAGE_TEST )
             {
-#if !PROFILE
                 printf( "%09.2f - received message %d - test message\n", timeBase.time, message->GetId() );
-#endif
             }
             else
             {
@@ -206,9 +200,7 @@ void soak_test()
                     const uint8_t * data = block.GetData();
                     for ( int i = 0; i < block.GetSize(); ++i )
                         CORE_CHECK( data[i] == ( index + i ) % 256 );
-#if !PROFILE
                     printf( "%09.2f - received message %d - small block\n", timeBase.time, message->GetId() );
-#endif
                 }
                 else
                 {
@@ -217,9 +209,7 @@ void soak_test()
                     const uint8_t * data = block.GetData();
                     for ( int i = 0; i < block.GetSize(); ++i )
                         CORE_CHECK( data[i] == ( index + i ) % 256 );
-#if !PROFILE
                     printf( "%09.2f - received message %d - large block\n", timeBase.time, message->GetId() );
-#endif
                 }
             }
 
@@ -228,7 +218,6 @@ void soak_test()
             messageFactory.Release( message );
         }
 
-#if !PROFILE
         auto status = messageChannel->GetReceiveLargeBlockStatus();
         if ( status.receiving )
             printf( "%09.2f - receiving large block %d - %d/%d fragments\n",
@@ -236,7 +225,6 @@ void soak_test()
                     status.blockId, 
                     status.numReceivedFragments, 
                     status.numFragments );
-#endif
 
         CORE_CHECK( messageChannel->GetCounter( protocol::RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_SENT ) == numMessagesSent );
         CORE_CHECK( messageChannel->GetCounter( protocol::RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_RECEIVED ) == numMessagesReceived );
@@ -57,3 +57,90 @@ void test_bitpacker()
     CORE_CHECK( reader.GetBitsRead() == bitsWritten );
     CORE_CHECK( reader.GetBitsRemaining() == BufferSize * 8 - bitsWritten );
 }
+
+void test_bitpacker_bulk()
+{
+    printf( "test_bitpacker_bulk\n" );
+
+    const int BufferSize = 1024;
+    const int NumValues = 300;
+    const int ValueBits = 11;
+
+    uint8_t bulkBuffer[BufferSize];
+    uint8_t singleBuffer[BufferSize];
+
+    memset( bulkBuffer, 0, BufferSize );
+    memset( singleBuffer, 0, BufferSize );
+
+    uint32_t values[NumValues];
+    for ( int i = 0; i < NumValues; ++i )
+        values[i] = ( i * 7919 ) & ( ( 1 << ValueBits ) - 1 );
+
+    const uint64_t a = 0x123456789ULL;
+    const uint64_t b = 0xFEDCBA9876543210ULL;
+
+    // bulk writes must produce exactly the same bits as the equivalent per-value writes
+
+    protocol::BitWriter bulkWriter( bulkBuffer, BufferSize );
+    bulkWriter.WriteBits( 5, 3 );
+    bulkWriter.WriteBitsArray( values, NumValues, ValueBits );
+    bulkWriter.WriteBits64( a, 40 );
+    bulkWriter.WriteBits64( b, 64 );
+    bulkWriter.WriteBits64( 1, 1 );
+    bulkWriter.FlushBits();
+
+    protocol::BitWriter singleWriter( singleBuffer, BufferSize );
+    singleWriter.WriteBits( 5, 3 );
+    for ( int i = 0; i < NumValues; ++i )
+        singleWriter.WriteBits( values[i], ValueBits );
+    singleWriter.WriteBits( uint32_t( a >> 32 ), 8 );
+    singleWriter.WriteBits( uint32_t( a ), 32 );
+    singleWriter.WriteBits( uint32_t( b >> 32 ), 32 );
+    singleWriter.WriteBits( uint32_t( b ), 32 );
+    singleWriter.WriteBits( 1, 1 );
+    singleWriter.FlushBits();
+
+    const int bitsWritten = 3 + NumValues * ValueBits + 40 + 64 + 1;
+
+    CORE_CHECK( !bulkWriter.IsOverflow() );
+    CORE_CHECK( bulkWriter.GetBitsWritten() == bitsWritten );
+    CORE_CHECK( bulkWriter.GetBytesWritten() == singleWriter.GetBytesWritten() );
+    CORE_CHECK( memcmp( bulkBuffer, singleBuffer, bulkWriter.GetBytesWritten() ) == 0 );
+
+    protocol::BitReader reader( bulkBuffer, BufferSize );
+
+    CORE_CHECK( reader.ReadBits( 3 ) == 5 );
+
+    uint32_t readValues[NumValues];
+    reader.ReadBitsArray( readValues, NumValues, ValueBits );
+    CORE_CHECK( memcmp( readValues, values, sizeof( values ) ) == 0 );
+
+    CORE_CHECK( reader.ReadBits64( 40 ) == a );
+    CORE_CHECK( reader.ReadBits64( 64 ) == b );
+    CORE_CHECK( reader.ReadBits64( 1 ) == 1 );
+    CORE_CHECK( !reader.IsOverflow() );
+    CORE_CHECK( reader.GetBitsRead() == bitsWritten );
+
+    // a run that does not fit must write nothing and flag overflow
+
+    const int SmallBufferSize = 16;
+
+    uint8_t smallBuffer[SmallBufferSize];
+
+    protocol::BitWriter smallWriter( smallBuffer, SmallBufferSize );
+    smallWriter.WriteBits( 1, 1 );
+    CORE_CHECK( !smallWriter.IsOverflow() );
+    smallWriter.WriteBitsArray( values, 12, ValueBits );
+    CORE_CHECK( smallWriter.IsOverflow() );
+    CORE_CHECK( smallWriter.GetBitsWritten() == 1 );
+
+    memset( smallBuffer, 0, SmallBufferSize );
+
+    protocol::BitReader smallReader( smallBuffer, SmallBufferSize );
+    smallReader.ReadBits( 1 );
+    readValues[0] = 1;
+    smallReader.ReadBitsArray( readValues, 12, ValueBits );
+    CORE_CHECK( smallReader.IsOverflow() );
+    CORE_CHECK( smallReader.GetBitsRead() == 1 );
+    CORE_CHECK( readValues[0] == 0 );
+}
@@ -82,7 +82,6 @@ public:
     AckChannel( int * _ackedPackets )
         : ackedPackets( _ackedPackets ) 
     {
-        ackedPackets = NULL;
     }
 
     bool ProcessData( uint16_t /*sequence*/, protocol::ChannelData * /*data*/ )
@@ -197,3 +196,349 @@ void test_acks()
     }
     core::memory::shutdown();
 }
+
+void test_acks_window()
+{
+    printf( "test_acks_window\n" );
+
+    core::memory::initialize();
+    {
+        // return packets are lost in bursts of 48. a 32 packet ack window cannot ack
+        // packets received early in a burst, while 64 and 128 packet windows ack them all
+
+        const int NumIterations = 1000;
+        const int BurstLength = 48;
+
+        const int ackWindowSize[] = { 32, 64, 128 };
+
+        for ( int window = 0; window < 3; ++window )
+        {
+            int receivedPackets[NumIterations];
+            int senderAckedPackets[NumIterations];
+            int receiverAckedPackets[NumIterations];
+
+            memset( receivedPackets, 0, sizeof( receivedPackets ) );
+            memset( senderAckedPackets, 0, sizeof( senderAckedPackets ) );
+            memset( receiverAckedPackets, 0, sizeof( receiverAckedPackets ) );
+
+            AckChannelStructure senderChannelStructure( senderAckedPackets );
+            AckChannelStructure receiverChannelStructure( receiverAckedPackets );
+
+            TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+            protocol::ConnectionConfig connectionConfig;
+            connectionConfig.packetFactory = &packetFactory;
+            connectionConfig.ackWindowSize = ackWindowSize[window];
+
+            connectionConfig.channelStructure = &senderChannelStructure;
+            protocol::Connection sender( connectionConfig );
+
+            connectionConfig.channelStructure = &receiverChannelStructure;
+            protocol::Connection receiver( connectionConfig );
+
+            for ( int i = 0; i < NumIterations; ++i )
+            {
+                protocol::ConnectionPacket * packet = sender.WritePacket();
+                CORE_CHECK( packet );
+                if ( receiver.ReadPacket( packet ) )
+                    receivedPackets[packet->sequence] = true;
+                packetFactory.Destroy( packet );
+
+                packet = receiver.WritePacket();
+                CORE_CHECK( packet );
+                CORE_CHECK( packet->num_ack_words * 32 == ackWindowSize[window] );
+                if ( i % 100 >= BurstLength || i >= NumIterations - 64 )
+                    sender.ReadPacket( packet );
+                packetFactory.Destroy( packet );
+            }
+
+            int numAckedPackets = 0;
+            int numReceivedPackets = 0;
+            for ( int i = 0; i < NumIterations; ++i )
+            {
+                if ( senderAckedPackets[i] )
+                    numAckedPackets++;
+
+                if ( receivedPackets[i] )
+                    numReceivedPackets++;
+
+                // an acked packet *must* have been received
+                if ( senderAckedPackets[i] && !receivedPackets[i] )
+                    CORE_CHECK( false );
+            }
+
+            CORE_CHECK( numAckedPackets > 0 );
+
+            if ( ackWindowSize[window] > BurstLength )
+                CORE_CHECK( numAckedPackets == numReceivedPackets );
+            else
+                CORE_CHECK( numAckedPackets < numReceivedPackets );
+        }
+    }
+    core::memory::shutdown();
+}
+
+void test_connection_rtt()
+{
+    printf( "test_connection_rtt\n" );
+
+    core::memory::initialize();
+    {
+        // packets take a fixed number of ticks to arrive in each direction and every 5th packet
+        // sent is lost, so the round trip time and packet loss estimates converge on known values
+
+        const int NumIterations = 1000;
+        const int Delay = 5;
+        const int LossInterval = 5;
+
+        FakeChannelStructure channelStructure;
+
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        protocol::ConnectionConfig connectionConfig;
+        connectionConfig.packetFactory = &packetFactory;
+        connectionConfig.channelStructure = &channelStructure;
+
+        protocol::Connection sender( connectionConfig );
+        protocol::Connection receiver( connectionConfig );
+
+        CORE_CHECK( sender.GetRTT() == 0.0f );
+        CORE_CHECK( sender.GetRTO() == 0.0f );
+
+        protocol::ConnectionPacket * senderPackets[Delay];
+        protocol::ConnectionPacket * receiverPackets[Delay];
+
+        memset( senderPackets, 0, sizeof( senderPackets ) );
+        memset( receiverPackets, 0, sizeof( receiverPackets ) );
+
+        core::TimeBase timeBase;
+        timeBase.deltaTime = 0.01;
+
+        for ( int i = 0; i < NumIterations; ++i )
+        {
+            sender.Update( timeBase );
+            receiver.Update( timeBase );
+
+            const int index = i % Delay;
+
+            if ( senderPackets[index] )
+            {
+                receiver.ReadPacket( senderPackets[index] );
+                packetFactory.Destroy( senderPackets[index] );
+                senderPackets[index] = nullptr;
+            }
+
+            if ( receiverPackets[index] )
+            {
+                sender.ReadPacket( receiverPackets[index] );
+                packetFactory.Destroy( receiverPackets[index] );
+                receiverPackets[index] = nullptr;
+            }
+
+            protocol::ConnectionPacket * packet = sender.WritePacket();
+            CORE_CHECK( packet );
+            if ( i % LossInterval == 0 )
+                packetFactory.Destroy( packet );
+            else
+                senderPackets[index] = packet;
+
+            packet = receiver.WritePacket();
+            CORE_CHECK( packet );
+            receiverPackets[index] = packet;
+
+            timeBase.time += timeBase.deltaTime;
+        }
+
+        for ( int i = 0; i < Delay; ++i )
+        {
+            if ( senderPackets[i] )
+                packetFactory.Destroy( senderPackets[i] );
+            if ( receiverPackets[i] )
+                packetFactory.Destroy( receiverPackets[i] );
+        }
+
+        const float ExpectedRTT = float( 2 * Delay * timeBase.deltaTime );
+
+        CORE_CHECK( fabs( sender.GetRTT() - ExpectedRTT ) < 0.001f );
+        CORE_CHECK( sender.GetRTTVariance() < 0.001f );
+        CORE_CHECK( sender.GetRTO() >= sender.GetRTT() );
+        CORE_CHECK( sender.GetCounter( protocol::CONNECTION_COUNTER_RTT_MICROSECONDS ) > 0 );
+
+        CORE_CHECK( sender.GetPacketLoss() > 0.1f );
+        CORE_CHECK( sender.GetPacketLoss() < 0.3f );
+        CORE_CHECK( sender.GetCounter( protocol::CONNECTION_COUNTER_PACKET_LOSS_PPM ) > 0 );
+        CORE_CHECK( sender.GetCounter( protocol::CONNECTION_COUNTER_PACKETS_LOST ) > NumIterations / LossInterval - 64 );
+        CORE_CHECK( sender.GetCounter( protocol::CONNECTION_COUNTER_PACKETS_LOST ) <= NumIterations / LossInterval );
+
+        // nothing sent by the receiver is lost
+
+        CORE_CHECK( receiver.GetPacketLoss() == 0.0f );
+        CORE_CHECK( receiver.GetCounter( protocol::CONNECTION_COUNTER_PACKETS_LOST ) == 0 );
+        CORE_CHECK( fabs( receiver.GetRTT() - ExpectedRTT ) < 0.02f );
+    }
+    core::memory::shutdown();
+}
+
+class BandwidthChannelData : public protocol::ChannelData
+{
+public:
+
+    static const int MaxBytes = 1024;
+
+    int numBytes;
+    uint8_t data[MaxBytes];
+
+    BandwidthChannelData() : numBytes(0) { memset( data, 0, sizeof( data ) ); }
+
+    PROTOCOL_SERIALIZE_OBJECT( stream )
+    {
+        serialize_int( stream, numBytes, 1, MaxBytes );
+        serialize_bytes( stream, data, numBytes );
+    }
+};
+
+class BandwidthChannel : public protocol::ChannelAdapter
+{
+public:
+
+    int chunkBytes;                 // bytes this channel wants to send per-packet. chunks are never split.
+
+    BandwidthChannel() : chunkBytes(0) {}
+
+    bool HasDataToSend() const { return chunkBytes > 0; }
+
+    protocol::ChannelData * GetData( uint16_t /*sequence*/, int availableBits )
+    {
+        const int overheadBits = 10 + 7;
+        if ( chunkBytes == 0 || availableBits < overheadBits + chunkBytes * 8 )
+            return nullptr;
+        auto data = CORE_NEW( core::memory::scratch_allocator(), BandwidthChannelData );
+        data->numBytes = chunkBytes;
+        return data;
+    }
+};
+
+class BandwidthChannelStructure : public protocol::ChannelStructure
+{
+public:
+
+    BandwidthChannelStructure() : ChannelStructure( core::memory::default_allocator(), core::memory::scratch_allocator(), 3 ) {}
+
+protected:
+
+    const char * GetChannelNameInternal( int /*channelIndex*/ ) const
+    {
+        return "bandwidth channel";
+    }
+
+    protocol::Channel * CreateChannelInternal( int /*channelIndex*/ )
+    {
+        return CORE_NEW( GetChannelAllocator(), BandwidthChannel );
+    }
+
+    protocol::ChannelData * CreateChannelDataInternal( int /*channelIndex*/ )
+    {
+        return CORE_NEW( GetChannelDataAllocator(), BandwidthChannelData );
+    }
+};
+
+void test_connection_bandwidth()
+{
+    printf( "test_connection_bandwidth\n" );
+
+    core::memory::initialize();
+    {
+        const int MaxPacketSize = 1024;
+        const int NumPackets = 100;
+
+        // channel 0 is a fat low priority channel that would fill the whole packet by itself,
+        // channel 1 is a high priority state channel, channel 2 is idle and must not waste space
+
+        BandwidthChannelStructure channelStructure;
+        channelStructure.SetChannelPriority( 1, 1 );
+        channelStructure.SetChannelWeight( 0, 2.0f );
+
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const void * context[protocol::MaxContexts];
+        memset( context, 0, sizeof( context ) );
+        context[protocol::CONTEXT_CONNECTION] = &channelStructure;
+
+        protocol::ConnectionConfig connectionConfig;
+        connectionConfig.maxPacketSize = MaxPacketSize;
+        connectionConfig.packetFactory = &packetFactory;
+        connectionConfig.channelStructure = &channelStructure;
+        connectionConfig.context = context;
+
+        protocol::Connection connection( connectionConfig );
+
+        auto fatChannel = static_cast<BandwidthChannel*>( connection.GetChannel( 0 ) );
+        auto stateChannel = static_cast<BandwidthChannel*>( connection.GetChannel( 1 ) );
+
+        uint8_t buffer[MaxPacketSize];
+
+        // 1. both channels fit: everything is sent each packet and spare space goes to the fat channel
+
+        fatChannel->chunkBytes = 600;
+        stateChannel->chunkBytes = 200;
+
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            protocol::ConnectionPacket * packet = connection.WritePacket();
+            CORE_CHECK( packet );
+            CORE_CHECK( packet->channelData[0] );
+            CORE_CHECK( packet->channelData[1] );
+            CORE_CHECK( !packet->channelData[2] );
+
+            protocol::WriteStream stream( buffer, MaxPacketSize );
+            stream.SetContext( context );
+            packet->SerializeWrite( stream );
+            stream.Flush();
+            CORE_CHECK( !stream.IsOverflow() );
+
+            packetFactory.Destroy( packet );
+        }
+
+        CORE_CHECK( connection.GetChannelCounter( 0, protocol::CONNECTION_CHANNEL_COUNTER_PACKETS_WRITTEN ) == NumPackets );
+        CORE_CHECK( connection.GetChannelCounter( 1, protocol::CONNECTION_CHANNEL_COUNTER_PACKETS_WRITTEN ) == NumPackets );
+        CORE_CHECK( connection.GetChannelCounter( 2, protocol::CONNECTION_CHANNEL_COUNTER_PACKETS_WRITTEN ) == 0 );
+        CORE_CHECK( connection.GetChannelCounter( 2, protocol::CONNECTION_CHANNEL_COUNTER_BITS_WRITTEN ) == 0 );
+        CORE_CHECK( connection.GetChannelCounter( 0, protocol::CONNECTION_CHANNEL_COUNTER_BITS_WRITTEN ) > connection.GetChannelCounter( 1, protocol::CONNECTION_CHANNEL_COUNTER_BITS_WRITTEN ) );
+
+        // 2. the high priority channel wants more than its share in chunks that don't fit next to
+        // the fat channel's chunks. carry over must still let the fat channel through regularly.
+
+        connection.Reset();
+
+        fatChannel->chunkBytes = 500;
+        stateChannel->chunkBytes = 700;
+
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            protocol::ConnectionPacket * packet = connection.WritePacket();
+            CORE_CHECK( packet );
+            CORE_CHECK( !( packet->channelData[0] && packet->channelData[1] ) );
+
+            protocol::WriteStream stream( buffer, MaxPacketSize );
+            stream.SetContext( context );
+            packet->SerializeWrite( stream );
+            stream.Flush();
+            CORE_CHECK( !stream.IsOverflow() );
+
+            packetFactory.Destroy( packet );
+        }
+
+        const uint64_t fatPackets = connection.GetChannelCounter( 0, protocol::CONNECTION_CHANNEL_COUNTER_PACKETS_WRITTEN );
+        const uint64_t statePackets = connection.GetChannelCounter( 1, protocol::CONNECTION_CHANNEL_COUNTER_PACKETS_WRITTEN );
+        const uint64_t fatBits = connection.GetChannelCounter( 0, protocol::CONNECTION_CHANNEL_COUNTER_BITS_WRITTEN );
+        const uint64_t stateBits = connection.GetChannelCounter( 1, protocol::CONNECTION_CHANNEL_COUNTER_BITS_WRITTEN );
+
+        // bandwidth is split roughly 2:1 by weight, so neither channel starves
+
+        CORE_CHECK( fatPackets + statePackets == NumPackets );
+        CORE_CHECK( statePackets >= NumPackets / 4 );
+        CORE_CHECK( fatBits >= stateBits );
+        CORE_CHECK( fatBits <= stateBits * 3 );
+    }
+    core::memory::shutdown();
+}
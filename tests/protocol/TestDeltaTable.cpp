@@ -0,0 +1,164 @@
+#include "protocol/DeltaTable.h"
+#include "protocol/Stream.h"
+#include "core/Memory.h"
+#include <stdio.h>
+#include <string.h>
+
+const int NumDeltas = 256;
+const int HistogramEntries = 1024;
+
+// the same bounds as serialize_offset with a small bound of 16 and a large bound of 256
+
+constexpr protocol::DeltaBucketTable TwoBuckets =
+{
+    2,
+    {
+        { 0, 4, 0x0, 1 },
+        { 16, 8, 0x1, 1 },
+    }
+};
+
+static_assert( protocol::delta_table_valid( TwoBuckets ), "two bucket table is not valid" );
+static_assert( protocol::delta_table_max( TwoBuckets ) == 271, "two bucket table covers the wrong range" );
+
+constexpr protocol::DeltaBucketTable BadBuckets =
+{
+    2,
+    {
+        { 0, 4, 0x0, 1 },
+        { 17, 8, 0x1, 1 },
+    }
+};
+
+static_assert( !protocol::delta_table_valid( BadBuckets ), "buckets with a gap must not be valid" );
+
+struct TestDeltaTableObject
+{
+    const protocol::DeltaBucketTable * table;
+    int deltas[NumDeltas];
+
+    template <typename Stream> void Serialize( Stream & stream )
+    {
+        for ( int i = 0; i < NumDeltas; ++i )
+            serialize_delta( stream, deltas[i], *table );
+    }
+};
+
+static int random_delta( int max )
+{
+    int delta = 0;
+    while ( delta < max && ( rand() % 3 ) != 0 )
+        delta++;
+    return ( rand() % 2 ) ? delta : -delta;
+}
+
+static int write_deltas( TestDeltaTableObject & object, uint8_t * buffer, int bufferSize )
+{
+    protocol::WriteStream stream( buffer, bufferSize );
+    object.Serialize( stream );
+    stream.Flush();
+    CORE_CHECK( !stream.IsOverflow() );
+    return stream.GetBitsProcessed();
+}
+
+static void read_deltas( TestDeltaTableObject & object, uint8_t * buffer, int bufferSize )
+{
+    protocol::ReadStream stream( buffer, bufferSize );
+    object.Serialize( stream );
+    CORE_CHECK( !stream.IsOverflow() );
+    CORE_CHECK( !stream.Aborted() );
+}
+
+void test_delta_table()
+{
+    printf( "test_delta_table\n" );
+
+    core::memory::initialize();
+    {
+        const int BufferSize = 4096;
+
+        uint8_t buffer[BufferSize];
+
+        // build a table from a histogram of mostly small absolute deltas
+
+        uint64_t histogram[HistogramEntries];
+        memset( histogram, 0, sizeof( histogram ) );
+        for ( int i = 0; i < 100000; ++i )
+        {
+            const int delta = random_delta( HistogramEntries - 1 );
+            histogram[delta >= 0 ? delta : -delta]++;
+        }
+
+        protocol::DeltaBucketTable table;
+        const float cost = protocol::BuildDeltaBucketTable( histogram, HistogramEntries, protocol::MaxDeltaBuckets, table );
+
+        CORE_CHECK( protocol::delta_table_valid( table ) );
+        CORE_CHECK( protocol::delta_table_max( table ) >= HistogramEntries - 1 );
+        CORE_CHECK( cost == protocol::GetDeltaBucketTableCost( histogram, HistogramEntries, table ) );
+
+        // codes must be prefix free
+
+        for ( int i = 0; i < table.numBuckets; ++i )
+        {
+            for ( int j = 0; j < table.numBuckets; ++j )
+            {
+                if ( i == j || table.buckets[i].codeLength > table.buckets[j].codeLength )
+                    continue;
+                const int shift = table.buckets[j].codeLength - table.buckets[i].codeLength;
+                CORE_CHECK( ( table.buckets[j].code >> shift ) != table.buckets[i].code );
+            }
+        }
+
+        // the bucket table beats the best small and large bounds for the same histogram
+
+        int smallBound = 0;
+        int largeBound = 0;
+        const float boundsCost = protocol::FindDeltaBounds( histogram, HistogramEntries, 32, smallBound, largeBound );
+
+        CORE_CHECK( smallBound > 0 );
+        CORE_CHECK( largeBound > smallBound );
+        CORE_CHECK( cost < boundsCost );
+
+        // deltas round trip with both tables, and the tuned table sends fewer bits
+
+        for ( int iteration = 0; iteration < 16; ++iteration )
+        {
+            TestDeltaTableObject writeObject;
+            for ( int i = 0; i < NumDeltas; ++i )
+                writeObject.deltas[i] = random_delta( protocol::delta_table_max( TwoBuckets ) );
+            writeObject.deltas[0] = protocol::delta_table_max( TwoBuckets );
+            writeObject.deltas[1] = -protocol::delta_table_max( TwoBuckets );
+            writeObject.deltas[2] = 0;
+
+            writeObject.table = &TwoBuckets;
+            const int twoBucketBits = write_deltas( writeObject, buffer, BufferSize );
+
+            TestDeltaTableObject readObject;
+            readObject.table = &TwoBuckets;
+            read_deltas( readObject, buffer, BufferSize );
+            for ( int i = 0; i < NumDeltas; ++i )
+                CORE_CHECK( readObject.deltas[i] == writeObject.deltas[i] );
+
+            writeObject.table = &table;
+            const int tunedBits = write_deltas( writeObject, buffer, BufferSize );
+
+            readObject.table = &table;
+            read_deltas( readObject, buffer, BufferSize );
+            for ( int i = 0; i < NumDeltas; ++i )
+                CORE_CHECK( readObject.deltas[i] == writeObject.deltas[i] );
+
+            CORE_CHECK( tunedBits < twoBucketBits );
+        }
+
+        // a single bucket needs no prefix code
+
+        memset( histogram, 0, sizeof( histogram ) );
+        for ( int i = 0; i < 8; ++i )
+            histogram[i] = 1000;
+        protocol::BuildDeltaBucketTable( histogram, 8, 1, table );
+        CORE_CHECK( table.numBuckets == 1 );
+        CORE_CHECK( table.buckets[0].codeLength == 0 );
+        CORE_CHECK( table.buckets[0].bits == 3 );
+    }
+    core::memory::shutdown();
+}
@@ -93,6 +93,26 @@ void test_generate_ack_bits()
 
         CORE_CHECK( ack == 11 );
         CORE_CHECK( ack_bits == ( 1 | (1<<(11-9)) | (1<<(11-5)) | (1<<(11-1)) ) );
+
+        // wide ack windows: the mask rolls forward on insert and matches a search of the buffer
+
+        received_packets.Reset();
+        for ( int i = 0; i < 1000; ++i )
+        {
+            if ( rand() % 3 )
+                received_packets.Insert( i * 7 % 1000 < 900 ? i : i - 50 );
+
+            uint32_t wide_ack_bits[protocol::MaxAckWords];
+            GenerateAckBits( received_packets, ack, wide_ack_bits, protocol::MaxAckWords );
+            CORE_CHECK( ack == uint16_t( received_packets.GetSequence() - 1 ) );
+
+            for ( int j = 0; j < protocol::MaxAckBits; ++j )
+            {
+                const bool expected = received_packets.Find( ack - j ) != nullptr;
+                const bool actual = ( wide_ack_bits[j/32] & ( 1U << ( j % 32 ) ) ) != 0;
+                CORE_CHECK( expected == actual );
+            }
+        }
     }
 
     core::memory::shutdown();
@@ -6,8 +6,13 @@
 extern void test_message_factory();
 extern void test_packet_factory();
 extern void test_bitpacker();
+extern void test_bitpacker_bulk();
 extern void test_stream();
 extern void test_stream_context();
+extern void test_stream_packet_buffer();
+extern void test_stream_packet_buffer_adjacent_slices();
+extern void test_range_stream();
+extern void test_delta_table();
 extern void test_bit_array();
 extern void test_sliding_window();
 extern void test_sequence_buffer();
@@ -16,11 +21,19 @@ extern void test_block();
 
 extern void test_connection();
 extern void test_acks();
+extern void test_acks_window();
+extern void test_connection_rtt();
+extern void test_connection_bandwidth();
 
 extern void test_reliable_message_channel_messages();
 extern void test_reliable_message_channel_small_blocks();
 extern void test_reliable_message_channel_large_blocks();
 extern void test_reliable_message_channel_mixture();
+extern void test_reliable_message_channel_large_block_window();
+
+extern void test_unreliable_message_channel_messages();
+extern void test_unreliable_message_channel_sequenced();
+extern void test_unreliable_message_channel_too_large();
 
 extern void test_client_initial_state();
 extern void test_client_resolve_hostname_failure();
@@ -58,8 +71,13 @@ int main()
     test_message_factory();
     test_packet_factory();
     test_bitpacker();
+    test_bitpacker_bulk();
     test_stream();
     test_stream_context();
+    test_stream_packet_buffer();
+    test_stream_packet_buffer_adjacent_slices();
+    test_range_stream();
+    test_delta_table();
     test_bit_array();
     test_sliding_window();
     test_sequence_buffer();
@@ -68,11 +86,19 @@ int main()
 
     test_connection();
     test_acks();
+    test_acks_window();
+    test_connection_rtt();
+    test_connection_bandwidth();
 
     test_reliable_message_channel_messages();
     test_reliable_message_channel_small_blocks();
     test_reliable_message_channel_large_blocks();
     test_reliable_message_channel_mixture();
+    test_reliable_message_channel_large_block_window();
+
+    test_unreliable_message_channel_messages();
+    test_unreliable_message_channel_sequenced();
+    test_unreliable_message_channel_too_large();
 
     test_data_block_send_and_receive();
     test_data_block_send_and_receive_packet_loss();
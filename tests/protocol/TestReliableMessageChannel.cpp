@@ -509,3 +509,181 @@ void test_reliable_message_channel_mixture()
     }
     core::memory::shutdown();
 }
+
+class LargeBlockChannelStructure : public protocol::ChannelStructure
+{
+    protocol::ReliableMessageChannelConfig m_config;
+
+public:
+
+    LargeBlockChannelStructure( TestMessageFactory & messageFactory, int maxFragmentsPerPacket, int maxConcurrentLargeBlocks )
+        : ChannelStructure( core::memory::default_allocator(), core::memory::scratch_allocator(), 1 )
+    {
+        m_config.messageFactory = &messageFactory;
+        m_config.messageAllocator = &core::memory::default_allocator();
+        m_config.smallBlockAllocator = &core::memory::default_allocator();
+        m_config.largeBlockAllocator = &core::memory::default_allocator();
+        m_config.packetBudget = 1800;
+        m_config.blockFragmentSize = 256;
+        m_config.maxFragmentsPerPacket = maxFragmentsPerPacket;
+        m_config.maxConcurrentLargeBlocks = maxConcurrentLargeBlocks;
+        m_config.fragmentWindowSize = 64;
+    }
+
+protected:
+
+    const char * GetChannelNameInternal( int /*channelIndex*/ ) const
+    {
+        return "reliable message channel";
+    }
+    
+    protocol::Channel * CreateChannelInternal( int /*channelIndex*/ )
+    {
+        return CORE_NEW( GetChannelAllocator(), protocol::ReliableMessageChannel, m_config );
+    }
+
+    protocol::ChannelData * CreateChannelDataInternal( int /*channelIndex*/ )
+    {
+        return CORE_NEW( GetChannelDataAllocator(), protocol::ReliableMessageChannelData, m_config );
+    }
+};
+
+static int transfer_large_blocks( int maxFragmentsPerPacket, int maxConcurrentLargeBlocks )
+{
+    // sends four 64k blocks with messages in between, returns the number of packets it took to receive them all
+
+    TestMessageFactory messageFactory( core::memory::default_allocator() );
+
+    LargeBlockChannelStructure channelStructure( messageFactory, maxFragmentsPerPacket, maxConcurrentLargeBlocks );
+
+    TestPacketFactory packetFactory( core::memory::default_allocator() );
+    
+    const void * context[protocol::MaxContexts];
+    memset( context, 0, sizeof( context ) );
+    context[protocol::CONTEXT_CONNECTION] = &channelStructure;
+
+    protocol::ConnectionConfig connectionConfig;
+    connectionConfig.maxPacketSize = 2048;
+    connectionConfig.packetFactory = &packetFactory;
+    connectionConfig.channelStructure = &channelStructure;
+
+    protocol::Connection connection( connectionConfig );
+
+    protocol::ReliableMessageChannel * messageChannel = static_cast<protocol::ReliableMessageChannel*>( connection.GetChannel( 0 ) );
+
+    const int NumBlocks = 4;
+    const int BlockSize = 64 * 1024 + 100;
+    const int MessagesPerBlock = 4;
+    const int NumMessagesSent = NumBlocks * ( MessagesPerBlock + 1 );
+    const int MaxIterations = 100000;
+
+    for ( int i = 0; i < NumMessagesSent; ++i )
+    {
+        if ( i % ( MessagesPerBlock + 1 ) == 0 )
+        {
+            protocol::Block block( core::memory::default_allocator(), BlockSize + i );
+            uint8_t * data = block.GetData();
+            for ( int j = 0; j < block.GetSize(); ++j )
+                data[j] = ( i + j ) % 256;
+            messageChannel->SendBlock( block );
+        }
+        else
+        {
+            TestMessage * message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+            CORE_CHECK( message );
+            message->sequence = i;
+            messageChannel->SendMessage( message );
+        }
+    }
+
+    core::TimeBase timeBase;
+    timeBase.deltaTime = 0.01f;
+
+    network::Address address( "::1" );
+
+    network::SimulatorConfig simulatorConfig;
+    simulatorConfig.packetFactory = &packetFactory;
+    simulatorConfig.maxPacketSize = connectionConfig.maxPacketSize;
+    network::Simulator simulator( simulatorConfig );
+    simulator.SetContext( context );
+    simulator.AddState( network::SimulatorState( 0.05f, 0.0f, 10 ) );
+
+    int numMessagesReceived = 0;
+
+    int iteration = 0;
+
+    for ( ; iteration < MaxIterations; ++iteration )
+    {
+        protocol::ConnectionPacket * writePacket = connection.WritePacket();
+        CORE_CHECK( writePacket );
+
+        simulator.SendPacket( address, writePacket );
+
+        simulator.Update( timeBase );
+
+        while ( protocol::Packet * packet = simulator.ReceivePacket() )
+        {
+            connection.ReadPacket( static_cast<protocol::ConnectionPacket*>( packet ) );
+            packetFactory.Destroy( packet );
+        }
+
+        while ( protocol::Message * message = messageChannel->ReceiveMessage() )
+        {
+            CORE_CHECK( message->GetId() == numMessagesReceived );
+
+            if ( numMessagesReceived % ( MessagesPerBlock + 1 ) == 0 )
+            {
+                CORE_CHECK( message->GetType() == MESSAGE_BLOCK );
+                protocol::Block & block = static_cast<protocol::BlockMessage*>( message )->GetBlock();
+                CORE_CHECK( block.GetSize() == BlockSize + numMessagesReceived );
+                const uint8_t * data = block.GetData();
+                for ( int i = 0; i < block.GetSize(); ++i )
+                    CORE_CHECK( data[i] == ( numMessagesReceived + i ) % 256 );
+            }
+            else
+            {
+                CORE_CHECK( message->GetType() == MESSAGE_TEST );
+                CORE_CHECK( static_cast<TestMessage*>( message )->sequence == numMessagesReceived );
+            }
+
+            ++numMessagesReceived;
+
+            messageFactory.Release( message );
+        }
+
+        if ( numMessagesReceived == NumMessagesSent )
+            break;
+
+        connection.Update( timeBase );
+
+        timeBase.time += timeBase.deltaTime;
+    }
+
+    CORE_CHECK( numMessagesReceived == NumMessagesSent );
+    CORE_CHECK( messageChannel->GetCounter( protocol::RELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_EARLY ) == 0 );
+    CORE_CHECK( !messageChannel->GetReceiveLargeBlockStatus().receiving );
+
+    return iteration + 1;
+}
+
+void test_reliable_message_channel_large_block_window()
+{
+    printf( "test_reliable_message_channel_large_block_window\n" );
+
+    core::memory::initialize();
+    {
+        // one fragment per packet and one block at a time is how large blocks used to be sent
+
+        const int singleFragmentPackets = transfer_large_blocks( 1, 1 );
+
+        const int concurrentBlockPackets = transfer_large_blocks( 1, 4 );
+
+        const int windowPackets = transfer_large_blocks( 6, 4 );
+
+//        printf( "%d packets, %d packets with concurrent blocks, %d packets with fragment window\n", singleFragmentPackets, concurrentBlockPackets, windowPackets );
+
+        CORE_CHECK( concurrentBlockPackets <= singleFragmentPackets );
+        CORE_CHECK( windowPackets * 4 < singleFragmentPackets );
+    }
+    core::memory::shutdown();
+}
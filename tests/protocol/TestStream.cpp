@@ -1,5 +1,8 @@
 #include "protocol/Object.h"
 #include "protocol/Stream.h"
+#include "protocol/RangeStream.h"
+#include "protocol/PacketBuffer.h"
+#include "core/Memory.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -14,6 +17,7 @@ struct TestObject : public protocol::Object
     bool g;
     int numItems;
     int items[MaxItems];
+    uint32_t values[MaxItems];
 
     TestObject()
     {
@@ -26,6 +30,7 @@ struct TestObject : public protocol::Object
         g = false;
         numItems = 0;
         memset( items, 0, sizeof(items) );
+        memset( values, 0, sizeof(values) );
     }
 
     void Init()
@@ -40,6 +45,8 @@ struct TestObject : public protocol::Object
         numItems = MaxItems / 2;
         for ( int i = 0; i < numItems; ++i )
             items[i] = i + 10;        
+        for ( int i = 0; i < MaxItems; ++i )
+            values[i] = i * 1000;
     }
 
     PROTOCOL_SERIALIZE_OBJECT( stream )
@@ -57,6 +64,8 @@ struct TestObject : public protocol::Object
         serialize_int( stream, numItems, 0, MaxItems - 1 );
         for ( int i = 0; i < numItems; ++i )
             serialize_bits( stream, items[i], 8 );
+
+        serialize_bits_array( stream, values, MaxItems, 14 );
     }
 };
 
@@ -98,6 +107,8 @@ void test_stream()
     CORE_CHECK( readObject.numItems == writeObject.numItems );
     for ( int i = 0; i < readObject.numItems; ++i )
         CORE_CHECK( readObject.items[i] == writeObject.items[i] );
+    for ( int i = 0; i < MaxItems; ++i )
+        CORE_CHECK( readObject.values[i] == writeObject.values[i] );
 }
 
 struct ContextA
@@ -203,3 +214,393 @@ void test_stream_context()
     CORE_CHECK( readObject.a == writeObject.a );
     CORE_CHECK( readObject.b == writeObject.b );
 }
+
+struct TestSliceObject : public protocol::Object
+{
+    int a;
+    protocol::Block block;
+    uint8_t * fragment;
+    core::Allocator * fragmentAllocator;
+
+    static const int FragmentSize = 37;
+
+    TestSliceObject()
+    {
+        a = 0;
+        fragment = nullptr;
+        fragmentAllocator = &core::memory::default_allocator();
+        block.SetAllocator( core::memory::default_allocator() );
+    }
+
+    ~TestSliceObject()
+    {
+        if ( fragment )
+            fragmentAllocator->Free( fragment );
+    }
+
+    PROTOCOL_SERIALIZE_OBJECT( stream )
+    {
+        // odd sized values so the block and fragment do not start on word boundaries
+
+        serialize_int( stream, a, 0, 100 );
+        serialize_block( stream, block, 1024 );
+        serialize_owned_bytes( stream, fragment, FragmentSize, fragmentAllocator );
+    }
+};
+
+void test_stream_packet_buffer()
+{
+    printf( "test_stream_packet_buffer\n" );
+
+    core::memory::initialize();
+    {
+        const int BufferSize = 256;
+
+        uint8_t buffer[BufferSize];
+
+        TestSliceObject writeObject;
+        writeObject.a = 42;
+        writeObject.block.Connect( core::memory::default_allocator(), (uint8_t*) core::memory::default_allocator().Allocate( 101 ), 101 );
+        for ( int i = 0; i < 101; ++i )
+            writeObject.block.GetData()[i] = i + 1;
+        writeObject.fragment = (uint8_t*) core::memory::default_allocator().Allocate( TestSliceObject::FragmentSize );
+        for ( int i = 0; i < TestSliceObject::FragmentSize; ++i )
+            writeObject.fragment[i] = 200 - i;
+        {
+            protocol::WriteStream writeStream( buffer, BufferSize );
+            writeObject.SerializeWrite( writeStream );
+            writeStream.Flush();
+        }
+
+        // read without a packet buffer: block and fragment are copies
+
+        {
+            TestSliceObject readObject;
+            protocol::ReadStream readStream( buffer, BufferSize );
+            readObject.SerializeRead( readStream );
+            CORE_CHECK( !readStream.IsOverflow() );
+            CORE_CHECK( readObject.block.GetAllocator() == &core::memory::default_allocator() );
+            CORE_CHECK( readObject.fragmentAllocator == &core::memory::default_allocator() );
+        }
+
+        // read from a packet buffer: block and fragment are slices holding references to it
+
+        protocol::PacketBuffer * packetBuffer = protocol::PacketBuffer::Create( core::memory::default_allocator(), BufferSize );
+        memcpy( packetBuffer->GetData(), buffer, BufferSize );
+
+        TestSliceObject * readObject = CORE_NEW( core::memory::default_allocator(), TestSliceObject );
+        {
+            protocol::ReadStream readStream( packetBuffer->GetData(), BufferSize );
+            readStream.SetPacketBuffer( packetBuffer );
+            readObject->SerializeRead( readStream );
+            CORE_CHECK( !readStream.IsOverflow() );
+        }
+
+        CORE_CHECK( packetBuffer->GetRefCount() == 3 );
+        CORE_CHECK( readObject->block.GetAllocator() == packetBuffer );
+        CORE_CHECK( readObject->fragmentAllocator == packetBuffer );
+        CORE_CHECK( packetBuffer->Contains( readObject->block.GetData() ) );
+        CORE_CHECK( packetBuffer->Contains( readObject->fragment ) );
+
+        // the slices stay valid after the receiver drops its reference
+
+        packetBuffer->Release();
+
+        CORE_CHECK( readObject->a == 42 );
+        CORE_CHECK( readObject->block.GetSize() == 101 );
+        for ( int i = 0; i < 101; ++i )
+            CORE_CHECK( readObject->block.GetData()[i] == i + 1 );
+        for ( int i = 0; i < TestSliceObject::FragmentSize; ++i )
+            CORE_CHECK( readObject->fragment[i] == 200 - i );
+
+        // destroying the object releases the last references and frees the packet buffer
+
+        CORE_DELETE( core::memory::default_allocator(), TestSliceObject, readObject );
+
+        // a block that reads past the end of the packet buffer is not connected to it
+
+        packetBuffer = protocol::PacketBuffer::Create( core::memory::default_allocator(), 64 );
+        memcpy( packetBuffer->GetData(), buffer, 64 );
+        {
+            TestSliceObject overflowObject;
+            protocol::ReadStream readStream( packetBuffer->GetData(), 64 );
+            readStream.SetPacketBuffer( packetBuffer );
+            overflowObject.SerializeRead( readStream );
+            CORE_CHECK( readStream.IsOverflow() );
+            CORE_CHECK( !overflowObject.block.IsValid() );
+        }
+        CORE_CHECK( packetBuffer->GetRefCount() == 1 );
+        packetBuffer->Release();
+    }
+    core::memory::shutdown();
+}
+
+struct TestAdjacentSliceObject : public protocol::Object
+{
+    protocol::Block a;
+    int value;
+    protocol::Block b;
+
+    TestAdjacentSliceObject()
+    {
+        value = 0;
+        a.SetAllocator( core::memory::default_allocator() );
+        b.SetAllocator( core::memory::default_allocator() );
+    }
+
+    PROTOCOL_SERIALIZE_OBJECT( stream )
+    {
+        serialize_block( stream, a, 16 );
+        serialize_int( stream, value, 0, 255 );
+        serialize_block( stream, b, 16 );
+    }
+};
+
+void test_stream_packet_buffer_adjacent_slices()
+{
+    printf( "test_stream_packet_buffer_adjacent_slices\n" );
+
+    core::memory::initialize();
+    {
+        // small in place reads back to back share partial words, which must only be reordered once
+
+        const int BufferSize = 64;
+
+        for ( int sizeA = 1; sizeA <= 9; ++sizeA )
+        {
+            for ( int sizeB = 1; sizeB <= 9; ++sizeB )
+            {
+                uint8_t buffer[BufferSize];
+                memset( buffer, 0, BufferSize );
+
+                {
+                    TestAdjacentSliceObject writeObject;
+                    writeObject.value = 100;
+                    writeObject.a.Connect( core::memory::default_allocator(), (uint8_t*) core::memory::default_allocator().Allocate( sizeA ), sizeA );
+                    writeObject.b.Connect( core::memory::default_allocator(), (uint8_t*) core::memory::default_allocator().Allocate( sizeB ), sizeB );
+                    for ( int i = 0; i < sizeA; ++i )
+                        writeObject.a.GetData()[i] = 10 + i;
+                    for ( int i = 0; i < sizeB; ++i )
+                        writeObject.b.GetData()[i] = 20 + i;
+                    protocol::WriteStream writeStream( buffer, BufferSize );
+                    writeObject.SerializeWrite( writeStream );
+                    writeStream.Flush();
+                }
+
+                protocol::PacketBuffer * packetBuffer = protocol::PacketBuffer::Create( core::memory::default_allocator(), BufferSize );
+                memcpy( packetBuffer->GetData(), buffer, BufferSize );
+
+                {
+                    TestAdjacentSliceObject readObject;
+                    {
+                        protocol::ReadStream readStream( packetBuffer->GetData(), BufferSize );
+                        readStream.SetPacketBuffer( packetBuffer );
+                        readObject.SerializeRead( readStream );
+                        CORE_CHECK( !readStream.IsOverflow() );
+                    }
+
+                    CORE_CHECK( readObject.a.GetAllocator() == packetBuffer );
+                    CORE_CHECK( readObject.b.GetAllocator() == packetBuffer );
+                    CORE_CHECK( readObject.value == 100 );
+                    CORE_CHECK( readObject.a.GetSize() == sizeA );
+                    CORE_CHECK( readObject.b.GetSize() == sizeB );
+                    for ( int i = 0; i < sizeA; ++i )
+                        CORE_CHECK( readObject.a.GetData()[i] == 10 + i );
+                    for ( int i = 0; i < sizeB; ++i )
+                        CORE_CHECK( readObject.b.GetData()[i] == 20 + i );
+
+                    packetBuffer->Release();
+                }
+            }
+        }
+    }
+    core::memory::shutdown();
+}
+
+const int NumDeltas = 256;
+const int DeltaBound = 256;
+
+struct TestDeltaObject : public protocol::Object
+{
+    int deltas[NumDeltas];
+
+    TestDeltaObject()
+    {
+        memset( deltas, 0, sizeof( deltas ) );
+    }
+
+    PROTOCOL_SERIALIZE_OBJECT( stream )
+    {
+        for ( int i = 0; i < NumDeltas; ++i )
+            serialize_int( stream, deltas[i], -DeltaBound, DeltaBound - 1 );
+    }
+};
+
+static int random_delta()
+{
+    // mostly small deltas, like positions of cubes that are moving slowly
+
+    int delta = 0;
+    while ( delta < DeltaBound - 1 && ( rand() % 2 ) != 0 )
+        delta++;
+    return ( rand() % 2 ) ? delta : -delta;
+}
+
+void test_range_stream()
+{
+    printf( "test_range_stream\n" );
+
+    core::memory::initialize();
+    {
+        const int BufferSize = 1024;
+
+        uint8_t buffer[BufferSize];
+
+        // without models the range stream codes everything uniformly
+
+        TestObject writeObject;
+        writeObject.Init();
+
+        int bitpackedBytes = 0;
+        {
+            protocol::WriteStream writeStream( buffer, BufferSize );
+            writeObject.SerializeWrite( writeStream );
+            writeStream.Flush();
+            bitpackedBytes = writeStream.GetBytesProcessed();
+        }
+
+        int rangeBytes = 0;
+        {
+            protocol::RangeWriteStream writeStream( buffer, BufferSize );
+            serialize_object( writeStream, writeObject );
+            writeStream.Flush();
+            CORE_CHECK( !writeStream.IsOverflow() );
+            rangeBytes = writeStream.GetBytesProcessed();
+        }
+
+        CORE_CHECK( rangeBytes <= bitpackedBytes + 4 );
+
+        TestObject readObject;
+        {
+            protocol::RangeReadStream readStream( buffer, rangeBytes );
+            serialize_object( readStream, readObject );
+            CORE_CHECK( !readStream.IsOverflow() );
+        }
+
+        CORE_CHECK( readObject.a == writeObject.a );
+        CORE_CHECK( readObject.b == writeObject.b );
+        CORE_CHECK( readObject.c == writeObject.c );
+        CORE_CHECK( readObject.d == writeObject.d );
+        CORE_CHECK( readObject.e == writeObject.e );
+        CORE_CHECK( readObject.f == writeObject.f );
+        CORE_CHECK( readObject.g == writeObject.g );
+        CORE_CHECK( readObject.numItems == writeObject.numItems );
+        for ( int i = 0; i < readObject.numItems; ++i )
+            CORE_CHECK( readObject.items[i] == writeObject.items[i] );
+        for ( int i = 0; i < MaxItems; ++i )
+            CORE_CHECK( readObject.values[i] == writeObject.values[i] );
+
+        // build a model from a histogram of absolute deltas, in the format written by DumpDeltaAccumulators
+
+        const char * histogramFilename = "test_range_stream_histogram.txt";
+        {
+            uint64_t histogram[DeltaBound];
+            memset( histogram, 0, sizeof( histogram ) );
+            for ( int i = 0; i < 100000; ++i )
+                histogram[abs( random_delta() )]++;
+
+            FILE * file = fopen( histogramFilename, "w" );
+            CORE_CHECK( file );
+            for ( int i = 0; i < DeltaBound; ++i )
+                fprintf( file, "%d,%llu,%d\n", i, (unsigned long long) histogram[i], i );
+            fclose( file );
+        }
+
+        uint64_t histogram[DeltaBound];
+        CORE_CHECK( protocol::LoadDeltaHistogram( histogramFilename, 1, histogram, DeltaBound ) == DeltaBound );
+        CORE_CHECK( protocol::LoadDeltaHistogram( "missing_histogram.txt", 1, histogram, DeltaBound ) == -1 );
+        remove( histogramFilename );
+
+        uint64_t counts[DeltaBound*2];
+        protocol::GetSignedDeltaCounts( histogram, DeltaBound, -DeltaBound, DeltaBound - 1, counts );
+
+        protocol::RangeModel model( core::memory::default_allocator(), -DeltaBound, DeltaBound - 1, counts );
+
+        CORE_CHECK( model.GetNumSymbols() == DeltaBound * 2 );
+        CORE_CHECK( model.GetCost( DeltaBound ) < model.GetCost( DeltaBound + 10 ) );
+        for ( int i = 0; i < model.GetNumSymbols(); ++i )
+        {
+            CORE_CHECK( model.GetFrequency( i ) > 0 );
+            CORE_CHECK( model.FindSymbol( model.GetCumulative( i ) ) == i );
+        }
+
+        protocol::RangeModelSet models;
+        models.Add( model );
+
+        CORE_CHECK( models.Find( -DeltaBound, DeltaBound - 1 ) == &model );
+        CORE_CHECK( models.Find( 0, DeltaBound - 1 ) == nullptr );
+
+        for ( int iteration = 0; iteration < 16; ++iteration )
+        {
+            TestDeltaObject writeDeltas;
+            for ( int i = 0; i < NumDeltas; ++i )
+                writeDeltas.deltas[i] = random_delta();
+
+            // rare values must still code, including the extremes
+
+            writeDeltas.deltas[0] = -DeltaBound;
+            writeDeltas.deltas[1] = DeltaBound - 1;
+
+            {
+                protocol::WriteStream writeStream( buffer, BufferSize );
+                writeDeltas.SerializeWrite( writeStream );
+                writeStream.Flush();
+                bitpackedBytes = writeStream.GetBytesProcessed();
+            }
+
+            {
+                protocol::RangeWriteStream writeStream( buffer, BufferSize, &models );
+                serialize_object( writeStream, writeDeltas );
+                writeStream.Flush();
+                CORE_CHECK( !writeStream.IsOverflow() );
+                rangeBytes = writeStream.GetBytesProcessed();
+            }
+
+            CORE_CHECK( rangeBytes * 2 < bitpackedBytes );
+
+            TestDeltaObject readDeltas;
+            {
+                protocol::RangeReadStream readStream( buffer, rangeBytes, &models );
+                serialize_object( readStream, readDeltas );
+                CORE_CHECK( !readStream.IsOverflow() );
+                CORE_CHECK( !readStream.Aborted() );
+            }
+
+            for ( int i = 0; i < NumDeltas; ++i )
+                CORE_CHECK( readDeltas.deltas[i] == writeDeltas.deltas[i] );
+        }
+
+        // too small a buffer overflows, and garbage reads back as values in range
+
+        {
+            TestDeltaObject writeDeltas;
+            for ( int i = 0; i < NumDeltas; ++i )
+                writeDeltas.deltas[i] = random_delta();
+            protocol::RangeWriteStream writeStream( buffer, 16, &models );
+            serialize_object( writeStream, writeDeltas );
+            writeStream.Flush();
+            CORE_CHECK( writeStream.IsOverflow() );
+        }
+
+        for ( int i = 0; i < BufferSize; ++i )
+            buffer[i] = uint8_t( rand() );
+        {
+            TestDeltaObject readDeltas;
+            protocol::RangeReadStream readStream( buffer, BufferSize, &models );
+            serialize_object( readStream, readDeltas );
+            for ( int i = 0; i < NumDeltas; ++i )
+                CORE_CHECK( readDeltas.deltas[i] >= -DeltaBound && readDeltas.deltas[i] <= DeltaBound - 1 );
+        }
+    }
+    core::memory::shutdown();
+}
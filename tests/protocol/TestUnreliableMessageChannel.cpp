@@ -0,0 +1,301 @@
+#include "protocol/Connection.h"
+#include "protocol/UnreliableMessageChannel.h"
+#include "TestMessages.h"
+#include "TestPackets.h"
+
+class UnreliableChannelStructure : public protocol::ChannelStructure
+{
+    protocol::UnreliableMessageChannelConfig m_config;
+    protocol::UnreliableMessageChannelConfig m_sequencedConfig;
+
+public:
+
+    UnreliableChannelStructure( TestMessageFactory & messageFactory, int packetBudget = 0 )
+        : ChannelStructure( core::memory::default_allocator(), core::memory::scratch_allocator(), 2 )
+    {
+        m_config.messageFactory = &messageFactory;
+        m_config.smallBlockAllocator = &core::memory::default_allocator();
+        if ( packetBudget > 0 )
+            m_config.packetBudget = packetBudget;
+
+        m_sequencedConfig = m_config;
+        m_sequencedConfig.sequenced = true;
+    }
+
+protected:
+
+    const char * GetChannelNameInternal( int channelIndex ) const
+    {
+        return channelIndex == 0 ? "unreliable message channel" : "unreliable sequenced message channel";
+    }
+
+    protocol::Channel * CreateChannelInternal( int channelIndex )
+    {
+        return CORE_NEW( GetChannelAllocator(), protocol::UnreliableMessageChannel, channelIndex == 0 ? m_config : m_sequencedConfig );
+    }
+
+    protocol::ChannelData * CreateChannelDataInternal( int channelIndex )
+    {
+        return CORE_NEW( GetChannelDataAllocator(), protocol::UnreliableMessageChannelData, channelIndex == 0 ? m_config : m_sequencedConfig );
+    }
+};
+
+static protocol::ConnectionPacket * serialize_packet( protocol::ConnectionPacket * packet, TestPacketFactory & packetFactory, const void ** context )
+{
+    const int MaxPacketSize = 1024;
+
+    uint8_t buffer[MaxPacketSize];
+
+    protocol::WriteStream writeStream( buffer, MaxPacketSize );
+    writeStream.SetContext( context );
+    packet->SerializeWrite( writeStream );
+    writeStream.Flush();
+    CORE_CHECK( !writeStream.IsOverflow() );
+
+    packetFactory.Destroy( packet );
+
+    auto readPacket = (protocol::ConnectionPacket*) packetFactory.Create( PACKET_CONNECTION );
+
+    protocol::ReadStream readStream( buffer, MaxPacketSize );
+    readStream.SetContext( context );
+    readPacket->SerializeRead( readStream );
+    CORE_CHECK( !readStream.IsOverflow() );
+
+    return readPacket;
+}
+
+void test_unreliable_message_channel_messages()
+{
+    printf( "test_unreliable_message_channel_messages\n" );
+
+    core::memory::initialize();
+    {
+        TestMessageFactory messageFactory( core::memory::default_allocator() );
+
+        UnreliableChannelStructure channelStructure( messageFactory );
+
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const void * context[protocol::MaxContexts];
+        memset( context, 0, sizeof( context ) );
+        context[protocol::CONTEXT_CONNECTION] = &channelStructure;
+
+        protocol::ConnectionConfig connectionConfig;
+        connectionConfig.packetFactory = &packetFactory;
+        connectionConfig.channelStructure = &channelStructure;
+        connectionConfig.context = context;
+
+        protocol::Connection sender( connectionConfig );
+        protocol::Connection receiver( connectionConfig );
+
+        auto senderChannel = static_cast<protocol::UnreliableMessageChannel*>( sender.GetChannel( 0 ) );
+        auto receiverChannel = static_cast<protocol::UnreliableMessageChannel*>( receiver.GetChannel( 0 ) );
+
+        const int NumIterations = 1000;
+        const int NumMessagesSent = NumIterations * 4;
+
+        uint16_t sendSequence = 0;
+        int numMessagesReceived = 0;
+        int lastSequenceReceived = -1;
+
+        for ( int i = 0; i < NumIterations; ++i )
+        {
+            for ( int j = 0; j < 4; ++j )
+            {
+                CORE_CHECK( senderChannel->CanSendMessage() );
+
+                if ( j == 3 )
+                {
+                    protocol::Block block( core::memory::default_allocator(), 1 + sendSequence % 32 );
+                    memset( block.GetData(), sendSequence & 0xFF, block.GetSize() );
+                    senderChannel->SendBlock( block );
+                }
+                else
+                {
+                    auto message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+                    message->sequence = sendSequence;
+                    senderChannel->SendMessage( message );
+                }
+
+                sendSequence++;
+            }
+
+            protocol::ConnectionPacket * packet = sender.WritePacket();
+            CORE_CHECK( packet );
+
+            packet = serialize_packet( packet, packetFactory, context );
+
+            if ( rand() % 10 )
+                receiver.ReadPacket( packet );
+
+            packetFactory.Destroy( packet );
+
+            // messages arrive in send order, with gaps where packets were lost
+
+            while ( protocol::Message * message = receiverChannel->ReceiveMessage() )
+            {
+                if ( message->GetType() == MESSAGE_TEST )
+                {
+                    const int sequence = static_cast<TestMessage*>( message )->sequence;
+                    CORE_CHECK( sequence > lastSequenceReceived );
+                    lastSequenceReceived = sequence;
+                }
+                else
+                {
+                    CORE_CHECK( message->GetType() == MESSAGE_BLOCK );
+                    protocol::Block & block = static_cast<protocol::BlockMessage*>( message )->GetBlock();
+                    CORE_CHECK( block.GetSize() == 1 + block.GetData()[0] % 32 );
+                    for ( int j = 1; j < block.GetSize(); ++j )
+                        CORE_CHECK( block.GetData()[j] == block.GetData()[0] );
+                }
+
+                numMessagesReceived++;
+
+                messageFactory.Release( message );
+            }
+        }
+
+        CORE_CHECK( senderChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_SENT ) == NumMessagesSent );
+        CORE_CHECK( senderChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_WRITTEN ) == NumMessagesSent );
+        CORE_CHECK( senderChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_SEND_QUEUE_FULL ) == 0 );
+        CORE_CHECK( receiverChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_RECEIVED ) == uint64_t( numMessagesReceived ) );
+        CORE_CHECK( numMessagesReceived > NumMessagesSent / 2 );
+        CORE_CHECK( numMessagesReceived < NumMessagesSent );
+    }
+    core::memory::shutdown();
+}
+
+void test_unreliable_message_channel_sequenced()
+{
+    printf( "test_unreliable_message_channel_sequenced\n" );
+
+    core::memory::initialize();
+    {
+        TestMessageFactory messageFactory( core::memory::default_allocator() );
+
+        UnreliableChannelStructure channelStructure( messageFactory );
+
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const void * context[protocol::MaxContexts];
+        memset( context, 0, sizeof( context ) );
+        context[protocol::CONTEXT_CONNECTION] = &channelStructure;
+
+        protocol::ConnectionConfig connectionConfig;
+        connectionConfig.packetFactory = &packetFactory;
+        connectionConfig.channelStructure = &channelStructure;
+        connectionConfig.context = context;
+
+        protocol::Connection sender( connectionConfig );
+        protocol::Connection receiver( connectionConfig );
+
+        const int NumPackets = 3;
+
+        protocol::ConnectionPacket * packets[NumPackets];
+
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            for ( int channelIndex = 0; channelIndex < 2; ++channelIndex )
+            {
+                auto message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+                message->sequence = i;
+                static_cast<protocol::UnreliableMessageChannel*>( sender.GetChannel( channelIndex ) )->SendMessage( message );
+            }
+
+            packets[i] = serialize_packet( sender.WritePacket(), packetFactory, context );
+        }
+
+        // deliver the newest packet first. the unordered channel takes everything,
+        // the sequenced channel drops messages from packets older than the newest
+
+        receiver.ReadPacket( packets[2] );
+        receiver.ReadPacket( packets[0] );
+        receiver.ReadPacket( packets[1] );
+
+        for ( int i = 0; i < NumPackets; ++i )
+            packetFactory.Destroy( packets[i] );
+
+        auto unorderedChannel = static_cast<protocol::UnreliableMessageChannel*>( receiver.GetChannel( 0 ) );
+        auto sequencedChannel = static_cast<protocol::UnreliableMessageChannel*>( receiver.GetChannel( 1 ) );
+
+        const int expectedUnordered[] = { 2, 0, 1 };
+        for ( int i = 0; i < NumPackets; ++i )
+        {
+            auto message = static_cast<TestMessage*>( unorderedChannel->ReceiveMessage() );
+            CORE_CHECK( message );
+            CORE_CHECK( message->sequence == expectedUnordered[i] );
+            messageFactory.Release( message );
+        }
+        CORE_CHECK( unorderedChannel->ReceiveMessage() == nullptr );
+
+        auto message = static_cast<TestMessage*>( sequencedChannel->ReceiveMessage() );
+        CORE_CHECK( message );
+        CORE_CHECK( message->sequence == 2 );
+        messageFactory.Release( message );
+        CORE_CHECK( sequencedChannel->ReceiveMessage() == nullptr );
+
+        CORE_CHECK( unorderedChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_LATE ) == 0 );
+        CORE_CHECK( sequencedChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_LATE ) == 2 );
+        CORE_CHECK( sequencedChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_READ ) == 3 );
+    }
+    core::memory::shutdown();
+}
+
+void test_unreliable_message_channel_too_large()
+{
+    printf( "test_unreliable_message_channel_too_large\n" );
+
+    core::memory::initialize();
+    {
+        TestMessageFactory messageFactory( core::memory::default_allocator() );
+
+        // a max size small block doesn't fit in a 32 byte packet budget
+
+        UnreliableChannelStructure channelStructure( messageFactory, 32 );
+
+        TestPacketFactory packetFactory( core::memory::default_allocator() );
+
+        const void * context[protocol::MaxContexts];
+        memset( context, 0, sizeof( context ) );
+        context[protocol::CONTEXT_CONNECTION] = &channelStructure;
+
+        protocol::ConnectionConfig connectionConfig;
+        connectionConfig.packetFactory = &packetFactory;
+        connectionConfig.channelStructure = &channelStructure;
+        connectionConfig.context = context;
+
+        protocol::Connection sender( connectionConfig );
+        protocol::Connection receiver( connectionConfig );
+
+        auto senderChannel = static_cast<protocol::UnreliableMessageChannel*>( sender.GetChannel( 0 ) );
+        auto receiverChannel = static_cast<protocol::UnreliableMessageChannel*>( receiver.GetChannel( 0 ) );
+
+        // the oversize block is dropped rather than queued, so the message behind it still goes out
+
+        protocol::Block block( core::memory::default_allocator(), 64 );
+        memset( block.GetData(), 0, block.GetSize() );
+        senderChannel->SendBlock( block );
+
+        auto message = (TestMessage*) messageFactory.Create( MESSAGE_TEST );
+        message->sequence = 3;                              // a few bits of payload, see GetNumBitsForMessage
+        senderChannel->SendMessage( message );
+
+        CORE_CHECK( senderChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_TOO_LARGE ) == 1 );
+        CORE_CHECK( senderChannel->GetCounter( protocol::UNRELIABLE_MESSAGE_CHANNEL_COUNTER_MESSAGES_SENT ) == 1 );
+
+        protocol::ConnectionPacket * packet = serialize_packet( sender.WritePacket(), packetFactory, context );
+        CORE_CHECK( packet );
+        receiver.ReadPacket( packet );
+        packetFactory.Destroy( packet );
+
+        CORE_CHECK( !senderChannel->HasDataToSend() );
+
+        auto receivedMessage = static_cast<TestMessage*>( receiverChannel->ReceiveMessage() );
+        CORE_CHECK( receivedMessage );
+        CORE_CHECK( receivedMessage->GetType() == MESSAGE_TEST );
+        CORE_CHECK( receivedMessage->sequence == 3 );
+        messageFactory.Release( receivedMessage );
+        CORE_CHECK( receiverChannel->ReceiveMessage() == nullptr );
+    }
+    core::memory::shutdown();
+}
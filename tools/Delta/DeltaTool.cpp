@@ -0,0 +1,174 @@
+/*
+    Delta Tool
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "core/Core.h"
+#include "core/Memory.h"
+#include "protocol/DeltaTable.h"
+#include "protocol/RangeCoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    Turns delta histograms written by DumpDeltaAccumulators (DeltaDemo with DELTA_STATS)
+    into a header of constexpr bounds, so delta encoders are tuned from captured traffic:
+
+        DeltaTool src/game/DeltaTables.h RelativePosition:output/delta_position.txt RelativeOrientation:output/delta_smallest_three.txt
+
+    For each name this writes <name>Bound_Small and <name>Bound_Large for serialize_offset
+    style coding. The cost of a serialize_delta bucket table is printed alongside so the two
+    can be compared, but the table itself is not written until an encoder uses one. All
+    columns of a histogram file are added together.
+*/
+
+const int MaxHistogramEntries = 1024;
+const int MaxColumns = 4;
+const int DefaultFallbackBits = 18;
+
+struct DeltaTable
+{
+    char name[256];
+    const char * filename;
+    uint64_t samples;
+    int smallBound;
+    int largeBound;
+    float boundsCost;
+    float bucketsCost;
+    protocol::DeltaBucketTable buckets;
+};
+
+static bool build_delta_table( char * argument, DeltaTable & table )
+{
+    char * separator = strchr( argument, ':' );
+    if ( !separator )
+        return false;
+
+    *separator = '\0';
+    strncpy( table.name, argument, sizeof( table.name ) - 1 );
+    table.name[sizeof(table.name)-1] = '\0';
+    table.filename = separator + 1;
+
+    uint64_t histogram[MaxHistogramEntries];
+    memset( histogram, 0, sizeof( histogram ) );
+
+    int entries = 0;
+
+    for ( int column = 0; column < MaxColumns; ++column )
+    {
+        uint64_t columnHistogram[MaxHistogramEntries];
+        const int columnEntries = protocol::LoadDeltaHistogram( table.filename, column, columnHistogram, MaxHistogramEntries );
+        if ( columnEntries < 0 )
+        {
+            printf( "error: failed to load histogram \"%s\"\n", table.filename );
+            return false;
+        }
+
+        if ( columnEntries == 0 )
+            break;
+
+        for ( int i = 0; i < columnEntries; ++i )
+            histogram[i] += columnHistogram[i];
+
+        entries = core::max( entries, columnEntries );
+    }
+
+    if ( entries == 0 )
+    {
+        printf( "error: histogram \"%s\" is empty\n", table.filename );
+        return false;
+    }
+
+    table.samples = 0;
+    for ( int i = 0; i < entries; ++i )
+        table.samples += histogram[i];
+
+    table.boundsCost = protocol::FindDeltaBounds( histogram, entries, DefaultFallbackBits, table.smallBound, table.largeBound );
+    table.bucketsCost = protocol::BuildDeltaBucketTable( histogram, entries, protocol::MaxDeltaBuckets, table.buckets );
+
+    printf( "%s: %llu samples, %.2f bits per delta with bounds %d/%d, %.2f bits per delta with %d buckets\n", 
+        table.name, (unsigned long long) table.samples, table.boundsCost, table.smallBound, table.largeBound, table.bucketsCost, table.buckets.numBuckets );
+
+    return true;
+}
+
+static void write_delta_table( FILE * file, const DeltaTable & table )
+{
+    fprintf( file, "// %s: %llu samples, %.2f bits per delta\n\n", table.filename, (unsigned long long) table.samples, table.boundsCost );
+
+    fprintf( file, "constexpr int %sBound_Small = %d;\n", table.name, table.smallBound );
+    fprintf( file, "constexpr int %sBound_Large = %d;\n\n", table.name, table.largeBound );
+}
+
+int main( int argc, char * argv[] )
+{
+    if ( argc < 3 )
+    {
+        printf( "usage: DeltaTool <output header> <name>:<histogram file> [<name>:<histogram file> ...]\n" );
+        return 1;
+    }
+
+    core::memory::initialize();
+
+    int result = 0;
+
+    {
+        const int numTables = argc - 2;
+
+        DeltaTable * tables = (DeltaTable*) malloc( sizeof( DeltaTable ) * numTables );
+
+        for ( int i = 0; i < numTables && result == 0; ++i )
+        {
+            if ( !build_delta_table( argv[i+2], tables[i] ) )
+            {
+                printf( "error: bad argument \"%s\"\n", argv[i+2] );
+                result = 1;
+            }
+        }
+
+        if ( result == 0 )
+        {
+            FILE * file = fopen( argv[1], "w" );
+            if ( file )
+            {
+                fprintf( file, "// Generated by DeltaTool from DeltaDemo delta histograms. Do not edit by hand, regenerate instead.\n\n" );
+                fprintf( file, "#ifndef GAME_DELTA_TABLES_H\n#define GAME_DELTA_TABLES_H\n\n" );
+                for ( int i = 0; i < numTables; ++i )
+                    write_delta_table( file, tables[i] );
+                fprintf( file, "#endif\n" );
+                fclose( file );
+            }
+            else
+            {
+                printf( "error: failed to write \"%s\"\n", argv[1] );
+                result = 1;
+            }
+        }
+
+        free( tables );
+    }
+
+    core::memory::shutdown();
+
+    return result;
+}
@@ -0,0 +1,124 @@
+/*
+    Dictionary Tool
+
+    Copyright © 2008 - 2016, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "core/Core.h"
+#include "core/Memory.h"
+#include "network/Compressor.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    Trains a packet compression dictionary from a packet capture.
+
+    Capture packets by running with BSDSocketConfig::capture set (eg. ProfileClientServer --capture <file>),
+    then load the dictionary and pass it in BSDSocketConfig::compressionDictionary on both sides.
+*/
+
+const int MaxPackets = 64 * 1024;
+const int MaxPacketSize = 4096;
+const int DefaultDictionaryBytes = 4096;
+
+int main( int argc, char * argv[] )
+{
+    if ( argc < 3 )
+    {
+        printf( "usage: DictionaryTool <capture file> <dictionary file> [dictionary bytes]\n" );
+        return 1;
+    }
+
+    const char * captureFilename = argv[1];
+    const char * dictionaryFilename = argv[2];
+    const int maxDictionaryBytes = argc > 3 ? atoi( argv[3] ) : DefaultDictionaryBytes;
+
+    if ( maxDictionaryBytes <= 0 )
+    {
+        printf( "error: bad dictionary size\n" );
+        return 1;
+    }
+
+    core::memory::initialize();
+
+    int result = 1;
+
+    {
+        network::PacketCapture capture( core::memory::default_allocator(), MaxPackets, MaxPacketSize );
+
+        uint8_t * dictionary = (uint8_t*) malloc( maxDictionaryBytes );
+
+        if ( !capture.Load( captureFilename ) )
+        {
+            printf( "error: failed to load capture \"%s\"\n", captureFilename );
+        }
+        else
+        {
+            const int dictionaryBytes = network::TrainDictionary( capture, dictionary, maxDictionaryBytes );
+
+            // report how well the capture compresses with and without the dictionary
+
+            network::Compressor compressor( core::memory::default_allocator() );
+            network::Compressor dictionaryCompressor( core::memory::default_allocator(), dictionary, dictionaryBytes );
+
+            uint8_t * compressed = (uint8_t*) malloc( network::Compressor::GetMaxCompressedBytes( MaxPacketSize ) );
+
+            uint64_t uncompressedBytes = 0;
+            uint64_t compressedBytes = 0;
+            uint64_t dictionaryCompressedBytes = 0;
+
+            for ( int i = 0; i < capture.GetNumPackets(); ++i )
+            {
+                const uint8_t * data = capture.GetPacketData( i );
+                const int bytes = capture.GetPacketBytes( i );
+                const int maxBytes = network::Compressor::GetMaxCompressedBytes( bytes );
+                uncompressedBytes += bytes;
+                compressedBytes += compressor.Compress( data, bytes, compressed, maxBytes );
+                dictionaryCompressedBytes += dictionaryCompressor.Compress( data, bytes, compressed, maxBytes );
+            }
+
+            free( compressed );
+
+            printf( "%d packets, %d byte dictionary\n", capture.GetNumPackets(), dictionaryBytes );
+
+            if ( uncompressedBytes > 0 )
+            {
+                printf( "compression ratio: %.3f without dictionary, %.3f with dictionary\n", 
+                    uncompressedBytes / double( compressedBytes ), 
+                    uncompressedBytes / double( dictionaryCompressedBytes ) );
+            }
+
+            FILE * file = fopen( dictionaryFilename, "wb" );
+            if ( file && fwrite( dictionary, dictionaryBytes, 1, file ) == 1 )
+                result = 0;
+            else
+                printf( "error: failed to write dictionary \"%s\"\n", dictionaryFilename );
+            if ( file )
+                fclose( file );
+        }
+
+        free( dictionary );
+    }
+
+    core::memory::shutdown();
+
+    return result;
+}